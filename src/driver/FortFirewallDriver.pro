@@ -6,10 +6,13 @@ QT = core
 
 SOURCES += \
     fortbuf.c \
+    fortbuf_path.c \
     fortcb.c \
     fortcnf.c \
+    fortcnf_cache.c \
     fortcnf_conf.c \
     fortcnf_rule.c \
+    fortcnf_scope.c \
     fortcnf_zone.c \
     fortcout.c \
     fortdbg.c \
@@ -47,10 +50,13 @@ SOURCES += \
 HEADERS += \
     evt/fortevt.h \
     fortbuf.h \
+    fortbuf_path.h \
     fortcb.h \
     fortcnf.h \
+    fortcnf_cache.h \
     fortcnf_conf.h \
     fortcnf_rule.h \
+    fortcnf_scope.h \
     fortcnf_zone.h \
     fortcout.h \
     fortcoutarg.h \
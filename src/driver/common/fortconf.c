@@ -7,18 +7,28 @@
 #include "fort_wildmatch.h"
 #include "fortdef.h"
 
+#if defined(_M_X64) || defined(__x86_64__)
+#    define FORT_CONF_SIMD_SSE2
+#    include <emmintrin.h>
+#elif defined(_M_ARM64) || defined(__aarch64__)
+#    define FORT_CONF_SIMD_NEON
+#    include <arm_neon.h>
+#endif
+
+/* Scan short lists linearly with SIMD instead of the binary search */
+#define FORT_CONF_LINEAR_FIND_MAX 16
+
 static_assert(sizeof(ip6_addr_t) == 16, "ip6_addr_t size mismatch");
 
 static_assert(sizeof(FORT_CONF_FLAGS) == sizeof(UINT64), "FORT_CONF_FLAGS size mismatch");
-static_assert(
-        sizeof(FORT_CONF_RULE_FILTER) == sizeof(UINT32), "FORT_CONF_RULE_FILTER size mismatch");
+static_assert(sizeof(FORT_CONF_RULE_OP) == 3 * sizeof(UINT32), "FORT_CONF_RULE_OP size mismatch");
 static_assert(sizeof(FORT_CONF_RULE_ZONES) == sizeof(UINT64), "FORT_CONF_RULE_ZONES size mismatch");
 static_assert(sizeof(FORT_CONF_RULE) == sizeof(UINT16), "FORT_CONF_RULE size mismatch");
 
 static_assert((FORT_CONF_RULE_GLOBAL_MAX + FORT_CONF_RULE_SET_MAX) < 256,
         "FORT_CONF_RULE_GLOBAL_MAX count mismatch");
 
-static_assert(sizeof(FORT_TRAF) == sizeof(UINT64), "FORT_TRAF size mismatch");
+static_assert(sizeof(FORT_TRAF) == 2 * sizeof(UINT64), "FORT_TRAF size mismatch");
 static_assert(sizeof(FORT_APP_FLAGS) == sizeof(UINT16), "FORT_APP_FLAGS size mismatch");
 static_assert(sizeof(FORT_APP_DATA) == 2 * sizeof(UINT64), "FORT_APP_DATA size mismatch");
 
@@ -106,6 +116,107 @@ static BOOL fort_conf_ip4_find(const UINT32 *iparr, UINT32 ip, UINT32 count, BOO
     return high >= 0 && ip >= iparr[high] && ip <= iparr[count + high];
 }
 
+static BOOL fort_conf_port_linear_find(
+        const UINT16 *port_arr, UINT16 port, UINT32 count, BOOL is_range)
+{
+    const UINT16 *to_arr = &port_arr[count];
+    UINT32 i = 0;
+
+#if defined(FORT_CONF_SIMD_SSE2)
+    const __m128i key = _mm_set1_epi16((short) port);
+
+    for (; i + 8 <= count; i += 8) {
+        const __m128i from = _mm_loadu_si128((const __m128i *) &port_arr[i]);
+        __m128i match;
+
+        if (is_range) {
+            const __m128i to = _mm_loadu_si128((const __m128i *) &to_arr[i]);
+
+            /* from <= port <= to, when both saturated differences are zero */
+            const __m128i out = _mm_or_si128(_mm_subs_epu16(from, key), _mm_subs_epu16(key, to));
+            match = _mm_cmpeq_epi16(out, _mm_setzero_si128());
+        } else {
+            match = _mm_cmpeq_epi16(from, key);
+        }
+
+        if (_mm_movemask_epi8(match) != 0)
+            return TRUE;
+    }
+#elif defined(FORT_CONF_SIMD_NEON)
+    const uint16x8_t key = vdupq_n_u16(port);
+
+    for (; i + 8 <= count; i += 8) {
+        const uint16x8_t from = vld1q_u16(&port_arr[i]);
+
+        const uint16x8_t match = is_range
+                ? vandq_u16(vcleq_u16(from, key), vcleq_u16(key, vld1q_u16(&to_arr[i])))
+                : vceqq_u16(from, key);
+
+        if (vmaxvq_u16(match) != 0)
+            return TRUE;
+    }
+#endif
+
+    for (; i < count; ++i) {
+        if (is_range ? (port >= port_arr[i] && port <= to_arr[i]) : (port == port_arr[i]))
+            return TRUE;
+    }
+
+    return FALSE;
+}
+
+static BOOL fort_conf_ip4_linear_find(const UINT32 *iparr, UINT32 ip, UINT32 count, BOOL is_range)
+{
+    const UINT32 *to_arr = &iparr[count];
+    UINT32 i = 0;
+
+#if defined(FORT_CONF_SIMD_SSE2)
+    /* SSE2 has signed comparison only: flip the sign bits */
+    const __m128i bias = _mm_set1_epi32((int) 0x80000000);
+    const __m128i key = _mm_set1_epi32((int) ip);
+    const __m128i key_biased = _mm_xor_si128(key, bias);
+
+    for (; i + 4 <= count; i += 4) {
+        const __m128i from = _mm_loadu_si128((const __m128i *) &iparr[i]);
+
+        if (is_range) {
+            const __m128i to = _mm_loadu_si128((const __m128i *) &to_arr[i]);
+
+            /* Lanes with from > ip or ip > to are all ones */
+            const __m128i out = _mm_or_si128(
+                    _mm_cmpgt_epi32(_mm_xor_si128(from, bias), key_biased),
+                    _mm_cmpgt_epi32(key_biased, _mm_xor_si128(to, bias)));
+
+            if (_mm_movemask_epi8(out) != 0xFFFF)
+                return TRUE;
+        } else {
+            if (_mm_movemask_epi8(_mm_cmpeq_epi32(from, key)) != 0)
+                return TRUE;
+        }
+    }
+#elif defined(FORT_CONF_SIMD_NEON)
+    const uint32x4_t key = vdupq_n_u32(ip);
+
+    for (; i + 4 <= count; i += 4) {
+        const uint32x4_t from = vld1q_u32(&iparr[i]);
+
+        const uint32x4_t match = is_range
+                ? vandq_u32(vcleq_u32(from, key), vcleq_u32(key, vld1q_u32(&to_arr[i])))
+                : vceqq_u32(from, key);
+
+        if (vmaxvq_u32(match) != 0)
+            return TRUE;
+    }
+#endif
+
+    for (; i < count; ++i) {
+        if (is_range ? (ip >= iparr[i] && ip <= to_arr[i]) : (ip == iparr[i]))
+            return TRUE;
+    }
+
+    return FALSE;
+}
+
 static BOOL fort_conf_ip6_find(
         const ip6_addr_t *iparr, const ip6_addr_t *ip, UINT32 count, BOOL is_range)
 {
@@ -135,6 +246,69 @@ static BOOL fort_conf_ip6_find(
             && fort_ip6_cmp(ip, &iparr[count + high]) <= 0;
 }
 
+/* Eytzinger layout: children of the (1-based) k-th key are at 2k and 2k+1 */
+static int fort_conf_ip4_eytzinger_floor(const UINT32 *iparr, UINT32 ip, UINT32 count)
+{
+    UINT32 found = 0;
+    UINT32 k = 1;
+
+    while (k <= count) {
+        /* 4 levels ahead, while in the array */
+        if (16 * k - 1 < count) {
+            PreFetchCacheLine(PF_TEMPORAL_LEVEL_1, &iparr[16 * k - 1]);
+        }
+
+        const UINT32 is_le = (iparr[k - 1] <= ip);
+
+        found = is_le ? k : found;
+        k = 2 * k + is_le;
+    }
+
+    return (int) found - 1;
+}
+
+static int fort_conf_ip6_eytzinger_floor(
+        const ip6_addr_t *iparr, const ip6_addr_t *ip, UINT32 count)
+{
+    UINT32 found = 0;
+    UINT32 k = 1;
+
+    while (k <= count) {
+        /* 2 levels ahead, while in the array */
+        if (4 * k - 1 < count) {
+            PreFetchCacheLine(PF_TEMPORAL_LEVEL_1, &iparr[4 * k - 1]);
+        }
+
+        const UINT32 is_le = (fort_ip6_cmp(&iparr[k - 1], ip) <= 0);
+
+        found = is_le ? k : found;
+        k = 2 * k + is_le;
+    }
+
+    return (int) found - 1;
+}
+
+static BOOL fort_conf_ip4_eytzinger_find(
+        const UINT32 *iparr, UINT32 ip, UINT32 count, BOOL is_range)
+{
+    const int index = fort_conf_ip4_eytzinger_floor(iparr, ip, count);
+    if (index < 0)
+        return FALSE;
+
+    return is_range ? (ip <= iparr[count + index]) : (ip == iparr[index]);
+}
+
+static BOOL fort_conf_ip6_eytzinger_find(
+        const ip6_addr_t *iparr, const ip6_addr_t *ip, UINT32 count, BOOL is_range)
+{
+    const int index = fort_conf_ip6_eytzinger_floor(iparr, ip, count);
+    if (index < 0)
+        return FALSE;
+
+    return is_range ? (fort_ip6_cmp(ip, &iparr[count + index]) <= 0)
+                    : fort_mem_eql(ip, &iparr[index], sizeof(ip6_addr_t));
+}
+
 static int fort_conf_blob_index(const char *arr, const char *p, UINT32 blob_len, UINT32 count)
 {
     if (count == 0)
@@ -169,21 +343,31 @@ static int fort_conf_blob_index(const char *arr, const char *p, UINT32 blob_len,
 
 #define fort_conf_proto_list_pair_ref(proto_list) &(proto_list)->proto[(proto_list)->proto_n]
 
+#define fort_conf_port_search(port_arr, port, count, is_range)                                     \
+    ((count) <= FORT_CONF_LINEAR_FIND_MAX                                                          \
+                    ? fort_conf_port_linear_find(port_arr, port, count, is_range)                  \
+                    : fort_conf_port_find(port_arr, port, count, is_range))
+
 #define fort_conf_port_inarr(port_arr, port, count)                                                \
-    fort_conf_port_find(port_arr, port, count, /*is_range=*/FALSE)
+    fort_conf_port_search(port_arr, port, count, /*is_range=*/FALSE)
 
 #define fort_conf_port_inrange(port_range, port, count)                                            \
-    fort_conf_port_find(port_range, port, count, /*is_range=*/TRUE)
+    fort_conf_port_search(port_range, port, count, /*is_range=*/TRUE)
 
 #define fort_conf_port_list_arr_ref(port_list) (port_list)->port
 
 #define fort_conf_port_list_pair_ref(port_list) &(port_list)->port[(port_list)->port_n]
 
+#define fort_conf_ip4_search(iparr, ip, count, is_range)                                           \
+    ((count) <= FORT_CONF_LINEAR_FIND_MAX                                                          \
+                    ? fort_conf_ip4_linear_find(iparr, ip, count, is_range)                        \
+                    : fort_conf_ip4_find(iparr, ip, count, is_range))
+
 #define fort_conf_ip4_inarr(iparr, ip, count)                                                      \
-    fort_conf_ip4_find(iparr, ip, count, /*is_range=*/FALSE)
+    fort_conf_ip4_search(iparr, ip, count, /*is_range=*/FALSE)
 
 #define fort_conf_ip4_inrange(iprange, ip, count)                                                  \
-    fort_conf_ip4_find(iprange, ip, count, /*is_range=*/TRUE)
+    fort_conf_ip4_search(iprange, ip, count, /*is_range=*/TRUE)
 
 #define fort_conf_addr_list_ip4_ref(addr_list) (addr_list)->ip
 
@@ -219,27 +403,66 @@ static BOOL fort_conf_proto_inlist(const UINT8 proto, PCFORT_CONF_PROTO_LIST pro
                     fort_conf_proto_list_pair_ref(proto_list), proto, proto_list->pair_n);
 }
 
-static BOOL fort_conf_port_inlist(const UINT16 port, PCFORT_CONF_PORT_LIST port_list)
+FORT_API BOOL fort_conf_port_inlist(const UINT16 port, PCFORT_CONF_PORT_LIST port_list)
 {
     return fort_conf_port_inarr(fort_conf_port_list_arr_ref(port_list), port, port_list->port_n)
             || fort_conf_port_inrange(
                     fort_conf_port_list_pair_ref(port_list), port, port_list->pair_n);
 }
 
+static UINT32 fort_conf_eytzinger_order_fill(UINT32 *order, UINT32 i, UINT32 k, UINT32 count)
+{
+    if (k <= count) {
+        i = fort_conf_eytzinger_order_fill(order, i, 2 * k, count);
+        order[k - 1] = i++;
+        i = fort_conf_eytzinger_order_fill(order, i, 2 * k + 1, count);
+    }
+    return i;
+}
+
+FORT_API void fort_conf_eytzinger_order(UINT32 *order, UINT32 count)
+{
+    fort_conf_eytzinger_order_fill(order, 0, 1, count);
+}
+
+static BOOL fort_conf_ip4_inlist(PCFORT_CONF_ADDR_LIST addr_list, const UINT32 ip)
+{
+    const UINT32 *ip_arr = fort_conf_addr_list_ip4_ref(addr_list);
+    const UINT32 *pair_arr = fort_conf_addr_list_pair4_ref(addr_list);
+
+    if (addr_list->eytzinger) {
+        return fort_conf_ip4_eytzinger_find(ip_arr, ip, addr_list->ip_n, /*is_range=*/FALSE)
+                || fort_conf_ip4_eytzinger_find(pair_arr, ip, addr_list->pair_n, /*is_range=*/TRUE);
+    }
+
+    return fort_conf_ip4_inarr(ip_arr, ip, addr_list->ip_n)
+            || fort_conf_ip4_inrange(pair_arr, ip, addr_list->pair_n);
+}
+
+static BOOL fort_conf_ip6_inlist(PCFORT_CONF_ADDR_LIST addr6_list, const ip6_addr_t *ip6)
+{
+    const ip6_addr_t *ip_arr = fort_conf_addr_list_ip6_ref(addr6_list);
+    const ip6_addr_t *pair_arr = fort_conf_addr_list_pair6_ref(addr6_list);
+
+    if (addr6_list->eytzinger) {
+        return fort_conf_ip6_eytzinger_find(ip_arr, ip6, addr6_list->ip_n, /*is_range=*/FALSE)
+                || fort_conf_ip6_eytzinger_find(
+                        pair_arr, ip6, addr6_list->pair_n, /*is_range=*/TRUE);
+    }
+
+    return fort_conf_ip6_inarr(ip_arr, ip6, addr6_list->ip_n)
+            || fort_conf_ip6_inrange(pair_arr, ip6, addr6_list->pair_n);
+}
+
 FORT_API BOOL fort_conf_ip_inlist(PCFORT_CONF_ADDR_LIST addr_list, const ip_addr_t ip, BOOL isIPv6)
 {
     if (isIPv6) {
-        const ip6_addr_t *ip6 = &ip.v6;
         PCFORT_CONF_ADDR_LIST addr6_list = (PCFORT_CONF_ADDR_LIST) ((PCCH) addr_list
                 + FORT_CONF_ADDR4_LIST_SIZE(addr_list->ip_n, addr_list->pair_n));
 
-        return fort_conf_ip6_inarr(fort_conf_addr_list_ip6_ref(addr6_list), ip6, addr6_list->ip_n)
-                || fort_conf_ip6_inrange(
-                        fort_conf_addr_list_pair6_ref(addr6_list), ip6, addr6_list->pair_n);
+        return fort_conf_ip6_inlist(addr6_list, &ip.v6);
     } else {
-        return fort_conf_ip4_inarr(fort_conf_addr_list_ip4_ref(addr_list), ip.v4, addr_list->ip_n)
-                || fort_conf_ip4_inrange(
-                        fort_conf_addr_list_pair4_ref(addr_list), ip.v4, addr_list->pair_n);
+        return fort_conf_ip4_inlist(addr_list, ip.v4);
     }
 }
 
@@ -302,19 +525,193 @@ FORT_API BOOL fort_conf_addr_group_ip_included(
     return ip_included && !ip_excluded;
 }
 
-FORT_API BOOL fort_conf_zones_ip_included(
-        PCFORT_CONF_ZONES zones, PCFORT_CONF_META_CONN conn, UCHAR *zone_id, UINT32 zones_mask)
+static int fort_conf_ip4_floor_index(const UINT32 *iparr, UINT32 ip, UINT32 count)
+{
+    const UINT32 *base = iparr;
+    UINT32 n = count;
+
+    if (n == 0 || ip < base[0])
+        return -1;
+
+    while (n > 1) {
+        const UINT32 half = n / 2;
+
+        base = (base[half] <= ip) ? &base[half] : base;
+        n -= half;
+    }
+
+    return (int) (base - iparr);
+}
+
+static int fort_conf_ip6_floor_index(const ip6_addr_t *iparr, const ip6_addr_t *ip, UINT32 count)
+{
+    const ip6_addr_t *base = iparr;
+    UINT32 n = count;
+
+    if (n == 0 || fort_ip6_cmp(ip, &base[0]) < 0)
+        return -1;
+
+    while (n > 1) {
+        const UINT32 half = n / 2;
+
+        base = (fort_ip6_cmp(&base[half], ip) <= 0) ? &base[half] : base;
+        n -= half;
+    }
+
+    return (int) (base - iparr);
+}
+
+FORT_API UINT32 fort_conf_zones_index_ip_mask(
+        PCFORT_CONF_ZONES_INDEX zones_index, const ip_addr_t ip, BOOL isIPv6)
+{
+    const UINT32 ip4_n = zones_index->ip4_n;
+    const UINT32 *ip4_masks = &zones_index->data[ip4_n];
+
+    if (!isIPv6) {
+        const int index = fort_conf_ip4_floor_index(zones_index->data, ip.v4, ip4_n);
+
+        return (index < 0) ? 0 : ip4_masks[index];
+    }
+
+    const UINT32 ip6_n = zones_index->ip6_n;
+    const ip6_addr_t *ip6_arr = (const ip6_addr_t *) &ip4_masks[ip4_n];
+    const UINT32 *ip6_masks = (const UINT32 *) &ip6_arr[ip6_n];
+
+    const int index = fort_conf_ip6_floor_index(ip6_arr, &ip.v6, ip6_n);
+
+    return (index < 0) ? 0 : ip6_masks[index];
+}
+
+FORT_API void fort_conf_zones_rt_init(PFORT_CONF_ZONES_RT zones_rt, PCFORT_CONF_ZONES zones)
+{
+    zones_rt->mask = zones->mask;
+    zones_rt->enabled_mask = zones->enabled_mask;
+
+    for (int i = 0; i < FORT_CONF_ZONE_MAX; ++i) {
+        zones_rt->addr_lists[i] = (zones->mask & (1u << i)) != 0
+                ? (PCFORT_CONF_ADDR_LIST) &zones->data[zones->addr_off[i]]
+                : NULL;
+    }
+
+    zones_rt->zones_index = (zones->index_off != 0)
+            ? (PCFORT_CONF_ZONES_INDEX) &zones->data[zones->index_off]
+            : NULL;
+}
+
+FORT_API BOOL fort_conf_addr_list_valid(PCFORT_CONF_ADDR_LIST addr_list, UINT32 len)
+{
+    if (len < FORT_CONF_ADDR_LIST_OFF)
+        return FALSE;
+
+    /* The counts are unchecked, so don't let the sizes overflow */
+    const UINT64 addr4_size = FORT_CONF_ADDR4_LIST_SIZE((UINT64) addr_list->ip_n, addr_list->pair_n);
+    if (addr4_size > len - FORT_CONF_ADDR_LIST_OFF)
+        return FALSE;
+
+    PCFORT_CONF_ADDR_LIST addr6_list = (PCFORT_CONF_ADDR_LIST) ((PCCH) addr_list + addr4_size);
+
+    const UINT64 addr6_size =
+            FORT_CONF_ADDR6_LIST_SIZE((UINT64) addr6_list->ip_n, addr6_list->pair_n);
+
+    return addr6_size <= len - addr4_size;
+}
+
+static BOOL fort_conf_addr_group_valid(PCFORT_CONF_ADDR_GROUP addr_group, UINT32 len)
+{
+    if (len < FORT_CONF_ADDR_GROUP_OFF)
+        return FALSE;
+
+    const UINT32 data_len = len - FORT_CONF_ADDR_GROUP_OFF;
+    const UINT32 exclude_off = addr_group->exclude_off;
+
+    if (exclude_off > data_len)
+        return FALSE;
+
+    return fort_conf_addr_list_valid(fort_conf_addr_group_include_list_ref(addr_group), exclude_off)
+            && fort_conf_addr_list_valid(
+                    fort_conf_addr_group_exclude_list_ref(addr_group), data_len - exclude_off);
+}
+
+/* Address groups are the offsets' header, then the groups, which the header's offsets point to */
+static BOOL fort_conf_addr_groups_valid(const char *addr_groups, UINT32 len)
+{
+    if (len == 0)
+        return TRUE;
+
+    if (len < sizeof(UINT32))
+        return FALSE;
+
+    const UINT32 *addr_group_offsets = (const UINT32 *) addr_groups;
+    const UINT32 header_size = addr_group_offsets[0];
+
+    if (header_size == 0 || header_size % sizeof(UINT32) != 0 || header_size > len)
+        return FALSE;
+
+    const UINT32 addr_groups_n = header_size / sizeof(UINT32);
+
+    for (UINT32 i = 0; i < addr_groups_n; ++i) {
+        const UINT32 off = addr_group_offsets[i];
+        const UINT32 end_off = (i + 1 < addr_groups_n) ? addr_group_offsets[i + 1] : len;
+
+        if (off < header_size || off > end_off || end_off > len)
+            return FALSE;
+
+        if (!fort_conf_addr_group_valid(
+                    (PCFORT_CONF_ADDR_GROUP) (addr_groups + off), end_off - off))
+            return FALSE;
+    }
+
+    return TRUE;
+}
+
+FORT_API BOOL fort_conf_zone_valid(PCFORT_CONF_ZONE zone, UINT32 len)
+{
+    if (len < FORT_CONF_ZONE_DATA_OFF)
+        return FALSE;
+
+    if (zone->zone_id == 0 || zone->zone_id > FORT_CONF_ZONE_MAX)
+        return FALSE;
+
+    const UINT32 addr_len = zone->addr_len;
+
+    if (addr_len > len - FORT_CONF_ZONE_DATA_OFF)
+        return FALSE;
+
+    return addr_len == 0
+            || fort_conf_addr_list_valid((PCFORT_CONF_ADDR_LIST) zone->data, addr_len);
+}
+
+inline static BOOL fort_conf_zones_index_ip_included(
+        PCFORT_CONF_ZONES_RT zones, PCFORT_CONF_META_CONN conn, UCHAR *zone_id, UINT32 zones_mask)
+{
+    zones_mask &= fort_conf_zones_index_ip_mask(zones->zones_index, conn->remote_ip, conn->isIPv6);
+
+    const int zone_index = bit_scan_forward(zones_mask);
+    if (zone_index == -1)
+        return FALSE;
+
+    *zone_id = zone_index + 1;
+    return TRUE;
+}
+
+FORT_API BOOL fort_conf_zones_ip_included(PCFORT_CONF_ZONES_RT zones, PCFORT_CONF_META_CONN conn,
+        UCHAR *zone_id, UINT32 zones_mask)
 {
     zones_mask &= (zones->mask & zones->enabled_mask);
 
+    if (zones_mask == 0)
+        return FALSE;
+
+    if (zones->zones_index != NULL)
+        return fort_conf_zones_index_ip_included(zones, conn, zone_id, zones_mask);
+
     while (zones_mask != 0) {
         const int zone_index = bit_scan_forward(zones_mask);
 
         if (zone_index == -1)
             break; /* never, but to avoid static analizers warning */
 
-        const UINT32 addr_off = zones->addr_off[zone_index];
-        PCFORT_CONF_ADDR_LIST addr_list = (PCFORT_CONF_ADDR_LIST) &zones->data[addr_off];
+        PCFORT_CONF_ADDR_LIST addr_list = zones->addr_lists[zone_index];
 
         if (fort_conf_ip_inlist(addr_list, conn->remote_ip, conn->isIPv6)) {
             *zone_id = zone_index + 1;
@@ -327,8 +724,8 @@ FORT_API BOOL fort_conf_zones_ip_included(
     return FALSE;
 }
 
-static BOOL fort_conf_zones_masks_conn_check(PCFORT_CONF_ZONES zones, PCFORT_CONF_META_CONN conn,
-        UINT32 zones_mask, FORT_CONF_ZONES_CONN_FILTERED_RESULT *result)
+static BOOL fort_conf_zones_masks_conn_check(PCFORT_CONF_ZONES_RT zones,
+        PCFORT_CONF_META_CONN conn, UINT32 zones_mask, FORT_CONF_ZONES_CONN_FILTERED_RESULT *result)
 {
     if (zones_mask == 0)
         return FALSE;
@@ -340,8 +737,8 @@ static BOOL fort_conf_zones_masks_conn_check(PCFORT_CONF_ZONES zones, PCFORT_CON
     return TRUE;
 }
 
-FORT_API BOOL fort_conf_zones_conn_filtered(
-        PCFORT_CONF_ZONES zones, PCFORT_CONF_META_CONN conn, PFORT_CONF_ZONES_CONN_FILTERED_OPT opt)
+FORT_API BOOL fort_conf_zones_conn_filtered(PCFORT_CONF_ZONES_RT zones,
+        PCFORT_CONF_META_CONN conn, PFORT_CONF_ZONES_CONN_FILTERED_OPT opt)
 {
     const BOOL reject_filtered = fort_conf_zones_masks_conn_check(
             zones, conn, opt->rule_zones.reject_mask, &opt->reject);
@@ -365,6 +762,317 @@ FORT_API BOOL fort_conf_app_exe_equal(PCFORT_APP_ENTRY app_entry, PCFORT_APP_PAT
     return fort_mem_eql(path->buffer, app_entry->path, path_len);
 }
 
+static BOOL fort_conf_app_entries_valid(const char *app_entries, UINT32 apps_n, UINT32 len)
+{
+    UINT32 off = 0;
+
+    for (UINT32 i = 0; i < apps_n; ++i) {
+        if (len - off < FORT_CONF_APP_ENTRY_PATH_OFF)
+            return FALSE;
+
+        PCFORT_APP_ENTRY app_entry = (PCFORT_APP_ENTRY) (app_entries + off);
+        const UINT32 app_size = FORT_CONF_APP_ENTRY_SIZE(app_entry->path_len);
+
+        if (len - off < app_size)
+            return FALSE;
+
+        off += app_size;
+    }
+
+    return TRUE;
+}
+
+/* Prefix apps are the offsets' header, then the entries, which the header's offsets point to */
+static BOOL fort_conf_prefix_apps_valid(const char *prefix_apps, UINT32 apps_n, UINT32 len)
+{
+    if (apps_n == 0)
+        return TRUE;
+
+    const UINT32 header_size = FORT_CONF_STR_HEADER_SIZE(apps_n);
+
+    if (len < header_size)
+        return FALSE;
+
+    const UINT32 *app_offsets = (const UINT32 *) prefix_apps;
+    const char *app_entries = prefix_apps + header_size;
+    const UINT32 entries_len = len - header_size;
+
+    UINT32 off = 0;
+
+    for (UINT32 i = 0; i < apps_n; ++i) {
+        if (app_offsets[i] != off || entries_len - off < FORT_CONF_APP_ENTRY_PATH_OFF)
+            return FALSE;
+
+        PCFORT_APP_ENTRY app_entry = (PCFORT_APP_ENTRY) (app_entries + off);
+        const UINT32 app_size = FORT_CONF_APP_ENTRY_SIZE(app_entry->path_len);
+
+        if (entries_len - off < app_size)
+            return FALSE;
+
+        off += app_size;
+    }
+
+    return TRUE;
+}
+
+FORT_API BOOL fort_conf_apps_batch_valid(PCFORT_CONF_APPS_BATCH apps_batch, UINT32 len)
+{
+    if (len < FORT_CONF_APPS_BATCH_DATA_OFF)
+        return FALSE;
+
+    const UINT32 data_len = len - FORT_CONF_APPS_BATCH_DATA_OFF;
+    const UINT32 add_apps_off = apps_batch->add_apps_off;
+
+    if (add_apps_off > data_len)
+        return FALSE;
+
+    return fort_conf_app_entries_valid(apps_batch->data, apps_batch->del_apps_n, add_apps_off)
+            && fort_conf_app_entries_valid(apps_batch->data + add_apps_off,
+                    apps_batch->add_apps_n, data_len - add_apps_off);
+}
+
+/* The index is the entries, then the buckets, the keys' lengths and the unkeyed entries */
+static BOOL fort_conf_wild_index_valid(PCFORT_CONF_WILD_INDEX wild_index, UINT32 len,
+        const char *app_entries, UINT32 apps_n, UINT32 apps_len)
+{
+    if (len < FORT_CONF_WILD_INDEX_OFF)
+        return FALSE;
+
+    const UINT32 buckets_n = wild_index->buckets_n;
+
+    if (buckets_n == 0 || (buckets_n & (buckets_n - 1)) != 0)
+        return FALSE;
+
+    const UINT32 shorts_n = buckets_n + wild_index->prefix_lens_n + wild_index->suffix_lens_n
+            + wild_index->unkeyed_n;
+
+    if (apps_n * sizeof(FORT_CONF_WILD_ENTRY) + shorts_n * sizeof(UINT16)
+            > len - FORT_CONF_WILD_INDEX_OFF)
+        return FALSE;
+
+    PCFORT_CONF_WILD_ENTRY entries = (PCFORT_CONF_WILD_ENTRY) wild_index->data;
+
+    for (UINT32 i = 0; i < apps_n; ++i) {
+        PCFORT_CONF_WILD_ENTRY entry = &entries[i];
+        const UINT32 app_off = entry->app_off;
+
+        if (app_off > apps_len || apps_len - app_off < FORT_CONF_APP_ENTRY_PATH_OFF)
+            return FALSE;
+
+        PCFORT_APP_ENTRY app_entry = (PCFORT_APP_ENTRY) (app_entries + app_off);
+
+        if (apps_len - app_off < FORT_CONF_APP_ENTRY_SIZE(app_entry->path_len))
+            return FALSE;
+
+        /* The bucket's chain must ascend to end */
+        const UINT32 next = entry->next;
+
+        if (next != 0 && (next <= i + 1 || next > apps_n))
+            return FALSE;
+    }
+
+    const UINT16 *buckets = (const UINT16 *) (entries + apps_n);
+
+    for (UINT32 i = 0; i < buckets_n; ++i) {
+        if (buckets[i] > apps_n)
+            return FALSE;
+    }
+
+    const UINT16 *unkeyed =
+            buckets + buckets_n + wild_index->prefix_lens_n + wild_index->suffix_lens_n;
+
+    for (UINT32 i = 0; i < wild_index->unkeyed_n; ++i) {
+        if (unkeyed[i] >= apps_n)
+            return FALSE;
+    }
+
+    return TRUE;
+}
+
+FORT_API BOOL fort_conf_valid(PCFORT_CONF conf, UINT32 len)
+{
+    if (len < FORT_CONF_DATA_OFF)
+        return FALSE;
+
+    const UINT32 data_len = len - FORT_CONF_DATA_OFF;
+    const UINT32 wild_apps_off = conf->wild_apps_off;
+    const UINT32 prefix_apps_off = conf->prefix_apps_off;
+    const UINT32 exe_apps_off = conf->exe_apps_off;
+
+    /* The driver keeps only the data before the exe apps */
+    if (exe_apps_off > data_len || prefix_apps_off > exe_apps_off
+            || wild_apps_off > prefix_apps_off || conf->addr_groups_off > wild_apps_off)
+        return FALSE;
+
+    const UINT32 wild_index_off = conf->wild_index_off;
+
+    if (wild_index_off != 0 && (wild_index_off < prefix_apps_off || wild_index_off > exe_apps_off))
+        return FALSE;
+
+    const char *data = conf->data;
+    const UINT32 wild_apps_len = prefix_apps_off - wild_apps_off;
+    const UINT32 prefix_apps_end = (wild_index_off != 0) ? wild_index_off : exe_apps_off;
+
+    return fort_conf_addr_groups_valid(
+                   data + conf->addr_groups_off, wild_apps_off - conf->addr_groups_off)
+            && fort_conf_app_entries_valid(data + wild_apps_off, conf->wild_apps_n, wild_apps_len)
+            && fort_conf_prefix_apps_valid(data + prefix_apps_off, conf->prefix_apps_n,
+                    prefix_apps_end - prefix_apps_off)
+            && (wild_index_off == 0
+                    || fort_conf_wild_index_valid(
+                            (PCFORT_CONF_WILD_INDEX) (data + wild_index_off),
+                            exe_apps_off - wild_index_off, data + wild_apps_off,
+                            conf->wild_apps_n, wild_apps_len))
+            && fort_conf_app_entries_valid(
+                    data + exe_apps_off, conf->exe_apps_n, data_len - exe_apps_off);
+}
+
+static BOOL fort_conf_delta_wild_apps_valid(PCFORT_CONF_DELTA_OP op)
+{
+    if (op->len < FORT_CONF_DELTA_WILD_APPS_DATA_OFF)
+        return FALSE;
+
+    PCFORT_CONF_DELTA_WILD_APPS wild_apps = (PCFORT_CONF_DELTA_WILD_APPS) op->data;
+
+    const UINT32 data_len = op->len - FORT_CONF_DELTA_WILD_APPS_DATA_OFF;
+    const UINT32 prefix_apps_off = wild_apps->prefix_apps_off;
+    const UINT32 wild_index_off = wild_apps->wild_index_off;
+
+    if (prefix_apps_off > data_len)
+        return FALSE;
+
+    if (wild_index_off != 0 && (wild_index_off < prefix_apps_off || wild_index_off > data_len))
+        return FALSE;
+
+    const char *data = wild_apps->data;
+    const UINT32 prefix_apps_end = (wild_index_off != 0) ? wild_index_off : data_len;
+
+    return fort_conf_app_entries_valid(data, wild_apps->wild_apps_n, prefix_apps_off)
+            && fort_conf_prefix_apps_valid(data + prefix_apps_off, wild_apps->prefix_apps_n,
+                    prefix_apps_end - prefix_apps_off)
+            && (wild_index_off == 0
+                    || fort_conf_wild_index_valid(
+                            (PCFORT_CONF_WILD_INDEX) (data + wild_index_off),
+                            data_len - wild_index_off, data, wild_apps->wild_apps_n,
+                            prefix_apps_off));
+}
+
+static BOOL fort_conf_delta_op_valid(PCFORT_CONF_DELTA_OP op)
+{
+    switch (op->type) {
+    case FORT_CONF_DELTA_OP_WILD_APPS:
+        return fort_conf_delta_wild_apps_valid(op);
+    default:
+        return FALSE;
+    }
+}
+
+inline static PCFORT_CONF_DELTA_OP fort_conf_delta_op_next(PCFORT_CONF_DELTA_OP op)
+{
+    return (PCFORT_CONF_DELTA_OP) ((const char *) op + FORT_CONF_DELTA_OP_SIZE(op->len));
+}
+
+FORT_API BOOL fort_conf_delta_valid(PCFORT_CONF_DELTA delta, UINT32 len)
+{
+    if (len < FORT_CONF_DELTA_DATA_OFF || delta->version != FORT_CONF_DELTA_VERSION)
+        return FALSE;
+
+    UINT32 off = FORT_CONF_DELTA_DATA_OFF;
+
+    for (UINT32 i = 0; i < delta->ops_n; ++i) {
+        if (len - off < FORT_CONF_DELTA_OP_DATA_OFF)
+            return FALSE;
+
+        PCFORT_CONF_DELTA_OP op = (PCFORT_CONF_DELTA_OP) ((const char *) delta + off);
+
+        if (op->len > len - off - FORT_CONF_DELTA_OP_DATA_OFF || !fort_conf_delta_op_valid(op))
+            return FALSE;
+
+        /* The last op's alignment may be truncated */
+        const UINT32 op_size = FORT_CONF_DELTA_OP_SIZE(op->len);
+
+        off = (op_size < len - off) ? off + op_size : len;
+    }
+
+    return TRUE;
+}
+
+/* The last op wins */
+static PCFORT_CONF_DELTA_OP fort_conf_delta_op_find(
+        PCFORT_CONF_DELTA delta, UCHAR type, UCHAR index)
+{
+    PCFORT_CONF_DELTA_OP found = NULL;
+
+    PCFORT_CONF_DELTA_OP op = (PCFORT_CONF_DELTA_OP) delta->data;
+
+    for (UINT32 i = 0; i < delta->ops_n; ++i) {
+        if (op->type == type && op->index == index) {
+            found = op;
+        }
+
+        op = fort_conf_delta_op_next(op);
+    }
+
+    return found;
+}
+
+FORT_API UINT32 fort_conf_delta_conf_len(PCFORT_CONF conf, PCFORT_CONF_DELTA delta)
+{
+    /* The address groups precede the wildcard apps */
+    UINT32 len = FORT_CONF_DATA_OFF + conf->wild_apps_off - conf->addr_groups_off;
+
+    PCFORT_CONF_DELTA_OP op = fort_conf_delta_op_find(delta, FORT_CONF_DELTA_OP_WILD_APPS, 0);
+
+    len += (op != NULL) ? op->len - FORT_CONF_DELTA_WILD_APPS_DATA_OFF
+                        : conf->exe_apps_off - conf->wild_apps_off;
+
+    return len;
+}
+
+FORT_API void fort_conf_delta_conf_write(
+        PFORT_CONF new_conf, PCFORT_CONF conf, PCFORT_CONF_DELTA delta)
+{
+    RtlCopyMemory(new_conf, conf, FORT_CONF_DATA_OFF);
+
+    const UINT32 off = conf->wild_apps_off - conf->addr_groups_off;
+
+    new_conf->addr_groups_off = 0;
+
+    RtlCopyMemory(new_conf->data, conf->data + conf->addr_groups_off, off);
+
+    new_conf->wild_apps_off = off;
+
+    PCFORT_CONF_DELTA_OP op = fort_conf_delta_op_find(delta, FORT_CONF_DELTA_OP_WILD_APPS, 0);
+
+    if (op != NULL) {
+        PCFORT_CONF_DELTA_WILD_APPS wild_apps = (PCFORT_CONF_DELTA_WILD_APPS) op->data;
+        const UINT32 len = op->len - FORT_CONF_DELTA_WILD_APPS_DATA_OFF;
+
+        RtlCopyMemory(new_conf->data + off, wild_apps->data, len);
+
+        new_conf->proc_wild = wild_apps->proc_wild;
+        new_conf->wild_apps_n = wild_apps->wild_apps_n;
+        new_conf->prefix_apps_n = wild_apps->prefix_apps_n;
+
+        new_conf->prefix_apps_off = off + wild_apps->prefix_apps_off;
+        new_conf->wild_index_off = (wild_apps->wild_index_off != 0)
+                ? off + wild_apps->wild_index_off
+                : 0;
+        new_conf->exe_apps_off = off + len;
+    } else {
+        /* The wildcard apps, prefix apps and the index are contiguous before the exe apps */
+        const UINT32 len = conf->exe_apps_off - conf->wild_apps_off;
+
+        RtlCopyMemory(new_conf->data + off, conf->data + conf->wild_apps_off, len);
+
+        new_conf->prefix_apps_off = off + (conf->prefix_apps_off - conf->wild_apps_off);
+        new_conf->wild_index_off = (conf->wild_index_off != 0)
+                ? off + (conf->wild_index_off - conf->wild_apps_off)
+                : 0;
+        new_conf->exe_apps_off = off + len;
+    }
+}
+
 static BOOL fort_conf_app_wild_equal(PCFORT_APP_ENTRY app_entry, PCFORT_APP_PATH path)
 {
     return wildmatch(app_entry->path, path->buffer) == WM_MATCH;
@@ -420,8 +1128,146 @@ FORT_API FORT_APP_DATA fort_conf_app_exe_find(PCFORT_CONF conf, PVOID context, P
     return fort_conf_app_find_loop(conf, path, &opt);
 }
 
+typedef struct fort_conf_wild_find_opt
+{
+    PCFORT_APP_PATH path;
+
+    const char *app_entries;
+    PCFORT_CONF_WILD_ENTRY entries;
+    const UINT16 *buckets;
+    UINT16 buckets_mask;
+
+    UINT16 match_index; /* the first matched entry's index */
+} FORT_CONF_WILD_FIND_OPT, *PFORT_CONF_WILD_FIND_OPT;
+
+static void fort_conf_wild_entry_check(PFORT_CONF_WILD_FIND_OPT opt, UINT16 index)
+{
+    PCFORT_CONF_WILD_ENTRY entry = &opt->entries[index];
+    PCFORT_APP_ENTRY app_entry = (PCFORT_APP_ENTRY) (opt->app_entries + entry->app_off);
+
+    if (fort_conf_app_wild_equal(app_entry, opt->path)) {
+        opt->match_index = index;
+    }
+}
+
+static void fort_conf_wild_bucket_check(
+        PFORT_CONF_WILD_FIND_OPT opt, UINT32 key_hash, UINT16 key_len, BOOL is_suffix)
+{
+    UINT16 next = opt->buckets[key_hash & opt->buckets_mask];
+
+    /* The bucket's entries are in ascending order */
+    while (next != 0 && next <= opt->match_index) {
+        const UINT16 index = next - 1;
+        PCFORT_CONF_WILD_ENTRY entry = &opt->entries[index];
+
+        if (entry->key_hash == key_hash && entry->key_len == key_len
+                && entry->is_suffix == is_suffix) {
+            fort_conf_wild_entry_check(opt, index);
+        }
+
+        next = entry->next;
+    }
+}
+
+static void fort_conf_wild_prefixes_check(
+        PFORT_CONF_WILD_FIND_OPT opt, const UINT16 *lens, UINT16 lens_n)
+{
+    const WCHAR *path = opt->path->buffer;
+    const UINT16 path_n = opt->path->len / sizeof(WCHAR);
+
+    UINT32 key_hash = FORT_CONF_WILD_HASH_INIT;
+    UINT16 n = 0;
+
+    for (UINT16 i = 0; i < lens_n; ++i) {
+        const UINT16 len = lens[i];
+        if (len > path_n)
+            break;
+
+        for (; n < len; ++n) {
+            key_hash = fort_conf_wild_hash(key_hash, path[n]);
+        }
+
+        fort_conf_wild_bucket_check(opt, key_hash, len, /*is_suffix=*/FALSE);
+    }
+}
+
+static void fort_conf_wild_suffixes_check(
+        PFORT_CONF_WILD_FIND_OPT opt, const UINT16 *lens, UINT16 lens_n)
+{
+    const UINT16 path_n = opt->path->len / sizeof(WCHAR);
+    const WCHAR *path_end = (const WCHAR *) opt->path->buffer + path_n;
+
+    UINT32 key_hash = FORT_CONF_WILD_HASH_INIT;
+    UINT16 n = 0;
+
+    for (UINT16 i = 0; i < lens_n; ++i) {
+        const UINT16 len = lens[i];
+        if (len > path_n)
+            break;
+
+        for (; n < len; ++n) {
+            key_hash = fort_conf_wild_hash(key_hash, *(path_end - 1 - n));
+        }
+
+        fort_conf_wild_bucket_check(opt, key_hash, len, /*is_suffix=*/TRUE);
+    }
+}
+
+static void fort_conf_wild_unkeyed_check(
+        PFORT_CONF_WILD_FIND_OPT opt, const UINT16 *unkeyed, UINT16 unkeyed_n)
+{
+    for (UINT16 i = 0; i < unkeyed_n; ++i) {
+        const UINT16 index = unkeyed[i];
+        if (index >= opt->match_index)
+            break;
+
+        fort_conf_wild_entry_check(opt, index);
+    }
+}
+
+/* Run wildmatch() only on the patterns, which literal prefix or suffix matches the path */
+static FORT_APP_DATA fort_conf_app_wild_index_find(PCFORT_CONF conf, PCFORT_APP_PATH path)
+{
+    const FORT_APP_DATA app_data = { 0 };
+
+    const UINT16 apps_n = conf->wild_apps_n;
+
+    PCFORT_CONF_WILD_INDEX wild_index =
+            (PCFORT_CONF_WILD_INDEX) (conf->data + conf->wild_index_off);
+
+    PCFORT_CONF_WILD_ENTRY entries = (PCFORT_CONF_WILD_ENTRY) wild_index->data;
+    const UINT16 *buckets = (const UINT16 *) (entries + apps_n);
+    const UINT16 *prefix_lens = buckets + wild_index->buckets_n;
+    const UINT16 *suffix_lens = prefix_lens + wild_index->prefix_lens_n;
+    const UINT16 *unkeyed = suffix_lens + wild_index->suffix_lens_n;
+
+    FORT_CONF_WILD_FIND_OPT opt = {
+        .path = path,
+        .app_entries = (const char *) (conf->data + conf->wild_apps_off),
+        .entries = entries,
+        .buckets = buckets,
+        .buckets_mask = wild_index->buckets_n - 1,
+        .match_index = apps_n,
+    };
+
+    fort_conf_wild_prefixes_check(&opt, prefix_lens, wild_index->prefix_lens_n);
+    fort_conf_wild_suffixes_check(&opt, suffix_lens, wild_index->suffix_lens_n);
+    fort_conf_wild_unkeyed_check(&opt, unkeyed, wild_index->unkeyed_n);
+
+    if (opt.match_index == apps_n)
+        return app_data;
+
+    PCFORT_APP_ENTRY app_entry =
+            (PCFORT_APP_ENTRY) (opt.app_entries + entries[opt.match_index].app_off);
+
+    return app_entry->app_data;
+}
+
 inline static FORT_APP_DATA fort_conf_app_wild_find(PCFORT_CONF conf, PCFORT_APP_PATH path)
 {
+    if (conf->wild_index_off != 0)
+        return fort_conf_app_wild_index_find(conf, path);
+
     const FORT_CONF_APP_FIND_LOOP_OPT opt = {
         .apps_off = conf->wild_apps_off,
         .apps_n = conf->wild_apps_n,
@@ -510,7 +1356,7 @@ inline static BOOL fort_conf_rules_rt_conn_filtered_zones(
     if (!rule->has_zones)
         return FALSE;
 
-    PCFORT_CONF_ZONES zones = rules_rt->zones;
+    PCFORT_CONF_ZONES_RT zones = rules_rt->zones;
     if (!zones)
         return FALSE;
 
@@ -532,42 +1378,6 @@ inline static BOOL fort_conf_rules_rt_conn_filtered_zones(
     return FALSE;
 }
 
-static BOOL fort_conf_rule_filter_check(
-        PCFORT_CONF_RULE_FILTER rule_filter, PFORT_CONF_META_CONN conn);
-
-static BOOL fort_conf_rule_filter_list_check(
-        PCFORT_CONF_RULE_FILTER rule_filter, PFORT_CONF_META_CONN conn, const BOOL isAnd)
-{
-    const char *end = (const char *) rule_filter + rule_filter->size;
-    const char *data = (const char *) (rule_filter + 1);
-
-    do {
-        PCFORT_CONF_RULE_FILTER sub_filter = (PCFORT_CONF_RULE_FILTER) data;
-
-        const BOOL filter_res = fort_conf_rule_filter_check(sub_filter, conn);
-
-        if (isAnd ? !filter_res : filter_res) {
-            return filter_res;
-        }
-
-        data += sub_filter->size;
-    } while (data < end);
-
-    return isAnd;
-}
-
-static BOOL fort_conf_rule_filter_list_and_check(
-        PCFORT_CONF_RULE_FILTER rule_filter, PFORT_CONF_META_CONN conn)
-{
-    const BOOL filter_res = fort_conf_rule_filter_list_check(rule_filter, conn, /*isAnd=*/TRUE);
-
-    if (!filter_res) {
-        conn->rule_filter_action = FALSE;
-    }
-
-    return filter_res;
-}
-
 static BOOL fort_conf_rule_filter_check_address(PFORT_CONF_META_CONN conn, const void *data)
 {
     return fort_conf_ip_inlist(data, conn->remote_ip, conn->isIPv6);
@@ -662,35 +1472,47 @@ static BOOL fort_conf_rule_filter_check_port_udp(PFORT_CONF_META_CONN conn, cons
     return fort_conf_rule_filter_check_port_protocol(conn, data, IpProto_UDP);
 }
 
-typedef BOOL (*FORT_CONF_RULE_FILTER_CHECK_FUNC)(PFORT_CONF_META_CONN conn, const void *data);
-
-static const FORT_CONF_RULE_FILTER_CHECK_FUNC fort_conf_rule_filter_check_funcList[] = {
-    &fort_conf_rule_filter_check_address, // FORT_RULE_FILTER_TYPE_ADDRESS,
-    &fort_conf_rule_filter_check_port, // FORT_RULE_FILTER_TYPE_PORT,
-    &fort_conf_rule_filter_check_local_address, // FORT_RULE_FILTER_TYPE_LOCAL_ADDRESS,
-    &fort_conf_rule_filter_check_local_port, // FORT_RULE_FILTER_TYPE_LOCAL_PORT,
-    &fort_conf_rule_filter_check_protocol, // FORT_RULE_FILTER_TYPE_PROTOCOL,
-    &fort_conf_rule_filter_check_ip_version, // FORT_RULE_FILTER_TYPE_IP_VERSION,
-    &fort_conf_rule_filter_check_direction, // FORT_RULE_FILTER_TYPE_DIRECTION,
-    &fort_conf_rule_filter_check_area, // FORT_RULE_FILTER_TYPE_AREA,
-    &fort_conf_rule_filter_check_profile, // FORT_RULE_FILTER_TYPE_PROFILE,
-    &fort_conf_rule_filter_check_action, // FORT_RULE_FILTER_TYPE_ACTION,
-    // Complex types
-    &fort_conf_rule_filter_check_port_tcp, // FORT_RULE_FILTER_TYPE_PORT_TCP,
-    &fort_conf_rule_filter_check_port_udp, // FORT_RULE_FILTER_TYPE_PORT_UDP,
-};
-
-inline static BOOL fort_conf_rule_filter_check_type(
-        PCFORT_CONF_RULE_FILTER rule_filter, PFORT_CONF_META_CONN conn, const int filter_type)
-{
-    if (rule_filter->is_empty)
-        return TRUE;
-
-    const FORT_CONF_RULE_FILTER_CHECK_FUNC func = fort_conf_rule_filter_check_funcList[filter_type];
+static BOOL fort_conf_rule_filter_check_action_reset(PFORT_CONF_META_CONN conn)
+{
+    /* The failed AND-list resets the action of its filters */
+    conn->rule_filter_action = FALSE;
 
-    const void *data = (const void *) (rule_filter + 1);
+    return FALSE;
+}
 
-    return func(conn, data);
+inline static BOOL fort_conf_rule_op_check_type(
+        PCFORT_CONF_RULE_OP op, PFORT_CONF_META_CONN conn, const void *data)
+{
+    switch (op->type) {
+    case FORT_RULE_FILTER_TYPE_ADDRESS:
+        return fort_conf_rule_filter_check_address(conn, data);
+    case FORT_RULE_FILTER_TYPE_PORT:
+        return fort_conf_rule_filter_check_port(conn, data);
+    case FORT_RULE_FILTER_TYPE_LOCAL_ADDRESS:
+        return fort_conf_rule_filter_check_local_address(conn, data);
+    case FORT_RULE_FILTER_TYPE_LOCAL_PORT:
+        return fort_conf_rule_filter_check_local_port(conn, data);
+    case FORT_RULE_FILTER_TYPE_PROTOCOL:
+        return fort_conf_rule_filter_check_protocol(conn, data);
+    case FORT_RULE_FILTER_TYPE_IP_VERSION:
+        return fort_conf_rule_filter_check_ip_version(conn, data);
+    case FORT_RULE_FILTER_TYPE_DIRECTION:
+        return fort_conf_rule_filter_check_direction(conn, data);
+    case FORT_RULE_FILTER_TYPE_AREA:
+        return fort_conf_rule_filter_check_area(conn, data);
+    case FORT_RULE_FILTER_TYPE_PROFILE:
+        return fort_conf_rule_filter_check_profile(conn, data);
+    case FORT_RULE_FILTER_TYPE_ACTION:
+        return fort_conf_rule_filter_check_action(conn, data);
+    case FORT_RULE_FILTER_TYPE_PORT_TCP:
+        return fort_conf_rule_filter_check_port_tcp(conn, data);
+    case FORT_RULE_FILTER_TYPE_PORT_UDP:
+        return fort_conf_rule_filter_check_port_udp(conn, data);
+    case FORT_RULE_FILTER_TYPE_ACTION_RESET:
+        return fort_conf_rule_filter_check_action_reset(conn);
+    default:
+        return FALSE;
+    }
 }
 
 inline static BOOL fort_conf_rule_filter_check_equal(
@@ -714,35 +1536,44 @@ inline static BOOL fort_conf_rule_filter_check_equal(
     }
 }
 
-static BOOL fort_conf_rule_filter_check(
-        PCFORT_CONF_RULE_FILTER rule_filter, PFORT_CONF_META_CONN conn)
+inline static BOOL fort_conf_rule_op_check(
+        PCFORT_CONF_RULE_OP op, PFORT_CONF_META_CONN conn, const char *data)
 {
-    assert(rule_filter->size != 0);
+    BOOL op_res = op->is_empty || fort_conf_rule_op_check_type(op, conn, data + op->data_off);
 
-    const int filter_type = rule_filter->type;
-
-    if (filter_type == FORT_RULE_FILTER_TYPE_LIST_OR) {
-        return fort_conf_rule_filter_list_check(rule_filter, conn, /*isAnd=*/FALSE);
+    if (op_res && op->equal_values) {
+        op_res = fort_conf_rule_filter_check_equal(conn, op->type);
     }
 
-    if (filter_type == FORT_RULE_FILTER_TYPE_LIST_AND) {
-        return fort_conf_rule_filter_list_and_check(rule_filter, conn);
-    }
+    return op_res;
+}
 
-    if (filter_type < FORT_RULE_FILTER_TYPE_ADDRESS || filter_type > FORT_RULE_FILTER_TYPE_PORT_UDP)
+static BOOL fort_conf_rule_prog_run(PCFORT_CONF_RULE_PROG prog, PFORT_CONF_META_CONN conn)
+{
+    const UINT16 op_count = prog->op_count;
+    if (op_count == 0)
         return FALSE;
 
-    BOOL filter_res = fort_conf_rule_filter_check_type(rule_filter, conn, filter_type);
+    PCFORT_CONF_RULE_OP ops = prog->ops;
+    const char *data = (const char *) (ops + op_count);
 
-    if (filter_res && rule_filter->equal_values) {
-        filter_res = fort_conf_rule_filter_check_equal(conn, filter_type);
-    }
+    UINT16 op_index = 0;
 
-    if (rule_filter->is_not) {
-        filter_res = !filter_res;
-    }
+    do {
+        PCFORT_CONF_RULE_OP op = &ops[op_index];
+
+        const BOOL op_res = fort_conf_rule_op_check(op, conn, data);
+
+        const UINT16 next_index = op_res ? op->jump_true : op->jump_false;
 
-    return filter_res;
+        /* Only forward jumps are valid */
+        if (next_index <= op_index)
+            return FALSE;
+
+        op_index = next_index;
+    } while (op_index < op_count);
+
+    return (op_index == FORT_CONF_RULE_OP_TRUE);
 }
 
 inline static BOOL fort_conf_rules_rt_conn_filtered_filters(
@@ -751,10 +1582,10 @@ inline static BOOL fort_conf_rules_rt_conn_filtered_filters(
     if (!rule->has_filters)
         return FALSE;
 
-    PCFORT_CONF_RULE_FILTER rule_filter =
-            (PCFORT_CONF_RULE_FILTER) ((PCCH) rule + FORT_CONF_RULE_SIZE(rule));
+    PCFORT_CONF_RULE_PROG rule_prog =
+            (PCFORT_CONF_RULE_PROG) ((PCCH) rule + FORT_CONF_RULE_SIZE(rule));
 
-    if (fort_conf_rule_filter_check(rule_filter, conn)) {
+    if (fort_conf_rule_prog_run(rule_prog, conn)) {
         if (!conn->rule_filter_action) {
             conn->blocked = rule->blocked;
         }
@@ -831,8 +1662,8 @@ FORT_API BOOL fort_conf_rules_rt_conn_filtered(
             || fort_conf_rules_rt_conn_filtered_terminate(conn, rule);
 }
 
-FORT_API BOOL fort_conf_rules_conn_filtered(
-        PCFORT_CONF_RULES rules, PCFORT_CONF_ZONES zones, PFORT_CONF_META_CONN conn, UINT16 rule_id)
+FORT_API BOOL fort_conf_rules_conn_filtered(PCFORT_CONF_RULES rules, PCFORT_CONF_ZONES_RT zones,
+        PFORT_CONF_META_CONN conn, UINT16 rule_id)
 {
     if (rule_id > rules->max_rule_id)
         return FALSE;
@@ -842,8 +1673,31 @@ FORT_API BOOL fort_conf_rules_conn_filtered(
     return fort_conf_rules_rt_conn_filtered(&rules_rt, conn, rule_id);
 }
 
+FORT_API UINT32 fort_conf_rules_filter_types(PCFORT_CONF_RULES rules)
+{
+    UINT32 filter_types = 0;
+
+    const FORT_CONF_RULES_RT rules_rt = fort_conf_rules_rt_make(rules, /*zones=*/NULL);
+
+    for (UINT16 rule_id = 1; rule_id <= rules->max_rule_id; ++rule_id) {
+        PCFORT_CONF_RULE rule = fort_conf_rules_rt_rule(&rules_rt, rule_id);
+
+        if (!rule->has_filters)
+            continue;
+
+        PCFORT_CONF_RULE_PROG rule_prog =
+                (PCFORT_CONF_RULE_PROG) ((PCCH) rule + FORT_CONF_RULE_SIZE(rule));
+
+        for (UINT16 i = 0; i < rule_prog->op_count; ++i) {
+            filter_types |= (1u << rule_prog->ops[i].type);
+        }
+    }
+
+    return filter_types;
+}
+
 FORT_API FORT_CONF_RULES_RT fort_conf_rules_rt_make(
-        PCFORT_CONF_RULES rules, PCFORT_CONF_ZONES zones)
+        PCFORT_CONF_RULES rules, PCFORT_CONF_ZONES_RT zones)
 {
     const FORT_CONF_RULES_RT rules_rt = {
         .rule_offsets = (PUINT32) rules->data - 1, /* exclude zero index */
@@ -62,7 +62,7 @@ typedef struct fort_conf_flags
     UINT32 reserved_flags : 9; /* not used */
 
     UINT16 group_bits;
-    UINT16 reserved; /* not used */
+    UINT16 ask_packets_max; /* held packets per process, 0 for the default */
 } FORT_CONF_FLAGS, *PFORT_CONF_FLAGS;
 
 typedef const FORT_CONF_FLAGS *PCFORT_CONF_FLAGS;
@@ -118,7 +118,8 @@ typedef const FORT_CONF_PORT_LIST *PCFORT_CONF_PORT_LIST;
 
 typedef struct fort_conf_addr_list
 {
-    UINT32 ip_n;
+    UINT32 ip_n : 31;
+    UINT32 eytzinger : 1; /* arrays are in Eytzinger (BFS) order instead of sorted */
     UINT32 pair_n;
 
     UINT32 ip[1];
@@ -161,6 +162,8 @@ enum FORT_RULE_FILTER_TYPE {
     // List types
     FORT_RULE_FILTER_TYPE_LIST_OR,
     FORT_RULE_FILTER_TYPE_LIST_AND,
+    // Program types
+    FORT_RULE_FILTER_TYPE_ACTION_RESET,
 };
 
 enum {
@@ -190,16 +193,41 @@ typedef struct fort_conf_rule_filter_flags
 
 typedef const FORT_CONF_RULE_FILTER_FLAGS *PCFORT_CONF_RULE_FILTER_FLAGS;
 
-typedef struct fort_conf_rule_filter
+/* Compiled rule filter: the filter tree is flattened into ops with precomputed jumps */
+#define FORT_CONF_RULE_OP_TRUE  0xFFFF
+#define FORT_CONF_RULE_OP_FALSE 0xFFFE
+#define FORT_CONF_RULE_OP_MAX   0xFFF0
+
+typedef struct fort_conf_rule_op
+{
+    UINT16 type : 5;
+    UINT16 equal_values : 1;
+    UINT16 is_empty : 1;
+    UINT16 reserved : 9; /* not used */
+
+    UINT16 jump_true; /* op index or FORT_CONF_RULE_OP_TRUE/FALSE */
+    UINT16 jump_false;
+
+    UINT16 reserved2; /* not used */
+
+    UINT32 data_off;
+} FORT_CONF_RULE_OP, *PFORT_CONF_RULE_OP;
+
+typedef const FORT_CONF_RULE_OP *PCFORT_CONF_RULE_OP;
+
+typedef struct fort_conf_rule_prog
 {
-    UINT32 is_not : 1;
-    UINT32 equal_values : 1;
-    UINT32 is_empty : 1;
-    UINT32 type : 4;
-    UINT32 size : 25;
-} FORT_CONF_RULE_FILTER, *PFORT_CONF_RULE_FILTER;
+    UINT16 op_count;
+    UINT16 reserved; /* not used */
 
-typedef const FORT_CONF_RULE_FILTER *PCFORT_CONF_RULE_FILTER;
+    FORT_CONF_RULE_OP ops[1];
+} FORT_CONF_RULE_PROG, *PFORT_CONF_RULE_PROG;
+
+typedef const FORT_CONF_RULE_PROG *PCFORT_CONF_RULE_PROG;
+
+#define FORT_CONF_RULE_PROG_OPS_OFF offsetof(FORT_CONF_RULE_PROG, ops)
+#define FORT_CONF_RULE_PROG_DATA_OFF(op_count)                                                     \
+    (FORT_CONF_RULE_PROG_OPS_OFF + (op_count) * sizeof(FORT_CONF_RULE_OP))
 
 typedef struct fort_conf_rule
 {
@@ -261,9 +289,22 @@ typedef struct fort_conf_zones
 
     UINT32 addr_off[FORT_CONF_ZONE_MAX];
 
+    UINT32 index_off; /* 0, if there is no merged index */
+
     char data[4];
 } FORT_CONF_ZONES, *PFORT_CONF_ZONES;
 
+/* Sorted interval boundaries of all zones with zones masks, covering [from(i), from(i+1)) */
+typedef struct fort_conf_zones_index
+{
+    UINT32 ip4_n;
+    UINT32 ip6_n;
+
+    UINT32 data[1]; /* ip4 from[ip4_n], ip4 mask[ip4_n], ip6 from[ip6_n], ip6 mask[ip6_n] */
+} FORT_CONF_ZONES_INDEX, *PFORT_CONF_ZONES_INDEX;
+
+typedef const FORT_CONF_ZONES_INDEX *PCFORT_CONF_ZONES_INDEX;
+
 typedef const FORT_CONF_ZONES *PCFORT_CONF_ZONES;
 
 typedef struct fort_conf_zone_flag
@@ -274,29 +315,60 @@ typedef struct fort_conf_zone_flag
 
 typedef const FORT_CONF_ZONE_FLAG *PCFORT_CONF_ZONE_FLAG;
 
+/* Counters of the conf's lookups, see FORT_IOCTL_GETCONFSTAT */
+typedef struct fort_conf_stat
+{
+    UINT64 cache_hits;
+    UINT64 cache_misses;
+
+    UINT64 scope_reauths;
+    UINT64 scope_skips;
+} FORT_CONF_STAT, *PFORT_CONF_STAT;
+
+/* Replaces or removes one zone's addresses, the driver rebuilds the merged index of all zones */
+typedef struct fort_conf_zone
+{
+    UCHAR zone_id;
+    UCHAR enabled : 1;
+
+    UINT32 addr_len; /* 0, if the zone is removed */
+
+    char data[4]; /* addresses list */
+} FORT_CONF_ZONE, *PFORT_CONF_ZONE;
+
+typedef const FORT_CONF_ZONE *PCFORT_CONF_ZONE;
+
+/* Zones' addresses lists, which may be in separate buffers */
+typedef struct fort_conf_zones_rt
+{
+    UINT32 mask;
+    UINT32 enabled_mask;
+
+    PCFORT_CONF_ADDR_LIST addr_lists[FORT_CONF_ZONE_MAX];
+
+    PCFORT_CONF_ZONES_INDEX zones_index; /* NULL, if there is no merged index */
+} FORT_CONF_ZONES_RT, *PFORT_CONF_ZONES_RT;
+
+typedef const FORT_CONF_ZONES_RT *PCFORT_CONF_ZONES_RT;
+
 typedef struct fort_conf_rules_rt
 {
     const UINT32 *rule_offsets;
     const char *rules_data;
 
-    PCFORT_CONF_ZONES zones;
+    PCFORT_CONF_ZONES_RT zones;
 } FORT_CONF_RULES_RT, *PFORT_CONF_RULES_RT;
 
 typedef const FORT_CONF_RULES_RT *PCFORT_CONF_RULES_RT;
 
 typedef struct fort_traf
 {
-    union {
-        UINT64 v;
-
-        struct
-        {
-            UINT32 in_bytes;
-            UINT32 out_bytes;
-        };
-    };
+    UINT64 in_bytes;
+    UINT64 out_bytes;
 } FORT_TRAF, *PFORT_TRAF;
 
+typedef const FORT_TRAF *PCFORT_TRAF;
+
 typedef struct fort_app_flags
 {
     UINT16 apply_parent : 1;
@@ -345,6 +417,51 @@ typedef const FORT_APP_ENTRY *PCFORT_APP_ENTRY;
 #define FORT_CONF_APP_ENTRY_SIZE(path_len)                                                         \
     (FORT_CONF_APP_ENTRY_PATH_OFF + (path_len) + sizeof(WCHAR)) /* include terminating zero */
 
+/* App entries to delete, then app entries to add, packed by FORT_CONF_APP_ENTRY_SIZE() */
+typedef struct fort_conf_apps_batch
+{
+    UINT32 del_apps_n;
+    UINT32 add_apps_n;
+
+    UINT32 add_apps_off; /* offset of the added app entries from data */
+
+    char data[4];
+} FORT_CONF_APPS_BATCH, *PFORT_CONF_APPS_BATCH;
+
+typedef const FORT_CONF_APPS_BATCH *PCFORT_CONF_APPS_BATCH;
+
+#define FORT_CONF_APPS_BATCH_DATA_OFF offsetof(FORT_CONF_APPS_BATCH, data)
+
+/* Wildcard app, keyed by its literal prefix or suffix */
+typedef struct fort_conf_wild_entry
+{
+    UINT32 app_off; /* offset of the app entry from wild_apps_off */
+    UINT32 key_hash;
+
+    UINT16 key_len : 15; /* in chars, 0 if the pattern has no literal prefix and suffix */
+    UINT16 is_suffix : 1;
+
+    UINT16 next; /* next entry's index + 1 in the bucket, 0 at the end */
+} FORT_CONF_WILD_ENTRY, *PFORT_CONF_WILD_ENTRY;
+
+typedef const FORT_CONF_WILD_ENTRY *PCFORT_CONF_WILD_ENTRY;
+
+typedef struct fort_conf_wild_index
+{
+    UINT16 buckets_n; /* power of 2 */
+    UINT16 prefix_lens_n;
+    UINT16 suffix_lens_n;
+    UINT16 unkeyed_n;
+
+    /* entries[wild_apps_n], UINT16 buckets[], prefix_lens[], suffix_lens[], unkeyed[] */
+    UINT32 data[1];
+} FORT_CONF_WILD_INDEX, *PFORT_CONF_WILD_INDEX;
+
+typedef const FORT_CONF_WILD_INDEX *PCFORT_CONF_WILD_INDEX;
+
+#define FORT_CONF_WILD_HASH_INIT      2166136261U
+#define fort_conf_wild_hash(hash, ch) (((hash) ^ (UINT16) (ch)) * 16777619U)
+
 typedef struct fort_conf_meta_conn
 {
     UINT16 conn_filled : 1;
@@ -392,9 +509,12 @@ typedef struct fort_conf_meta_conn
 
 typedef const FORT_CONF_META_CONN *PCFORT_CONF_META_CONN;
 
+#define FORT_SPEED_LIMIT_CODEL 0x01 /* drop by the packets' queueing delay instead of tail drop */
+
 typedef struct fort_speed_limit
 {
     UINT16 plr; /* packet loss rate in 1/100% (0-10000, i.e. 10% packet loss = 1000) */
+    UINT16 flags;
     UINT32 latency_ms; /* latency in milliseconds */
     UINT32 buffer_bytes; /* size of packet buffer in bytes (150,000 is the dummynet's default) */
     UINT64 bps; /* bandwidth in bytes per second */
@@ -433,6 +553,8 @@ typedef struct fort_conf
     UINT32 prefix_apps_off;
     UINT32 exe_apps_off;
 
+    UINT32 wild_index_off; /* 0, if there is no wildcard apps index */
+
     char data[4];
 } FORT_CONF, *PFORT_CONF;
 
@@ -454,6 +576,53 @@ typedef struct fort_conf_io
 
 typedef const FORT_CONF_IO *PCFORT_CONF_IO;
 
+#define FORT_CONF_DELTA_VERSION 1
+
+enum FORT_CONF_DELTA_OP_TYPE {
+    FORT_CONF_DELTA_OP_WILD_APPS = 0, /* replace the wildcard and prefix apps with their index */
+    FORT_CONF_DELTA_OP_COUNT,
+};
+
+/* Wildcard apps at data, then prefix apps, then the optional wildcard apps' index */
+typedef struct fort_conf_delta_wild_apps
+{
+    UCHAR proc_wild : 1;
+
+    UINT16 wild_apps_n;
+    UINT16 prefix_apps_n;
+
+    UINT32 prefix_apps_off;
+    UINT32 wild_index_off; /* 0, if there is no wildcard apps index */
+
+    char data[4];
+} FORT_CONF_DELTA_WILD_APPS, *PFORT_CONF_DELTA_WILD_APPS;
+
+typedef const FORT_CONF_DELTA_WILD_APPS *PCFORT_CONF_DELTA_WILD_APPS;
+
+typedef struct fort_conf_delta_op
+{
+    UCHAR type;
+    UCHAR index; /* of the op's item, 0 for the wildcard apps */
+    UINT16 reserved; /* not used */
+
+    UINT32 len; /* of data */
+
+    char data[8];
+} FORT_CONF_DELTA_OP, *PFORT_CONF_DELTA_OP;
+
+typedef const FORT_CONF_DELTA_OP *PCFORT_CONF_DELTA_OP;
+
+/* Changes of the applied conf, the later ops of the same item override the earlier ones */
+typedef struct fort_conf_delta
+{
+    UINT32 version;
+    UINT32 ops_n;
+
+    char data[8];
+} FORT_CONF_DELTA, *PFORT_CONF_DELTA;
+
+typedef const FORT_CONF_DELTA *PCFORT_CONF_DELTA;
+
 typedef struct fort_conf_zones_conn_filtered_result
 {
     UCHAR filtered : 1;
@@ -469,13 +638,23 @@ typedef struct fort_conf_zones_conn_filtered_opt
     FORT_CONF_ZONES_CONN_FILTERED_RESULT reject;
 } FORT_CONF_ZONES_CONN_FILTERED_OPT, *PFORT_CONF_ZONES_CONN_FILTERED_OPT;
 
-#define FORT_CONF_DATA_OFF       offsetof(FORT_CONF, data)
-#define FORT_CONF_IO_CONF_OFF    offsetof(FORT_CONF_IO, conf)
-#define FORT_CONF_PROTO_LIST_OFF offsetof(FORT_CONF_PROTO_LIST, proto)
-#define FORT_CONF_PORT_LIST_OFF  offsetof(FORT_CONF_PORT_LIST, port)
-#define FORT_CONF_ADDR_LIST_OFF  offsetof(FORT_CONF_ADDR_LIST, ip)
-#define FORT_CONF_ADDR_GROUP_OFF offsetof(FORT_CONF_ADDR_GROUP, data)
-#define FORT_CONF_ZONES_DATA_OFF offsetof(FORT_CONF_ZONES, data)
+#define FORT_CONF_DATA_OFF        offsetof(FORT_CONF, data)
+#define FORT_CONF_IO_CONF_OFF     offsetof(FORT_CONF_IO, conf)
+#define FORT_CONF_PROTO_LIST_OFF  offsetof(FORT_CONF_PROTO_LIST, proto)
+#define FORT_CONF_PORT_LIST_OFF   offsetof(FORT_CONF_PORT_LIST, port)
+#define FORT_CONF_ADDR_LIST_OFF   offsetof(FORT_CONF_ADDR_LIST, ip)
+#define FORT_CONF_ADDR_GROUP_OFF  offsetof(FORT_CONF_ADDR_GROUP, data)
+#define FORT_CONF_ZONES_DATA_OFF  offsetof(FORT_CONF_ZONES, data)
+#define FORT_CONF_ZONES_INDEX_OFF offsetof(FORT_CONF_ZONES_INDEX, data)
+#define FORT_CONF_ZONE_DATA_OFF   offsetof(FORT_CONF_ZONE, data)
+#define FORT_CONF_WILD_INDEX_OFF  offsetof(FORT_CONF_WILD_INDEX, data)
+
+#define FORT_CONF_DELTA_DATA_OFF           offsetof(FORT_CONF_DELTA, data)
+#define FORT_CONF_DELTA_OP_DATA_OFF        offsetof(FORT_CONF_DELTA_OP, data)
+#define FORT_CONF_DELTA_WILD_APPS_DATA_OFF offsetof(FORT_CONF_DELTA_WILD_APPS, data)
+
+#define FORT_CONF_DELTA_OP_SIZE(len)                                                               \
+    FORT_ALIGN_SIZE(FORT_CONF_DELTA_OP_DATA_OFF + (len), sizeof(UINT64))
 
 #define FORT_CONF_PROTO_LIST_SIZE(proto_n, pair_n)                                                 \
     (FORT_CONF_PROTO_LIST_OFF + FORT_CONF_PROTO_ARR_SIZE(proto_n)                                  \
@@ -490,9 +669,20 @@ typedef struct fort_conf_zones_conn_filtered_opt
 #define FORT_CONF_ADDR6_LIST_SIZE(ip_n, pair_n)                                                    \
     (FORT_CONF_ADDR_LIST_OFF + FORT_CONF_IP6_ARR_SIZE(ip_n) + FORT_CONF_IP6_RANGE_SIZE(pair_n))
 
+/* Use Eytzinger layout for lists, which do not fit in a CPU cache */
+#define FORT_CONF_ADDR_LIST_EYTZINGER_MIN 4096
+
 #define FORT_CONF_ADDR_LIST_SIZE(ip4_n, pair4_n, ip6_n, pair6_n)                                   \
     (FORT_CONF_ADDR4_LIST_SIZE(ip4_n, pair4_n) + FORT_CONF_ADDR6_LIST_SIZE(ip6_n, pair6_n))
 
+#define FORT_CONF_ZONES_INDEX_SIZE(ip4_n, ip6_n)                                                   \
+    (FORT_CONF_ZONES_INDEX_OFF + FORT_CONF_IP4_RANGE_SIZE(ip4_n)                                   \
+            + FORT_CONF_IP6_ARR_SIZE(ip6_n) + FORT_CONF_IP4_ARR_SIZE(ip6_n))
+
+#define FORT_CONF_WILD_INDEX_SIZE(apps_n, shorts_n)                                                \
+    (FORT_CONF_WILD_INDEX_OFF + (apps_n) * sizeof(FORT_CONF_WILD_ENTRY)                            \
+            + FORT_ALIGN_SIZE((shorts_n) * sizeof(UINT16), sizeof(UINT32)))
+
 typedef FORT_APP_DATA fort_conf_app_exe_find_func(
         PCFORT_CONF conf, PVOID context, PCFORT_APP_PATH path);
 
@@ -509,6 +699,10 @@ FORT_API int fort_mem_cmp(const void *p1, const void *p2, UINT32 len);
 
 FORT_API BOOL fort_mem_eql(const void *p1, const void *p2, UINT32 len);
 
+FORT_API BOOL fort_conf_port_inlist(const UINT16 port, PCFORT_CONF_PORT_LIST port_list);
+
+FORT_API void fort_conf_eytzinger_order(UINT32 *order, UINT32 count);
+
 FORT_API BOOL fort_conf_ip_inlist(PCFORT_CONF_ADDR_LIST addr_list, const ip_addr_t ip, BOOL isIPv6);
 
 FORT_API PCFORT_CONF_ADDR_GROUP fort_conf_addr_group_ref(PCFORT_CONF conf, int addr_group_index);
@@ -532,17 +726,38 @@ typedef const FORT_CONF_ADDR_GROUP_IP_INCLUDED_OPT *PCFORT_CONF_ADDR_GROUP_IP_IN
 FORT_API BOOL fort_conf_addr_group_ip_included(
         PCFORT_CONF conf, PCFORT_CONF_META_CONN conn, PCFORT_CONF_ADDR_GROUP_IP_INCLUDED_OPT opt);
 
-FORT_API BOOL fort_conf_zones_ip_included(
-        PCFORT_CONF_ZONES zones, PCFORT_CONF_META_CONN conn, UCHAR *zone_id, UINT32 zones_mask);
+FORT_API UINT32 fort_conf_zones_index_ip_mask(
+        PCFORT_CONF_ZONES_INDEX zones_index, const ip_addr_t ip, BOOL isIPv6);
+
+FORT_API void fort_conf_zones_rt_init(PFORT_CONF_ZONES_RT zones_rt, PCFORT_CONF_ZONES zones);
+
+FORT_API BOOL fort_conf_addr_list_valid(PCFORT_CONF_ADDR_LIST addr_list, UINT32 len);
 
-FORT_API BOOL fort_conf_zones_conn_filtered(PCFORT_CONF_ZONES zones, PCFORT_CONF_META_CONN conn,
-        PFORT_CONF_ZONES_CONN_FILTERED_OPT opt);
+FORT_API BOOL fort_conf_zone_valid(PCFORT_CONF_ZONE zone, UINT32 len);
+
+FORT_API BOOL fort_conf_zones_ip_included(PCFORT_CONF_ZONES_RT zones, PCFORT_CONF_META_CONN conn,
+        UCHAR *zone_id, UINT32 zones_mask);
+
+FORT_API BOOL fort_conf_zones_conn_filtered(PCFORT_CONF_ZONES_RT zones,
+        PCFORT_CONF_META_CONN conn, PFORT_CONF_ZONES_CONN_FILTERED_OPT opt);
 
 FORT_API BOOL fort_conf_app_exe_equal(PCFORT_APP_ENTRY app_entry, PCFORT_APP_PATH path);
 
 FORT_API FORT_APP_DATA fort_conf_app_exe_find(
         PCFORT_CONF conf, PVOID context, PCFORT_APP_PATH path);
 
+FORT_API BOOL fort_conf_apps_batch_valid(PCFORT_CONF_APPS_BATCH apps_batch, UINT32 len);
+
+FORT_API BOOL fort_conf_valid(PCFORT_CONF conf, UINT32 len);
+
+FORT_API BOOL fort_conf_delta_valid(PCFORT_CONF_DELTA delta, UINT32 len);
+
+/* Length of the conf without the exe apps, when the delta is applied */
+FORT_API UINT32 fort_conf_delta_conf_len(PCFORT_CONF conf, PCFORT_CONF_DELTA delta);
+
+FORT_API void fort_conf_delta_conf_write(
+        PFORT_CONF new_conf, PCFORT_CONF conf, PCFORT_CONF_DELTA delta);
+
 FORT_API FORT_APP_DATA fort_conf_app_find(PCFORT_CONF conf, PCFORT_APP_PATH path,
         fort_conf_app_exe_find_func *exe_find_func, PVOID exe_context);
 
@@ -551,14 +766,17 @@ FORT_API BOOL fort_conf_app_group_blocked(const FORT_CONF_FLAGS conf_flags, FORT
 FORT_API BOOL fort_conf_rules_rt_conn_filtered(
         PCFORT_CONF_RULES_RT rules_rt, PFORT_CONF_META_CONN conn, UINT16 rule_id);
 
-FORT_API BOOL fort_conf_rules_conn_filtered(PCFORT_CONF_RULES rules, PCFORT_CONF_ZONES zones,
+FORT_API BOOL fort_conf_rules_conn_filtered(PCFORT_CONF_RULES rules, PCFORT_CONF_ZONES_RT zones,
         PFORT_CONF_META_CONN conn, UINT16 rule_id);
 
+/* Mask of (1 << FORT_RULE_FILTER_TYPE_*), used by the rules' filters */
+FORT_API UINT32 fort_conf_rules_filter_types(PCFORT_CONF_RULES rules);
+
 #define fort_conf_rules_rt_rule(rt, rule_id)                                                       \
     ((PFORT_CONF_RULE) ((rt)->rules_data + (rt)->rule_offsets[rule_id]))
 
 FORT_API FORT_CONF_RULES_RT fort_conf_rules_rt_make(
-        PCFORT_CONF_RULES rules, PCFORT_CONF_ZONES zones);
+        PCFORT_CONF_RULES rules, PCFORT_CONF_ZONES_RT zones);
 
 #ifdef __cplusplus
 } // extern "C"
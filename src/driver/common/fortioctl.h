@@ -27,19 +27,29 @@ enum {
     FORT_IOCTL_INDEX_SETZONEFLAG,
     FORT_IOCTL_INDEX_SETRULES,
     FORT_IOCTL_INDEX_SETRULEFLAG,
+    FORT_IOCTL_INDEX_UPDATEAPPS,
+    FORT_IOCTL_INDEX_MAPLOG,
+    FORT_IOCTL_INDEX_SETCONFDELTA,
+    FORT_IOCTL_INDEX_SETZONE,
+    FORT_IOCTL_INDEX_GETCONFSTAT,
     FORT_IOCTL_INDEX_COUNT,
 };
 
-#define FORT_IOCTL_VALIDATE    FORT_CTL_CODE(FORT_IOCTL_INDEX_VALIDATE, FILE_WRITE_DATA)
-#define FORT_IOCTL_SETSERVICES FORT_CTL_CODE(FORT_IOCTL_INDEX_SETSERVICES, FILE_WRITE_DATA)
-#define FORT_IOCTL_SETCONF     FORT_CTL_CODE(FORT_IOCTL_INDEX_SETCONF, FILE_WRITE_DATA)
-#define FORT_IOCTL_SETFLAGS    FORT_CTL_CODE(FORT_IOCTL_INDEX_SETFLAGS, FILE_WRITE_DATA)
-#define FORT_IOCTL_GETLOG      FORT_CTL_CODE(FORT_IOCTL_INDEX_GETLOG, FILE_READ_DATA)
-#define FORT_IOCTL_ADDAPP      FORT_CTL_CODE(FORT_IOCTL_INDEX_ADDAPP, FILE_WRITE_DATA)
-#define FORT_IOCTL_DELAPP      FORT_CTL_CODE(FORT_IOCTL_INDEX_DELAPP, FILE_WRITE_DATA)
-#define FORT_IOCTL_SETZONES    FORT_CTL_CODE(FORT_IOCTL_INDEX_SETZONES, FILE_WRITE_DATA)
-#define FORT_IOCTL_SETZONEFLAG FORT_CTL_CODE(FORT_IOCTL_INDEX_SETZONEFLAG, FILE_WRITE_DATA)
-#define FORT_IOCTL_SETRULES    FORT_CTL_CODE(FORT_IOCTL_INDEX_SETRULES, FILE_WRITE_DATA)
-#define FORT_IOCTL_SETRULEFLAG FORT_CTL_CODE(FORT_IOCTL_INDEX_SETRULEFLAG, FILE_WRITE_DATA)
+#define FORT_IOCTL_VALIDATE     FORT_CTL_CODE(FORT_IOCTL_INDEX_VALIDATE, FILE_WRITE_DATA)
+#define FORT_IOCTL_SETSERVICES  FORT_CTL_CODE(FORT_IOCTL_INDEX_SETSERVICES, FILE_WRITE_DATA)
+#define FORT_IOCTL_SETCONF      FORT_CTL_CODE(FORT_IOCTL_INDEX_SETCONF, FILE_WRITE_DATA)
+#define FORT_IOCTL_SETFLAGS     FORT_CTL_CODE(FORT_IOCTL_INDEX_SETFLAGS, FILE_WRITE_DATA)
+#define FORT_IOCTL_GETLOG       FORT_CTL_CODE(FORT_IOCTL_INDEX_GETLOG, FILE_READ_DATA)
+#define FORT_IOCTL_ADDAPP       FORT_CTL_CODE(FORT_IOCTL_INDEX_ADDAPP, FILE_WRITE_DATA)
+#define FORT_IOCTL_DELAPP       FORT_CTL_CODE(FORT_IOCTL_INDEX_DELAPP, FILE_WRITE_DATA)
+#define FORT_IOCTL_SETZONES     FORT_CTL_CODE(FORT_IOCTL_INDEX_SETZONES, FILE_WRITE_DATA)
+#define FORT_IOCTL_SETZONEFLAG  FORT_CTL_CODE(FORT_IOCTL_INDEX_SETZONEFLAG, FILE_WRITE_DATA)
+#define FORT_IOCTL_SETRULES     FORT_CTL_CODE(FORT_IOCTL_INDEX_SETRULES, FILE_WRITE_DATA)
+#define FORT_IOCTL_SETRULEFLAG  FORT_CTL_CODE(FORT_IOCTL_INDEX_SETRULEFLAG, FILE_WRITE_DATA)
+#define FORT_IOCTL_UPDATEAPPS   FORT_CTL_CODE(FORT_IOCTL_INDEX_UPDATEAPPS, FILE_WRITE_DATA)
+#define FORT_IOCTL_MAPLOG       FORT_CTL_CODE(FORT_IOCTL_INDEX_MAPLOG, FILE_READ_DATA)
+#define FORT_IOCTL_SETCONFDELTA FORT_CTL_CODE(FORT_IOCTL_INDEX_SETCONFDELTA, FILE_WRITE_DATA)
+#define FORT_IOCTL_SETZONE      FORT_CTL_CODE(FORT_IOCTL_INDEX_SETZONE, FILE_WRITE_DATA)
+#define FORT_IOCTL_GETCONFSTAT  FORT_CTL_CODE(FORT_IOCTL_INDEX_GETCONFSTAT, FILE_READ_DATA)
 
 #endif // FORTIOCTL_H
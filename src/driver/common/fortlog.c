@@ -4,36 +4,42 @@
 
 #include "fortdef.h"
 
-FORT_API void fort_log_app_header_write(char *p, BOOL blocked, UINT32 pid, UINT16 path_len)
+FORT_API void fort_log_app_header_write(
+        char *p, BOOL blocked, UINT32 pid, UINT32 path_id, UINT16 path_len)
 {
     UINT32 *up = (UINT32 *) p;
 
     *up++ = fort_log_flag_type(FORT_LOG_TYPE_APP) | (blocked ? FORT_LOG_FLAG_OPT_BLOCKED : 0)
             | path_len;
-    *up = pid;
+    *up++ = pid;
+    *up = path_id;
 }
 
-FORT_API void fort_log_app_write(char *p, BOOL blocked, UINT32 pid, PCFORT_APP_PATH path)
+FORT_API void fort_log_app_write(
+        char *p, BOOL blocked, UINT32 pid, UINT32 path_id, PCFORT_APP_PATH path)
 {
     const UINT16 path_len = path->len;
 
-    fort_log_app_header_write(p, blocked, pid, path_len);
+    fort_log_app_header_write(p, blocked, pid, path_id, path_len);
 
     if (path_len != 0) {
         RtlCopyMemory(p + FORT_LOG_APP_HEADER_SIZE, path->buffer, path_len);
     }
 }
 
-FORT_API void fort_log_app_header_read(const char *p, BOOL *blocked, UINT32 *pid, UINT16 *path_len)
+FORT_API void fort_log_app_header_read(
+        const char *p, BOOL *blocked, UINT32 *pid, UINT32 *path_id, UINT16 *path_len)
 {
     const UINT32 *up = (const UINT32 *) p;
 
     *blocked = (*up & FORT_LOG_FLAG_OPT_BLOCKED) != 0;
     *path_len = (UINT16) (*up++ & ~FORT_LOG_FLAG_EX_MASK);
-    *pid = *up;
+    *pid = *up++;
+    *path_id = *up;
 }
 
-FORT_API void fort_log_conn_header_write(char *p, PCFORT_CONF_META_CONN conn, UINT16 path_len)
+FORT_API void fort_log_conn_header_write(
+        char *p, PCFORT_CONF_META_CONN conn, UINT32 path_id, UINT16 path_len)
 {
     UINT32 *up = (UINT32 *) p;
 
@@ -45,6 +51,7 @@ FORT_API void fort_log_conn_header_write(char *p, PCFORT_CONF_META_CONN conn, UI
     *up++ = ((UINT32) conn->rule_id) | ((UINT32) conn->zone_id << 16);
     *up++ = conn->local_port | ((UINT32) conn->remote_port << 16);
     *up++ = conn->process_id;
+    *up++ = path_id;
 
     const int ip_size = FORT_IP_ADDR_SIZE(conn->isIPv6);
 
@@ -56,18 +63,20 @@ FORT_API void fort_log_conn_header_write(char *p, PCFORT_CONF_META_CONN conn, UI
     RtlCopyMemory(up, conn->remote_ip.data, ip_size);
 }
 
-FORT_API void fort_log_conn_write(char *p, PCFORT_CONF_META_CONN conn, PCFORT_APP_PATH path)
+FORT_API void fort_log_conn_write(
+        char *p, PCFORT_CONF_META_CONN conn, UINT32 path_id, PCFORT_APP_PATH path)
 {
     const UINT16 path_len = path->len;
 
-    fort_log_conn_header_write(p, conn, path_len);
+    fort_log_conn_header_write(p, conn, path_id, path_len);
 
     if (path_len != 0) {
         RtlCopyMemory(p + FORT_LOG_CONN_HEADER_SIZE(conn->isIPv6), path->buffer, path_len);
     }
 }
 
-FORT_API void fort_log_conn_header_read(const char *p, PFORT_CONF_META_CONN conn, UINT16 *path_len)
+FORT_API void fort_log_conn_header_read(
+        const char *p, PFORT_CONF_META_CONN conn, UINT32 *path_id, UINT16 *path_len)
 {
     const UINT32 *up = (const UINT32 *) p;
 
@@ -95,6 +104,8 @@ FORT_API void fort_log_conn_header_read(const char *p, PFORT_CONF_META_CONN conn
     v = *up++;
     conn->process_id = v;
 
+    *path_id = *up++;
+
     const int ip_size = FORT_IP_ADDR_SIZE(conn->isIPv6);
 
     // Local IP
@@ -105,45 +116,128 @@ FORT_API void fort_log_conn_header_read(const char *p, PFORT_CONF_META_CONN conn
     RtlCopyMemory(conn->remote_ip.data, up, ip_size);
 }
 
-FORT_API void fort_log_proc_new_header_write(char *p, UINT32 pid, UINT16 path_len)
+FORT_API void fort_log_proc_new_header_write(char *p, UINT32 pid, UINT32 path_id, UINT16 path_len)
 {
     UINT32 *up = (UINT32 *) p;
 
     *up++ = fort_log_flag_type(FORT_LOG_TYPE_PROC_NEW) | path_len;
-    *up = pid;
+    *up++ = pid;
+    *up = path_id;
 }
 
-FORT_API void fort_log_proc_new_write(char *p, UINT32 pid, PCFORT_APP_PATH path)
+FORT_API void fort_log_proc_new_write(char *p, UINT32 pid, UINT32 path_id, PCFORT_APP_PATH path)
 {
     const UINT16 path_len = path->len;
 
-    fort_log_proc_new_header_write(p, pid, path_len);
+    fort_log_proc_new_header_write(p, pid, path_id, path_len);
 
     if (path_len != 0) {
         RtlCopyMemory(p + FORT_LOG_PROC_NEW_HEADER_SIZE, path->buffer, path_len);
     }
 }
 
-FORT_API void fort_log_proc_new_header_read(const char *p, UINT32 *pid, UINT16 *path_len)
+FORT_API void fort_log_proc_new_header_read(
+        const char *p, UINT32 *pid, UINT32 *path_id, UINT16 *path_len)
 {
     const UINT32 *up = (const UINT32 *) p;
 
     *path_len = (*up++ & ~FORT_LOG_FLAG_EX_MASK);
-    *pid = *up;
+    *pid = *up++;
+    *path_id = *up;
+}
+
+FORT_API UINT32 fort_log_varint_size(UINT64 v)
+{
+    UINT32 size = 1;
+
+    while (v >= 0x80) {
+        v >>= 7;
+        ++size;
+    }
+
+    return size;
 }
 
-FORT_API void fort_log_stat_traf_header_write(char *p, UINT16 proc_count)
+/* LEB128: 7 bits per byte, the high bit marks the next byte */
+FORT_API char *fort_log_varint_write(char *p, UINT64 v)
+{
+    UCHAR *cp = (UCHAR *) p;
+
+    while (v >= 0x80) {
+        *cp++ = (UCHAR) (v | 0x80);
+        v >>= 7;
+    }
+    *cp++ = (UCHAR) v;
+
+    return (char *) cp;
+}
+
+FORT_API const char *fort_log_varint_read(const char *p, const char *end, UINT64 *v)
+{
+    const UCHAR *cp = (const UCHAR *) p;
+    UINT64 res = 0;
+
+    for (int shift = 0; shift < 64 && cp < (const UCHAR *) end; shift += 7) {
+        const UCHAR c = *cp++;
+
+        res |= (UINT64) (c & 0x7F) << shift;
+
+        if ((c & 0x80) == 0) {
+            *v = res;
+            return (const char *) cp;
+        }
+    }
+
+    return NULL; /* truncated */
+}
+
+FORT_API void fort_log_stat_traf_header_write(char *p, UINT16 proc_count, UINT32 data_len)
 {
     UINT32 *up = (UINT32 *) p;
 
-    *up = fort_log_flag_type(FORT_LOG_TYPE_STAT_TRAF) | proc_count;
+    *up++ = fort_log_flag_type(FORT_LOG_TYPE_STAT_TRAF) | proc_count;
+    *up = data_len;
 }
 
-FORT_API void fort_log_stat_traf_header_read(const char *p, UINT16 *proc_count)
+FORT_API void fort_log_stat_traf_header_read(const char *p, UINT16 *proc_count, UINT32 *data_len)
 {
     const UINT32 *up = (const UINT32 *) p;
 
-    *proc_count = (UINT16) *up;
+    *proc_count = (UINT16) *up++;
+    *data_len = *up;
+}
+
+FORT_API UINT32 fort_log_stat_traf_proc_size(UINT32 pid_flag, PCFORT_TRAF traf)
+{
+    return fort_log_varint_size(pid_flag) + fort_log_varint_size(traf->in_bytes)
+            + fort_log_varint_size(traf->out_bytes);
+}
+
+FORT_API char *fort_log_stat_traf_proc_write(char *p, UINT32 pid_flag, PCFORT_TRAF traf)
+{
+    p = fort_log_varint_write(p, pid_flag);
+    p = fort_log_varint_write(p, traf->in_bytes);
+    p = fort_log_varint_write(p, traf->out_bytes);
+
+    return p;
+}
+
+FORT_API const char *fort_log_stat_traf_proc_read(
+        const char *p, const char *end, UINT32 *pid_flag, PFORT_TRAF traf)
+{
+    UINT64 pid_v = 0;
+
+    p = fort_log_varint_read(p, end, &pid_v);
+    if (p != NULL) {
+        p = fort_log_varint_read(p, end, &traf->in_bytes);
+    }
+    if (p != NULL) {
+        p = fort_log_varint_read(p, end, &traf->out_bytes);
+    }
+
+    *pid_flag = (UINT32) pid_v;
+
+    return p;
 }
 
 FORT_API void fort_log_time_write(char *p, BOOL system_time_changed, INT64 unix_time)
@@ -161,3 +255,21 @@ FORT_API void fort_log_time_read(const char *p, BOOL *system_time_changed, INT64
     *system_time_changed = ((UCHAR) *up++ != 0);
     *unix_time = *((INT64 *) up);
 }
+
+FORT_API void fort_log_buffer_stat_write(char *p, UINT32 ring_size, UINT32 drop_count)
+{
+    UINT32 *up = (UINT32 *) p;
+
+    *up++ = fort_log_flag_type(FORT_LOG_TYPE_BUFFER_STAT);
+    *up++ = ring_size;
+    *up = drop_count;
+}
+
+FORT_API void fort_log_buffer_stat_read(const char *p, UINT32 *ring_size, UINT32 *drop_count)
+{
+    const UINT32 *up = (const UINT32 *) p;
+
+    ++up;
+    *ring_size = *up++;
+    *drop_count = *up;
+}
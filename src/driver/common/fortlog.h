@@ -20,65 +20,119 @@
 #define fort_log_type(p)                                                                           \
     ((*((UINT32 *) (p)) & FORT_LOG_FLAG_TYPE_MASK) >> FORT_LOG_FLAG_TYPE_MASK_OFF)
 
-#define FORT_LOG_APP_HEADER_SIZE (2 * sizeof(UINT32))
+/* The path is written with its id once, then the id refers to it; the zero id is not interned */
+#define FORT_LOG_APP_HEADER_SIZE (3 * sizeof(UINT32))
 
 #define FORT_LOG_APP_SIZE(path_len)                                                                \
     FORT_ALIGN_SIZE(FORT_LOG_APP_HEADER_SIZE + (path_len), FORT_LOG_ALIGN)
 
 #define FORT_IP_ADDR_SIZE(isIPv6) ((isIPv6) ? sizeof(ip6_addr_t) : sizeof(UINT32))
 
-#define FORT_LOG_CONN_HEADER_SIZE(isIPv6) (5 * sizeof(UINT32) + 2 * FORT_IP_ADDR_SIZE(isIPv6))
+#define FORT_LOG_CONN_HEADER_SIZE(isIPv6) (6 * sizeof(UINT32) + 2 * FORT_IP_ADDR_SIZE(isIPv6))
 
 #define FORT_LOG_CONN_SIZE(path_len, isIPv6)                                                       \
     FORT_ALIGN_SIZE(FORT_LOG_CONN_HEADER_SIZE(isIPv6) + (path_len), FORT_LOG_ALIGN)
 
-#define FORT_LOG_PROC_NEW_HEADER_SIZE (2 * sizeof(UINT32))
+#define FORT_LOG_PROC_NEW_HEADER_SIZE (3 * sizeof(UINT32))
 
 #define FORT_LOG_PROC_NEW_SIZE(path_len)                                                           \
     FORT_ALIGN_SIZE(FORT_LOG_PROC_NEW_HEADER_SIZE + (path_len), FORT_LOG_ALIGN)
 
-#define FORT_LOG_STAT_HEADER_SIZE (sizeof(UINT32))
+#define FORT_LOG_VARINT_SIZE_MAX 10 /* of UINT64 */
 
-#define FORT_LOG_STAT_TRAF_SIZE(proc_count) ((proc_count) * sizeof(UINT32) * 3)
+#define FORT_LOG_STAT_HEADER_SIZE (2 * sizeof(UINT32))
 
-#define FORT_LOG_STAT_SIZE(proc_count)                                                             \
-    (FORT_LOG_STAT_HEADER_SIZE + FORT_LOG_STAT_TRAF_SIZE(proc_count))
+/* Processes' traffic: varints of the process id with the terminated flag, of the in & out bytes */
+#define FORT_LOG_STAT_SIZE(data_len)                                                               \
+    FORT_ALIGN_SIZE(FORT_LOG_STAT_HEADER_SIZE + (data_len), FORT_LOG_ALIGN)
 
-#define FORT_LOG_STAT_BUFFER_PROC_COUNT                                                            \
-    ((FORT_BUFFER_SIZE - FORT_LOG_STAT_HEADER_SIZE) / FORT_LOG_STAT_TRAF_SIZE(1))
+#define FORT_LOG_STAT_BUFFER_DATA_SIZE (FORT_BUFFER_SIZE - FORT_LOG_STAT_HEADER_SIZE)
 
 #define FORT_LOG_TIME_SIZE (sizeof(UINT32) + sizeof(INT64))
 
+#define FORT_LOG_BUFFER_STAT_SIZE (3 * sizeof(UINT32))
+
+#define FORT_LOG_SHARED_SIZE_MIN (1 * 1024 * 1024)
+#define FORT_LOG_SHARED_SIZE_MAX (16 * 1024 * 1024)
+
+/* Ring of log entries shared with the client: an entry's zero header skips the data's end */
+typedef struct fort_log_shared
+{
+    UINT32 volatile head; /* written by the driver */
+    UINT32 volatile tail; /* written by the client */
+
+    UINT32 size; /* of data, power of 2 */
+    UINT32 reserved; /* not used */
+
+    char data[4];
+} FORT_LOG_SHARED, *PFORT_LOG_SHARED;
+
+#define FORT_LOG_SHARED_DATA_OFF offsetof(FORT_LOG_SHARED, data)
+
+typedef struct fort_log_shared_map
+{
+    UINT32 size; /* requested */
+    UINT32 reserved; /* not used */
+
+    UINT64 address; /* of the mapped ring */
+} FORT_LOG_SHARED_MAP, *PFORT_LOG_SHARED_MAP;
+
+typedef const FORT_LOG_SHARED_MAP *PCFORT_LOG_SHARED_MAP;
+
 #if defined(__cplusplus)
 extern "C" {
 #endif
 
-FORT_API void fort_log_app_header_write(char *p, BOOL blocked, UINT32 pid, UINT16 path_len);
+FORT_API void fort_log_app_header_write(
+        char *p, BOOL blocked, UINT32 pid, UINT32 path_id, UINT16 path_len);
 
-FORT_API void fort_log_app_write(char *p, BOOL blocked, UINT32 pid, PCFORT_APP_PATH path);
+FORT_API void fort_log_app_write(
+        char *p, BOOL blocked, UINT32 pid, UINT32 path_id, PCFORT_APP_PATH path);
 
-FORT_API void fort_log_app_header_read(const char *p, BOOL *blocked, UINT32 *pid, UINT16 *path_len);
+FORT_API void fort_log_app_header_read(
+        const char *p, BOOL *blocked, UINT32 *pid, UINT32 *path_id, UINT16 *path_len);
 
-FORT_API void fort_log_conn_header_write(char *p, PCFORT_CONF_META_CONN conn, UINT16 path_len);
+FORT_API void fort_log_conn_header_write(
+        char *p, PCFORT_CONF_META_CONN conn, UINT32 path_id, UINT16 path_len);
 
-FORT_API void fort_log_conn_write(char *p, PCFORT_CONF_META_CONN conn, PCFORT_APP_PATH path);
+FORT_API void fort_log_conn_write(
+        char *p, PCFORT_CONF_META_CONN conn, UINT32 path_id, PCFORT_APP_PATH path);
 
-FORT_API void fort_log_conn_header_read(const char *p, PFORT_CONF_META_CONN conn, UINT16 *path_len);
+FORT_API void fort_log_conn_header_read(
+        const char *p, PFORT_CONF_META_CONN conn, UINT32 *path_id, UINT16 *path_len);
 
-FORT_API void fort_log_proc_new_header_write(char *p, UINT32 pid, UINT16 path_len);
+FORT_API void fort_log_proc_new_header_write(char *p, UINT32 pid, UINT32 path_id, UINT16 path_len);
 
-FORT_API void fort_log_proc_new_write(char *p, UINT32 pid, PCFORT_APP_PATH path);
+FORT_API void fort_log_proc_new_write(char *p, UINT32 pid, UINT32 path_id, PCFORT_APP_PATH path);
 
-FORT_API void fort_log_proc_new_header_read(const char *p, UINT32 *pid, UINT16 *path_len);
+FORT_API void fort_log_proc_new_header_read(
+        const char *p, UINT32 *pid, UINT32 *path_id, UINT16 *path_len);
 
-FORT_API void fort_log_stat_traf_header_write(char *p, UINT16 proc_count);
+FORT_API UINT32 fort_log_varint_size(UINT64 v);
 
-FORT_API void fort_log_stat_traf_header_read(const char *p, UINT16 *proc_count);
+FORT_API char *fort_log_varint_write(char *p, UINT64 v);
+
+FORT_API const char *fort_log_varint_read(const char *p, const char *end, UINT64 *v);
+
+FORT_API void fort_log_stat_traf_header_write(char *p, UINT16 proc_count, UINT32 data_len);
+
+FORT_API void fort_log_stat_traf_header_read(const char *p, UINT16 *proc_count, UINT32 *data_len);
+
+FORT_API UINT32 fort_log_stat_traf_proc_size(UINT32 pid_flag, PCFORT_TRAF traf);
+
+FORT_API char *fort_log_stat_traf_proc_write(char *p, UINT32 pid_flag, PCFORT_TRAF traf);
+
+FORT_API const char *fort_log_stat_traf_proc_read(
+        const char *p, const char *end, UINT32 *pid_flag, PFORT_TRAF traf);
 
 FORT_API void fort_log_time_write(char *p, BOOL system_time_changed, INT64 unix_time);
 
 FORT_API void fort_log_time_read(const char *p, BOOL *system_time_changed, INT64 *unix_time);
 
+FORT_API void fort_log_buffer_stat_write(char *p, UINT32 ring_size, UINT32 drop_count);
+
+FORT_API void fort_log_buffer_stat_read(const char *p, UINT32 *ring_size, UINT32 *drop_count);
+
 #ifdef __cplusplus
 } // extern "C"
 #endif
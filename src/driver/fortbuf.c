@@ -9,6 +9,17 @@
 
 #define FORT_BUFFER_POOL_TAG 'BwfF'
 
+#define FORT_BUFFER_RING_SIZE       (32 * 1024) /* power of 2 */
+#define FORT_BUFFER_TIMER_RING_SIZE (64 * 1024) /* power of 2 */
+
+/* Complete the pending request, when a ring has so much data */
+#define FORT_BUFFER_RING_FLUSH_SIZE (FORT_BUFFER_SIZE / 2)
+
+/* While the log timer is slowed down, the first writer flushes the log itself */
+#define FORT_BUFFER_IDLE_OFF   0
+#define FORT_BUFFER_IDLE_WAIT  1
+#define FORT_BUFFER_IDLE_WOKEN 2
+
 static FORT_APP_PATH fort_buffer_adjust_log_path(PCFORT_CONF_META_CONN conn)
 {
     FORT_APP_PATH log_path = conn->real_path;
@@ -20,251 +31,722 @@ static FORT_APP_PATH fort_buffer_adjust_log_path(PCFORT_CONF_META_CONN conn)
     return log_path;
 }
 
-static PFORT_BUFFER_DATA fort_buffer_data_new(PFORT_BUFFER buf)
+static PFORT_BUFFER_RING_HEADER fort_buffer_ring_header(PFORT_BUFFER_RING ring, LONG64 pos)
 {
-    PFORT_BUFFER_DATA data = buf->data_free;
+    return (PFORT_BUFFER_RING_HEADER) (ring->data + ((UINT32) pos & ring->size_mask));
+}
 
-    if (data != NULL) {
-        buf->data_free = data->next;
-    } else {
-        data = fort_mem_alloc(sizeof(FORT_BUFFER_DATA), FORT_BUFFER_POOL_TAG);
-    }
+static void fort_buffer_ring_commit(PFORT_BUFFER_RING_HEADER header, LONG64 pos, UINT32 len)
+{
+    header->len = len;
 
-    return data;
+    InterlockedExchange(&header->seq, fort_buffer_ring_seq(pos));
 }
 
-static void fort_buffer_data_del(PFORT_BUFFER_DATA data)
+/* The reader moves the tail by InterlockedExchange64(), so read it whole on x86 too */
+inline static LONG64 fort_buffer_ring_tail(PFORT_BUFFER_RING ring)
 {
-    while (data != NULL) {
-        PFORT_BUFFER_DATA next = data->next;
-        fort_mem_free(data, FORT_BUFFER_POOL_TAG);
-        data = next;
-    }
+    return InterlockedCompareExchange64(&ring->tail, 0, 0);
 }
 
-static PFORT_BUFFER_DATA fort_buffer_data_alloc(PFORT_BUFFER buf, UINT32 len)
+static PFORT_BUFFER_RING_HEADER fort_buffer_ring_reserve(
+        PFORT_BUFFER_RING ring, UINT32 len, LONG64 *pos)
 {
-    PFORT_BUFFER_DATA data = buf->data_tail;
+    const UINT32 ring_size = ring->size_mask + 1;
+    const UINT32 record_size = FORT_BUFFER_RING_RECORD_SIZE(len);
 
-    if (data == NULL || len > FORT_BUFFER_SIZE - data->top) {
-        if (len > FORT_BUFFER_SIZE)
-            return NULL;
+    LONG64 head = ring->head;
+    UINT32 skip_size;
+
+    for (;;) {
+        const UINT32 to_end = ring_size - ((UINT32) head & ring->size_mask);
 
-        PFORT_BUFFER_DATA new_data = fort_buffer_data_new(buf);
-        if (new_data == NULL)
+        /* The record must be contiguous */
+        skip_size = (record_size > to_end) ? to_end : 0;
+
+        const LONG64 new_head = head + skip_size + record_size;
+
+        /* Is the ring full? */
+        if (new_head - fort_buffer_ring_tail(ring) > ring_size)
             return NULL;
 
-        new_data->top = 0;
-        new_data->next = NULL;
+        const LONG64 old_head = InterlockedCompareExchange64(&ring->head, new_head, head);
+        if (old_head == head)
+            break;
+
+        head = old_head;
+    }
+
+    if (skip_size != 0) {
+        fort_buffer_ring_commit(fort_buffer_ring_header(ring, head), head, /*len=*/0);
+
+        head += skip_size;
+    }
+
+    *pos = head;
+
+    return fort_buffer_ring_header(ring, head);
+}
+
+static ULONG fort_buffer_ring_drain(PFORT_BUFFER_RING ring, PCHAR out, ULONG out_len, BOOL *is_full)
+{
+    const UINT32 ring_size = ring->size_mask + 1;
+
+    LONG64 tail = ring->tail;
+    ULONG out_top = 0;
+
+    for (;;) {
+        PFORT_BUFFER_RING_HEADER header = fort_buffer_ring_header(ring, tail);
 
-        if (data == NULL) {
-            buf->data_head = new_data;
+        /* Is the record committed? */
+        if (header->seq != fort_buffer_ring_seq(tail))
+            break;
+
+        KeMemoryBarrier();
+
+        const UINT32 len = header->len;
+        UINT32 record_size;
+
+        if (len == 0) {
+            record_size = ring_size - ((UINT32) tail & ring->size_mask);
+        } else if (tail < ring->discard_head) {
+            /* The record was reserved before the buffer's clear */
+            record_size = FORT_BUFFER_RING_RECORD_SIZE(len);
         } else {
-            data->next = new_data;
+            if (len > out_len - out_top) {
+                *is_full = TRUE;
+                break;
+            }
+
+            if (out != NULL) {
+                RtlCopyMemory(out + out_top, header + 1, len);
+            }
+
+            out_top += len;
+            record_size = FORT_BUFFER_RING_RECORD_SIZE(len);
         }
 
-        buf->data_tail = new_data;
+        /* Producers find the free space zeroed, i.e. not committed */
+        RtlZeroMemory(header, record_size);
+
+        tail += record_size;
+    }
+
+    if (tail != ring->tail) {
+        InterlockedExchange64(&ring->tail, tail);
+    }
+
+    return out_top;
+}
+
+static PFORT_BUFFER_RING fort_buffer_timer_ring(PFORT_BUFFER buf)
+{
+    return &buf->rings[buf->ring_count];
+}
+
+static PFORT_BUFFER_RING fort_buffer_cpu_ring(PFORT_BUFFER buf)
+{
+    const ULONG cpu_index = KeGetCurrentProcessorNumberEx(NULL) % buf->ring_count;
+
+    return &buf->rings[cpu_index];
+}
+
+static ULONG fort_buffer_drain_drop_stat(
+        PFORT_BUFFER buf, UINT32 ring_size, PCHAR out, ULONG out_len)
+{
+    if (buf->drop_count == 0 || out_len < FORT_LOG_BUFFER_STAT_SIZE)
+        return 0;
+
+    const UINT32 drop_count = (UINT32) InterlockedExchange(&buf->drop_count, 0);
+
+    if (out != NULL) {
+        fort_log_buffer_stat_write(out, ring_size, drop_count);
+    }
+
+    return FORT_LOG_BUFFER_STAT_SIZE;
+}
+
+static ULONG fort_buffer_drain_locked(PFORT_BUFFER buf, PCHAR out, ULONG out_len, BOOL *is_full)
+{
+    if (buf->rings == NULL)
+        return 0;
+
+    ULONG out_top = 0;
+
+    /* The timer's ring is drained last: its traffic refers to the processes logged by CPUs */
+    for (UINT32 i = 0; i <= buf->ring_count && !*is_full; ++i) {
+        PFORT_BUFFER_RING ring = &buf->rings[i];
 
-        data = new_data;
+        out_top += fort_buffer_ring_drain(
+                ring, (out != NULL ? out + out_top : NULL), out_len - out_top, is_full);
     }
 
-    return data;
+    /* Only the CPUs' rings drop the connections' log */
+    if (!*is_full) {
+        const UINT32 ring_size = buf->rings[0].size_mask + 1;
+
+        out_top += fort_buffer_drain_drop_stat(
+                buf, ring_size, (out != NULL ? out + out_top : NULL), out_len - out_top);
+    }
+
+    return out_top;
 }
 
-static void fort_buffer_data_shift(PFORT_BUFFER buf)
+static ULONG fort_buffer_drain_shared_locked(PFORT_BUFFER buf)
 {
-    PFORT_BUFFER_DATA data = buf->data_head;
+    PFORT_LOG_SHARED shared = buf->shared;
+
+    /* The client may corrupt the shared header, so only its tail is read */
+    const UINT32 size = buf->shared_size;
+    const UINT32 tail = shared->tail;
+
+    UINT32 head = buf->shared_head;
+    ULONG drained_len = 0;
+
+    for (;;) {
+        const UINT32 used_len = head - tail;
+        if (used_len >= size)
+            break;
+
+        const UINT32 off = head & (size - 1);
+        const UINT32 to_end = size - off;
+        const BOOL is_till_end = (size - used_len >= to_end);
+
+        BOOL is_full = FALSE;
+        const ULONG out_top = fort_buffer_drain_locked(
+                buf, shared->data + off, (is_till_end ? to_end : size - used_len), &is_full);
+
+        head += out_top;
+        drained_len += out_top;
 
-    buf->data_head = data->next;
+        if (!is_full || !is_till_end || (off == 0 && out_top == 0))
+            break;
 
-    if (data->next == NULL) {
-        buf->data_tail = NULL;
+        /* Skip the data's end, which does not fit the next entry */
+        const UINT32 skip_len = to_end - out_top;
+        if (skip_len != 0) {
+            /* The client skips the too short end without the zero header */
+            if (skip_len >= sizeof(UINT32)) {
+                *((UINT32 *) (shared->data + off + out_top)) = 0;
+            }
+
+            head += skip_len;
+        }
     }
 
-    data->next = buf->data_free;
-    buf->data_free = data;
+    if (head != buf->shared_head) {
+        buf->shared_head = head;
+
+        InterlockedExchange((LONG volatile *) &shared->head, (LONG) head);
+    }
+
+    return drained_len;
+}
+
+static void fort_buffer_ring_init(PFORT_BUFFER_RING ring, PCHAR data, UINT32 size)
+{
+    ring->head = 0;
+    ring->tail = 0;
+    ring->discard_head = 0;
+    ring->size_mask = size - 1;
+    ring->data = data;
+
+    fort_buffer_path_cache_init(&ring->path_cache);
 }
 
 FORT_API void fort_buffer_open(PFORT_BUFFER buf)
 {
     KeInitializeSpinLock(&buf->lock);
+
+    const ULONG cpu_count = KeQueryMaximumProcessorCountEx(ALL_PROCESSOR_GROUPS);
+
+    fort_buffer_paths_open(&buf->paths, cpu_count);
+
+    const ULONG data_size = cpu_count * FORT_BUFFER_RING_SIZE + FORT_BUFFER_TIMER_RING_SIZE;
+
+    buf->rings = fort_mem_alloc((cpu_count + 1) * sizeof(FORT_BUFFER_RING), FORT_BUFFER_POOL_TAG);
+    if (buf->rings == NULL)
+        return;
+
+    PCHAR data = fort_mem_alloc(data_size, FORT_BUFFER_POOL_TAG);
+    if (data == NULL) {
+        fort_mem_free(buf->rings, FORT_BUFFER_POOL_TAG);
+        buf->rings = NULL;
+        return;
+    }
+
+    RtlZeroMemory(data, data_size);
+
+    for (UINT32 i = 0; i < cpu_count; ++i) {
+        fort_buffer_ring_init(&buf->rings[i], data, FORT_BUFFER_RING_SIZE);
+        data += FORT_BUFFER_RING_SIZE;
+    }
+
+    fort_buffer_ring_init(&buf->rings[cpu_count], data, FORT_BUFFER_TIMER_RING_SIZE);
+
+    buf->ring_count = cpu_count;
 }
 
 FORT_API void fort_buffer_close(PFORT_BUFFER buf)
 {
-    fort_buffer_data_del(buf->data_head);
-    fort_buffer_data_del(buf->data_free);
+    fort_buffer_paths_close(&buf->paths);
+
+    if (buf->rings == NULL)
+        return;
+
+    fort_mem_free(buf->rings[0].data, FORT_BUFFER_POOL_TAG);
+    fort_mem_free(buf->rings, FORT_BUFFER_POOL_TAG);
+
+    buf->rings = NULL;
+    buf->ring_count = 0;
 }
 
-FORT_API void fort_buffer_clear(PFORT_BUFFER buf)
+static void fort_buffer_discard_locked(PFORT_BUFFER buf)
 {
-    KLOCK_QUEUE_HANDLE lock_queue;
-    KeAcquireInStackQueuedSpinLock(&buf->lock, &lock_queue);
+    if (buf->rings == NULL)
+        return;
 
-    fort_buffer_close(buf);
+    /* The being written records are discarded later, when they are committed */
+    for (UINT32 i = 0; i <= buf->ring_count; ++i) {
+        PFORT_BUFFER_RING ring = &buf->rings[i];
 
-    buf->data_head = NULL;
-    buf->data_tail = NULL;
-    buf->data_free = NULL;
+        ring->discard_head = ring->head;
+    }
 
-    KeReleaseInStackQueuedSpinLock(&lock_queue);
+    BOOL is_full = FALSE;
+    fort_buffer_drain_locked(buf, /*out=*/NULL, MAXULONG, &is_full);
+
+    buf->drop_count = 0;
 }
 
-static void fort_buffer_flush_pending_out(PFORT_BUFFER buf, PFORT_IRP_INFO irp_info, UINT32 out_top)
+FORT_API void fort_buffer_clear(PFORT_BUFFER buf)
 {
-    PIRP *irp = &irp_info->irp;
+    /* The paths' lock keeps the interning writers out, so the next client gets
+     * only the records, which are reserved after the paths' clear */
+    KLOCK_QUEUE_HANDLE paths_lock_queue;
+    KeAcquireInStackQueuedSpinLock(&buf->paths.lock, &paths_lock_queue);
+    {
+        /* The rings' cached paths are stale, wait for their current lookups */
+        InterlockedIncrement(&buf->paths.gen);
 
-    if (irp != NULL && *irp == NULL) {
-        *irp = buf->irp;
-        buf->irp = NULL;
+        for (UINT32 i = 0; buf->rings != NULL && i < buf->ring_count; ++i) {
+            fort_buffer_path_cache_wait(&buf->rings[i].path_cache);
+        }
 
-        irp_info->info = out_top;
+        KLOCK_QUEUE_HANDLE lock_queue;
+        KeAcquireInStackQueuedSpinLock(&buf->lock, &lock_queue);
 
-        buf->out_top = 0;
-        buf->out_len = 0;
+        fort_buffer_discard_locked(buf);
+
+        KeReleaseInStackQueuedSpinLock(&lock_queue);
+
+        /* The next client knows no paths */
+        fort_buffer_paths_clear_locked(&buf->paths);
     }
+    KeReleaseInStackQueuedSpinLock(&paths_lock_queue);
 }
 
-inline static NTSTATUS fort_buffer_prepare_pending(
-        PFORT_BUFFER buf, UINT32 len, PCHAR *out, PFORT_IRP_INFO irp_info)
+static UINT32 fort_buffer_shared_size(UINT32 size)
 {
-    const ULONG out_len = buf->out_len;
-    if (out_len == 0)
-        return FALSE;
+    UINT32 shared_size = FORT_LOG_SHARED_SIZE_MIN;
 
-    UINT32 out_top = buf->out_top;
-    const UINT32 new_top = out_top + len;
+    while (shared_size < size && shared_size < FORT_LOG_SHARED_SIZE_MAX) {
+        shared_size <<= 1;
+    }
 
-    const INT32 free_len = (INT32) out_len - (INT32) new_top;
+    return shared_size;
+}
 
-    /* Use the pending buffer? */
-    const BOOL use_buffer = (free_len >= 0);
-    if (use_buffer) {
-        *out = buf->out + out_top;
+static void fort_buffer_shared_free(PFORT_LOG_SHARED shared, PMDL mdl, PVOID address)
+{
+    if (address != NULL) {
+        MmUnmapLockedPages(address, mdl);
+    }
 
-        buf->out_top = new_top;
-        out_top = new_top;
+    if (mdl != NULL) {
+        IoFreeMdl(mdl);
     }
 
-    /* Flush logs? */
-    const BOOL flush_logs = (free_len < FORT_LOG_TIME_SIZE);
-    if (flush_logs) {
-        fort_buffer_flush_pending_out(buf, irp_info, out_top);
+    fort_mem_free(shared, FORT_BUFFER_POOL_TAG);
+}
+
+static PVOID fort_buffer_shared_map_user(PMDL mdl)
+{
+    PVOID address;
+
+    /* Mapping to the user space raises an exception on failure */
+    __try {
+        address = MmMapLockedPagesSpecifyCache(mdl, UserMode, MmCached, /*requestedAddress=*/NULL,
+                /*bugCheckOnFailure=*/FALSE, NormalPagePriority | MdlMappingNoExecute);
+    } __except (EXCEPTION_EXECUTE_HANDLER) {
+        address = NULL;
     }
 
-    return use_buffer;
+    return address;
 }
 
-inline static NTSTATUS fort_buffer_prepare_new(PFORT_BUFFER buf, UINT32 len, PCHAR *out)
+FORT_API NTSTATUS fort_buffer_shared_map(PFORT_BUFFER buf, UINT32 size, PVOID *address)
 {
-    PFORT_BUFFER_DATA data = fort_buffer_data_alloc(buf, len);
-    if (data == NULL) {
-        LOG("Buffer OOM: len=%d\n", len);
-        TRACE(FORT_BUFFER_OOM, STATUS_INSUFFICIENT_RESOURCES, len, 0);
+    if (buf->shared != NULL)
+        return STATUS_INVALID_DEVICE_STATE;
+
+    const UINT32 shared_size = fort_buffer_shared_size(size);
+    const ULONG alloc_size = FORT_ALIGN_SIZE(FORT_LOG_SHARED_DATA_OFF + shared_size, PAGE_SIZE);
+
+    /* Whole pages are allocated, so nothing else is mapped to the client */
+    PFORT_LOG_SHARED shared = fort_mem_alloc(alloc_size, FORT_BUFFER_POOL_TAG);
+    if (shared == NULL)
+        return STATUS_INSUFFICIENT_RESOURCES;
+
+    RtlZeroMemory(shared, alloc_size);
+
+    shared->size = shared_size;
+
+    PMDL mdl = IoAllocateMdl(shared, alloc_size, /*secondaryBuffer=*/FALSE,
+            /*chargeQuota=*/FALSE, /*irp=*/NULL);
+    if (mdl == NULL) {
+        fort_buffer_shared_free(shared, /*mdl=*/NULL, /*address=*/NULL);
         return STATUS_INSUFFICIENT_RESOURCES;
     }
 
-    *out = data->p + data->top;
-    data->top += len;
+    MmBuildMdlForNonPagedPool(mdl);
+
+    PVOID user_address = fort_buffer_shared_map_user(mdl);
+    if (user_address == NULL) {
+        fort_buffer_shared_free(shared, mdl, /*address=*/NULL);
+        return STATUS_INSUFFICIENT_RESOURCES;
+    }
+
+    KLOCK_QUEUE_HANDLE lock_queue;
+    KeAcquireInStackQueuedSpinLock(&buf->lock, &lock_queue);
+    {
+        buf->shared = shared;
+        buf->shared_mdl = mdl;
+        buf->shared_address = user_address;
+        buf->shared_head = 0;
+        buf->shared_size = shared_size;
+    }
+    KeReleaseInStackQueuedSpinLock(&lock_queue);
+
+    *address = user_address;
 
     return STATUS_SUCCESS;
 }
 
-FORT_API NTSTATUS fort_buffer_prepare(
-        PFORT_BUFFER buf, UINT32 len, PCHAR *out, PFORT_IRP_INFO irp_info)
+FORT_API void fort_buffer_shared_unmap(PFORT_BUFFER buf)
 {
-    /* Check a pending buffer */
-    if (buf->data_head == NULL) {
-        if (fort_buffer_prepare_pending(buf, len, out, irp_info))
-            return STATUS_SUCCESS;
+    PFORT_LOG_SHARED shared;
+    PMDL mdl;
+    PVOID address;
+
+    KLOCK_QUEUE_HANDLE lock_queue;
+    KeAcquireInStackQueuedSpinLock(&buf->lock, &lock_queue);
+    {
+        shared = buf->shared;
+        mdl = buf->shared_mdl;
+        address = buf->shared_address;
+
+        buf->shared = NULL;
+        buf->shared_mdl = NULL;
+        buf->shared_address = NULL;
     }
+    KeReleaseInStackQueuedSpinLock(&lock_queue);
 
-    return fort_buffer_prepare_new(buf, len, out);
+    /* Unmap in the client's process context */
+    if (shared != NULL) {
+        fort_buffer_shared_free(shared, mdl, address);
+    }
 }
 
-FORT_API NTSTATUS fort_buffer_conn_write(PFORT_BUFFER buf, PCFORT_CONF_META_CONN conn,
-        PFORT_IRP_INFO irp_info, FORT_BUFFER_CONN_WRITE_TYPE log_type)
+static void fort_buffer_flush_pending_out(PFORT_BUFFER buf, PFORT_IRP_INFO irp_info, ULONG out_top)
+{
+    PIRP *irp = &irp_info->irp;
+
+    if (irp != NULL && *irp == NULL) {
+        *irp = buf->irp;
+        buf->irp = NULL;
+
+        irp_info->info = out_top;
+
+        buf->out_len = 0;
+    }
+}
+
+FORT_API NTSTATUS fort_buffer_prepare(PFORT_BUFFER buf, UINT32 len, PCHAR *out)
+{
+    if (buf->rings == NULL)
+        return STATUS_INSUFFICIENT_RESOURCES;
+
+    /* The timer's ring is written and drained under the lock, so commit it at once */
+    PFORT_BUFFER_RING ring = fort_buffer_timer_ring(buf);
+
+    LONG64 pos;
+    PFORT_BUFFER_RING_HEADER header = fort_buffer_ring_reserve(ring, len, &pos);
+    if (header == NULL) {
+        LOG("Buffer OOM: len=%d\n", len);
+        TRACE(FORT_BUFFER_OOM, STATUS_INSUFFICIENT_RESOURCES, len, 0);
+        return STATUS_INSUFFICIENT_RESOURCES;
+    }
+
+    *out = (PCHAR) (header + 1);
+
+    fort_buffer_ring_commit(header, pos, len);
+
+    return STATUS_SUCCESS;
+}
+
+typedef struct fort_buffer_conn_write_arg
 {
-    NTSTATUS status;
+    FORT_BUFFER_CONN_WRITE_TYPE log_type;
 
-    const FORT_APP_PATH log_path = fort_buffer_adjust_log_path(conn);
+    UINT32 path_id;
+    FORT_APP_PATH log_path; /* empty, when the ring has the path's id already */
 
     UINT32 len;
-    switch (log_type) {
+    LONG64 pos;
+    PFORT_BUFFER_RING ring;
+} FORT_BUFFER_CONN_WRITE_ARG, *PFORT_BUFFER_CONN_WRITE_ARG;
+
+typedef const FORT_BUFFER_CONN_WRITE_ARG *PCFORT_BUFFER_CONN_WRITE_ARG;
+
+inline static void fort_buffer_conn_write_log(
+        PCHAR out, PCFORT_CONF_META_CONN conn, PCFORT_BUFFER_CONN_WRITE_ARG wa)
+{
+    const UINT32 path_id = wa->path_id;
+    PCFORT_APP_PATH log_path = &wa->log_path;
+
+    switch (wa->log_type) {
     case FORT_BUFFER_CONN_WRITE_APP: {
-        len = FORT_LOG_APP_SIZE(log_path.len);
+        const BOOL blocked = conn->app_data.flags.blocked;
+
+        fort_log_app_write(out, blocked, conn->process_id, path_id, log_path);
     } break;
     case FORT_BUFFER_CONN_WRITE_CONN: {
-        len = FORT_LOG_CONN_SIZE(log_path.len, conn->isIPv6);
+        fort_log_conn_write(out, conn, path_id, log_path);
     } break;
     case FORT_BUFFER_CONN_WRITE_PROC_NEW: {
-        len = FORT_LOG_PROC_NEW_SIZE(log_path.len);
+        fort_log_proc_new_write(out, conn->process_id, path_id, log_path);
     } break;
     }
+}
 
-    KLOCK_QUEUE_HANDLE lock_queue;
-    KeAcquireInStackQueuedSpinLock(&buf->lock, &lock_queue);
+inline static UINT32 fort_buffer_conn_write_len(
+        PCFORT_CONF_META_CONN conn, PCFORT_BUFFER_CONN_WRITE_ARG wa)
+{
+    const UINT16 path_len = wa->log_path.len;
+
+    switch (wa->log_type) {
+    case FORT_BUFFER_CONN_WRITE_APP:
+        return FORT_LOG_APP_SIZE(path_len);
+    case FORT_BUFFER_CONN_WRITE_CONN:
+        return FORT_LOG_CONN_SIZE(path_len, conn->isIPv6);
+    case FORT_BUFFER_CONN_WRITE_PROC_NEW:
+        return FORT_LOG_PROC_NEW_SIZE(path_len);
+    }
+
+    return 0;
+}
+
+static PFORT_BUFFER_RING_HEADER fort_buffer_conn_reserve(
+        PFORT_BUFFER buf, PCFORT_CONF_META_CONN conn, PFORT_BUFFER_CONN_WRITE_ARG wa)
+{
+    if (wa->ring == NULL) {
+        wa->ring = fort_buffer_cpu_ring(buf);
+    }
+
+    wa->len = fort_buffer_conn_write_len(conn, wa);
+
+    return fort_buffer_ring_reserve(wa->ring, wa->len, &wa->pos);
+}
+
+static PFORT_BUFFER_RING_HEADER fort_buffer_conn_reserve_path_locked(PFORT_BUFFER buf,
+        PCFORT_CONF_META_CONN conn, PFORT_BUFFER_CONN_WRITE_ARG wa, tommy_key_t path_hash)
+{
+    /* The current CPU is kept under the lock, so its ring is reserved in order */
+    wa->ring = fort_buffer_cpu_ring(buf);
+
+    PFORT_BUFFER_PATH path = fort_buffer_path_get_locked(&buf->paths, &wa->log_path, path_hash);
+    if (path == NULL)
+        return fort_buffer_conn_reserve(buf, conn, wa);
+
+    const UINT32 ring_index = (UINT32) (wa->ring - buf->rings);
+
+    const BOOL is_path_written = fort_buffer_path_ring_written(path, ring_index);
+
+    wa->path_id = path->path_id;
+
+    if (is_path_written) {
+        wa->log_path.len = 0;
+    }
+
+    PFORT_BUFFER_RING_HEADER header = fort_buffer_conn_reserve(buf, conn, wa);
+    if (header == NULL)
+        return NULL;
+
+    /* The ring's next records refer to the path by its id */
+    if (!is_path_written) {
+        fort_buffer_path_ring_set_written(path, ring_index);
+    }
+
+    fort_buffer_path_cache_add_locked(&buf->paths, &wa->ring->path_cache, path);
+
+    return header;
+}
+
+static BOOL fort_buffer_conn_reserve_path_cached(PFORT_BUFFER buf, PCFORT_CONF_META_CONN conn,
+        PFORT_BUFFER_CONN_WRITE_ARG wa, tommy_key_t path_hash, PFORT_BUFFER_RING_HEADER *header)
+{
+    BOOL is_cached;
+
+    /* The current CPU is kept, so its ring is reserved in order */
+    const KIRQL oldIrql = KeRaiseIrqlToDpcLevel();
     {
-        PCHAR out;
-        status = fort_buffer_prepare(buf, len, &out, irp_info);
-
-        if (NT_SUCCESS(status)) {
-            switch (log_type) {
-            case FORT_BUFFER_CONN_WRITE_APP: {
-                const BOOL blocked = conn->app_data.flags.blocked;
-
-                fort_log_app_write(out, blocked, conn->process_id, &log_path);
-            } break;
-            case FORT_BUFFER_CONN_WRITE_CONN: {
-                fort_log_conn_write(out, conn, &log_path);
-            } break;
-            case FORT_BUFFER_CONN_WRITE_PROC_NEW: {
-                fort_log_proc_new_write(out, conn->process_id, &log_path);
-            } break;
-            }
+        wa->ring = fort_buffer_cpu_ring(buf);
+
+        PFORT_BUFFER_PATH_CACHE cache = &wa->ring->path_cache;
+
+        fort_buffer_path_cache_enter(cache);
+
+        PFORT_BUFFER_PATH path =
+                fort_buffer_path_cache_find(&buf->paths, cache, &wa->log_path, path_hash);
+
+        is_cached = (path != NULL);
+
+        /* The ring has the path already, so refer to it by its id */
+        if (is_cached) {
+            wa->path_id = path->path_id;
+            wa->log_path.len = 0;
+
+            *header = fort_buffer_conn_reserve(buf, conn, wa);
         }
+
+        fort_buffer_path_cache_leave(cache);
     }
+    KeLowerIrql(oldIrql);
+
+    return is_cached;
+}
+
+static PFORT_BUFFER_RING_HEADER fort_buffer_conn_reserve_path(
+        PFORT_BUFFER buf, PCFORT_CONF_META_CONN conn, PFORT_BUFFER_CONN_WRITE_ARG wa)
+{
+    if (wa->log_path.len == 0)
+        return fort_buffer_conn_reserve(buf, conn, wa);
+
+    const tommy_key_t path_hash = fort_buffer_path_hash(&wa->log_path);
+
+    PFORT_BUFFER_RING_HEADER header = NULL;
+
+    /* Only the paths, which are not written to the CPU's ring yet, take the lock */
+    if (fort_buffer_conn_reserve_path_cached(buf, conn, wa, path_hash, &header))
+        return header;
+
+    KLOCK_QUEUE_HANDLE lock_queue;
+    KeAcquireInStackQueuedSpinLock(&buf->paths.lock, &lock_queue);
+
+    header = fort_buffer_conn_reserve_path_locked(buf, conn, wa, path_hash);
+
     KeReleaseInStackQueuedSpinLock(&lock_queue);
 
-    return status;
+    return header;
 }
 
-inline static NTSTATUS fort_buffer_xmove_locked_empty(
-        PFORT_BUFFER buf, PFORT_IRP_INFO irp_info, PVOID out, ULONG out_len)
+inline static BOOL fort_buffer_conn_write_wake(PFORT_BUFFER buf)
 {
-    if (buf->out_len != 0)
-        return STATUS_UNSUCCESSFUL; /* collision */
+    return buf->idle == FORT_BUFFER_IDLE_WAIT
+            && InterlockedCompareExchange(
+                       &buf->idle, FORT_BUFFER_IDLE_WOKEN, FORT_BUFFER_IDLE_WAIT)
+            == FORT_BUFFER_IDLE_WAIT;
+}
 
-    buf->irp = irp_info->irp;
-    buf->out = out;
-    buf->out_len = out_len;
-    buf->out_top = 0;
+inline static void fort_buffer_conn_write_flush(
+        PFORT_BUFFER buf, PFORT_BUFFER_RING ring, PFORT_IRP_INFO irp_info)
+{
+    if (buf->irp == NULL)
+        return;
 
-    return STATUS_PENDING;
+    const LONG64 used_size = InterlockedCompareExchange64(&ring->head, 0, 0)
+            - fort_buffer_ring_tail(ring);
+
+    if (used_size < FORT_BUFFER_RING_FLUSH_SIZE && !fort_buffer_conn_write_wake(buf))
+        return;
+
+    KLOCK_QUEUE_HANDLE lock_queue;
+    KeAcquireInStackQueuedSpinLock(&buf->lock, &lock_queue);
+
+    fort_buffer_flush_pending(buf, irp_info);
+
+    KeReleaseInStackQueuedSpinLock(&lock_queue);
 }
 
-static NTSTATUS fort_buffer_xmove_locked(
-        PFORT_BUFFER buf, PFORT_IRP_INFO irp_info, PVOID out, ULONG out_len)
+FORT_API NTSTATUS fort_buffer_conn_write(PFORT_BUFFER buf, PCFORT_CONF_META_CONN conn,
+        PFORT_IRP_INFO irp_info, FORT_BUFFER_CONN_WRITE_TYPE log_type)
 {
-    PFORT_BUFFER_DATA data = buf->data_head;
-    const UINT32 buf_top = (data ? data->top : 0);
+    if (buf->rings == NULL)
+        return STATUS_INSUFFICIENT_RESOURCES;
 
-    irp_info->info = buf_top;
+    FORT_BUFFER_CONN_WRITE_ARG wa = {
+        .log_type = log_type,
+        .log_path = fort_buffer_adjust_log_path(conn),
+    };
 
-    if (buf_top == 0) {
-        return fort_buffer_xmove_locked_empty(buf, irp_info, out, out_len);
+    PFORT_BUFFER_RING_HEADER header = fort_buffer_conn_reserve_path(buf, conn, &wa);
+    if (header == NULL) {
+        InterlockedIncrement(&buf->drop_count);
+        return STATUS_BUFFER_OVERFLOW;
     }
 
-    if (out_len < buf_top)
-        return STATUS_BUFFER_TOO_SMALL;
+    fort_buffer_conn_write_log((PCHAR) (header + 1), conn, &wa);
 
-    RtlCopyMemory(out, data->p, buf_top);
+    fort_buffer_ring_commit(header, wa.pos, wa.len);
 
-    fort_buffer_data_shift(buf);
+    fort_buffer_conn_write_flush(buf, wa.ring, irp_info);
 
     return STATUS_SUCCESS;
 }
 
+inline static BOOL fort_buffer_xmove_shared_locked(PFORT_BUFFER buf, PFORT_IRP_INFO irp_info)
+{
+    fort_buffer_drain_shared_locked(buf);
+
+    irp_info->info = 0;
+
+    /* Has the client unread data? */
+    return buf->shared_head != buf->shared->tail;
+}
+
+inline static BOOL fort_buffer_xmove_out_locked(
+        PFORT_BUFFER buf, PFORT_IRP_INFO irp_info, PVOID out, ULONG out_len)
+{
+    BOOL is_full = FALSE;
+    const ULONG out_top = fort_buffer_drain_locked(buf, out, out_len, &is_full);
+
+    irp_info->info = out_top;
+
+    return out_top != 0;
+}
+
+static NTSTATUS fort_buffer_xmove_locked(
+        PFORT_BUFFER buf, PFORT_IRP_INFO irp_info, PVOID out, ULONG out_len)
+{
+    /* The request is a doorbell only, when the log is shared */
+    const BOOL has_data = (buf->shared != NULL)
+            ? fort_buffer_xmove_shared_locked(buf, irp_info)
+            : fort_buffer_xmove_out_locked(buf, irp_info, out, out_len);
+
+    if (has_data)
+        return STATUS_SUCCESS;
+
+    if (buf->irp != NULL)
+        return STATUS_UNSUCCESSFUL; /* collision */
+
+    buf->irp = irp_info->irp;
+    buf->out = out;
+    buf->out_len = out_len;
+
+    return STATUS_PENDING;
+}
+
 FORT_API NTSTATUS fort_buffer_xmove(
         PFORT_BUFFER buf, PFORT_IRP_INFO irp_info, PVOID out, ULONG out_len)
 {
@@ -293,13 +775,6 @@ inline static NTSTATUS fort_buffer_cancel_pending(PFORT_BUFFER buf, PFORT_IRP_IN
         buf->out_len = 0;
 
         status = STATUS_CANCELLED;
-
-        if (buf->out_top != 0) {
-            irp_info->info = buf->out_top;
-            buf->out_top = 0;
-
-            status = STATUS_SUCCESS;
-        }
     }
     KeReleaseInStackQueuedSpinLockFromDpcLevel(&lock_queue);
 
@@ -352,23 +827,52 @@ FORT_API void fort_buffer_dpc_end(PKLOCK_QUEUE_HANDLE lock_queue)
     KeReleaseInStackQueuedSpinLockFromDpcLevel(lock_queue);
 }
 
-FORT_API void fort_buffer_flush_pending(PFORT_BUFFER buf, PFORT_IRP_INFO irp_info)
+/* Returns TRUE, when the connections were logged since the previous timer's flush */
+FORT_API BOOL fort_buffer_log_written(PFORT_BUFFER buf)
 {
-    UINT32 out_top = buf->out_top;
+    if (buf->idle == FORT_BUFFER_IDLE_WOKEN)
+        return TRUE;
 
-    /* Move data from buffer to pending */
-    if (out_top == 0 && buf->out_len != 0) {
-        PFORT_BUFFER_DATA data = buf->data_head;
+    if (buf->rings == NULL)
+        return FALSE;
+
+    for (UINT32 i = 0; i < buf->ring_count; ++i) {
+        PFORT_BUFFER_RING ring = &buf->rings[i];
+        const LONG64 tail = ring->tail;
 
-        out_top = (data ? data->top : 0);
+        /* Is the first unread record committed? */
+        if (fort_buffer_ring_header(ring, tail)->seq == fort_buffer_ring_seq(tail))
+            return TRUE;
+    }
 
-        if (out_top != 0) {
-            RtlCopyMemory(buf->out, data->p, out_top);
+    return FALSE;
+}
 
-            fort_buffer_data_shift(buf);
+FORT_API void fort_buffer_set_idle(PFORT_BUFFER buf, BOOL idle)
+{
+    InterlockedExchange(&buf->idle, idle ? FORT_BUFFER_IDLE_WAIT : FORT_BUFFER_IDLE_OFF);
+}
+
+FORT_API void fort_buffer_flush_pending(PFORT_BUFFER buf, PFORT_IRP_INFO irp_info)
+{
+    if (buf->irp == NULL || irp_info->irp != NULL)
+        return;
+
+    /* Move data from rings to the shared log */
+    if (buf->shared != NULL) {
+        if (fort_buffer_drain_shared_locked(buf) != 0) {
+            fort_buffer_flush_pending_out(buf, irp_info, /*out_top=*/0);
         }
+        return;
     }
 
+    if (buf->out_len == 0)
+        return;
+
+    /* Move data from rings to pending */
+    BOOL is_full = FALSE;
+    const ULONG out_top = fort_buffer_drain_locked(buf, buf->out, buf->out_len, &is_full);
+
     if (out_top != 0) {
         fort_buffer_flush_pending_out(buf, irp_info, out_top);
     }
@@ -5,6 +5,7 @@
 
 #include "common/fortconf.h"
 #include "common/fortlog.h"
+#include "fortbuf_path.h"
 
 typedef enum FORT_BUFFER_CONN_WRITE_TYPE {
     FORT_BUFFER_CONN_WRITE_APP = 0,
@@ -12,26 +13,56 @@ typedef enum FORT_BUFFER_CONN_WRITE_TYPE {
     FORT_BUFFER_CONN_WRITE_PROC_NEW,
 } FORT_BUFFER_CONN_WRITE_TYPE;
 
-typedef struct fort_buffer_data
+#define FORT_BUFFER_RING_ALIGN 8
+
+/* The sequence is the record's position with the lowest bit set, when it's committed */
+typedef struct fort_buffer_ring_header
+{
+    LONG volatile seq;
+    UINT32 len; /* 0 for the padding to the ring's end */
+} FORT_BUFFER_RING_HEADER, *PFORT_BUFFER_RING_HEADER;
+
+#define FORT_BUFFER_RING_RECORD_SIZE(len)                                                          \
+    FORT_ALIGN_SIZE(sizeof(FORT_BUFFER_RING_HEADER) + (len), FORT_BUFFER_RING_ALIGN)
+
+#define fort_buffer_ring_seq(pos) ((LONG) ((UINT32) (pos) | 1))
+
+typedef struct fort_buffer_ring
 {
-    struct fort_buffer_data *next;
+    LONG64 volatile head; /* reserved by producers */
+    LONG64 volatile tail; /* drained by the reader */
+
+    LONG64 discard_head; /* the records before it are discarded, see fort_buffer_clear() */
+
+    UINT32 size_mask;
+
+    PCHAR data;
 
-    UINT32 top;
-    CHAR p[FORT_BUFFER_SIZE];
-} FORT_BUFFER_DATA, *PFORT_BUFFER_DATA;
+    FORT_BUFFER_PATH_CACHE path_cache; /* of the CPU's ring */
+} FORT_BUFFER_RING, *PFORT_BUFFER_RING;
 
 typedef struct fort_buffer
 {
-    PFORT_BUFFER_DATA data_head;
-    PFORT_BUFFER_DATA data_tail; /* last is current */
-    PFORT_BUFFER_DATA data_free;
+    UINT32 ring_count; /* per CPU */
+    PFORT_BUFFER_RING rings; /* + the timer's ring is the last */
 
-    PIRP irp; /* pending */
+    LONG volatile drop_count;
+
+    LONG volatile idle; /* the log timer is slowed down, see fort_buffer_set_idle() */
+
+    FORT_BUFFER_PATHS paths;
+
+    PFORT_LOG_SHARED shared; /* mapped to the client */
+    PMDL shared_mdl;
+    PVOID shared_address;
+    UINT32 shared_head;
+    UINT32 shared_size;
+
+    PIRP volatile irp; /* pending */
     PCHAR out;
     ULONG out_len;
-    UINT32 out_top;
 
-    KSPIN_LOCK lock;
+    KSPIN_LOCK lock; /* of the reader */
 } FORT_BUFFER, *PFORT_BUFFER;
 
 #if defined(__cplusplus)
@@ -44,8 +75,11 @@ FORT_API void fort_buffer_close(PFORT_BUFFER buf);
 
 FORT_API void fort_buffer_clear(PFORT_BUFFER buf);
 
-FORT_API NTSTATUS fort_buffer_prepare(
-        PFORT_BUFFER buf, UINT32 len, PCHAR *out, PFORT_IRP_INFO irp_info);
+FORT_API NTSTATUS fort_buffer_shared_map(PFORT_BUFFER buf, UINT32 size, PVOID *address);
+
+FORT_API void fort_buffer_shared_unmap(PFORT_BUFFER buf);
+
+FORT_API NTSTATUS fort_buffer_prepare(PFORT_BUFFER buf, UINT32 len, PCHAR *out);
 
 FORT_API NTSTATUS fort_buffer_conn_write(PFORT_BUFFER buf, PCFORT_CONF_META_CONN conn,
         PFORT_IRP_INFO irp_info, FORT_BUFFER_CONN_WRITE_TYPE log_type);
@@ -63,6 +97,10 @@ FORT_API void fort_buffer_dpc_end(PKLOCK_QUEUE_HANDLE lock_queue);
 
 FORT_API void fort_buffer_flush_pending(PFORT_BUFFER buf, PFORT_IRP_INFO irp_info);
 
+FORT_API BOOL fort_buffer_log_written(PFORT_BUFFER buf);
+
+FORT_API void fort_buffer_set_idle(PFORT_BUFFER buf, BOOL idle);
+
 #ifdef __cplusplus
 } // extern "C"
 #endif
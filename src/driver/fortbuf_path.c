@@ -0,0 +1,183 @@
+/* Fort Firewall Log Buffer: Interned Paths */
+
+#include "fortbuf_path.h"
+
+#define FORT_BUFFER_PATH_POOL_TAG 'AwfF'
+
+#define FORT_BUFFER_PATH_DATA_OFF offsetof(FORT_BUFFER_PATH, path)
+
+#define FORT_BUFFER_PATH_BITS_OFF(len)                                                             \
+    FORT_ALIGN_SIZE(FORT_BUFFER_PATH_DATA_OFF + (len), sizeof(UINT64))
+
+#define FORT_BUFFER_PATH_SIZE(len, ring_words)                                                     \
+    (FORT_BUFFER_PATH_BITS_OFF(len) + (ring_words) * sizeof(UINT64))
+
+#define fort_buffer_path_ring_bits(path)                                                           \
+    ((UINT64 *) ((PCHAR) (path) + FORT_BUFFER_PATH_BITS_OFF((path)->path_len)))
+
+FORT_API void fort_buffer_paths_open(PFORT_BUFFER_PATHS paths, UINT32 ring_count)
+{
+    paths->ring_words = (ring_count + 63) / 64;
+
+    tommy_hashdyn_init(&paths->paths_map);
+
+    KeInitializeSpinLock(&paths->lock);
+}
+
+static void fort_buffer_path_free(PVOID path_node)
+{
+    fort_mem_free(path_node, FORT_BUFFER_PATH_POOL_TAG);
+}
+
+static void fort_buffer_paths_done(PFORT_BUFFER_PATHS paths)
+{
+    tommy_hashdyn_foreach_node(&paths->paths_map, &fort_buffer_path_free);
+    tommy_hashdyn_done(&paths->paths_map);
+
+    paths->path_count = 0;
+    paths->paths_size = 0;
+}
+
+FORT_API void fort_buffer_paths_close(PFORT_BUFFER_PATHS paths)
+{
+    fort_buffer_paths_done(paths);
+}
+
+FORT_API void fort_buffer_paths_clear_locked(PFORT_BUFFER_PATHS paths)
+{
+    if (paths->path_count == 0)
+        return;
+
+    fort_buffer_paths_done(paths);
+
+    tommy_hashdyn_init(&paths->paths_map);
+}
+
+static PFORT_BUFFER_PATH fort_buffer_path_find_locked(
+        PFORT_BUFFER_PATHS paths, PCFORT_APP_PATH path, tommy_key_t path_hash)
+{
+    PFORT_BUFFER_PATH node =
+            (PFORT_BUFFER_PATH) tommy_hashdyn_bucket(&paths->paths_map, path_hash);
+
+    while (node != NULL) {
+        if (node->path_hash == path_hash && node->path_len == path->len
+                && fort_mem_eql(node->path, path->buffer, path->len))
+            return node;
+
+        node = node->next;
+    }
+
+    return NULL;
+}
+
+static PFORT_BUFFER_PATH fort_buffer_path_add_locked(
+        PFORT_BUFFER_PATHS paths, PCFORT_APP_PATH path, tommy_key_t path_hash)
+{
+    const UINT32 size = FORT_BUFFER_PATH_SIZE(path->len, paths->ring_words);
+
+    /* The table is bounded: the other paths are written in full */
+    if (paths->path_count >= FORT_BUFFER_PATH_COUNT_MAX
+            || paths->paths_size + size > FORT_BUFFER_PATHS_SIZE_MAX)
+        return NULL;
+
+    PFORT_BUFFER_PATH node = fort_mem_alloc(size, FORT_BUFFER_PATH_POOL_TAG);
+    if (node == NULL)
+        return NULL;
+
+    tommy_hashdyn_insert(&paths->paths_map, (tommy_hashdyn_node *) node, NULL, path_hash);
+
+    /* The zero id means a not interned path */
+    if (++paths->last_path_id == 0) {
+        ++paths->last_path_id;
+    }
+
+    node->path_id = paths->last_path_id;
+    node->path_len = path->len;
+
+    RtlCopyMemory(node->path, path->buffer, path->len);
+
+    RtlZeroMemory(fort_buffer_path_ring_bits(node), paths->ring_words * sizeof(UINT64));
+
+    paths->path_count++;
+    paths->paths_size += size;
+
+    return node;
+}
+
+FORT_API PFORT_BUFFER_PATH fort_buffer_path_get_locked(
+        PFORT_BUFFER_PATHS paths, PCFORT_APP_PATH path, tommy_key_t path_hash)
+{
+    PFORT_BUFFER_PATH node = fort_buffer_path_find_locked(paths, path, path_hash);
+
+    if (node == NULL) {
+        node = fort_buffer_path_add_locked(paths, path, path_hash);
+    }
+
+    return node;
+}
+
+FORT_API BOOL fort_buffer_path_ring_written(PCFORT_BUFFER_PATH path, UINT32 ring_index)
+{
+    const UINT64 *ring_bits = fort_buffer_path_ring_bits(path);
+
+    return (ring_bits[ring_index / 64] & ((UINT64) 1 << (ring_index % 64))) != 0;
+}
+
+FORT_API void fort_buffer_path_ring_set_written(PFORT_BUFFER_PATH path, UINT32 ring_index)
+{
+    UINT64 *ring_bits = fort_buffer_path_ring_bits(path);
+
+    ring_bits[ring_index / 64] |= ((UINT64) 1 << (ring_index % 64));
+}
+
+FORT_API void fort_buffer_path_cache_init(PFORT_BUFFER_PATH_CACHE cache)
+{
+    RtlZeroMemory(cache, sizeof(FORT_BUFFER_PATH_CACHE));
+}
+
+FORT_API void fort_buffer_path_cache_enter(PFORT_BUFFER_PATH_CACHE cache)
+{
+    /* Full barrier: the paths' generation is read after */
+    InterlockedExchange(&cache->busy, 1);
+}
+
+FORT_API void fort_buffer_path_cache_leave(PFORT_BUFFER_PATH_CACHE cache)
+{
+    InterlockedExchange(&cache->busy, 0);
+}
+
+FORT_API void fort_buffer_path_cache_wait(PFORT_BUFFER_PATH_CACHE cache)
+{
+    while (InterlockedCompareExchange(&cache->busy, 0, 0) != 0) {
+        YieldProcessor();
+    }
+}
+
+FORT_API PFORT_BUFFER_PATH fort_buffer_path_cache_find(PFORT_BUFFER_PATHS paths,
+        PFORT_BUFFER_PATH_CACHE cache, PCFORT_APP_PATH path, tommy_key_t path_hash)
+{
+    PCFORT_BUFFER_PATH_CACHE_ENTRY entry =
+            &cache->entries[path_hash & (FORT_BUFFER_PATH_CACHE_SIZE - 1)];
+
+    /* The cleared table's paths may be freed already */
+    if (entry->gen != paths->gen)
+        return NULL;
+
+    PFORT_BUFFER_PATH node = entry->path;
+
+    if (node != NULL && node->path_hash == path_hash && node->path_len == path->len
+            && fort_mem_eql(node->path, path->buffer, path->len))
+        return node;
+
+    return NULL;
+}
+
+FORT_API void fort_buffer_path_cache_add_locked(
+        PFORT_BUFFER_PATHS paths, PFORT_BUFFER_PATH_CACHE cache, PFORT_BUFFER_PATH path)
+{
+    PFORT_BUFFER_PATH_CACHE_ENTRY entry =
+            &cache->entries[path->path_hash & (FORT_BUFFER_PATH_CACHE_SIZE - 1)];
+
+    entry->path = path;
+    entry->gen = paths->gen;
+}
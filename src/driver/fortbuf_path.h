@@ -0,0 +1,102 @@
+#ifndef FORTBUF_PATH_H
+#define FORTBUF_PATH_H
+
+#include "fortdrv.h"
+
+#include "common/fortconf.h"
+#include "forttds.h"
+
+#define FORT_BUFFER_PATH_COUNT_MAX (8 * 1024)
+#define FORT_BUFFER_PATHS_SIZE_MAX (4 * 1024 * 1024)
+
+#define FORT_BUFFER_PATH_CACHE_SIZE 64 /* power of 2 */
+
+/* Synchronize with tommy_hashdyn_node! */
+typedef struct fort_buffer_path
+{
+    struct fort_buffer_path *next;
+    struct fort_buffer_path *prev;
+
+    void *data; /* tommy_hashdyn_node::data */
+
+    tommy_key_t path_hash; /* tommy_hashdyn_node::index */
+
+    UINT32 path_id;
+
+    UINT16 path_len;
+    WCHAR path[1]; /* + the bits of rings, where the path is written */
+} FORT_BUFFER_PATH, *PFORT_BUFFER_PATH;
+
+typedef const FORT_BUFFER_PATH *PCFORT_BUFFER_PATH;
+
+typedef struct fort_buffer_path_cache_entry
+{
+    PFORT_BUFFER_PATH path;
+    LONG gen; /* of the paths' table */
+} FORT_BUFFER_PATH_CACHE_ENTRY, *PFORT_BUFFER_PATH_CACHE_ENTRY;
+
+/* Paths, which are written to the CPU's ring: looked up by the CPU without the paths' lock */
+typedef struct fort_buffer_path_cache
+{
+    LONG volatile busy; /* the paths' clear waits for the lookup */
+
+    FORT_BUFFER_PATH_CACHE_ENTRY entries[FORT_BUFFER_PATH_CACHE_SIZE];
+} FORT_BUFFER_PATH_CACHE, *PFORT_BUFFER_PATH_CACHE;
+
+/* Interned paths of the log: a path is written once per ring and referenced by its id after.
+ * Only the log buffer uses the table and it is cleared with the buffer, so no refcounts. */
+typedef struct fort_buffer_paths
+{
+    UINT32 path_count;
+    UINT32 paths_size;
+
+    UINT32 last_path_id; /* kept on clear, so a client never mixes up the ids */
+
+    UINT32 ring_words; /* of the paths' ring bits */
+
+    LONG volatile gen; /* invalidates the rings' caches on clear */
+
+    tommy_hashdyn paths_map;
+
+    KSPIN_LOCK lock; /* of the interning */
+} FORT_BUFFER_PATHS, *PFORT_BUFFER_PATHS;
+
+#define fort_buffer_path_hash(path)                                                                \
+    ((tommy_key_t) tommy_hash_u64(0, (path)->buffer, (path)->len))
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+FORT_API void fort_buffer_paths_open(PFORT_BUFFER_PATHS paths, UINT32 ring_count);
+
+FORT_API void fort_buffer_paths_close(PFORT_BUFFER_PATHS paths);
+
+FORT_API void fort_buffer_paths_clear_locked(PFORT_BUFFER_PATHS paths);
+
+FORT_API PFORT_BUFFER_PATH fort_buffer_path_get_locked(
+        PFORT_BUFFER_PATHS paths, PCFORT_APP_PATH path, tommy_key_t path_hash);
+
+FORT_API BOOL fort_buffer_path_ring_written(PCFORT_BUFFER_PATH path, UINT32 ring_index);
+
+FORT_API void fort_buffer_path_ring_set_written(PFORT_BUFFER_PATH path, UINT32 ring_index);
+
+FORT_API void fort_buffer_path_cache_init(PFORT_BUFFER_PATH_CACHE cache);
+
+FORT_API void fort_buffer_path_cache_enter(PFORT_BUFFER_PATH_CACHE cache);
+
+FORT_API void fort_buffer_path_cache_leave(PFORT_BUFFER_PATH_CACHE cache);
+
+FORT_API void fort_buffer_path_cache_wait(PFORT_BUFFER_PATH_CACHE cache);
+
+FORT_API PFORT_BUFFER_PATH fort_buffer_path_cache_find(PFORT_BUFFER_PATHS paths,
+        PFORT_BUFFER_PATH_CACHE cache, PCFORT_APP_PATH path, tommy_key_t path_hash);
+
+FORT_API void fort_buffer_path_cache_add_locked(
+        PFORT_BUFFER_PATHS paths, PFORT_BUFFER_PATH_CACHE cache, PFORT_BUFFER_PATH path);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif // FORTBUF_PATH_H
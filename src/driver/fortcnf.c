@@ -4,20 +4,73 @@
 
 #define FORT_DEVICE_CONF_POOL_TAG 'CwfF'
 
-FORT_API PVOID fort_conf_mem_alloc(const void *src, ULONG len)
+FORT_API PFORT_CONF_BLOB_REF fort_conf_blob_ref_alloc(ULONG len)
 {
-    PVOID p = fort_mem_alloc(len, FORT_DEVICE_CONF_POOL_TAG);
-    if (p != NULL) {
-        RtlCopyMemory(p, src, len);
+    PFORT_CONF_BLOB_REF blob_ref =
+            fort_mem_alloc(FORT_CONF_BLOB_REF_DATA_OFF + len, FORT_DEVICE_CONF_POOL_TAG);
+    if (blob_ref != NULL) {
+        blob_ref->refcount = 1;
+        blob_ref->len = len;
     }
-    return p;
+    return blob_ref;
 }
 
-FORT_API void fort_conf_mem_free(PVOID p)
+FORT_API PFORT_CONF_BLOB_REF fort_conf_blob_ref_new(const void *src, ULONG len)
 {
-    if (p != NULL) {
-        fort_mem_free(p, FORT_DEVICE_CONF_POOL_TAG);
+    PFORT_CONF_BLOB_REF blob_ref = fort_conf_blob_ref_alloc(len);
+    if (blob_ref != NULL) {
+        RtlCopyMemory(blob_ref->data, src, len);
     }
+    return blob_ref;
+}
+
+FORT_API void fort_conf_blob_ref_put(PFORT_CONF_BLOB_REF blob_ref)
+{
+    if (blob_ref != NULL && InterlockedDecrement(&blob_ref->refcount) == 0) {
+        fort_mem_free(blob_ref, FORT_DEVICE_CONF_POOL_TAG);
+    }
+}
+
+FORT_API PFORT_CONF_BLOB_REF fort_conf_blob_ref_take(
+        PFORT_DEVICE_CONF device_conf, PFORT_CONF_BLOB_REF volatile *ref_ptr)
+{
+    if (*ref_ptr == NULL)
+        return NULL;
+
+    PFORT_CONF_BLOB_REF blob_ref;
+
+    KIRQL oldIrql = ExAcquireSpinLockShared(&device_conf->lock);
+    {
+        blob_ref = *ref_ptr;
+        if (blob_ref != NULL) {
+            InterlockedIncrement(&blob_ref->refcount);
+        }
+    }
+    ExReleaseSpinLockShared(&device_conf->lock, oldIrql);
+
+    return blob_ref;
+}
+
+FORT_API BOOL fort_conf_blob_ref_replace(PFORT_DEVICE_CONF device_conf,
+        PFORT_CONF_BLOB_REF volatile *ref_ptr, PFORT_CONF_BLOB_REF old_ref,
+        PFORT_CONF_BLOB_REF new_ref)
+{
+    BOOL replaced = FALSE;
+
+    KIRQL oldIrql = ExAcquireSpinLockExclusive(&device_conf->lock);
+    if (*ref_ptr == old_ref) {
+        *ref_ptr = new_ref;
+        replaced = TRUE;
+    }
+    ExReleaseSpinLockExclusive(&device_conf->lock, oldIrql);
+
+    if (replaced) {
+        fort_device_conf_changed(device_conf);
+
+        fort_conf_blob_ref_put(old_ref);
+    }
+
+    return replaced;
 }
 
 FORT_API void fort_device_conf_open(PFORT_DEVICE_CONF device_conf)
@@ -25,6 +78,12 @@ FORT_API void fort_device_conf_open(PFORT_DEVICE_CONF device_conf)
     KeInitializeSpinLock(&device_conf->ref_lock);
 }
 
+FORT_API void fort_device_conf_changed(PFORT_DEVICE_CONF device_conf)
+{
+    /* Invalidate the cached verdicts */
+    InterlockedIncrement(&device_conf->conf_gen);
+}
+
 FORT_API UINT16 fort_device_flag_set(PFORT_DEVICE_CONF device_conf, UINT16 flag, BOOL on)
 {
     return on ? InterlockedOr16(&device_conf->flags, flag)
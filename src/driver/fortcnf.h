@@ -11,21 +11,62 @@
 #define FORT_SVCHOST_PREFIX_SIZE                                                                   \
     (sizeof(FORT_SVCHOST_PREFIX) - sizeof(WCHAR)) /* skip terminating zero */
 
-typedef struct fort_conf_ref
+/* Exe apps' map, shared by the conf's copies on incremental changes */
+typedef struct fort_conf_exe_map
 {
-    UINT32 volatile refcount;
+    LONG volatile refcount;
+
+    UINT32 apps_n;
 
     FORT_POOL_LIST pool_list;
     tommy_list free_nodes;
+    struct fort_conf_exe_node *del_nodes; /* freed after the readers' wait */
 
     tommy_arrayof exe_nodes;
-    tommy_hashdyn exe_map;
+    struct fort_conf_exe_table *volatile exe_table;
+
+    /* Readers of the exe map by the epoch's parity */
+    LONG volatile exe_epoch;
+    LONG volatile exe_readers[2];
+
+    EX_SPIN_LOCK lock; /* serializes the exe map's writers */
+} FORT_CONF_EXE_MAP, *PFORT_CONF_EXE_MAP;
+
+typedef struct fort_conf_ref
+{
+    UINT32 volatile refcount;
 
-    EX_SPIN_LOCK conf_lock;
+    PFORT_CONF_EXE_MAP exe_map;
 
     FORT_CONF conf;
 } FORT_CONF_REF, *PFORT_CONF_REF;
 
+/* Immutable refcounted snapshot of zones or rules */
+typedef struct fort_conf_blob_ref
+{
+    LONG volatile refcount;
+    ULONG len;
+
+    UINT64 data[1];
+} FORT_CONF_BLOB_REF, *PFORT_CONF_BLOB_REF;
+
+#define FORT_CONF_BLOB_REF_DATA_OFF offsetof(FORT_CONF_BLOB_REF, data)
+
+#define fort_conf_blob_ref_zones(blob_ref) ((PFORT_CONF_ZONES) (blob_ref)->data)
+#define fort_conf_blob_ref_zone(blob_ref)  ((PFORT_CONF_ZONE) (blob_ref)->data)
+#define fort_conf_blob_ref_rules(blob_ref) ((PFORT_CONF_RULES) (blob_ref)->data)
+
+/* Refcounted set of zones, sharing the unchanged zones' snapshots with the previous sets */
+typedef struct fort_conf_zones_ref
+{
+    LONG volatile refcount;
+
+    PFORT_CONF_BLOB_REF zone_refs[FORT_CONF_ZONE_MAX]; /* hold the zones' addresses lists */
+    PFORT_CONF_BLOB_REF index_ref; /* holds the merged index */
+
+    FORT_CONF_ZONES_RT zones;
+} FORT_CONF_ZONES_REF, *PFORT_CONF_ZONES_REF;
+
 #define FORT_DEVICE_BOOT_FILTER   0x01
 #define FORT_DEVICE_STEALTH_MODE  0x02
 #define FORT_DEVICE_FILTER_LOCALS 0x04
@@ -42,28 +83,42 @@ typedef struct fort_device_conf
 {
     UINT16 volatile flags;
 
-    FORT_CONF_RULES_GLOB volatile rules_glob;
+    FORT_CONF_RULES_GLOB rules_glob; /* guarded by the lock, see fort_devconf_rules_glob() */
+    UINT32 volatile rules_filter_types; /* see fort_conf_rules_filter_types() */
+
+    LONG volatile conf_gen; /* incremented after each change of the filtering */
 
     FORT_CONF_FLAGS volatile conf_flags;
     PFORT_CONF_REF volatile ref;
     KSPIN_LOCK ref_lock;
 
-    PFORT_CONF_ZONES zones;
-    PFORT_CONF_RULES rules;
+    PFORT_CONF_ZONES_REF volatile zones_ref;
+    PFORT_CONF_BLOB_REF volatile rules_ref;
 
-    EX_SPIN_LOCK lock;
+    EX_SPIN_LOCK lock; /* guards publishing of zones_ref and rules_ref with its globals */
 } FORT_DEVICE_CONF, *PFORT_DEVICE_CONF;
 
 #if defined(__cplusplus)
 extern "C" {
 #endif
 
-FORT_API PVOID fort_conf_mem_alloc(const void *src, ULONG len);
+FORT_API PFORT_CONF_BLOB_REF fort_conf_blob_ref_alloc(ULONG len);
+
+FORT_API PFORT_CONF_BLOB_REF fort_conf_blob_ref_new(const void *src, ULONG len);
+
+FORT_API void fort_conf_blob_ref_put(PFORT_CONF_BLOB_REF blob_ref);
 
-FORT_API void fort_conf_mem_free(PVOID p);
+FORT_API PFORT_CONF_BLOB_REF fort_conf_blob_ref_take(
+        PFORT_DEVICE_CONF device_conf, PFORT_CONF_BLOB_REF volatile *ref_ptr);
+
+FORT_API BOOL fort_conf_blob_ref_replace(PFORT_DEVICE_CONF device_conf,
+        PFORT_CONF_BLOB_REF volatile *ref_ptr, PFORT_CONF_BLOB_REF old_ref,
+        PFORT_CONF_BLOB_REF new_ref);
 
 FORT_API void fort_device_conf_open(PFORT_DEVICE_CONF device_conf);
 
+FORT_API void fort_device_conf_changed(PFORT_DEVICE_CONF device_conf);
+
 FORT_API UINT16 fort_device_flag_set(PFORT_DEVICE_CONF device_conf, UINT16 flag, BOOL on);
 
 FORT_API UINT16 fort_device_flags(PFORT_DEVICE_CONF device_conf);
@@ -0,0 +1,247 @@
+/* Fort Firewall Configuration: Verdicts Cache */
+
+#include "fortcnf_cache.h"
+
+#define FORT_CONF_CACHE_POOL_TAG 'VwfF'
+
+#define FORT_CONF_CACHE_SLOTS_COUNT 2048 /* power of 2 */
+#define FORT_CONF_CACHE_CPU_SIZE    64 /* keep the CPUs' counters on own cache lines */
+
+#define FORT_CONF_CACHE_PORT_FILTER_TYPES                                                          \
+    ((1u << FORT_RULE_FILTER_TYPE_PORT) | (1u << FORT_RULE_FILTER_TYPE_LOCAL_PORT)                 \
+            | (1u << FORT_RULE_FILTER_TYPE_PORT_TCP) | (1u << FORT_RULE_FILTER_TYPE_PORT_UDP))
+
+typedef struct fort_conf_cache_key
+{
+    ip_addr_t remote_ip;
+    ip_addr_t local_ip;
+
+    FORT_CONF_RULE_ZONES app_zones;
+
+    FORT_APP_FLAGS app_flags;
+    UINT16 app_rule_id;
+
+    UCHAR app_group_index;
+    UCHAR ip_proto;
+
+    UINT16 remote_port; /* 0, if the rules do not filter ports */
+    UINT16 local_port;
+
+    UCHAR inbound : 1;
+    UCHAR isIPv6 : 1;
+    UCHAR profile_id : 2;
+    UCHAR is_loopback : 1;
+    UCHAR is_broadcast : 1;
+    UCHAR is_local_net : 1;
+
+    UCHAR reserved; /* not used */
+} FORT_CONF_CACHE_KEY, *PFORT_CONF_CACHE_KEY;
+
+typedef const FORT_CONF_CACHE_KEY *PCFORT_CONF_CACHE_KEY;
+
+typedef struct fort_conf_cache_verdict
+{
+    UCHAR blocked : 1;
+    UCHAR ignore : 1;
+    UCHAR ask_to_connect : 1;
+
+    UCHAR reason;
+    UCHAR zone_id;
+    UINT16 rule_id;
+} FORT_CONF_CACHE_VERDICT, *PFORT_CONF_CACHE_VERDICT;
+
+/* Per-CPU counters, summed by fort_conf_cache_stat() */
+typedef struct fort_conf_cache_cpu
+{
+    LONG64 volatile hits;
+    LONG64 volatile misses;
+
+    UCHAR reserved[FORT_CONF_CACHE_CPU_SIZE - 2 * sizeof(LONG64)]; /* not used */
+} FORT_CONF_CACHE_CPU, *PFORT_CONF_CACHE_CPU;
+
+/* The odd sequence marks a slot being written, the zero one marks an empty slot */
+typedef struct fort_conf_cache_slot
+{
+    LONG volatile seq;
+    LONG conf_gen;
+
+    FORT_CONF_CACHE_KEY key;
+    FORT_CONF_CACHE_VERDICT verdict;
+} FORT_CONF_CACHE_SLOT, *PFORT_CONF_CACHE_SLOT;
+
+FORT_API void fort_conf_cache_open(PFORT_CONF_CACHE cache)
+{
+    const ULONG cpu_count = KeQueryMaximumProcessorCountEx(ALL_PROCESSOR_GROUPS);
+
+    const ULONG cpus_size = cpu_count * sizeof(FORT_CONF_CACHE_CPU);
+    const ULONG size = cpus_size + FORT_CONF_CACHE_SLOTS_COUNT * sizeof(FORT_CONF_CACHE_SLOT);
+
+    /* The cache is optional: classify without it, when there is no memory */
+    PCHAR data = fort_mem_alloc(size, FORT_CONF_CACHE_POOL_TAG);
+
+    if (data != NULL) {
+        RtlZeroMemory(data, size);
+
+        cache->cpu_count = cpu_count;
+        cache->cpus = (PFORT_CONF_CACHE_CPU) data;
+        cache->slots = (PFORT_CONF_CACHE_SLOT) (data + cpus_size);
+    }
+}
+
+FORT_API void fort_conf_cache_close(PFORT_CONF_CACHE cache)
+{
+    if (cache->cpus != NULL) {
+        fort_mem_free(cache->cpus, FORT_CONF_CACHE_POOL_TAG);
+        cache->cpus = NULL;
+        cache->slots = NULL;
+    }
+}
+
+FORT_API void fort_conf_cache_stat(PFORT_CONF_CACHE cache, PFORT_CONF_STAT conf_stat)
+{
+    UINT64 hits = 0;
+    UINT64 misses = 0;
+
+    for (UINT32 i = 0; i < cache->cpu_count; ++i) {
+        PFORT_CONF_CACHE_CPU cpu = &cache->cpus[i];
+
+        /* Read the 64-bit counters whole on x86 too */
+        hits += (UINT64) InterlockedCompareExchange64(&cpu->hits, 0, 0);
+        misses += (UINT64) InterlockedCompareExchange64(&cpu->misses, 0, 0);
+    }
+
+    conf_stat->cache_hits = hits;
+    conf_stat->cache_misses = misses;
+}
+
+static PFORT_CONF_CACHE_CPU fort_conf_cache_cpu(PFORT_CONF_CACHE cache)
+{
+    const ULONG cpu_index = KeGetCurrentProcessorNumberEx(NULL) % cache->cpu_count;
+
+    return &cache->cpus[cpu_index];
+}
+
+static void fort_conf_cache_key_make(
+        PFORT_CONF_CACHE_KEY key, PCFORT_CONF_META_CONN conn, const FORT_APP_DATA app_data,
+        UINT32 filter_types)
+{
+    RtlZeroMemory(key, sizeof(FORT_CONF_CACHE_KEY));
+
+    key->remote_ip = conn->remote_ip;
+    key->local_ip = conn->local_ip;
+
+    /* The app is identified by its data, as the verdict depends on it only */
+    key->app_zones = app_data.zones;
+    key->app_flags = app_data.flags;
+    key->app_rule_id = app_data.rule_id;
+    key->app_group_index = app_data.group_index;
+
+    /* Ephemeral ports would defeat the cache */
+    if ((filter_types & FORT_CONF_CACHE_PORT_FILTER_TYPES) != 0) {
+        key->remote_port = conn->remote_port;
+        key->local_port = conn->local_port;
+    }
+
+    key->ip_proto = conn->ip_proto;
+
+    key->inbound = conn->inbound;
+    key->isIPv6 = conn->isIPv6;
+    key->profile_id = conn->profile_id;
+    key->is_loopback = conn->is_loopback;
+    key->is_broadcast = conn->is_broadcast;
+    key->is_local_net = conn->is_local_net;
+}
+
+static PFORT_CONF_CACHE_SLOT fort_conf_cache_slot(
+        PFORT_CONF_CACHE cache, PCFORT_CONF_CACHE_KEY key)
+{
+    const tommy_key_t key_hash = (tommy_key_t) tommy_hash_u64(0, key, sizeof(FORT_CONF_CACHE_KEY));
+
+    return &cache->slots[key_hash & (FORT_CONF_CACHE_SLOTS_COUNT - 1)];
+}
+
+static BOOL fort_conf_cache_slot_read(PFORT_CONF_CACHE_SLOT slot, LONG conf_gen,
+        PCFORT_CONF_CACHE_KEY key, PFORT_CONF_CACHE_VERDICT verdict)
+{
+    const LONG seq = slot->seq;
+    if (seq == 0 || (seq & 1) != 0)
+        return FALSE;
+
+    KeMemoryBarrier();
+
+    const BOOL found = (slot->conf_gen == conf_gen
+            && fort_mem_eql(&slot->key, key, sizeof(FORT_CONF_CACHE_KEY)));
+
+    if (found) {
+        *verdict = slot->verdict;
+    }
+
+    KeMemoryBarrier();
+
+    /* Was the slot re-written meanwhile? */
+    return found && slot->seq == seq;
+}
+
+FORT_API BOOL fort_conf_cache_get(PFORT_CONF_CACHE cache, LONG conf_gen, UINT32 filter_types,
+        PFORT_CONF_META_CONN conn, const FORT_APP_DATA app_data)
+{
+    if (cache->slots == NULL)
+        return FALSE;
+
+    FORT_CONF_CACHE_KEY key;
+    fort_conf_cache_key_make(&key, conn, app_data, filter_types);
+
+    PFORT_CONF_CACHE_SLOT slot = fort_conf_cache_slot(cache, &key);
+
+    /* The classify may be preempted at PASSIVE_LEVEL, so the CPU's counters are interlocked */
+    PFORT_CONF_CACHE_CPU cpu = fort_conf_cache_cpu(cache);
+
+    FORT_CONF_CACHE_VERDICT verdict;
+    if (!fort_conf_cache_slot_read(slot, conf_gen, &key, &verdict)) {
+        InterlockedIncrement64(&cpu->misses);
+        return FALSE;
+    }
+
+    InterlockedIncrement64(&cpu->hits);
+
+    conn->blocked = verdict.blocked;
+    conn->ignore = verdict.ignore;
+    conn->ask_to_connect = verdict.ask_to_connect;
+    conn->reason = verdict.reason;
+    conn->zone_id = verdict.zone_id;
+    conn->rule_id = verdict.rule_id;
+
+    return TRUE;
+}
+
+FORT_API void fort_conf_cache_put(PFORT_CONF_CACHE cache, LONG conf_gen, UINT32 filter_types,
+        PCFORT_CONF_META_CONN conn, const FORT_APP_DATA app_data)
+{
+    if (cache->slots == NULL)
+        return;
+
+    FORT_CONF_CACHE_KEY key;
+    fort_conf_cache_key_make(&key, conn, app_data, filter_types);
+
+    PFORT_CONF_CACHE_SLOT slot = fort_conf_cache_slot(cache, &key);
+
+    /* Skip the slot, when it's being written by another CPU */
+    const LONG seq = slot->seq;
+    if ((seq & 1) != 0 || InterlockedCompareExchange(&slot->seq, seq | 1, seq) != seq)
+        return;
+
+    slot->conf_gen = conf_gen;
+    slot->key = key;
+
+    FORT_CONF_CACHE_VERDICT *verdict = &slot->verdict;
+    verdict->blocked = conn->blocked;
+    verdict->ignore = conn->ignore;
+    verdict->ask_to_connect = conn->ask_to_connect;
+    verdict->reason = conn->reason;
+    verdict->zone_id = conn->zone_id;
+    verdict->rule_id = conn->rule_id;
+
+    /* Publish the written slot, skipping the empty slot's zero sequence on wrap */
+    const LONG next_seq = (LONG) ((ULONG) seq + 2);
+    InterlockedExchange(&slot->seq, (next_seq != 0) ? next_seq : 2);
+}
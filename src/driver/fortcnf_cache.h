@@ -0,0 +1,35 @@
+#ifndef FORTCNF_CACHE_H
+#define FORTCNF_CACHE_H
+
+#include "fortcnf.h"
+
+/* Bounded cache of the connections' verdicts, invalidated by the device conf's generation */
+typedef struct fort_conf_cache
+{
+    UINT32 cpu_count;
+    struct fort_conf_cache_cpu *cpus; /* hits and misses */
+
+    struct fort_conf_cache_slot *slots;
+} FORT_CONF_CACHE, *PFORT_CONF_CACHE;
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+FORT_API void fort_conf_cache_open(PFORT_CONF_CACHE cache);
+
+FORT_API void fort_conf_cache_close(PFORT_CONF_CACHE cache);
+
+FORT_API void fort_conf_cache_stat(PFORT_CONF_CACHE cache, PFORT_CONF_STAT conf_stat);
+
+FORT_API BOOL fort_conf_cache_get(PFORT_CONF_CACHE cache, LONG conf_gen, UINT32 filter_types,
+        PFORT_CONF_META_CONN conn, const FORT_APP_DATA app_data);
+
+FORT_API void fort_conf_cache_put(PFORT_CONF_CACHE cache, LONG conf_gen, UINT32 filter_types,
+        PCFORT_CONF_META_CONN conn, const FORT_APP_DATA app_data);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif // FORTCNF_CACHE_H
@@ -3,92 +3,283 @@
 #include "fortcnf_conf.h"
 #include "forttrace.h"
 
-/* Synchronize with tommy_hashdyn_node! */
+#define FORT_CONF_EXE_TABLE_SIZE_MIN 64
+#define FORT_CONF_EXE_TABLE_SIZE_MAX (64 * 1024)
+
+/* Synchronize with tommy_node! */
 typedef struct fort_conf_exe_node
 {
-    struct fort_conf_exe_node *next;
-    struct fort_conf_exe_node *prev;
+    struct fort_conf_exe_node *volatile next[2]; /* by the table's link index */
 
-    PFORT_APP_ENTRY app_entry; /* tommy_hashdyn_node::data */
+    PFORT_APP_ENTRY volatile app_entry; /* tommy_node::data */
 
-    tommy_key_t path_hash; /* tommy_hashdyn_node::index */
+    tommy_key_t path_hash; /* tommy_node::index */
 } FORT_CONF_EXE_NODE, *PFORT_CONF_EXE_NODE;
 
 typedef const FORT_CONF_EXE_NODE *PCFORT_CONF_EXE_NODE;
 
-static PFORT_CONF_EXE_NODE fort_conf_ref_exe_find_node(
-        PFORT_CONF_REF conf_ref, PCFORT_APP_PATH path, tommy_key_t path_hash)
+/* Readers traverse the table without locks, writers publish changes atomically */
+typedef struct fort_conf_exe_table
+{
+    UINT32 bucket_mask;
+
+    UCHAR link; /* index of the nodes' next[] link */
+
+    PFORT_CONF_EXE_NODE volatile buckets[1];
+} FORT_CONF_EXE_TABLE, *PFORT_CONF_EXE_TABLE;
+
+typedef const FORT_CONF_EXE_TABLE *PCFORT_CONF_EXE_TABLE;
+
+#define FORT_CONF_EXE_TABLE_BUCKETS_OFF offsetof(FORT_CONF_EXE_TABLE, buckets)
+#define FORT_CONF_EXE_TABLE_SIZE(n)                                                                \
+    (FORT_CONF_EXE_TABLE_BUCKETS_OFF + (n) * sizeof(PFORT_CONF_EXE_NODE))
+
+static PFORT_CONF_EXE_TABLE fort_conf_exe_table_new(UINT32 size, UCHAR link)
+{
+    PFORT_CONF_EXE_TABLE table = tommy_calloc(1, FORT_CONF_EXE_TABLE_SIZE(size));
+
+    if (table != NULL) {
+        table->bucket_mask = size - 1;
+        table->link = link;
+    }
+
+    return table;
+}
+
+inline static PFORT_CONF_EXE_NODE volatile *fort_conf_exe_table_bucket(
+        PFORT_CONF_EXE_TABLE table, tommy_key_t path_hash)
+{
+    return &table->buckets[path_hash & table->bucket_mask];
+}
+
+static void fort_conf_exe_table_insert(PFORT_CONF_EXE_TABLE table, PFORT_CONF_EXE_NODE node)
 {
-    PFORT_CONF_EXE_NODE node =
-            (PFORT_CONF_EXE_NODE) tommy_hashdyn_bucket(&conf_ref->exe_map, path_hash);
+    PFORT_CONF_EXE_NODE volatile *bucket = fort_conf_exe_table_bucket(table, node->path_hash);
+
+    node->next[table->link] = *bucket;
+
+    /* Publish the initialized node */
+    InterlockedExchangePointer((PVOID volatile *) bucket, node);
+}
+
+static void fort_conf_exe_table_remove(PFORT_CONF_EXE_TABLE table, PFORT_CONF_EXE_NODE node)
+{
+    const UCHAR link = table->link;
+
+    PFORT_CONF_EXE_NODE volatile *prev = fort_conf_exe_table_bucket(table, node->path_hash);
+
+    while (*prev != node) {
+        prev = &(*prev)->next[link];
+    }
+
+    /* The removed node still links to the rest of chain for current readers */
+    InterlockedExchangePointer((PVOID volatile *) prev, node->next[link]);
+}
+
+static PFORT_CONF_EXE_NODE fort_conf_exe_table_find(
+        PCFORT_CONF_EXE_TABLE table, PCFORT_APP_PATH path, tommy_key_t path_hash)
+{
+    const UCHAR link = table->link;
+
+    PFORT_CONF_EXE_NODE node = table->buckets[path_hash & table->bucket_mask];
 
     while (node != NULL) {
-        if (fort_conf_app_exe_equal(node->app_entry, path))
+        if (node->path_hash == path_hash && fort_conf_app_exe_equal(node->app_entry, path))
             return node;
 
-        node = node->next;
+        node = node->next[link];
     }
 
     return NULL;
 }
 
+static LONG fort_conf_exe_read_begin(PFORT_CONF_EXE_MAP exe_map)
+{
+    for (;;) {
+        const LONG epoch = exe_map->exe_epoch;
+        const LONG slot = (epoch & 1);
+
+        InterlockedIncrement(&exe_map->exe_readers[slot]);
+
+        /* Re-check the epoch, as a writer may be already waiting for the slot's readers */
+        if (exe_map->exe_epoch == epoch)
+            return slot;
+
+        InterlockedDecrement(&exe_map->exe_readers[slot]);
+    }
+}
+
+static void fort_conf_exe_read_end(PFORT_CONF_EXE_MAP exe_map, LONG slot)
+{
+    InterlockedDecrement(&exe_map->exe_readers[slot]);
+}
+
+/* Wait for the readers, which may still see the unpublished data */
+static void fort_conf_exe_synchronize(PFORT_CONF_EXE_MAP exe_map)
+{
+    const LONG epoch = InterlockedIncrement(&exe_map->exe_epoch) - 1;
+    LONG volatile *readers = &exe_map->exe_readers[epoch & 1];
+
+    while (InterlockedAdd(readers, 0) != 0) {
+        YieldProcessor();
+    }
+}
+
 FORT_API FORT_APP_DATA fort_conf_exe_find(PCFORT_CONF conf, PVOID context, PCFORT_APP_PATH path)
 {
     UNUSED(conf);
 
     PFORT_CONF_REF conf_ref = context;
+    PFORT_CONF_EXE_MAP exe_map = conf_ref->exe_map;
     const tommy_key_t path_hash = (tommy_key_t) tommy_hash_u64(0, path->buffer, path->len);
 
     FORT_APP_DATA app_data = { 0 };
 
-    KIRQL oldIrql = ExAcquireSpinLockShared(&conf_ref->conf_lock);
+    /* Readers must not be preempted by the writers, which wait for them */
+    const KIRQL oldIrql = KeRaiseIrqlToDpcLevel();
+    const LONG slot = fort_conf_exe_read_begin(exe_map);
     {
-        PCFORT_CONF_EXE_NODE node = fort_conf_ref_exe_find_node(conf_ref, path, path_hash);
+        PCFORT_CONF_EXE_NODE node = fort_conf_exe_table_find(exe_map->exe_table, path, path_hash);
 
         if (node != NULL) {
-            app_data = node->app_entry->app_data;
+            PCFORT_APP_ENTRY app_entry = node->app_entry;
+
+            app_data = app_entry->app_data;
         }
     }
-    ExReleaseSpinLockShared(&conf_ref->conf_lock, oldIrql);
+    fort_conf_exe_read_end(exe_map, slot);
+    KeLowerIrql(oldIrql);
 
     return app_data;
 }
 
-static void fort_conf_ref_exe_new_path(
-        PFORT_CONF_REF conf_ref, PFORT_APP_ENTRY entry, tommy_key_t path_hash)
+/* The deferred nodes are chained by the link, which the table's readers don't follow */
+inline static UCHAR fort_conf_exe_map_del_link(PFORT_CONF_EXE_MAP exe_map)
+{
+    return exe_map->exe_table->link ^ 1;
+}
+
+/* Free the deferred nodes and their app entries, after the readers' wait */
+static void fort_conf_exe_map_free_del_nodes(PFORT_CONF_EXE_MAP exe_map, UCHAR del_link)
 {
-    PFORT_CONF conf = &conf_ref->conf;
+    PFORT_CONF_EXE_NODE node = exe_map->del_nodes;
+
+    exe_map->del_nodes = NULL;
+
+    while (node != NULL) {
+        PFORT_CONF_EXE_NODE node_next = node->next[del_link];
 
-    tommy_arrayof *exe_nodes = &conf_ref->exe_nodes;
-    tommy_hashdyn *exe_map = &conf_ref->exe_map;
+        /* Delete from pool */
+        {
+            PFORT_APP_ENTRY entry = node->app_entry;
+            fort_pool_free(&exe_map->pool_list, entry);
+        }
 
-    tommy_hashdyn_node *exe_node = tommy_list_tail(&conf_ref->free_nodes);
+        tommy_list_insert_tail_check(&exe_map->free_nodes, (tommy_node *) node);
 
-    if (exe_node != NULL) {
-        tommy_list_remove_existing(&conf_ref->free_nodes, exe_node);
+        node = node_next;
+    }
+}
+
+/* The readers may still see the node, so free it on the next wait for them */
+static void fort_conf_exe_map_del_node_later(PFORT_CONF_EXE_MAP exe_map, PFORT_CONF_EXE_NODE node)
+{
+    node->next[fort_conf_exe_map_del_link(exe_map)] = exe_map->del_nodes;
+
+    exe_map->del_nodes = node;
+}
+
+/* Wait for the readers once for all the writer's deferred nodes */
+static void fort_conf_exe_map_flush_locked(PFORT_CONF_EXE_MAP exe_map)
+{
+    if (exe_map->del_nodes == NULL)
+        return;
+
+    fort_conf_exe_synchronize(exe_map);
+
+    fort_conf_exe_map_free_del_nodes(exe_map, fort_conf_exe_map_del_link(exe_map));
+}
+
+static void fort_conf_exe_map_grow(PFORT_CONF_EXE_MAP exe_map)
+{
+    PFORT_CONF_EXE_TABLE old_table = exe_map->exe_table;
+    const UINT32 old_size = old_table->bucket_mask + 1;
+
+    if (exe_map->apps_n < old_size || old_size >= FORT_CONF_EXE_TABLE_SIZE_MAX)
+        return;
+
+    const UCHAR old_link = old_table->link;
+
+    PFORT_CONF_EXE_TABLE table = fort_conf_exe_table_new(old_size * 2, old_link ^ 1);
+    if (table == NULL)
+        return; /* keep the longer chains */
+
+    /* Re-link the nodes by the other link, the old table's readers are not affected */
+    for (UINT32 i = 0; i < old_size; ++i) {
+        PFORT_CONF_EXE_NODE node = old_table->buckets[i];
+
+        while (node != NULL) {
+            fort_conf_exe_table_insert(table, node);
+
+            node = node->next[old_link];
+        }
+    }
+
+    InterlockedExchangePointer((PVOID volatile *) &exe_map->exe_table, table);
+
+    fort_conf_exe_synchronize(exe_map);
+
+    tommy_free(old_table);
+
+    /* The wait covers the deferred nodes too, they are chained by the old table's spare link */
+    fort_conf_exe_map_free_del_nodes(exe_map, old_link ^ 1);
+}
+
+static PFORT_CONF_EXE_NODE fort_conf_exe_map_node_new(PFORT_CONF_EXE_MAP exe_map)
+{
+    tommy_arrayof *exe_nodes = &exe_map->exe_nodes;
+
+    PFORT_CONF_EXE_NODE node = (PFORT_CONF_EXE_NODE) tommy_list_tail(&exe_map->free_nodes);
+
+    if (node != NULL) {
+        tommy_list_remove_existing(&exe_map->free_nodes, (tommy_node *) node);
     } else {
-        const UINT16 index = conf->exe_apps_n;
+        const tommy_size_t index = tommy_arrayof_size(exe_nodes);
 
+        /* The array's segments are never moved, so the readers are not affected */
         tommy_arrayof_grow(exe_nodes, index + 1);
 
-        exe_node = tommy_arrayof_ref(exe_nodes, index);
+        node = tommy_arrayof_ref(exe_nodes, index);
     }
 
-    tommy_hashdyn_insert(exe_map, exe_node, entry, path_hash);
+    return node;
+}
+
+static void fort_conf_exe_map_new_path(
+        PFORT_CONF_EXE_MAP exe_map, PFORT_APP_ENTRY entry, tommy_key_t path_hash)
+{
+    PFORT_CONF_EXE_NODE node = fort_conf_exe_map_node_new(exe_map);
+
+    node->app_entry = entry;
+    node->path_hash = path_hash;
 
-    ++conf->exe_apps_n;
+    fort_conf_exe_table_insert(exe_map->exe_table, node);
+
+    ++exe_map->apps_n;
+
+    fort_conf_exe_map_grow(exe_map);
 }
 
-static NTSTATUS fort_conf_ref_exe_new_entry(PFORT_CONF_REF conf_ref, PCFORT_APP_ENTRY app_entry,
-        PCFORT_APP_PATH path, tommy_key_t path_hash)
+static PFORT_APP_ENTRY fort_conf_exe_map_new_app_entry(
+        PFORT_CONF_EXE_MAP exe_map, PCFORT_APP_ENTRY app_entry, PCFORT_APP_PATH path)
 {
     const UINT16 path_len = path->len;
 
     const UINT16 entry_size = (UINT16) FORT_CONF_APP_ENTRY_SIZE(path_len);
-    PFORT_APP_ENTRY entry = fort_pool_malloc(&conf_ref->pool_list, entry_size);
+    PFORT_APP_ENTRY entry = fort_pool_malloc(&exe_map->pool_list, entry_size);
 
     if (entry == NULL)
-        return STATUS_INSUFFICIENT_RESOURCES;
+        return NULL;
 
     entry->app_data = app_entry->app_data;
     entry->path_len = path_len;
@@ -99,44 +290,94 @@ static NTSTATUS fort_conf_ref_exe_new_entry(PFORT_CONF_REF conf_ref, PCFORT_APP_
         entry->path[path_len / sizeof(WCHAR)] = L'\0';
     }
 
+    return entry;
+}
+
+static NTSTATUS fort_conf_exe_map_new_entry(PFORT_CONF_EXE_MAP exe_map,
+        PCFORT_APP_ENTRY app_entry, PCFORT_APP_PATH path, tommy_key_t path_hash)
+{
+    PFORT_APP_ENTRY entry = fort_conf_exe_map_new_app_entry(exe_map, app_entry, path);
+
+    if (entry == NULL)
+        return STATUS_INSUFFICIENT_RESOURCES;
+
     /* Add exe node */
-    fort_conf_ref_exe_new_path(conf_ref, entry, path_hash);
+    fort_conf_exe_map_new_path(exe_map, entry, path_hash);
+
+    return STATUS_SUCCESS;
+}
+
+static NTSTATUS fort_conf_exe_map_replace_entry(
+        PFORT_CONF_EXE_MAP exe_map, PFORT_CONF_EXE_NODE node, PCFORT_APP_ENTRY app_entry)
+{
+    PFORT_APP_ENTRY old_entry = node->app_entry;
+
+    const FORT_APP_PATH path = {
+        .len = old_entry->path_len,
+        .buffer = old_entry->path,
+    };
+
+    /* Readers may copy the app data meanwhile, so replace the whole entry */
+    PFORT_APP_ENTRY entry = fort_conf_exe_map_new_app_entry(exe_map, app_entry, &path);
+
+    if (entry == NULL)
+        return STATUS_INSUFFICIENT_RESOURCES;
+
+    InterlockedExchangePointer((PVOID volatile *) &node->app_entry, entry);
+
+    /* Free the old entry by a spare node, which is not in the table */
+    PFORT_CONF_EXE_NODE old_node = fort_conf_exe_map_node_new(exe_map);
+    old_node->app_entry = old_entry;
+
+    fort_conf_exe_map_del_node_later(exe_map, old_node);
 
     return STATUS_SUCCESS;
 }
 
-static NTSTATUS fort_conf_ref_exe_add_path_locked(PFORT_CONF_REF conf_ref,
+static NTSTATUS fort_conf_exe_map_add_path_locked(PFORT_CONF_EXE_MAP exe_map,
         PCFORT_APP_ENTRY app_entry, PCFORT_APP_PATH path, tommy_key_t path_hash)
 {
-    PCFORT_CONF_EXE_NODE node = fort_conf_ref_exe_find_node(conf_ref, path, path_hash);
+    PFORT_CONF_EXE_NODE node = fort_conf_exe_table_find(exe_map->exe_table, path, path_hash);
 
     if (node == NULL) {
-        return fort_conf_ref_exe_new_entry(conf_ref, app_entry, path, path_hash);
+        return fort_conf_exe_map_new_entry(exe_map, app_entry, path, path_hash);
     }
 
     if (app_entry->app_data.flags.is_new)
         return FORT_STATUS_USER_ERROR;
 
     /* Replace the app data */
-    {
-        PFORT_APP_ENTRY entry = node->app_entry;
-        entry->app_data = app_entry->app_data;
-    }
+    return fort_conf_exe_map_replace_entry(exe_map, node, app_entry);
+}
 
-    return STATUS_SUCCESS;
+static NTSTATUS fort_conf_exe_map_add_entry_locked(
+        PFORT_CONF_EXE_MAP exe_map, PCFORT_APP_ENTRY app_entry)
+{
+    const FORT_APP_PATH path = {
+        .len = app_entry->path_len,
+        .buffer = app_entry->path,
+    };
+
+    const tommy_key_t path_hash = (tommy_key_t) tommy_hash_u64(0, path.buffer, path.len);
+
+    return fort_conf_exe_map_add_path_locked(exe_map, app_entry, &path, path_hash);
 }
 
 FORT_API NTSTATUS fort_conf_ref_exe_add_path(
         PFORT_CONF_REF conf_ref, PCFORT_APP_ENTRY app_entry, PCFORT_APP_PATH path)
 {
+    PFORT_CONF_EXE_MAP exe_map = conf_ref->exe_map;
+
     const tommy_key_t path_hash = (tommy_key_t) tommy_hash_u64(0, path->buffer, path->len);
     NTSTATUS status;
 
-    KIRQL oldIrql = ExAcquireSpinLockExclusive(&conf_ref->conf_lock);
+    KIRQL oldIrql = ExAcquireSpinLockExclusive(&exe_map->lock);
     {
-        status = fort_conf_ref_exe_add_path_locked(conf_ref, app_entry, path, path_hash);
+        status = fort_conf_exe_map_add_path_locked(exe_map, app_entry, path, path_hash);
+
+        fort_conf_exe_map_flush_locked(exe_map);
     }
-    ExReleaseSpinLockExclusive(&conf_ref->conf_lock, oldIrql);
+    ExReleaseSpinLockExclusive(&exe_map->lock, oldIrql);
 
     return status;
 }
@@ -144,21 +385,25 @@ FORT_API NTSTATUS fort_conf_ref_exe_add_path(
 FORT_API NTSTATUS fort_conf_ref_exe_add_entry(
         PFORT_CONF_REF conf_ref, PCFORT_APP_ENTRY app_entry, BOOL locked)
 {
-    const FORT_APP_PATH path = {
-        .len = app_entry->path_len,
-        .buffer = app_entry->path,
-    };
-
     if (locked) {
-        const tommy_key_t path_hash = (tommy_key_t) tommy_hash_u64(0, path.buffer, path.len);
+        PFORT_CONF_EXE_MAP exe_map = conf_ref->exe_map;
 
-        return fort_conf_ref_exe_add_path_locked(conf_ref, app_entry, &path, path_hash);
+        const NTSTATUS status = fort_conf_exe_map_add_entry_locked(exe_map, app_entry);
+
+        fort_conf_exe_map_flush_locked(exe_map);
+
+        return status;
     } else {
+        const FORT_APP_PATH path = {
+            .len = app_entry->path_len,
+            .buffer = app_entry->path,
+        };
+
         return fort_conf_ref_exe_add_path(conf_ref, app_entry, &path);
     }
 }
 
-static void fort_conf_ref_exe_fill(PFORT_CONF_REF conf_ref, PCFORT_CONF conf)
+static void fort_conf_exe_map_fill(PFORT_CONF_EXE_MAP exe_map, PCFORT_CONF conf)
 {
     const char *app_entries = (const char *) (conf->data + conf->exe_apps_off);
 
@@ -167,89 +412,226 @@ static void fort_conf_ref_exe_fill(PFORT_CONF_REF conf_ref, PCFORT_CONF conf)
     for (int i = 0; i < count; ++i) {
         PCFORT_APP_ENTRY entry = (PCFORT_APP_ENTRY) app_entries;
 
-        fort_conf_ref_exe_add_entry(conf_ref, entry, TRUE);
+        fort_conf_exe_map_add_entry_locked(exe_map, entry);
 
         app_entries += FORT_CONF_APP_ENTRY_SIZE(entry->path_len);
     }
+
+    /* The duplicate paths' replaced entries, the map has no readers yet */
+    fort_conf_exe_map_flush_locked(exe_map);
 }
 
-static void fort_conf_ref_exe_del_path(PFORT_CONF_REF conf_ref, PCFORT_APP_PATH path)
+static PFORT_CONF_EXE_NODE fort_conf_exe_map_unlink_path_locked(
+        PFORT_CONF_EXE_MAP exe_map, PCFORT_APP_PATH path)
 {
     const tommy_key_t path_hash = (tommy_key_t) tommy_hash_u64(0, path->buffer, path->len);
 
-    KIRQL oldIrql = ExAcquireSpinLockExclusive(&conf_ref->conf_lock);
-    {
-        PFORT_CONF_EXE_NODE node = fort_conf_ref_exe_find_node(conf_ref, path, path_hash);
+    PFORT_CONF_EXE_TABLE table = exe_map->exe_table;
+    PFORT_CONF_EXE_NODE node = fort_conf_exe_table_find(table, path, path_hash);
 
-        if (node != NULL) {
-            /* Delete from conf */
-            {
-                PFORT_CONF conf = &conf_ref->conf;
-                --conf->exe_apps_n;
-            }
+    if (node == NULL)
+        return NULL;
 
-            /* Delete from pool */
-            {
-                PFORT_APP_ENTRY entry = node->app_entry;
-                fort_pool_free(&conf_ref->pool_list, entry);
-            }
+    --exe_map->apps_n;
 
-            /* Delete from exe map */
-            tommy_hashdyn_remove_existing(&conf_ref->exe_map, (tommy_hashdyn_node *) node);
+    /* Delete from exe map */
+    fort_conf_exe_table_remove(table, node);
 
-            tommy_list_insert_tail_check(&conf_ref->free_nodes, (tommy_node *) node);
-        }
+    return node;
+}
+
+static void fort_conf_exe_map_del_path_locked(PFORT_CONF_EXE_MAP exe_map, PCFORT_APP_PATH path)
+{
+    PFORT_CONF_EXE_NODE node = fort_conf_exe_map_unlink_path_locked(exe_map, path);
+
+    if (node != NULL) {
+        fort_conf_exe_map_del_node_later(exe_map, node);
     }
-    ExReleaseSpinLockExclusive(&conf_ref->conf_lock, oldIrql);
 }
 
-FORT_API void fort_conf_ref_exe_del_entry(PFORT_CONF_REF conf_ref, PCFORT_APP_ENTRY entry)
+static void fort_conf_exe_map_del_entry_locked(
+        PFORT_CONF_EXE_MAP exe_map, PCFORT_APP_ENTRY entry)
 {
     const FORT_APP_PATH path = {
         .len = entry->path_len,
         .buffer = entry->path,
     };
 
-    fort_conf_ref_exe_del_path(conf_ref, &path);
+    fort_conf_exe_map_del_path_locked(exe_map, &path);
+}
+
+FORT_API void fort_conf_ref_exe_del_entry(PFORT_CONF_REF conf_ref, PCFORT_APP_ENTRY entry)
+{
+    PFORT_CONF_EXE_MAP exe_map = conf_ref->exe_map;
+
+    KIRQL oldIrql = ExAcquireSpinLockExclusive(&exe_map->lock);
+    {
+        fort_conf_exe_map_del_entry_locked(exe_map, entry);
+
+        fort_conf_exe_map_flush_locked(exe_map);
+    }
+    ExReleaseSpinLockExclusive(&exe_map->lock, oldIrql);
 }
 
-static void fort_conf_ref_init(PFORT_CONF_REF conf_ref)
+static NTSTATUS fort_conf_exe_map_batch_locked(
+        PFORT_CONF_EXE_MAP exe_map, PCFORT_CONF_APPS_BATCH apps_batch)
 {
-    conf_ref->refcount = 0;
+    NTSTATUS status = STATUS_SUCCESS;
+
+    /* Delete the apps */
+    {
+        const char *app_entries = apps_batch->data;
+
+        for (UINT32 i = 0; i < apps_batch->del_apps_n; ++i) {
+            PCFORT_APP_ENTRY entry = (PCFORT_APP_ENTRY) app_entries;
+
+            fort_conf_exe_map_del_entry_locked(exe_map, entry);
+
+            app_entries += FORT_CONF_APP_ENTRY_SIZE(entry->path_len);
+        }
+    }
+
+    /* Add the apps, continue on errors */
+    {
+        const char *app_entries = apps_batch->data + apps_batch->add_apps_off;
+
+        for (UINT32 i = 0; i < apps_batch->add_apps_n; ++i) {
+            PCFORT_APP_ENTRY entry = (PCFORT_APP_ENTRY) app_entries;
 
-    fort_pool_list_init(&conf_ref->pool_list);
-    tommy_list_init(&conf_ref->free_nodes);
+            const NTSTATUS add_status = fort_conf_exe_map_add_entry_locked(exe_map, entry);
+            if (!NT_SUCCESS(add_status)) {
+                status = add_status;
+            }
+
+            app_entries += FORT_CONF_APP_ENTRY_SIZE(entry->path_len);
+        }
+    }
 
-    tommy_arrayof_init(&conf_ref->exe_nodes, sizeof(FORT_CONF_EXE_NODE));
-    tommy_hashdyn_init(&conf_ref->exe_map);
+    /* Wait for the readers once for the deleted and replaced apps */
+    fort_conf_exe_map_flush_locked(exe_map);
 
-    conf_ref->conf_lock = 0;
+    return status;
 }
 
-FORT_API PFORT_CONF_REF fort_conf_ref_new(PCFORT_CONF conf, ULONG len)
+FORT_API NTSTATUS fort_conf_ref_exe_batch(
+        PFORT_CONF_REF conf_ref, PCFORT_CONF_APPS_BATCH apps_batch)
+{
+    PFORT_CONF_EXE_MAP exe_map = conf_ref->exe_map;
+    NTSTATUS status;
+
+    KIRQL oldIrql = ExAcquireSpinLockExclusive(&exe_map->lock);
+    {
+        status = fort_conf_exe_map_batch_locked(exe_map, apps_batch);
+    }
+    ExReleaseSpinLockExclusive(&exe_map->lock, oldIrql);
+
+    return status;
+}
+
+static PFORT_CONF_EXE_MAP fort_conf_exe_map_new(ULONG pool_size)
+{
+    PFORT_CONF_EXE_MAP exe_map = tommy_malloc(sizeof(FORT_CONF_EXE_MAP));
+
+    if (exe_map == NULL)
+        return NULL;
+
+    exe_map->exe_table = fort_conf_exe_table_new(FORT_CONF_EXE_TABLE_SIZE_MIN, /*link=*/0);
+
+    if (exe_map->exe_table == NULL) {
+        tommy_free(exe_map);
+        return NULL;
+    }
+
+    exe_map->refcount = 1;
+    exe_map->apps_n = 0;
+
+    fort_pool_list_init(&exe_map->pool_list);
+    fort_pool_init(&exe_map->pool_list, pool_size);
+
+    tommy_list_init(&exe_map->free_nodes);
+    exe_map->del_nodes = NULL;
+
+    tommy_arrayof_init(&exe_map->exe_nodes, sizeof(FORT_CONF_EXE_NODE));
+
+    exe_map->exe_epoch = 0;
+    exe_map->exe_readers[0] = 0;
+    exe_map->exe_readers[1] = 0;
+
+    exe_map->lock = 0;
+
+    return exe_map;
+}
+
+static void fort_conf_exe_map_put(PFORT_CONF_EXE_MAP exe_map)
+{
+    if (InterlockedDecrement(&exe_map->refcount) != 0)
+        return;
+
+    fort_pool_done(&exe_map->pool_list);
+
+    tommy_free(exe_map->exe_table);
+    tommy_arrayof_done(&exe_map->exe_nodes);
+
+    tommy_free(exe_map);
+}
+
+static PFORT_CONF_REF fort_conf_ref_alloc(PFORT_CONF_EXE_MAP exe_map, ULONG conf_len)
 {
-    const ULONG conf_len = FORT_CONF_DATA_OFF + conf->exe_apps_off;
     const ULONG ref_len = conf_len + offsetof(FORT_CONF_REF, conf);
     PFORT_CONF_REF conf_ref = tommy_malloc(ref_len);
 
     if (conf_ref != NULL) {
-        RtlCopyMemory(&conf_ref->conf, conf, conf_len);
+        conf_ref->refcount = 0;
+        conf_ref->exe_map = exe_map;
+    }
+
+    return conf_ref;
+}
+
+FORT_API PFORT_CONF_REF fort_conf_ref_new(PCFORT_CONF conf, ULONG len)
+{
+    const ULONG conf_len = FORT_CONF_DATA_OFF + conf->exe_apps_off;
 
-        fort_conf_ref_init(conf_ref);
-        fort_pool_init(&conf_ref->pool_list, len - conf_len);
+    PFORT_CONF_EXE_MAP exe_map = fort_conf_exe_map_new(len - conf_len);
+    if (exe_map == NULL)
+        return NULL;
 
-        fort_conf_ref_exe_fill(conf_ref, conf);
+    PFORT_CONF_REF conf_ref = fort_conf_ref_alloc(exe_map, conf_len);
+    if (conf_ref == NULL) {
+        fort_conf_exe_map_put(exe_map);
+        return NULL;
     }
 
+    RtlCopyMemory(&conf_ref->conf, conf, conf_len);
+
+    fort_conf_exe_map_fill(exe_map, conf);
+
     return conf_ref;
 }
 
-static void fort_conf_ref_del(PFORT_CONF_REF conf_ref)
+FORT_API PFORT_CONF_REF fort_conf_ref_delta_new(
+        PFORT_CONF_REF conf_ref, PCFORT_CONF_DELTA delta, ULONG conf_len)
 {
-    fort_pool_done(&conf_ref->pool_list);
+    PFORT_CONF_EXE_MAP exe_map = conf_ref->exe_map;
 
-    tommy_hashdyn_done(&conf_ref->exe_map);
-    tommy_arrayof_done(&conf_ref->exe_nodes);
+    /* Share the exe map instead of re-filling it */
+    PFORT_CONF_REF new_ref = fort_conf_ref_alloc(exe_map, conf_len);
+    if (new_ref == NULL)
+        return NULL;
+
+    InterlockedIncrement(&exe_map->refcount);
+
+    fort_conf_delta_conf_write(&new_ref->conf, &conf_ref->conf, delta);
+
+    /* Return it taken to be put after fort_conf_ref_replace() */
+    new_ref->refcount = 1;
+
+    return new_ref;
+}
+
+static void fort_conf_ref_del(PFORT_CONF_REF conf_ref)
+{
+    fort_conf_exe_map_put(conf_ref->exe_map);
 
     tommy_free(conf_ref);
 }
@@ -293,6 +675,29 @@ FORT_API PFORT_CONF_REF fort_conf_ref_take(PFORT_DEVICE_CONF device_conf)
     return conf_ref;
 }
 
+FORT_API BOOL fort_conf_ref_replace(
+        PFORT_DEVICE_CONF device_conf, PFORT_CONF_REF old_ref, PFORT_CONF_REF new_ref)
+{
+    BOOL replaced = FALSE;
+
+    KLOCK_QUEUE_HANDLE lock_queue;
+    KeAcquireInStackQueuedSpinLock(&device_conf->ref_lock, &lock_queue);
+    if (device_conf->ref == old_ref) {
+        /* The flags may be changed in place after the new conf's copy */
+        new_ref->conf.flags = old_ref->conf.flags;
+
+        device_conf->ref = new_ref;
+        replaced = TRUE;
+    }
+    KeReleaseInStackQueuedSpinLock(&lock_queue);
+
+    if (replaced) {
+        fort_device_conf_changed(device_conf);
+    }
+
+    return replaced;
+}
+
 static void fort_device_flags_conf_set(PFORT_DEVICE_CONF device_conf, FORT_CONF_FLAGS conf_flags)
 {
     fort_device_flag_set(device_conf, FORT_DEVICE_BOOT_FILTER, conf_flags.boot_filter);
@@ -367,6 +772,8 @@ FORT_API FORT_CONF_FLAGS fort_conf_ref_set(PFORT_DEVICE_CONF device_conf, PFORT_
     }
     KeReleaseInStackQueuedSpinLock(&lock_queue);
 
+    fort_device_conf_changed(device_conf);
+
     fort_device_flags_conf_log_event(old_conf_flags, conf_flags);
 
     return old_conf_flags;
@@ -401,6 +808,8 @@ FORT_API FORT_CONF_FLAGS fort_conf_ref_flags_set(
     }
     KeReleaseInStackQueuedSpinLock(&lock_queue);
 
+    fort_device_conf_changed(device_conf);
+
     fort_device_flags_conf_log_event(old_conf_flags, conf_flags);
 
     return old_conf_flags;
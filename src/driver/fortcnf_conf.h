@@ -17,12 +17,21 @@ FORT_API NTSTATUS fort_conf_ref_exe_add_entry(
 
 FORT_API void fort_conf_ref_exe_del_entry(PFORT_CONF_REF conf_ref, PCFORT_APP_ENTRY entry);
 
+FORT_API NTSTATUS fort_conf_ref_exe_batch(
+        PFORT_CONF_REF conf_ref, PCFORT_CONF_APPS_BATCH apps_batch);
+
 FORT_API PFORT_CONF_REF fort_conf_ref_new(PCFORT_CONF conf, ULONG len);
 
+FORT_API PFORT_CONF_REF fort_conf_ref_delta_new(
+        PFORT_CONF_REF conf_ref, PCFORT_CONF_DELTA delta, ULONG conf_len);
+
 FORT_API void fort_conf_ref_put(PFORT_DEVICE_CONF device_conf, PFORT_CONF_REF conf_ref);
 
 FORT_API PFORT_CONF_REF fort_conf_ref_take(PFORT_DEVICE_CONF device_conf);
 
+FORT_API BOOL fort_conf_ref_replace(
+        PFORT_DEVICE_CONF device_conf, PFORT_CONF_REF old_ref, PFORT_CONF_REF new_ref);
+
 FORT_API FORT_CONF_FLAGS fort_conf_ref_set(PFORT_DEVICE_CONF device_conf, PFORT_CONF_REF conf_ref);
 
 FORT_API FORT_CONF_FLAGS fort_conf_ref_flags_set(
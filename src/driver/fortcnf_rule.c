@@ -2,49 +2,100 @@
 
 #include "fortcnf_rule.h"
 
-FORT_API PFORT_CONF_RULES fort_conf_rules_new(PCFORT_CONF_RULES rules, ULONG len)
+#include "fortcnf_zone.h"
+
+FORT_API PFORT_CONF_BLOB_REF fort_conf_rules_new(PCFORT_CONF_RULES rules, ULONG len)
 {
-    return fort_conf_mem_alloc(rules, len);
+    return fort_conf_blob_ref_new(rules, len);
 }
 
-FORT_API void fort_conf_rules_set(PFORT_DEVICE_CONF device_conf, PFORT_CONF_RULES rules)
+FORT_API void fort_conf_rules_set(PFORT_DEVICE_CONF device_conf, PFORT_CONF_BLOB_REF rules_ref)
 {
+    FORT_CONF_RULES_GLOB rules_glob = { 0 };
+    UINT32 rules_filter_types = 0;
+
+    if (rules_ref != NULL) {
+        PCFORT_CONF_RULES rules = fort_conf_blob_ref_rules(rules_ref);
+
+        rules_glob = rules->glob;
+        rules_filter_types = fort_conf_rules_filter_types(rules);
+    }
+
+    PFORT_CONF_BLOB_REF old_ref;
+
+    /* Publish the global rules together with their snapshot */
     KIRQL oldIrql = ExAcquireSpinLockExclusive(&device_conf->lock);
     {
-        fort_conf_mem_free(device_conf->rules);
-        device_conf->rules = rules;
-
-        if (rules != NULL) {
-            device_conf->rules_glob = rules->glob;
-        } else {
-            const FORT_CONF_RULES_GLOB rules_glob = { 0 };
-            device_conf->rules_glob = rules_glob;
-        }
+        old_ref = device_conf->rules_ref;
+        device_conf->rules_ref = rules_ref;
+
+        device_conf->rules_glob = rules_glob;
+        device_conf->rules_filter_types = rules_filter_types;
     }
     ExReleaseSpinLockExclusive(&device_conf->lock, oldIrql);
+
+    fort_device_conf_changed(device_conf);
+
+    fort_conf_blob_ref_put(old_ref);
+}
+
+FORT_API FORT_CONF_RULES_GLOB fort_devconf_rules_glob(PFORT_DEVICE_CONF device_conf)
+{
+    FORT_CONF_RULES_GLOB rules_glob;
+
+    KIRQL oldIrql = ExAcquireSpinLockShared(&device_conf->lock);
+    {
+        rules_glob = device_conf->rules_glob;
+    }
+    ExReleaseSpinLockShared(&device_conf->lock, oldIrql);
+
+    return rules_glob;
 }
 
-inline static void fort_conf_rule_flag_set_locked(
-        PFORT_CONF_RULES rules, PCFORT_CONF_RULE_FLAG rule_flag)
+static PFORT_CONF_BLOB_REF fort_conf_rules_copy_flag(
+        PFORT_CONF_BLOB_REF rules_ref, PCFORT_CONF_RULE_FLAG rule_flag)
 {
+    PCFORT_CONF_RULES rules = fort_conf_blob_ref_rules(rules_ref);
+
     if (rule_flag->rule_id > rules->max_rule_id)
-        return;
+        return NULL;
+
+    PFORT_CONF_BLOB_REF new_ref = fort_conf_blob_ref_new(rules, rules_ref->len);
+    if (new_ref == NULL)
+        return NULL;
 
-    const FORT_CONF_RULES_RT rules_rt = fort_conf_rules_rt_make(rules, /*zones=*/NULL);
+    const FORT_CONF_RULES_RT rules_rt =
+            fort_conf_rules_rt_make(fort_conf_blob_ref_rules(new_ref), /*zones=*/NULL);
     PFORT_CONF_RULE rule = fort_conf_rules_rt_rule(&rules_rt, rule_flag->rule_id);
 
     rule->enabled = rule_flag->enabled;
+
+    return new_ref;
 }
 
 FORT_API void fort_conf_rule_flag_set(
         PFORT_DEVICE_CONF device_conf, PCFORT_CONF_RULE_FLAG rule_flag)
 {
-    KIRQL oldIrql = ExAcquireSpinLockExclusive(&device_conf->lock);
-    PFORT_CONF_RULES rules = device_conf->rules;
-    if (rules != NULL) {
-        fort_conf_rule_flag_set_locked(rules, rule_flag);
+    /* Copy on write: retry, if the rules were replaced meanwhile */
+    for (;;) {
+        PFORT_CONF_BLOB_REF rules_ref =
+                fort_conf_blob_ref_take(device_conf, &device_conf->rules_ref);
+        if (rules_ref == NULL)
+            break;
+
+        PFORT_CONF_BLOB_REF new_ref = fort_conf_rules_copy_flag(rules_ref, rule_flag);
+
+        const BOOL done = (new_ref == NULL)
+                || fort_conf_blob_ref_replace(
+                        device_conf, &device_conf->rules_ref, rules_ref, new_ref);
+
+        fort_conf_blob_ref_put(rules_ref);
+
+        if (done)
+            break;
+
+        fort_conf_blob_ref_put(new_ref);
     }
-    ExReleaseSpinLockExclusive(&device_conf->lock, oldIrql);
 }
 
 FORT_API BOOL fort_devconf_rules_conn_filtered(
@@ -52,12 +103,18 @@ FORT_API BOOL fort_devconf_rules_conn_filtered(
 {
     BOOL res = FALSE;
 
-    KIRQL oldIrql = ExAcquireSpinLockExclusive(&device_conf->lock);
-    PFORT_CONF_RULES rules = device_conf->rules;
-    if (rules != NULL) {
-        res = fort_conf_rules_conn_filtered(rules, device_conf->zones, conn, rule_id);
+    PFORT_CONF_BLOB_REF rules_ref = fort_conf_blob_ref_take(device_conf, &device_conf->rules_ref);
+    if (rules_ref != NULL) {
+        PFORT_CONF_ZONES_REF zones_ref = fort_conf_zones_ref_take(device_conf);
+
+        PCFORT_CONF_ZONES_RT zones = (zones_ref != NULL) ? &zones_ref->zones : NULL;
+
+        res = fort_conf_rules_conn_filtered(
+                fort_conf_blob_ref_rules(rules_ref), zones, conn, rule_id);
+
+        fort_conf_zones_ref_put(zones_ref);
+        fort_conf_blob_ref_put(rules_ref);
     }
-    ExReleaseSpinLockExclusive(&device_conf->lock, oldIrql);
 
     return res;
 }
@@ -7,9 +7,11 @@
 extern "C" {
 #endif
 
-FORT_API PFORT_CONF_RULES fort_conf_rules_new(PCFORT_CONF_RULES rules, ULONG len);
+FORT_API PFORT_CONF_BLOB_REF fort_conf_rules_new(PCFORT_CONF_RULES rules, ULONG len);
 
-FORT_API void fort_conf_rules_set(PFORT_DEVICE_CONF device_conf, PFORT_CONF_RULES rules);
+FORT_API void fort_conf_rules_set(PFORT_DEVICE_CONF device_conf, PFORT_CONF_BLOB_REF rules_ref);
+
+FORT_API FORT_CONF_RULES_GLOB fort_devconf_rules_glob(PFORT_DEVICE_CONF device_conf);
 
 FORT_API void fort_conf_rule_flag_set(
         PFORT_DEVICE_CONF device_conf, PCFORT_CONF_RULE_FLAG rule_flag);
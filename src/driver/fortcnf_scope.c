@@ -0,0 +1,275 @@
+/* Fort Firewall Configuration: Reauth Scope */
+
+#include "fortcnf_scope.h"
+
+#include "fortcnf_conf.h"
+
+#define FORT_CONF_SCOPE_ADDR_GROUPS_COUNT 2 /* LAN, INET */
+
+/* Recorded before reading the conf: the writer sees the items or the reader sees the change */
+static void fort_conf_scope_mask_add(LONG volatile *word, LONG mask)
+{
+    /* Skip the interlocked write to the shared word, when the mask is already recorded */
+    if ((*word & mask) == mask) {
+        KeMemoryBarrier();
+    } else {
+        InterlockedOr(word, mask);
+    }
+}
+
+inline static void fort_conf_scope_bit_add(LONG volatile *bits, UINT32 index)
+{
+    fort_conf_scope_mask_add(&bits[index / 32], (LONG) (1u << (index % 32)));
+}
+
+inline static BOOL fort_conf_scope_bit(const LONG *bits, UINT32 index)
+{
+    return (bits[index / 32] & (1u << (index % 32))) != 0;
+}
+
+inline static PFORT_CONF_SCOPE_SET fort_conf_scope_set(PFORT_CONF_SCOPE scope)
+{
+    return &scope->sets[scope->epoch & 1];
+}
+
+static UINT32 fort_conf_scope_app_index(PCFORT_APP_PATH path)
+{
+    const tommy_key_t path_hash = (tommy_key_t) tommy_hash_u64(0, path->buffer, path->len);
+
+    return path_hash & (FORT_CONF_SCOPE_APP_BITS_COUNT - 1);
+}
+
+static BOOL fort_conf_scope_used(PFORT_CONF_SCOPE scope, BOOL used)
+{
+    if (!used) {
+        InterlockedIncrement64(&scope->skip_count);
+    }
+
+    return used;
+}
+
+FORT_API void fort_conf_scope_reset(PFORT_CONF_SCOPE scope)
+{
+    const LONG epoch = scope->epoch + 1;
+
+    /* The previous set is kept, as the racing classifiers may still fill it */
+    PFORT_CONF_SCOPE_SET set = &scope->sets[epoch & 1];
+    RtlZeroMemory((PVOID) set, sizeof(FORT_CONF_SCOPE_SET));
+
+    InterlockedExchange(&scope->epoch, epoch);
+
+    InterlockedIncrement64(&scope->reauth_count);
+}
+
+FORT_API void fort_conf_scope_stat(PFORT_CONF_SCOPE scope, PFORT_CONF_STAT conf_stat)
+{
+    conf_stat->scope_reauths = (UINT64) scope->reauth_count;
+    conf_stat->scope_skips = (UINT64) scope->skip_count;
+}
+
+FORT_API void fort_conf_scope_app_add(PFORT_CONF_SCOPE scope, PCFORT_APP_PATH path)
+{
+    PFORT_CONF_SCOPE_SET set = fort_conf_scope_set(scope);
+
+    fort_conf_scope_bit_add(set->app_bits, fort_conf_scope_app_index(path));
+}
+
+FORT_API void fort_conf_scope_conn_add(PFORT_CONF_SCOPE scope, const FORT_APP_DATA app_data)
+{
+    PFORT_CONF_SCOPE_SET set = fort_conf_scope_set(scope);
+
+    const UINT32 zones_mask = app_data.zones.accept_mask | app_data.zones.reject_mask;
+    if (zones_mask != 0) {
+        fort_conf_scope_mask_add(&set->zones_mask, (LONG) zones_mask);
+    }
+
+    const UINT16 rule_id = app_data.rule_id;
+    if (rule_id != 0 && rule_id <= FORT_CONF_RULE_MAX) {
+        fort_conf_scope_bit_add(set->rule_bits, rule_id);
+    }
+}
+
+static BOOL fort_conf_scope_app_bit(PFORT_CONF_SCOPE scope, PCFORT_APP_PATH path)
+{
+    const UINT32 index = fort_conf_scope_app_index(path);
+
+    return fort_conf_scope_bit((const LONG *) scope->sets[0].app_bits, index)
+            || fort_conf_scope_bit((const LONG *) scope->sets[1].app_bits, index);
+}
+
+FORT_API BOOL fort_conf_scope_app_used(PFORT_CONF_SCOPE scope, PCFORT_APP_PATH path)
+{
+    /* Read the recorded items after the change */
+    KeMemoryBarrier();
+
+    return fort_conf_scope_used(scope, fort_conf_scope_app_bit(scope, path));
+}
+
+static BOOL fort_conf_scope_apps_used(
+        PFORT_CONF_SCOPE scope, const char *app_entries, UINT32 apps_n)
+{
+    for (UINT32 i = 0; i < apps_n; ++i) {
+        PCFORT_APP_ENTRY entry = (PCFORT_APP_ENTRY) app_entries;
+
+        const FORT_APP_PATH path = {
+            .len = entry->path_len,
+            .buffer = entry->path,
+        };
+
+        if (fort_conf_scope_app_bit(scope, &path))
+            return TRUE;
+
+        app_entries += FORT_CONF_APP_ENTRY_SIZE(entry->path_len);
+    }
+
+    return FALSE;
+}
+
+FORT_API BOOL fort_conf_scope_apps_batch_used(
+        PFORT_CONF_SCOPE scope, PCFORT_CONF_APPS_BATCH apps_batch)
+{
+    KeMemoryBarrier();
+
+    const BOOL used = fort_conf_scope_apps_used(scope, apps_batch->data, apps_batch->del_apps_n)
+            || fort_conf_scope_apps_used(scope, apps_batch->data + apps_batch->add_apps_off,
+                    apps_batch->add_apps_n);
+
+    return fort_conf_scope_used(scope, used);
+}
+
+static void fort_conf_scope_rule_bits(PFORT_CONF_SCOPE scope, PLONG rule_bits)
+{
+    for (int i = 0; i < FORT_CONF_SCOPE_BITS_WORDS(FORT_CONF_SCOPE_RULE_BITS_COUNT); ++i) {
+        rule_bits[i] = scope->sets[0].rule_bits[i] | scope->sets[1].rule_bits[i];
+    }
+}
+
+inline static BOOL fort_conf_scope_rule_mark(PLONG rule_bits, UINT16 rule_id)
+{
+    if (rule_id == 0 || fort_conf_scope_bit(rule_bits, rule_id))
+        return FALSE;
+
+    rule_bits[rule_id / 32] |= (1u << (rule_id % 32));
+    return TRUE;
+}
+
+static BOOL fort_conf_scope_rule_sets_mark(
+        PCFORT_CONF_RULES rules, PCFORT_CONF_RULE rule, PLONG rule_bits)
+{
+    BOOL marked = FALSE;
+
+    const UINT16 *rule_ids =
+            (const UINT16 *) ((PCCH) rule + FORT_CONF_RULE_SET_INDEXES_OFFSET(rule));
+
+    for (int i = 0; i < rule->set_count; ++i) {
+        const UINT16 rule_id = rule_ids[i];
+
+        if (rule_id <= rules->max_rule_id) {
+            marked |= fort_conf_scope_rule_mark(rule_bits, rule_id);
+        }
+    }
+
+    return marked;
+}
+
+/* Mark the nested rules of the used rules, returns the zones of the used rules */
+static UINT32 fort_conf_scope_rules_mark(PCFORT_CONF_RULES rules, PLONG rule_bits)
+{
+    const FORT_CONF_RULES_RT rules_rt = fort_conf_rules_rt_make(rules, /*zones=*/NULL);
+
+    fort_conf_scope_rule_mark(rule_bits, rules->glob.pre_rule_id);
+    fort_conf_scope_rule_mark(rule_bits, rules->glob.post_rule_id);
+
+    UINT32 zones_mask = 0;
+    BOOL marked;
+
+    do {
+        marked = FALSE;
+
+        for (UINT16 rule_id = 1; rule_id <= rules->max_rule_id; ++rule_id) {
+            if (!fort_conf_scope_bit(rule_bits, rule_id))
+                continue;
+
+            PCFORT_CONF_RULE rule = fort_conf_rules_rt_rule(&rules_rt, rule_id);
+
+            if (rule->has_zones) {
+                PCFORT_CONF_RULE_ZONES rule_zones = (PCFORT_CONF_RULE_ZONES) (rule + 1);
+
+                zones_mask |= rule_zones->accept_mask | rule_zones->reject_mask;
+            }
+
+            marked |= fort_conf_scope_rule_sets_mark(rules, rule, rule_bits);
+        }
+    } while (marked);
+
+    return zones_mask;
+}
+
+static UINT32 fort_conf_scope_rules_used(PFORT_DEVICE_CONF device_conf, PLONG rule_bits)
+{
+    UINT32 zones_mask = 0;
+
+    PFORT_CONF_BLOB_REF rules_ref = fort_conf_blob_ref_take(device_conf, &device_conf->rules_ref);
+    if (rules_ref != NULL) {
+        PCFORT_CONF_RULES rules = fort_conf_blob_ref_rules(rules_ref);
+
+        zones_mask = fort_conf_scope_rules_mark(rules, rule_bits);
+
+        fort_conf_blob_ref_put(rules_ref);
+    }
+
+    return zones_mask;
+}
+
+static UINT32 fort_conf_scope_addr_groups_zones(PFORT_DEVICE_CONF device_conf)
+{
+    UINT32 zones_mask = 0;
+
+    PFORT_CONF_REF conf_ref = fort_conf_ref_take(device_conf);
+    if (conf_ref != NULL) {
+        for (int i = 0; i < FORT_CONF_SCOPE_ADDR_GROUPS_COUNT; ++i) {
+            PCFORT_CONF_ADDR_GROUP addr_group = fort_conf_addr_group_ref(&conf_ref->conf, i);
+
+            zones_mask |= addr_group->include_zones | addr_group->exclude_zones;
+        }
+
+        fort_conf_ref_put(device_conf, conf_ref);
+    }
+
+    return zones_mask;
+}
+
+FORT_API BOOL fort_conf_scope_zones_used(
+        PFORT_CONF_SCOPE scope, PFORT_DEVICE_CONF device_conf, UINT32 zones_mask)
+{
+    KeMemoryBarrier();
+
+    /* The addresses' groups are checked by all connections */
+    UINT32 used_mask = (UINT32) (scope->sets[0].zones_mask | scope->sets[1].zones_mask)
+            | fort_conf_scope_addr_groups_zones(device_conf);
+
+    if ((used_mask & zones_mask) == 0) {
+        LONG rule_bits[FORT_CONF_SCOPE_BITS_WORDS(FORT_CONF_SCOPE_RULE_BITS_COUNT)];
+        fort_conf_scope_rule_bits(scope, rule_bits);
+
+        used_mask |= fort_conf_scope_rules_used(device_conf, rule_bits);
+    }
+
+    return fort_conf_scope_used(scope, (used_mask & zones_mask) != 0);
+}
+
+FORT_API BOOL fort_conf_scope_rule_used(
+        PFORT_CONF_SCOPE scope, PFORT_DEVICE_CONF device_conf, UINT16 rule_id)
+{
+    KeMemoryBarrier();
+
+    if (rule_id == 0 || rule_id > FORT_CONF_RULE_MAX)
+        return fort_conf_scope_used(scope, FALSE);
+
+    LONG rule_bits[FORT_CONF_SCOPE_BITS_WORDS(FORT_CONF_SCOPE_RULE_BITS_COUNT)];
+    fort_conf_scope_rule_bits(scope, rule_bits);
+
+    fort_conf_scope_rules_used(device_conf, rule_bits);
+
+    return fort_conf_scope_used(scope, fort_conf_scope_bit(rule_bits, rule_id));
+}
@@ -0,0 +1,57 @@
+#ifndef FORTCNF_SCOPE_H
+#define FORTCNF_SCOPE_H
+
+#include "fortcnf.h"
+
+#define FORT_CONF_SCOPE_APP_BITS_COUNT  4096 /* power of 2 */
+#define FORT_CONF_SCOPE_RULE_BITS_COUNT (FORT_CONF_RULE_MAX + 1)
+
+#define FORT_CONF_SCOPE_BITS_WORDS(n) (((n) + 31) / 32)
+
+typedef struct fort_conf_scope_set
+{
+    LONG volatile app_bits[FORT_CONF_SCOPE_BITS_WORDS(FORT_CONF_SCOPE_APP_BITS_COUNT)];
+    LONG volatile rule_bits[FORT_CONF_SCOPE_BITS_WORDS(FORT_CONF_SCOPE_RULE_BITS_COUNT)];
+
+    LONG volatile zones_mask;
+} FORT_CONF_SCOPE_SET, *PFORT_CONF_SCOPE_SET;
+
+/* Conf items, which the classified connections depended on since the last full reauth */
+typedef struct fort_conf_scope
+{
+    LONG volatile epoch; /* the set being filled by its parity */
+
+    LONG64 volatile reauth_count;
+    LONG64 volatile skip_count;
+
+    FORT_CONF_SCOPE_SET sets[2];
+} FORT_CONF_SCOPE, *PFORT_CONF_SCOPE;
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+FORT_API void fort_conf_scope_reset(PFORT_CONF_SCOPE scope);
+
+FORT_API void fort_conf_scope_stat(PFORT_CONF_SCOPE scope, PFORT_CONF_STAT conf_stat);
+
+FORT_API void fort_conf_scope_app_add(PFORT_CONF_SCOPE scope, PCFORT_APP_PATH path);
+
+FORT_API void fort_conf_scope_conn_add(PFORT_CONF_SCOPE scope, const FORT_APP_DATA app_data);
+
+FORT_API BOOL fort_conf_scope_app_used(PFORT_CONF_SCOPE scope, PCFORT_APP_PATH path);
+
+FORT_API BOOL fort_conf_scope_apps_batch_used(
+        PFORT_CONF_SCOPE scope, PCFORT_CONF_APPS_BATCH apps_batch);
+
+FORT_API BOOL fort_conf_scope_zones_used(
+        PFORT_CONF_SCOPE scope, PFORT_DEVICE_CONF device_conf, UINT32 zones_mask);
+
+FORT_API BOOL fort_conf_scope_rule_used(
+        PFORT_CONF_SCOPE scope, PFORT_DEVICE_CONF device_conf, UINT16 rule_id);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif // FORTCNF_SCOPE_H
@@ -2,42 +2,606 @@
 
 #include "fortcnf_zone.h"
 
-FORT_API PFORT_CONF_ZONES fort_conf_zones_new(PCFORT_CONF_ZONES zones, ULONG len)
+#define FORT_CONF_ZONES_POOL_TAG 'ZwfF'
+
+static PFORT_CONF_ZONES_REF fort_conf_zones_ref_alloc(void)
+{
+    PFORT_CONF_ZONES_REF zones_ref =
+            fort_mem_alloc(sizeof(FORT_CONF_ZONES_REF), FORT_CONF_ZONES_POOL_TAG);
+    if (zones_ref != NULL) {
+        RtlZeroMemory(zones_ref, sizeof(FORT_CONF_ZONES_REF));
+
+        zones_ref->refcount = 1;
+    }
+    return zones_ref;
+}
+
+inline static void fort_conf_zones_ref_hold(
+        PFORT_CONF_BLOB_REF *ref_ptr, PFORT_CONF_BLOB_REF blob_ref)
+{
+    InterlockedIncrement(&blob_ref->refcount);
+
+    *ref_ptr = blob_ref;
+}
+
+FORT_API void fort_conf_zones_ref_put(PFORT_CONF_ZONES_REF zones_ref)
+{
+    if (zones_ref == NULL || InterlockedDecrement(&zones_ref->refcount) != 0)
+        return;
+
+    for (int i = 0; i < FORT_CONF_ZONE_MAX; ++i) {
+        fort_conf_blob_ref_put(zones_ref->zone_refs[i]);
+    }
+
+    fort_conf_blob_ref_put(zones_ref->index_ref);
+
+    fort_mem_free(zones_ref, FORT_CONF_ZONES_POOL_TAG);
+}
+
+FORT_API PFORT_CONF_ZONES_REF fort_conf_zones_ref_take(PFORT_DEVICE_CONF device_conf)
+{
+    if (device_conf->zones_ref == NULL)
+        return NULL;
+
+    PFORT_CONF_ZONES_REF zones_ref;
+
+    KIRQL oldIrql = ExAcquireSpinLockShared(&device_conf->lock);
+    {
+        zones_ref = device_conf->zones_ref;
+        if (zones_ref != NULL) {
+            InterlockedIncrement(&zones_ref->refcount);
+        }
+    }
+    ExReleaseSpinLockShared(&device_conf->lock, oldIrql);
+
+    return zones_ref;
+}
+
+static BOOL fort_conf_zones_ref_replace(PFORT_DEVICE_CONF device_conf,
+        PFORT_CONF_ZONES_REF old_ref, PFORT_CONF_ZONES_REF new_ref)
+{
+    BOOL replaced = FALSE;
+
+    KIRQL oldIrql = ExAcquireSpinLockExclusive(&device_conf->lock);
+    if (device_conf->zones_ref == old_ref) {
+        device_conf->zones_ref = new_ref;
+        replaced = TRUE;
+    }
+    ExReleaseSpinLockExclusive(&device_conf->lock, oldIrql);
+
+    if (replaced) {
+        fort_device_conf_changed(device_conf);
+
+        fort_conf_zones_ref_put(old_ref);
+    }
+
+    return replaced;
+}
+
+FORT_API PFORT_CONF_ZONES_REF fort_conf_zones_new(PCFORT_CONF_ZONES zones, ULONG len)
 {
-    return fort_conf_mem_alloc(zones, len);
+    PFORT_CONF_ZONES_REF zones_ref = fort_conf_zones_ref_alloc();
+    if (zones_ref == NULL)
+        return NULL;
+
+    PFORT_CONF_BLOB_REF blob_ref = fort_conf_blob_ref_new(zones, len);
+    if (blob_ref == NULL) {
+        fort_mem_free(zones_ref, FORT_CONF_ZONES_POOL_TAG);
+        return NULL;
+    }
+
+    PFORT_CONF_ZONES_RT zones_rt = &zones_ref->zones;
+
+    fort_conf_zones_rt_init(zones_rt, fort_conf_blob_ref_zones(blob_ref));
+
+    /* All zones share the one snapshot, until some of them are replaced */
+    for (int i = 0; i < FORT_CONF_ZONE_MAX; ++i) {
+        if (zones_rt->addr_lists[i] != NULL) {
+            fort_conf_zones_ref_hold(&zones_ref->zone_refs[i], blob_ref);
+        }
+    }
+
+    if (zones_rt->zones_index != NULL) {
+        fort_conf_zones_ref_hold(&zones_ref->index_ref, blob_ref);
+    }
+
+    fort_conf_blob_ref_put(blob_ref);
+
+    return zones_ref;
 }
 
-FORT_API void fort_conf_zones_set(PFORT_DEVICE_CONF device_conf, PFORT_CONF_ZONES zones)
+FORT_API void fort_conf_zones_set(PFORT_DEVICE_CONF device_conf, PFORT_CONF_ZONES_REF zones_ref)
 {
+    PFORT_CONF_ZONES_REF old_ref;
+
     KIRQL oldIrql = ExAcquireSpinLockExclusive(&device_conf->lock);
     {
-        fort_conf_mem_free(device_conf->zones);
-        device_conf->zones = zones;
+        old_ref = device_conf->zones_ref;
+        device_conf->zones_ref = zones_ref;
     }
     ExReleaseSpinLockExclusive(&device_conf->lock, oldIrql);
+
+    fort_device_conf_changed(device_conf);
+
+    fort_conf_zones_ref_put(old_ref);
+}
+
+static void fort_conf_zones_ref_copy(PFORT_CONF_ZONES_REF new_ref, PFORT_CONF_ZONES_REF zones_ref)
+{
+    new_ref->zones = zones_ref->zones;
+
+    for (int i = 0; i < FORT_CONF_ZONE_MAX; ++i) {
+        PFORT_CONF_BLOB_REF zone_ref = zones_ref->zone_refs[i];
+
+        if (zone_ref != NULL) {
+            fort_conf_zones_ref_hold(&new_ref->zone_refs[i], zone_ref);
+        }
+    }
+}
+
+typedef struct fort_conf_zone_ip4_bound
+{
+    UINT32 ip;
+    UCHAR zone_index;
+    CHAR delta; /* +1 at the range's start, -1 after its end */
+} FORT_CONF_ZONE_IP4_BOUND, *PFORT_CONF_ZONE_IP4_BOUND;
+
+typedef struct fort_conf_zone_ip6_bound
+{
+    ip6_addr_t ip;
+    UCHAR zone_index;
+    CHAR delta; /* +1 at the range's start, -1 after its end */
+} FORT_CONF_ZONE_IP6_BOUND, *PFORT_CONF_ZONE_IP6_BOUND;
+
+typedef struct fort_conf_zones_bounds
+{
+    PFORT_CONF_ZONE_IP4_BOUND ip4;
+    PFORT_CONF_ZONE_IP6_BOUND ip6;
+
+    UINT32 ip4_n;
+    UINT32 ip6_n;
+} FORT_CONF_ZONES_BOUNDS, *PFORT_CONF_ZONES_BOUNDS;
+
+typedef const FORT_CONF_ZONES_BOUNDS *PCFORT_CONF_ZONES_BOUNDS;
+
+typedef int fort_conf_zones_bound_cmp_func(const void *l, const void *r);
+
+static int fort_conf_zones_ip4_bound_cmp(const void *l, const void *r)
+{
+    const UINT32 l_ip = ((const FORT_CONF_ZONE_IP4_BOUND *) l)->ip;
+    const UINT32 r_ip = ((const FORT_CONF_ZONE_IP4_BOUND *) r)->ip;
+
+    return (l_ip < r_ip) ? -1 : (l_ip > r_ip);
+}
+
+static int fort_conf_zones_ip6_bound_cmp(const void *l, const void *r)
+{
+    return fort_ip6_cmp(
+            &((const FORT_CONF_ZONE_IP6_BOUND *) l)->ip, &((const FORT_CONF_ZONE_IP6_BOUND *) r)->ip);
+}
+
+static void fort_conf_zones_bound_swap(char *l, char *r, UINT32 size)
+{
+    while (size-- != 0) {
+        const char c = *l;
+        *l++ = *r;
+        *r++ = c;
+    }
+}
+
+static void fort_conf_zones_bounds_sift(
+        char *base, UINT32 i, UINT32 n, UINT32 size, fort_conf_zones_bound_cmp_func *cmp)
+{
+    for (;;) {
+        UINT32 max_i = i;
+        const UINT32 l = 2 * i + 1;
+        const UINT32 r = l + 1;
+
+        if (l < n && cmp(base + (SIZE_T) l * size, base + (SIZE_T) max_i * size) > 0) {
+            max_i = l;
+        }
+        if (r < n && cmp(base + (SIZE_T) r * size, base + (SIZE_T) max_i * size) > 0) {
+            max_i = r;
+        }
+        if (max_i == i)
+            break;
+
+        fort_conf_zones_bound_swap(base + (SIZE_T) i * size, base + (SIZE_T) max_i * size, size);
+        i = max_i;
+    }
+}
+
+/* Heap sort: in place and without recursion */
+static void fort_conf_zones_bounds_sort(
+        void *bounds, UINT32 n, UINT32 size, fort_conf_zones_bound_cmp_func *cmp)
+{
+    char *base = bounds;
+
+    for (UINT32 i = n / 2; i-- != 0;) {
+        fort_conf_zones_bounds_sift(base, i, n, size, cmp);
+    }
+
+    for (UINT32 i = n; i-- > 1;) {
+        fort_conf_zones_bound_swap(base, base + (SIZE_T) i * size, size);
+
+        fort_conf_zones_bounds_sift(base, 0, i, size, cmp);
+    }
+}
+
+static void fort_conf_zones_add_ip4_bounds(
+        PFORT_CONF_ZONES_BOUNDS bounds, UCHAR zone_index, UINT32 from, UINT32 to)
+{
+    bounds->ip4[bounds->ip4_n++] = (FORT_CONF_ZONE_IP4_BOUND) {
+        .ip = from,
+        .zone_index = zone_index,
+        .delta = 1,
+    };
+
+    if (to != 0xFFFFFFFF) {
+        bounds->ip4[bounds->ip4_n++] = (FORT_CONF_ZONE_IP4_BOUND) {
+            .ip = to + 1,
+            .zone_index = zone_index,
+            .delta = -1,
+        };
+    }
+}
+
+static BOOL fort_conf_zones_ip6_increment(ip6_addr_t *ip)
+{
+    for (int i = sizeof(ip6_addr_t) - 1; i >= 0; --i) {
+        UCHAR *b = (UCHAR *) &ip->data[i];
+        if (++(*b) != 0)
+            return TRUE;
+    }
+    return FALSE; /* overflow */
+}
+
+static void fort_conf_zones_add_ip6_bounds(PFORT_CONF_ZONES_BOUNDS bounds, UCHAR zone_index,
+        const ip6_addr_t *from, const ip6_addr_t *to)
+{
+    bounds->ip6[bounds->ip6_n++] = (FORT_CONF_ZONE_IP6_BOUND) {
+        .ip = *from,
+        .zone_index = zone_index,
+        .delta = 1,
+    };
+
+    ip6_addr_t end = *to;
+    if (fort_conf_zones_ip6_increment(&end)) {
+        bounds->ip6[bounds->ip6_n++] = (FORT_CONF_ZONE_IP6_BOUND) {
+            .ip = end,
+            .zone_index = zone_index,
+            .delta = -1,
+        };
+    }
 }
 
-inline static void fort_conf_zone_flag_set_locked(
-        PFORT_CONF_ZONES zones, PCFORT_CONF_ZONE_FLAG zone_flag)
+/* The arrays' order doesn't matter, as the bounds are sorted */
+static void fort_conf_zones_add_bounds(
+        PFORT_CONF_ZONES_BOUNDS bounds, UCHAR zone_index, PCFORT_CONF_ADDR_LIST addr_list)
 {
+    {
+        const UINT32 *ip_arr = addr_list->ip;
+        const UINT32 *pair_arr = &ip_arr[addr_list->ip_n];
+        const UINT32 pair_n = addr_list->pair_n;
+
+        for (UINT32 i = 0; i < addr_list->ip_n; ++i) {
+            fort_conf_zones_add_ip4_bounds(bounds, zone_index, ip_arr[i], ip_arr[i]);
+        }
+        for (UINT32 i = 0; i < pair_n; ++i) {
+            fort_conf_zones_add_ip4_bounds(bounds, zone_index, pair_arr[i], pair_arr[pair_n + i]);
+        }
+    }
+
+    PCFORT_CONF_ADDR_LIST addr6_list = (PCFORT_CONF_ADDR_LIST) ((PCCH) addr_list
+            + FORT_CONF_ADDR4_LIST_SIZE(addr_list->ip_n, addr_list->pair_n));
+    {
+        const ip6_addr_t *ip_arr = (const ip6_addr_t *) addr6_list->ip;
+        const ip6_addr_t *pair_arr = &ip_arr[addr6_list->ip_n];
+        const UINT32 pair_n = addr6_list->pair_n;
+
+        for (UINT32 i = 0; i < addr6_list->ip_n; ++i) {
+            fort_conf_zones_add_ip6_bounds(bounds, zone_index, &ip_arr[i], &ip_arr[i]);
+        }
+        for (UINT32 i = 0; i < pair_n; ++i) {
+            fort_conf_zones_add_ip6_bounds(
+                    bounds, zone_index, &pair_arr[i], &pair_arr[pair_n + i]);
+        }
+    }
+}
+
+inline static UINT32 fort_conf_zones_bound_mask(
+        int *zone_counts, UINT32 mask, UCHAR zone_index, CHAR delta)
+{
+    const UINT32 zone_mask = (1u << zone_index);
+
+    zone_counts[zone_index] += delta;
+
+    return (zone_counts[zone_index] > 0) ? (mask | zone_mask) : (mask & ~zone_mask);
+}
+
+/* Sweep the sorted bounds and keep only the points, where the zones mask changes */
+static UINT32 fort_conf_zones_ip4_sweep(
+        const FORT_CONF_ZONE_IP4_BOUND *bounds, UINT32 n, UINT32 *from_arr, UINT32 *mask_arr)
+{
+    int zone_counts[FORT_CONF_ZONE_MAX] = { 0 };
+    UINT32 mask = 0;
+    UINT32 prev_mask = 0;
+    UINT32 index_n = 0;
+
+    for (UINT32 i = 0; i < n;) {
+        const UINT32 ip = bounds[i].ip;
+
+        do {
+            mask = fort_conf_zones_bound_mask(
+                    zone_counts, mask, bounds[i].zone_index, bounds[i].delta);
+        } while (++i < n && bounds[i].ip == ip);
+
+        if (mask != prev_mask) {
+            if (from_arr != NULL) {
+                from_arr[index_n] = ip;
+                mask_arr[index_n] = mask;
+            }
+            ++index_n;
+
+            prev_mask = mask;
+        }
+    }
+
+    return index_n;
+}
+
+static UINT32 fort_conf_zones_ip6_sweep(
+        const FORT_CONF_ZONE_IP6_BOUND *bounds, UINT32 n, ip6_addr_t *from_arr, UINT32 *mask_arr)
+{
+    int zone_counts[FORT_CONF_ZONE_MAX] = { 0 };
+    UINT32 mask = 0;
+    UINT32 prev_mask = 0;
+    UINT32 index_n = 0;
+
+    for (UINT32 i = 0; i < n;) {
+        const ip6_addr_t *ip = &bounds[i].ip;
+
+        do {
+            mask = fort_conf_zones_bound_mask(
+                    zone_counts, mask, bounds[i].zone_index, bounds[i].delta);
+        } while (++i < n && fort_ip6_cmp(&bounds[i].ip, ip) == 0);
+
+        if (mask != prev_mask) {
+            if (from_arr != NULL) {
+                from_arr[index_n] = *ip;
+                mask_arr[index_n] = mask;
+            }
+            ++index_n;
+
+            prev_mask = mask;
+        }
+    }
+
+    return index_n;
+}
+
+static BOOL fort_conf_zones_bounds_alloc(
+        PFORT_CONF_ZONES_BOUNDS bounds, PCFORT_CONF_ZONES_RT zones_rt)
+{
+    UINT64 ip4_n = 0;
+    UINT64 ip6_n = 0;
+
+    for (int i = 0; i < FORT_CONF_ZONE_MAX; ++i) {
+        PCFORT_CONF_ADDR_LIST addr_list = zones_rt->addr_lists[i];
+        if (addr_list == NULL)
+            continue;
+
+        PCFORT_CONF_ADDR_LIST addr6_list = (PCFORT_CONF_ADDR_LIST) ((PCCH) addr_list
+                + FORT_CONF_ADDR4_LIST_SIZE(addr_list->ip_n, addr_list->pair_n));
+
+        ip4_n += 2 * ((UINT64) addr_list->ip_n + addr_list->pair_n);
+        ip6_n += 2 * ((UINT64) addr6_list->ip_n + addr6_list->pair_n);
+    }
+
+    const UINT64 ip4_size = ip4_n * sizeof(FORT_CONF_ZONE_IP4_BOUND);
+    const UINT64 ip6_size = ip6_n * sizeof(FORT_CONF_ZONE_IP6_BOUND);
+
+    if (ip4_size > MAXULONG || ip6_size > MAXULONG)
+        return FALSE;
+
+    bounds->ip4 = (ip4_n == 0)
+            ? NULL
+            : fort_mem_alloc((SIZE_T) ip4_size, FORT_CONF_ZONES_POOL_TAG);
+    bounds->ip6 = (ip6_n == 0)
+            ? NULL
+            : fort_mem_alloc((SIZE_T) ip6_size, FORT_CONF_ZONES_POOL_TAG);
+
+    return (ip4_n == 0 || bounds->ip4 != NULL) && (ip6_n == 0 || bounds->ip6 != NULL);
+}
+
+static void fort_conf_zones_bounds_free(PFORT_CONF_ZONES_BOUNDS bounds)
+{
+    if (bounds->ip4 != NULL) {
+        fort_mem_free(bounds->ip4, FORT_CONF_ZONES_POOL_TAG);
+    }
+    if (bounds->ip6 != NULL) {
+        fort_mem_free(bounds->ip6, FORT_CONF_ZONES_POOL_TAG);
+    }
+}
+
+static PFORT_CONF_BLOB_REF fort_conf_zones_index_write(PCFORT_CONF_ZONES_BOUNDS bounds)
+{
+    const UINT32 ip4_n = fort_conf_zones_ip4_sweep(bounds->ip4, bounds->ip4_n, NULL, NULL);
+    const UINT32 ip6_n = fort_conf_zones_ip6_sweep(bounds->ip6, bounds->ip6_n, NULL, NULL);
+
+    PFORT_CONF_BLOB_REF index_ref =
+            fort_conf_blob_ref_alloc((ULONG) FORT_CONF_ZONES_INDEX_SIZE(ip4_n, ip6_n));
+    if (index_ref == NULL)
+        return NULL;
+
+    PFORT_CONF_ZONES_INDEX zones_index = (PFORT_CONF_ZONES_INDEX) index_ref->data;
+    zones_index->ip4_n = ip4_n;
+    zones_index->ip6_n = ip6_n;
+
+    UINT32 *ip4_from = zones_index->data;
+    UINT32 *ip4_masks = &ip4_from[ip4_n];
+    ip6_addr_t *ip6_from = (ip6_addr_t *) &ip4_masks[ip4_n];
+    UINT32 *ip6_masks = (UINT32 *) &ip6_from[ip6_n];
+
+    fort_conf_zones_ip4_sweep(bounds->ip4, bounds->ip4_n, ip4_from, ip4_masks);
+    fort_conf_zones_ip6_sweep(bounds->ip6, bounds->ip6_n, ip6_from, ip6_masks);
+
+    return index_ref;
+}
+
+FORT_API PFORT_CONF_BLOB_REF fort_conf_zones_index_new(PCFORT_CONF_ZONES_RT zones_rt)
+{
+    PFORT_CONF_BLOB_REF index_ref = NULL;
+
+    FORT_CONF_ZONES_BOUNDS bounds;
+    RtlZeroMemory(&bounds, sizeof(FORT_CONF_ZONES_BOUNDS));
+
+    if (fort_conf_zones_bounds_alloc(&bounds, zones_rt)) {
+        for (int i = 0; i < FORT_CONF_ZONE_MAX; ++i) {
+            PCFORT_CONF_ADDR_LIST addr_list = zones_rt->addr_lists[i];
+
+            if (addr_list != NULL) {
+                fort_conf_zones_add_bounds(&bounds, (UCHAR) i, addr_list);
+            }
+        }
+
+        fort_conf_zones_bounds_sort(bounds.ip4, bounds.ip4_n, sizeof(FORT_CONF_ZONE_IP4_BOUND),
+                &fort_conf_zones_ip4_bound_cmp);
+        fort_conf_zones_bounds_sort(bounds.ip6, bounds.ip6_n, sizeof(FORT_CONF_ZONE_IP6_BOUND),
+                &fort_conf_zones_ip6_bound_cmp);
+
+        index_ref = fort_conf_zones_index_write(&bounds);
+    }
+
+    fort_conf_zones_bounds_free(&bounds);
+
+    return index_ref;
+}
+
+static PFORT_CONF_ZONES_REF fort_conf_zones_copy_zone(
+        PFORT_CONF_ZONES_REF zones_ref, PFORT_CONF_BLOB_REF zone_blob_ref)
+{
+    PFORT_CONF_ZONES_REF new_ref = fort_conf_zones_ref_alloc();
+    if (new_ref == NULL)
+        return NULL;
+
+    if (zones_ref != NULL) {
+        fort_conf_zones_ref_copy(new_ref, zones_ref);
+    }
+
+    PFORT_CONF_ZONES_RT zones_rt = &new_ref->zones;
+    PCFORT_CONF_ZONE zone = fort_conf_blob_ref_zone(zone_blob_ref);
+
+    const int zone_index = zone->zone_id - 1;
+    const UINT32 zone_mask = (1u << zone_index);
+
+    fort_conf_blob_ref_put(new_ref->zone_refs[zone_index]);
+    new_ref->zone_refs[zone_index] = NULL;
+
+    zones_rt->addr_lists[zone_index] = NULL;
+    zones_rt->mask &= ~zone_mask;
+    zones_rt->enabled_mask &= ~zone_mask;
+
+    if (zone->addr_len != 0) {
+        fort_conf_zones_ref_hold(&new_ref->zone_refs[zone_index], zone_blob_ref);
+
+        zones_rt->addr_lists[zone_index] = (PCFORT_CONF_ADDR_LIST) zone->data;
+        zones_rt->mask |= zone_mask;
+
+        if (zone->enabled) {
+            zones_rt->enabled_mask |= zone_mask;
+        }
+    }
+
+    /* Rebuild the merged index, else search the zones one by one */
+    new_ref->index_ref = fort_conf_zones_index_new(zones_rt);
+
+    zones_rt->zones_index = (new_ref->index_ref != NULL)
+            ? (PCFORT_CONF_ZONES_INDEX) new_ref->index_ref->data
+            : NULL;
+
+    return new_ref;
+}
+
+FORT_API BOOL fort_conf_zone_set(PFORT_DEVICE_CONF device_conf, PCFORT_CONF_ZONE zone, ULONG len)
+{
+    PFORT_CONF_BLOB_REF zone_blob_ref = fort_conf_blob_ref_new(zone, len);
+    if (zone_blob_ref == NULL)
+        return FALSE;
+
+    BOOL res;
+
+    /* Copy on write: retry, if the zones were replaced meanwhile */
+    for (;;) {
+        PFORT_CONF_ZONES_REF zones_ref = fort_conf_zones_ref_take(device_conf);
+
+        PFORT_CONF_ZONES_REF new_ref = fort_conf_zones_copy_zone(zones_ref, zone_blob_ref);
+
+        res = (new_ref != NULL);
+
+        const BOOL done = !res || fort_conf_zones_ref_replace(device_conf, zones_ref, new_ref);
+
+        fort_conf_zones_ref_put(zones_ref);
+
+        if (done)
+            break;
+
+        fort_conf_zones_ref_put(new_ref);
+    }
+
+    fort_conf_blob_ref_put(zone_blob_ref);
+
+    return res;
+}
+
+static PFORT_CONF_ZONES_REF fort_conf_zones_copy_flag(
+        PFORT_CONF_ZONES_REF zones_ref, PCFORT_CONF_ZONE_FLAG zone_flag)
+{
+    PFORT_CONF_ZONES_REF new_ref = fort_conf_zones_ref_alloc();
+    if (new_ref == NULL)
+        return NULL;
+
+    fort_conf_zones_ref_copy(new_ref, zones_ref);
+
+    /* The merged index does not depend on the zones' flags */
+    if (zones_ref->index_ref != NULL) {
+        fort_conf_zones_ref_hold(&new_ref->index_ref, zones_ref->index_ref);
+    }
+
+    PFORT_CONF_ZONES_RT zones_rt = &new_ref->zones;
+
     const UINT32 zone_mask = (1u << (zone_flag->zone_id - 1));
 
     if (zone_flag->enabled) {
-        zones->enabled_mask |= zone_mask;
+        zones_rt->enabled_mask |= zone_mask;
     } else {
-        zones->enabled_mask &= ~zone_mask;
+        zones_rt->enabled_mask &= ~zone_mask;
     }
+
+    return new_ref;
 }
 
 FORT_API void fort_conf_zone_flag_set(
         PFORT_DEVICE_CONF device_conf, PCFORT_CONF_ZONE_FLAG zone_flag)
 {
-    KIRQL oldIrql = ExAcquireSpinLockExclusive(&device_conf->lock);
-    PFORT_CONF_ZONES zones = device_conf->zones;
-    if (zones != NULL) {
-        fort_conf_zone_flag_set_locked(zones, zone_flag);
+    /* Copy on write: retry, if the zones were replaced meanwhile */
+    for (;;) {
+        PFORT_CONF_ZONES_REF zones_ref = fort_conf_zones_ref_take(device_conf);
+        if (zones_ref == NULL)
+            break;
+
+        PFORT_CONF_ZONES_REF new_ref = fort_conf_zones_copy_flag(zones_ref, zone_flag);
+
+        const BOOL done =
+                (new_ref == NULL) || fort_conf_zones_ref_replace(device_conf, zones_ref, new_ref);
+
+        fort_conf_zones_ref_put(zones_ref);
+
+        if (done)
+            break;
+
+        fort_conf_zones_ref_put(new_ref);
     }
-    ExReleaseSpinLockExclusive(&device_conf->lock, oldIrql);
 }
 
 FORT_API BOOL fort_devconf_zones_ip_included(PFORT_DEVICE_CONF device_conf,
@@ -45,12 +609,12 @@ FORT_API BOOL fort_devconf_zones_ip_included(PFORT_DEVICE_CONF device_conf,
 {
     BOOL res = FALSE;
 
-    KIRQL oldIrql = ExAcquireSpinLockShared(&device_conf->lock);
-    PCFORT_CONF_ZONES zones = device_conf->zones;
-    if (zones != NULL) {
-        res = fort_conf_zones_ip_included(zones, conn, zone_id, zones_mask);
+    PFORT_CONF_ZONES_REF zones_ref = fort_conf_zones_ref_take(device_conf);
+    if (zones_ref != NULL) {
+        res = fort_conf_zones_ip_included(&zones_ref->zones, conn, zone_id, zones_mask);
+
+        fort_conf_zones_ref_put(zones_ref);
     }
-    ExReleaseSpinLockShared(&device_conf->lock, oldIrql);
 
     return res;
 }
@@ -60,12 +624,12 @@ FORT_API BOOL fort_devconf_zones_conn_filtered(PFORT_DEVICE_CONF device_conf,
 {
     BOOL res = FALSE;
 
-    KIRQL oldIrql = ExAcquireSpinLockShared(&device_conf->lock);
-    PCFORT_CONF_ZONES zones = device_conf->zones;
-    if (zones != NULL) {
-        res = fort_conf_zones_conn_filtered(zones, conn, opt);
+    PFORT_CONF_ZONES_REF zones_ref = fort_conf_zones_ref_take(device_conf);
+    if (zones_ref != NULL) {
+        res = fort_conf_zones_conn_filtered(&zones_ref->zones, conn, opt);
+
+        fort_conf_zones_ref_put(zones_ref);
     }
-    ExReleaseSpinLockShared(&device_conf->lock, oldIrql);
 
     return res;
 }
@@ -7,9 +7,17 @@
 extern "C" {
 #endif
 
-FORT_API PFORT_CONF_ZONES fort_conf_zones_new(PCFORT_CONF_ZONES zones, ULONG len);
+FORT_API void fort_conf_zones_ref_put(PFORT_CONF_ZONES_REF zones_ref);
 
-FORT_API void fort_conf_zones_set(PFORT_DEVICE_CONF device_conf, PFORT_CONF_ZONES zones);
+FORT_API PFORT_CONF_ZONES_REF fort_conf_zones_ref_take(PFORT_DEVICE_CONF device_conf);
+
+FORT_API PFORT_CONF_ZONES_REF fort_conf_zones_new(PCFORT_CONF_ZONES zones, ULONG len);
+
+FORT_API void fort_conf_zones_set(PFORT_DEVICE_CONF device_conf, PFORT_CONF_ZONES_REF zones_ref);
+
+FORT_API PFORT_CONF_BLOB_REF fort_conf_zones_index_new(PCFORT_CONF_ZONES_RT zones_rt);
+
+FORT_API BOOL fort_conf_zone_set(PFORT_DEVICE_CONF device_conf, PCFORT_CONF_ZONE zone, ULONG len);
 
 FORT_API void fort_conf_zone_flag_set(
         PFORT_DEVICE_CONF device_conf, PCFORT_CONF_ZONE_FLAG zone_flag);
@@ -124,6 +124,8 @@ static FORT_APP_DATA fort_callout_ale_conf_app_data(
 
     fort_callout_ale_fill_meta_path(ca, conn);
 
+    fort_conf_scope_app_add(&fort_device()->conf_scope, &conn->path);
+
     const FORT_APP_DATA app_data =
             fort_conf_app_find(&conf_ref->conf, &conn->path, fort_conf_exe_find, conf_ref);
 
@@ -219,9 +221,10 @@ inline static BOOL fort_callout_ale_log_conn_check(PCFORT_CALLOUT_ARG ca, PFORT_
     return fort_callout_ale_log_conn_check_app(conf_flags, app_data, blocked);
 }
 
-inline static BOOL fort_callout_ale_add_pending(PCFORT_CALLOUT_ARG ca, PFORT_CONF_META_CONN conn)
+inline static BOOL fort_callout_ale_add_pending(
+        PCFORT_CALLOUT_ARG ca, PFORT_CONF_META_CONN conn, const FORT_CONF_FLAGS conf_flags)
 {
-    if (!fort_pending_add_packet(&fort_device()->pending, ca, conn)) {
+    if (!fort_pending_add_packet(&fort_device()->pending, ca, conn, conf_flags.ask_packets_max)) {
         conn->reason = FORT_CONN_REASON_ASK_LIMIT;
         return TRUE; /* block (Error) */
     }
@@ -237,7 +240,7 @@ inline static BOOL fort_callout_ale_process_flow(
     PFORT_CONF_META_CONN conn = &cx->conn;
 
     if (conn->ask_to_connect) {
-        return fort_callout_ale_add_pending(ca, conn);
+        return fort_callout_ale_add_pending(ca, conn, conf_flags);
     }
 
     if (!conf_flags.log_stat)
@@ -330,7 +333,7 @@ static BOOL fort_callout_ale_app_filtered(
 inline static void fort_callout_ale_filter(
         PFORT_CONF_META_CONN conn, const FORT_CONF_FLAGS conf_flags, const FORT_APP_DATA app_data)
 {
-    const FORT_CONF_RULES_GLOB rules_glob = fort_device()->conf.rules_glob;
+    const FORT_CONF_RULES_GLOB rules_glob = fort_devconf_rules_glob(&fort_device()->conf);
 
     if (fort_callout_ale_conn_rule_filtered(
                 conn, rules_glob.pre_rule_id, FORT_CONN_REASON_RULE_GLOB_PRE)) {
@@ -397,6 +400,32 @@ inline static BOOL fort_callout_ale_allowed(
     return !conn->blocked;
 }
 
+inline static BOOL fort_callout_ale_allowed_cached(PFORT_CALLOUT_ALE_EXTRA cx,
+        const FORT_CONF_FLAGS conf_flags, const FORT_APP_DATA app_data)
+{
+    PFORT_CONF_META_CONN conn = &cx->conn;
+
+    if (!conn->blocked)
+        return TRUE; /* collect traffic, when Filter Disabled */
+
+    fort_conf_scope_conn_add(&fort_device()->conf_scope, app_data);
+
+    /* The cached verdict may be stale, when the conf was changed meanwhile */
+    if (fort_device()->conf.conf_gen != cx->conf_gen)
+        return fort_callout_ale_allowed(conn, conf_flags, app_data);
+
+    PFORT_CONF_CACHE conf_cache = &fort_device()->conf_cache;
+    const UINT32 filter_types = fort_device()->conf.rules_filter_types;
+
+    if (!fort_conf_cache_get(conf_cache, cx->conf_gen, filter_types, conn, app_data)) {
+        fort_callout_ale_allowed(conn, conf_flags, app_data);
+
+        fort_conf_cache_put(conf_cache, cx->conf_gen, filter_types, conn, app_data);
+    }
+
+    return !conn->blocked;
+}
+
 inline static void fort_callout_ale_check_app(PCFORT_CALLOUT_ARG ca, PFORT_CALLOUT_ALE_EXTRA cx,
         PFORT_CONF_REF conf_ref, const FORT_CONF_FLAGS conf_flags)
 {
@@ -404,7 +433,7 @@ inline static void fort_callout_ale_check_app(PCFORT_CALLOUT_ARG ca, PFORT_CALLO
 
     const FORT_APP_DATA app_data = fort_callout_ale_conf_app_data(ca, conn, conf_ref);
 
-    if (fort_callout_ale_allowed(conn, conf_flags, app_data)) {
+    if (fort_callout_ale_allowed_cached(cx, conf_flags, app_data)) {
 
         if (fort_callout_ale_process_flow(ca, cx, conf_flags)) {
             conn->blocked = TRUE; /* block (Error | Pending) */
@@ -648,6 +677,8 @@ static void fort_callout_ale_classify(PFORT_CALLOUT_ARG ca)
     };
 
     PFORT_DEVICE_CONF device_conf = &fort_device()->conf;
+    cx.conf_gen = device_conf->conf_gen;
+
     const FORT_CONF_FLAGS conf_flags = device_conf->conf_flags;
 
     if (fort_callout_ale_is_local_address(ca, &cx, conf_flags, classify_flags)) {
@@ -1190,8 +1221,7 @@ FORT_API NTSTATUS fort_callout_force_reauth(const FORT_CONF_FLAGS old_conf_flags
     return status;
 }
 
-inline static void fort_callout_update_system_time(
-        PFORT_STAT stat, PFORT_BUFFER buf, PFORT_IRP_INFO irp_info)
+inline static void fort_callout_update_system_time(PFORT_STAT stat, PFORT_BUFFER buf)
 {
     LARGE_INTEGER system_time;
     KeQuerySystemTime(&system_time);
@@ -1202,7 +1232,7 @@ inline static void fort_callout_update_system_time(
     stat->system_time = system_time;
 
     PCHAR out;
-    if (NT_SUCCESS(fort_buffer_prepare(buf, FORT_LOG_TIME_SIZE, &out, irp_info))) {
+    if (NT_SUCCESS(fort_buffer_prepare(buf, FORT_LOG_TIME_SIZE, &out))) {
         const INT64 unix_time = fort_system_to_unix_time(system_time.QuadPart);
 
         const UCHAR old_stat_flags =
@@ -1213,28 +1243,48 @@ inline static void fort_callout_update_system_time(
     }
 }
 
-inline static void fort_callout_flush_stat_traf(
-        PFORT_STAT stat, PFORT_BUFFER buf, PFORT_IRP_INFO irp_info)
+inline static UINT64 fort_callout_flush_stat_traf(PFORT_STAT stat, PFORT_BUFFER buf)
 {
+    UINT64 traf_bytes = 0;
+
+    /* Collect the per-CPU traffic into the processes' active list */
+    fort_stat_traf_merge(stat);
+
     while (stat->proc_active_count != 0) {
-        const UINT16 proc_count = (stat->proc_active_count < FORT_LOG_STAT_BUFFER_PROC_COUNT)
-                ? stat->proc_active_count
-                : FORT_LOG_STAT_BUFFER_PROC_COUNT;
-        const UINT32 len = FORT_LOG_STAT_SIZE(proc_count);
+        /* Pack as many processes, as their varints fit in the buffer */
+        UINT16 proc_count;
+        const UINT32 data_len =
+                fort_stat_traf_flush_size(stat, FORT_LOG_STAT_BUFFER_DATA_SIZE, &proc_count);
+        const UINT32 len = FORT_LOG_STAT_SIZE(data_len);
         PCHAR out;
 
-        const NTSTATUS status = fort_buffer_prepare(buf, len, &out, irp_info);
+        const NTSTATUS status = fort_buffer_prepare(buf, len, &out);
         if (!NT_SUCCESS(status)) {
             LOG("Callout Timer: Error: %x\n", status);
             TRACE(FORT_CALLOUT_CALLOUT_TIMER_ERROR, status, 0, 0);
             break;
         }
 
-        fort_log_stat_traf_header_write(out, proc_count);
+        fort_log_stat_traf_header_write(out, proc_count, data_len);
         out += FORT_LOG_STAT_HEADER_SIZE;
 
-        fort_stat_traf_flush(stat, proc_count, out);
+        traf_bytes += fort_stat_traf_flush(stat, proc_count, out);
     }
+
+    return traf_bytes;
+}
+
+static ULONG fort_callout_timer_period(ULONG period, UINT64 traf_bytes, BOOL log_written)
+{
+    /* Wake up rarer, while there is no traffic and no connections are logged */
+    if (traf_bytes == 0 && !log_written)
+        return (period < FORT_LOG_TIMER_PERIOD_MAX / 2) ? period * 2 : FORT_LOG_TIMER_PERIOD_MAX;
+
+    /* Flush smaller records more often under heavy traffic */
+    if (traf_bytes * 1000 / period >= FORT_LOG_TIMER_HEAVY_TRAF_RATE)
+        return (period > FORT_LOG_TIMER_PERIOD_MIN * 2) ? period / 2 : FORT_LOG_TIMER_PERIOD_MIN;
+
+    return FORT_LOG_TIMER_PERIOD;
 }
 
 FORT_API void fort_callout_timer(void)
@@ -1255,18 +1305,26 @@ FORT_API void fort_callout_timer(void)
     fort_stat_dpc_begin(stat, &stat_lock_queue);
 
     /* Get current Unix time */
-    fort_callout_update_system_time(stat, buf, &irp_info);
+    fort_callout_update_system_time(stat, buf);
 
     /* Flush traffic statistics */
-    fort_callout_flush_stat_traf(stat, buf, &irp_info);
+    const UINT64 traf_bytes = fort_callout_flush_stat_traf(stat, buf);
 
     /* Unlock stat */
     fort_stat_dpc_end(&stat_lock_queue);
 
+    /* Adapt the period to the traffic and the connections' log */
+    PFORT_TIMER log_timer = &fort_device()->log_timer;
+    const BOOL log_written = fort_buffer_log_written(buf);
+    const ULONG period = fort_callout_timer_period(log_timer->period, traf_bytes, log_written);
+
+    fort_timer_set_period(log_timer, period);
+
+    /* Let the next connection's log flush itself, while the timer is slowed down */
+    fort_buffer_set_idle(buf, period > FORT_LOG_TIMER_PERIOD);
+
     /* Flush pending buffer */
-    if (irp_info.irp == NULL) {
-        fort_buffer_flush_pending(buf, &irp_info);
-    }
+    fort_buffer_flush_pending(buf, &irp_info);
 
     /* Unlock buffer */
     fort_buffer_dpc_end(&buf_lock_queue);
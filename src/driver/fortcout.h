@@ -5,6 +5,12 @@
 
 #include "common/fortconf.h"
 
+#define FORT_LOG_TIMER_PERIOD     500 /* milliseconds */
+#define FORT_LOG_TIMER_PERIOD_MIN 250
+#define FORT_LOG_TIMER_PERIOD_MAX 2000
+
+#define FORT_LOG_TIMER_HEAVY_TRAF_RATE (64 * 1024 * 1024) /* bytes per second */
+
 #if defined(__cplusplus)
 extern "C" {
 #endif
@@ -45,6 +45,8 @@ typedef struct fort_callout_ale_extra
 {
     FORT_CONF_META_CONN conn;
 
+    LONG conf_gen; /* of the device conf, read before the conf */
+
     FORT_IRP_INFO irp_info;
 } FORT_CALLOUT_ALE_EXTRA, *PFORT_CALLOUT_ALE_EXTRA;
 
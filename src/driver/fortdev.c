@@ -42,6 +42,9 @@ static NTSTATUS fort_device_reauth_force(const FORT_CONF_FLAGS old_conf_flags)
     PEX_RUNDOWN_REF reauth_rundown = &fort_device()->reauth_rundown;
     ExAcquireRundownProtection(reauth_rundown);
 
+    /* All connections are re-classified and record their conf items again */
+    fort_conf_scope_reset(&fort_device()->conf_scope);
+
     const NTSTATUS status = fort_callout_force_reauth(old_conf_flags);
 
     ExReleaseRundownProtection(reauth_rundown);
@@ -129,6 +132,9 @@ FORT_API NTSTATUS fort_device_cleanup(PDEVICE_OBJECT device, PIRP irp)
     /* Clear pending packets */
     fort_pending_clear(&fort_device()->pending);
 
+    /* Unmap the shared log */
+    fort_buffer_shared_unmap(&fort_device()->buffer);
+
     /* Clear buffer */
     fort_buffer_clear(&fort_device()->buffer);
 
@@ -176,7 +182,7 @@ inline static NTSTATUS fort_device_control_setconf_ref(
     const FORT_CONF_FLAGS old_conf_flags = fort_conf_ref_set(device_conf, conf_ref);
 
     fort_stat_conf_update(&fort_device()->stat, conf_io);
-    fort_shaper_conf_update(&fort_device()->shaper, conf_io);
+    fort_shaper_conf_update(&fort_device()->shaper, &conf_io->conf_group, conf_io->conf.flags);
 
     /* Enumerate processes */
     if (was_null_conf) {
@@ -193,7 +199,12 @@ static NTSTATUS fort_device_control_setconf(PFORT_DEVICE_CONTROL_ARG dca)
 
     if (len > sizeof(FORT_CONF_IO)) {
         PCFORT_CONF conf = &conf_io->conf;
-        PFORT_CONF_REF conf_ref = fort_conf_ref_new(conf, len - FORT_CONF_IO_CONF_OFF);
+        const ULONG conf_len = len - FORT_CONF_IO_CONF_OFF;
+
+        if (!fort_conf_valid(conf, conf_len))
+            return STATUS_UNSUCCESSFUL;
+
+        PFORT_CONF_REF conf_ref = fort_conf_ref_new(conf, conf_len);
 
         if (conf_ref == NULL) {
             return STATUS_INSUFFICIENT_RESOURCES;
@@ -230,7 +241,8 @@ static NTSTATUS fort_device_control_getlog(PFORT_DEVICE_CONTROL_ARG dca)
     PVOID out = dca->buffer;
     const ULONG out_len = dca->out_len;
 
-    if (out_len < FORT_BUFFER_SIZE)
+    /* The shared log's client needs no buffer */
+    if (out_len < FORT_BUFFER_SIZE && fort_device()->buffer.shared == NULL)
         return STATUS_BUFFER_TOO_SMALL;
 
     PFORT_IRP_INFO irp_info = dca->irp_info;
@@ -277,7 +289,15 @@ static NTSTATUS fort_device_control_app(PFORT_DEVICE_CONTROL_ARG dca, BOOL is_ad
     fort_conf_ref_put(&fort_device()->conf, conf_ref);
 
     if (NT_SUCCESS(status)) {
-        fort_device_reauth_queue();
+        const FORT_APP_PATH path = {
+            .len = app_entry->path_len,
+            .buffer = app_entry->path,
+        };
+
+        /* Skip the reauth, when no connection depends on the app */
+        if (fort_conf_scope_app_used(&fort_device()->conf_scope, &path)) {
+            fort_device_reauth_queue();
+        }
     }
 
     return status;
@@ -299,16 +319,19 @@ static NTSTATUS fort_device_control_setzones(PFORT_DEVICE_CONTROL_ARG dca)
     const ULONG len = dca->in_len;
 
     if (len >= FORT_CONF_ZONES_DATA_OFF) {
-        PFORT_CONF_ZONES conf_zones = fort_conf_zones_new(zones, len);
+        PFORT_CONF_ZONES_REF zones_ref = fort_conf_zones_new(zones, len);
 
-        if (conf_zones == NULL) {
+        if (zones_ref == NULL) {
             return STATUS_INSUFFICIENT_RESOURCES;
         } else {
             PFORT_DEVICE_CONF device_conf = &fort_device()->conf;
 
-            fort_conf_zones_set(device_conf, conf_zones);
+            fort_conf_zones_set(device_conf, zones_ref);
 
-            fort_device_conf_reauth_queue(device_conf);
+            if (fort_conf_scope_zones_used(
+                        &fort_device()->conf_scope, device_conf, /*zones_mask=*/(UINT32) -1)) {
+                fort_device_conf_reauth_queue(device_conf);
+            }
 
             return STATUS_SUCCESS;
         }
@@ -317,17 +340,48 @@ static NTSTATUS fort_device_control_setzones(PFORT_DEVICE_CONTROL_ARG dca)
     return STATUS_UNSUCCESSFUL;
 }
 
+static NTSTATUS fort_device_control_setzone(PFORT_DEVICE_CONTROL_ARG dca)
+{
+    PCFORT_CONF_ZONE zone = dca->buffer;
+    const ULONG len = dca->in_len;
+
+    if (!fort_conf_zone_valid(zone, len))
+        return STATUS_UNSUCCESSFUL;
+
+    PFORT_DEVICE_CONF device_conf = &fort_device()->conf;
+
+    if (!fort_conf_zone_set(device_conf, zone, len))
+        return STATUS_INSUFFICIENT_RESOURCES;
+
+    const UINT32 zones_mask = (1u << (zone->zone_id - 1));
+
+    /* Skip the reauth, when no connection depends on the zone */
+    if (fort_conf_scope_zones_used(&fort_device()->conf_scope, device_conf, zones_mask)) {
+        fort_device_conf_reauth_queue(device_conf);
+    }
+
+    return STATUS_SUCCESS;
+}
+
 static NTSTATUS fort_device_control_setzoneflag(PFORT_DEVICE_CONTROL_ARG dca)
 {
     PCFORT_CONF_ZONE_FLAG zone_flag = dca->buffer;
     const ULONG len = dca->in_len;
 
     if (len == sizeof(FORT_CONF_ZONE_FLAG)) {
+        /* The zone's id is shifted to its mask */
+        if (zone_flag->zone_id == 0 || zone_flag->zone_id > FORT_CONF_ZONE_MAX)
+            return STATUS_UNSUCCESSFUL;
+
         PFORT_DEVICE_CONF device_conf = &fort_device()->conf;
 
         fort_conf_zone_flag_set(device_conf, zone_flag);
 
-        fort_device_conf_reauth_queue(device_conf);
+        const UINT32 zones_mask = (1u << (zone_flag->zone_id - 1));
+
+        if (fort_conf_scope_zones_used(&fort_device()->conf_scope, device_conf, zones_mask)) {
+            fort_device_conf_reauth_queue(device_conf);
+        }
 
         return STATUS_SUCCESS;
     }
@@ -340,19 +394,19 @@ static NTSTATUS fort_device_control_setrules(PFORT_DEVICE_CONTROL_ARG dca)
     PCFORT_CONF_RULES rules = dca->buffer;
     const ULONG len = dca->in_len;
 
-    PFORT_CONF_RULES conf_rules = NULL;
+    PFORT_CONF_BLOB_REF rules_ref = NULL;
 
     if (len >= FORT_CONF_RULES_DATA_OFF) {
-        conf_rules = fort_conf_rules_new(rules, len);
+        rules_ref = fort_conf_rules_new(rules, len);
 
-        if (conf_rules == NULL) {
+        if (rules_ref == NULL) {
             return STATUS_INSUFFICIENT_RESOURCES;
         }
     }
 
     PFORT_DEVICE_CONF device_conf = &fort_device()->conf;
 
-    fort_conf_rules_set(device_conf, conf_rules);
+    fort_conf_rules_set(device_conf, rules_ref);
 
     fort_device_conf_reauth_queue(device_conf);
 
@@ -369,7 +423,10 @@ static NTSTATUS fort_device_control_setruleflag(PFORT_DEVICE_CONTROL_ARG dca)
 
         fort_conf_rule_flag_set(device_conf, rule_flag);
 
-        fort_device_conf_reauth_queue(device_conf);
+        if (fort_conf_scope_rule_used(
+                    &fort_device()->conf_scope, device_conf, rule_flag->rule_id)) {
+            fort_device_conf_reauth_queue(device_conf);
+        }
 
         return STATUS_SUCCESS;
     }
@@ -377,7 +434,119 @@ static NTSTATUS fort_device_control_setruleflag(PFORT_DEVICE_CONTROL_ARG dca)
     return STATUS_UNSUCCESSFUL;
 }
 
-static_assert(FORT_CTL_INDEX_FROM_CODE(FORT_IOCTL_SETRULEFLAG) == FORT_IOCTL_INDEX_SETRULEFLAG,
+static NTSTATUS fort_device_control_updateapps(PFORT_DEVICE_CONTROL_ARG dca)
+{
+    PCFORT_CONF_APPS_BATCH apps_batch = dca->buffer;
+    const ULONG len = dca->in_len;
+
+    if (!fort_conf_apps_batch_valid(apps_batch, len))
+        return STATUS_UNSUCCESSFUL;
+
+    PFORT_CONF_REF conf_ref = fort_conf_ref_take(&fort_device()->conf);
+
+    if (conf_ref == NULL)
+        return STATUS_INVALID_PARAMETER;
+
+    const NTSTATUS status = fort_conf_ref_exe_batch(conf_ref, apps_batch);
+
+    fort_conf_ref_put(&fort_device()->conf, conf_ref);
+
+    /* Some apps may be applied, even on error */
+    if (fort_conf_scope_apps_batch_used(&fort_device()->conf_scope, apps_batch)) {
+        fort_device_reauth_queue();
+    }
+
+    return status;
+}
+
+static NTSTATUS fort_device_control_maplog(PFORT_DEVICE_CONTROL_ARG dca)
+{
+    PFORT_LOG_SHARED_MAP shared_map = dca->buffer;
+    const ULONG len = dca->in_len;
+
+    if (len < sizeof(FORT_LOG_SHARED_MAP) || dca->out_len < sizeof(FORT_LOG_SHARED_MAP))
+        return STATUS_BUFFER_TOO_SMALL;
+
+    PVOID address;
+    const NTSTATUS status =
+            fort_buffer_shared_map(&fort_device()->buffer, shared_map->size, &address);
+
+    if (NT_SUCCESS(status)) {
+        shared_map->address = (UINT64) (ULONG_PTR) address;
+
+        dca->irp_info->info = sizeof(FORT_LOG_SHARED_MAP);
+    }
+
+    return status;
+}
+
+static NTSTATUS fort_device_control_getconfstat(PFORT_DEVICE_CONTROL_ARG dca)
+{
+    PFORT_CONF_STAT conf_stat = dca->buffer;
+
+    if (dca->out_len < sizeof(FORT_CONF_STAT))
+        return STATUS_BUFFER_TOO_SMALL;
+
+    RtlZeroMemory(conf_stat, sizeof(FORT_CONF_STAT));
+
+    fort_conf_cache_stat(&fort_device()->conf_cache, conf_stat);
+    fort_conf_scope_stat(&fort_device()->conf_scope, conf_stat);
+
+    dca->irp_info->info = sizeof(FORT_CONF_STAT);
+
+    return STATUS_SUCCESS;
+}
+
+static NTSTATUS fort_device_control_setconfdelta_ref(PCFORT_CONF_DELTA delta)
+{
+    PFORT_DEVICE_CONF device_conf = &fort_device()->conf;
+
+    /* Copy on write: retry, if the conf was replaced meanwhile */
+    for (;;) {
+        PFORT_CONF_REF conf_ref = fort_conf_ref_take(device_conf);
+
+        if (conf_ref == NULL)
+            return STATUS_INVALID_PARAMETER;
+
+        const ULONG conf_len = fort_conf_delta_conf_len(&conf_ref->conf, delta);
+
+        PFORT_CONF_REF new_ref = fort_conf_ref_delta_new(conf_ref, delta, conf_len);
+
+        const BOOL replaced =
+                (new_ref != NULL) && fort_conf_ref_replace(device_conf, conf_ref, new_ref);
+
+        fort_conf_ref_put(device_conf, conf_ref);
+
+        if (new_ref == NULL)
+            return STATUS_INSUFFICIENT_RESOURCES;
+
+        fort_conf_ref_put(device_conf, new_ref);
+
+        if (replaced)
+            return STATUS_SUCCESS;
+    }
+}
+
+static NTSTATUS fort_device_control_setconfdelta(PFORT_DEVICE_CONTROL_ARG dca)
+{
+    PCFORT_CONF_DELTA delta = dca->buffer;
+    const ULONG len = dca->in_len;
+
+    if (!fort_conf_delta_valid(delta, len))
+        return STATUS_UNSUCCESSFUL;
+
+    const NTSTATUS status = fort_device_control_setconfdelta_ref(delta);
+
+    if (NT_SUCCESS(status)) {
+        fort_device_reauth_queue();
+    }
+
+    return status;
+}
+
+static_assert(FORT_CTL_INDEX_FROM_CODE(FORT_IOCTL_SETCONFDELTA) == FORT_IOCTL_INDEX_SETCONFDELTA,
+        "Invalid FORT_CTL_INDEX_FROM_CODE()");
+static_assert(FORT_CTL_INDEX_FROM_CODE(FORT_IOCTL_SETZONE) == FORT_IOCTL_INDEX_SETZONE,
         "Invalid FORT_CTL_INDEX_FROM_CODE()");
 
 typedef NTSTATUS(FORT_DEVICE_CONTROL_PROCESS_FUNC)(PFORT_DEVICE_CONTROL_ARG dca);
@@ -395,6 +564,11 @@ static PFORT_DEVICE_CONTROL_PROCESS_FUNC fortDeviceControlProcess_funcList[] = {
     &fort_device_control_setzoneflag, // FORT_IOCTL_SETZONEFLAG
     &fort_device_control_setrules, // FORT_IOCTL_SETRULES
     &fort_device_control_setruleflag, // FORT_IOCTL_SETRULEFLAG
+    &fort_device_control_updateapps, // FORT_IOCTL_UPDATEAPPS
+    &fort_device_control_maplog, // FORT_IOCTL_MAPLOG
+    &fort_device_control_setconfdelta, // FORT_IOCTL_SETCONFDELTA
+    &fort_device_control_setzone, // FORT_IOCTL_SETZONE
+    &fort_device_control_getconfstat, // FORT_IOCTL_GETCONFSTAT
 };
 
 static NTSTATUS fort_device_control_process(PFORT_DEVICE_CONTROL_ARG dca)
@@ -508,11 +682,13 @@ FORT_API NTSTATUS fort_device_load(PVOID device_param)
     fort_worker_func_set(&fort_device()->worker, FORT_WORKER_REAUTH, &fort_device_reauth);
 
     fort_device_conf_open(&fort_device()->conf);
+    fort_conf_cache_open(&fort_device()->conf_cache);
     fort_buffer_open(&fort_device()->buffer);
     fort_stat_open(&fort_device()->stat);
     fort_pending_open(&fort_device()->pending);
     fort_shaper_open(&fort_device()->shaper);
-    fort_timer_open(&fort_device()->log_timer, 500, /*flags=*/0, &fort_callout_timer);
+    fort_timer_open(
+            &fort_device()->log_timer, FORT_LOG_TIMER_PERIOD, /*flags=*/0, &fort_callout_timer);
     fort_pstree_open(&fort_device()->ps_tree);
 
     /* Register filters provider */
@@ -571,6 +747,9 @@ FORT_API void fort_device_unload(void)
     /* Uninstall callouts */
     fort_callout_remove();
 
+    /* Free verdicts cache */
+    fort_conf_cache_close(&fort_device()->conf_cache);
+
     /* Unregister filters provider */
     if (fort_device_flag(&fort_device()->conf, FORT_DEVICE_BOOT_FILTER) == 0) {
         fort_prov_trans_unregister();
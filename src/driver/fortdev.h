@@ -5,6 +5,8 @@
 
 #include "fortbuf.h"
 #include "fortcnf.h"
+#include "fortcnf_cache.h"
+#include "fortcnf_scope.h"
 #include "fortpkt.h"
 #include "fortps.h"
 #include "fortstat.h"
@@ -24,6 +26,8 @@ typedef struct fort_device
     PVOID systime_cb_reg;
 
     FORT_DEVICE_CONF conf;
+    FORT_CONF_CACHE conf_cache;
+    FORT_CONF_SCOPE conf_scope;
     FORT_BUFFER buffer;
     FORT_STAT stat;
     FORT_PENDING pending;
@@ -20,10 +20,13 @@
 #include "forttds.c"
 
 #include "fortbuf.c"
+#include "fortbuf_path.c"
 #include "fortcb.c"
 #include "fortcnf.c"
+#include "fortcnf_cache.c"
 #include "fortcnf_conf.c"
 #include "fortcnf_rule.c"
+#include "fortcnf_scope.c"
 #include "fortcnf_zone.c"
 #include "fortdbg.c"
 #include "fortmod.c"
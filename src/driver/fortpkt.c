@@ -13,6 +13,13 @@
 
 #define FORT_QUEUE_INITIAL_TOKEN_COUNT 1500
 
+#define FORT_QUEUE_FLOW_QUANTUM 1514 /* bytes, the Ethernet frame's size */
+
+#define FORT_QUEUE_CODEL_TARGET_MS   5
+#define FORT_QUEUE_CODEL_INTERVAL_MS 100
+
+#define FORT_QUEUE_NEXT_TICK_NONE MAXLONGLONG /* no packet to become eligible */
+
 #define HTONL(l) _byteswap_ulong(l)
 
 typedef void FORT_SHAPER_PACKET_FOREACH_FUNC(PFORT_SHAPER, PFORT_FLOW_PACKET);
@@ -96,14 +103,25 @@ inline static BOOL fort_packet_is_ipsec_tunneled(PCFORT_CALLOUT_ARG ca)
     return info.isTunnelMode && !info.isDeTunneled;
 }
 
-inline static PFORT_FLOW_PACKET fort_shaper_packet_new(void)
+inline static PFORT_FLOW_PACKET fort_shaper_packet_new(PFORT_SHAPER shaper)
 {
-    return fort_mem_alloc(sizeof(FORT_FLOW_PACKET), FORT_PACKET_POOL_TAG);
+    PFORT_FLOW_PACKET pkt = ExAllocateFromNPagedLookasideList(&shaper->packet_lookaside);
+
+    if (pkt != NULL) {
+        InterlockedIncrement(&shaper->packet_count);
+    }
+
+    return pkt;
 }
 
 inline static void fort_shaper_packet_del(PFORT_FLOW_PACKET pkt)
 {
-    fort_mem_free(pkt, FORT_PACKET_POOL_TAG);
+    /* Called on injection's completion too */
+    PFORT_SHAPER shaper = &fort_device()->shaper;
+
+    ExFreeToNPagedLookasideList(&shaper->packet_lookaside, pkt);
+
+    InterlockedDecrement(&shaper->packet_count);
 }
 
 static void fort_packet_free_cloned(PNET_BUFFER_LIST clonedNetBufList)
@@ -144,6 +162,23 @@ static void fort_shaper_packet_free(PFORT_FLOW_PACKET pkt)
     fort_shaper_packet_del(pkt);
 }
 
+/* Free the packets injected by one call, their clones are chained as the packets */
+static void fort_shaper_packet_free_chain(PFORT_FLOW_PACKET pkt)
+{
+    do {
+        PFORT_FLOW_PACKET pkt_next = pkt->next;
+
+        PNET_BUFFER_LIST netBufList = pkt->io.netBufList;
+        if (netBufList != NULL) {
+            NET_BUFFER_LIST_NEXT_NBL(netBufList) = NULL;
+        }
+
+        fort_shaper_packet_free(pkt);
+
+        pkt = pkt_next;
+    } while (pkt != NULL);
+}
+
 static void fort_shaper_packet_drop(PFORT_SHAPER shaper, PFORT_FLOW_PACKET pkt)
 {
     UNUSED(shaper);
@@ -178,7 +213,7 @@ static void NTAPI fort_packet_inject_complete(
 
     switch (pkt->flags & FORT_PACKET_TYPE_MASK) {
     case FORT_PACKET_TYPE_FLOW: {
-        fort_shaper_packet_free((PFORT_FLOW_PACKET) pkt);
+        fort_shaper_packet_free_chain((PFORT_FLOW_PACKET) pkt);
     } break;
     case FORT_PACKET_TYPE_PENDING: {
         fort_pending_packet_free((PFORT_PENDING_PACKET) pkt);
@@ -401,16 +436,76 @@ static NTSTATUS fort_packet_fill(PCFORT_CALLOUT_ARG ca, PFORT_PACKET_IO pkt, UCH
     return status;
 }
 
+/* The packets can be injected by one call with the same arguments */
+static BOOL fort_shaper_packet_is_same_inject(PCFORT_FLOW_PACKET pkt, PCFORT_FLOW_PACKET pkt_next)
+{
+    PCFORT_PACKET_IO io = &pkt->io;
+    PCFORT_PACKET_IO io_next = &pkt_next->io;
+
+    if (pkt->flow != pkt_next->flow || io->flags != io_next->flags
+            || io->compartmentId != io_next->compartmentId)
+        return FALSE;
+
+    if ((io->flags & FORT_PACKET_INBOUND) != 0) {
+        return io->in.interfaceIndex == io_next->in.interfaceIndex
+                && io->in.subInterfaceIndex == io_next->in.subInterfaceIndex;
+    }
+
+    PCFORT_PACKET_OUT out = &io->out;
+    PCFORT_PACKET_OUT out_next = &io_next->out;
+
+    /* The control data is per send */
+    if (out->controlData != NULL || out_next->controlData != NULL)
+        return FALSE;
+
+    if (out->endpointHandle != out_next->endpointHandle
+            || out->remoteScopeId.Value != out_next->remoteScopeId.Value)
+        return FALSE;
+
+    if ((io->flags & FORT_PACKET_IP6) != 0) {
+        return out->remoteAddr.v6.lo64 == out_next->remoteAddr.v6.lo64
+                && out->remoteAddr.v6.hi64 == out_next->remoteAddr.v6.hi64;
+    }
+
+    return out->remoteAddr.v4 == out_next->remoteAddr.v4;
+}
+
+/* Cut the packets, which can be injected with the head, and chain their clones */
+static PFORT_FLOW_PACKET fort_shaper_packet_cut_inject(PFORT_FLOW_PACKET pkt_head)
+{
+    PFORT_FLOW_PACKET pkt = pkt_head;
+    PFORT_FLOW_PACKET pkt_next = pkt->next;
+
+    for (int count = 1; pkt_next != NULL && count < FORT_PACKET_INJECT_CHAIN_MAX; ++count) {
+        if (!fort_shaper_packet_is_same_inject(pkt_head, pkt_next))
+            break;
+
+        NET_BUFFER_LIST_NEXT_NBL(pkt->io.netBufList) = pkt_next->io.netBufList;
+
+        pkt = pkt_next;
+        pkt_next = pkt->next;
+    }
+
+    pkt->next = NULL;
+
+    return pkt_next;
+}
+
 static void fort_shaper_packet_inject(PFORT_SHAPER shaper, PFORT_FLOW_PACKET pkt)
 {
     UNUSED(shaper);
 
-    NTSTATUS status;
+    while (pkt != NULL) {
+        PFORT_FLOW_PACKET pkt_next = fort_shaper_packet_cut_inject(pkt);
 
-    status = fort_packet_inject(&pkt->io);
+        /* The head's completion frees the injected chain */
+        const NTSTATUS status = fort_packet_inject(&pkt->io);
 
-    if (!NT_SUCCESS(status)) {
-        fort_shaper_packet_free(pkt);
+        if (!NT_SUCCESS(status)) {
+            fort_shaper_packet_free_chain(pkt);
+        }
+
+        pkt = pkt_next;
     }
 }
 
@@ -504,6 +599,212 @@ static PFORT_FLOW_PACKET fort_shaper_packet_list_get_flow_packets(
     return pkt_chain;
 }
 
+inline static PFORT_PACKET_FLOW_QUEUE fort_shaper_queue_flow_queue(
+        PFORT_PACKET_QUEUE queue, PFORT_FLOW flow)
+{
+    return &queue->flow_queues[flow->flow_hash & (FORT_PACKET_QUEUE_FLOWS_COUNT - 1)];
+}
+
+static void fort_shaper_flow_list_push(PFORT_PACKET_FLOW_LIST flow_list, PFORT_PACKET_FLOW_QUEUE fq)
+{
+    fq->next_active = NULL;
+
+    if (flow_list->flow_tail == NULL) {
+        flow_list->flow_head = fq;
+    } else {
+        flow_list->flow_tail->next_active = fq;
+    }
+
+    flow_list->flow_tail = fq;
+}
+
+static PFORT_PACKET_FLOW_QUEUE fort_shaper_flow_list_pop(PFORT_PACKET_FLOW_LIST flow_list)
+{
+    PFORT_PACKET_FLOW_QUEUE fq = flow_list->flow_head;
+
+    flow_list->flow_head = fq->next_active;
+    fq->next_active = NULL;
+
+    if (flow_list->flow_head == NULL) {
+        flow_list->flow_tail = NULL;
+    }
+
+    return fq;
+}
+
+inline static BOOL fort_shaper_queue_has_flows(PFORT_PACKET_QUEUE queue)
+{
+    return queue->new_flows.flow_head != NULL || queue->old_flows.flow_head != NULL;
+}
+
+static void fort_shaper_queue_add_flow_packet(PFORT_PACKET_QUEUE queue, PFORT_FLOW_PACKET pkt)
+{
+    PFORT_PACKET_FLOW_QUEUE fq = fort_shaper_queue_flow_queue(queue, pkt->flow);
+
+    fq->queued_bytes += pkt->data_length;
+    queue->queued_bytes += pkt->data_length;
+
+    fort_shaper_packet_list_add_chain(&fq->packet_list, pkt, pkt);
+
+    if (!fq->is_active) {
+        fq->is_active = TRUE;
+        fq->deficit = FORT_QUEUE_FLOW_QUANTUM;
+
+        fort_shaper_flow_list_push(&queue->new_flows, fq);
+    }
+}
+
+static PFORT_FLOW_PACKET fort_shaper_flow_queue_pop(
+        PFORT_PACKET_QUEUE queue, PFORT_PACKET_FLOW_QUEUE fq)
+{
+    PFORT_FLOW_PACKET pkt = fq->packet_list.packet_head;
+
+    fort_shaper_packet_list_cut_chain(&fq->packet_list, pkt);
+
+    fq->queued_bytes -= pkt->data_length;
+    queue->queued_bytes -= pkt->data_length;
+
+    return pkt;
+}
+
+static PFORT_FLOW_PACKET fort_shaper_flow_queue_drop_head(
+        PFORT_PACKET_QUEUE queue, PFORT_PACKET_FLOW_QUEUE fq, PFORT_FLOW_PACKET *pkt_drop_chain)
+{
+    PFORT_FLOW_PACKET pkt = fort_shaper_flow_queue_pop(queue, fq);
+
+    pkt->next = *pkt_drop_chain;
+    *pkt_drop_chain = pkt;
+
+    return fq->packet_list.packet_head;
+}
+
+static PFORT_PACKET_FLOW_QUEUE fort_shaper_flow_list_fattest(
+        PFORT_PACKET_FLOW_LIST flow_list, PFORT_PACKET_FLOW_QUEUE fq_fattest)
+{
+    PFORT_PACKET_FLOW_QUEUE fq = flow_list->flow_head;
+
+    for (; fq != NULL; fq = fq->next_active) {
+        if (fq_fattest == NULL || fq->queued_bytes > fq_fattest->queued_bytes) {
+            fq_fattest = fq;
+        }
+    }
+
+    return fq_fattest;
+}
+
+static PFORT_PACKET_FLOW_QUEUE fort_shaper_queue_fattest_flow_queue(PFORT_PACKET_QUEUE queue)
+{
+    PFORT_PACKET_FLOW_QUEUE fq_fattest = NULL;
+
+    fq_fattest = fort_shaper_flow_list_fattest(&queue->new_flows, fq_fattest);
+    fq_fattest = fort_shaper_flow_list_fattest(&queue->old_flows, fq_fattest);
+
+    return (fq_fattest != NULL && fq_fattest->queued_bytes != 0) ? fq_fattest : NULL;
+}
+
+static UINT64 fort_shaper_codel_isqrt(UINT64 v)
+{
+    UINT64 res = 0;
+    UINT64 bit = 1ULL << 62;
+
+    while (bit > v) {
+        bit >>= 2;
+    }
+
+    while (bit != 0) {
+        if (v >= res + bit) {
+            v -= res + bit;
+            res = (res >> 1) + bit;
+        } else {
+            res >>= 1;
+        }
+        bit >>= 2;
+    }
+
+    return res;
+}
+
+inline static INT64 fort_shaper_codel_interval(PFORT_SHAPER shaper)
+{
+    return shaper->qpcFrequency.QuadPart * FORT_QUEUE_CODEL_INTERVAL_MS / 1000;
+}
+
+static INT64 fort_shaper_codel_control_law(PFORT_SHAPER shaper, INT64 t, UINT32 count)
+{
+    const UINT64 interval = fort_shaper_codel_interval(shaper);
+
+    /* t + interval / sqrt(count), as sqrt(count << 16) is sqrt(count) << 8 */
+    return t + (INT64) ((interval << 8) / fort_shaper_codel_isqrt((UINT64) count << 16));
+}
+
+static BOOL fort_shaper_codel_should_drop(PFORT_SHAPER shaper, PFORT_PACKET_FLOW_QUEUE fq,
+        PFORT_FLOW_PACKET pkt, const LARGE_INTEGER now)
+{
+    const INT64 target = shaper->qpcFrequency.QuadPart * FORT_QUEUE_CODEL_TARGET_MS / 1000;
+    const INT64 sojourn = now.QuadPart - pkt->latency_start.QuadPart;
+
+    if (sojourn < target || fq->queued_bytes <= FORT_QUEUE_FLOW_QUANTUM) {
+        fq->codel_first_above.QuadPart = 0;
+        return FALSE;
+    }
+
+    if (fq->codel_first_above.QuadPart == 0) {
+        fq->codel_first_above.QuadPart = now.QuadPart + fort_shaper_codel_interval(shaper);
+        return FALSE;
+    }
+
+    return now.QuadPart >= fq->codel_first_above.QuadPart;
+}
+
+static PFORT_FLOW_PACKET fort_shaper_flow_queue_codel_head(PFORT_SHAPER shaper,
+        PFORT_PACKET_QUEUE queue, PFORT_PACKET_FLOW_QUEUE fq, const LARGE_INTEGER now,
+        PFORT_FLOW_PACKET *pkt_drop_chain)
+{
+    PFORT_FLOW_PACKET pkt = fq->packet_list.packet_head;
+
+    if (pkt == NULL || (queue->limit.flags & FORT_SPEED_LIMIT_CODEL) == 0)
+        return pkt;
+
+    const BOOL drop = fort_shaper_codel_should_drop(shaper, fq, pkt, now);
+
+    if (fq->codel_dropping) {
+        if (!drop) {
+            fq->codel_dropping = FALSE;
+            return pkt;
+        }
+
+        while (now.QuadPart >= fq->codel_drop_next.QuadPart) {
+            pkt = fort_shaper_flow_queue_drop_head(queue, fq, pkt_drop_chain);
+
+            ++fq->codel_count;
+
+            if (pkt == NULL || !fort_shaper_codel_should_drop(shaper, fq, pkt, now)) {
+                fq->codel_dropping = FALSE;
+                break;
+            }
+
+            fq->codel_drop_next.QuadPart = fort_shaper_codel_control_law(
+                    shaper, fq->codel_drop_next.QuadPart, fq->codel_count);
+        }
+    } else if (drop) {
+        pkt = fort_shaper_flow_queue_drop_head(queue, fq, pkt_drop_chain);
+
+        fq->codel_dropping = TRUE;
+
+        /* Resume the previous drop rate, when the dropping state was left recently */
+        const UINT32 count = fq->codel_count;
+        const BOOL is_recent = (now.QuadPart - fq->codel_drop_next.QuadPart)
+                < 16 * fort_shaper_codel_interval(shaper);
+
+        fq->codel_count = (count > 2 && is_recent) ? count - 2 : 1;
+
+        fq->codel_drop_next.QuadPart =
+                fort_shaper_codel_control_law(shaper, now.QuadPart, fq->codel_count);
+    }
+
+    return pkt;
+}
+
 static void fort_shaper_queue_advance_available(
         PFORT_SHAPER shaper, PFORT_PACKET_QUEUE queue, const LARGE_INTEGER now)
 {
@@ -523,7 +824,7 @@ static void fort_shaper_queue_advance_available(
         queue->available_bytes = max_available;
     }
 
-    if (fort_shaper_packet_list_is_empty(&queue->bandwidth_list)
+    if (!fort_shaper_queue_has_flows(queue)
             && queue->available_bytes > FORT_QUEUE_INITIAL_TOKEN_COUNT) {
         queue->available_bytes = FORT_QUEUE_INITIAL_TOKEN_COUNT;
     }
@@ -536,38 +837,61 @@ static void fort_shaper_queue_advance_available(
     */
 }
 
-static void fort_shaper_queue_process_bandwidth(
+static PFORT_FLOW_PACKET fort_shaper_queue_process_bandwidth(
         PFORT_SHAPER shaper, PFORT_PACKET_QUEUE queue, const LARGE_INTEGER now)
 {
-    UNUSED(shaper);
+    PFORT_FLOW_PACKET pkt_drop_chain = NULL;
 
-    /* Move packets to the latency queue as the accumulated available bytes will allow */
-    PFORT_FLOW_PACKET pkt_chain = queue->bandwidth_list.packet_head;
-    if (pkt_chain == NULL)
-        return;
+    /* Move packets to the latency queue as the accumulated available bytes will allow,
+     * serving the flows' sub-queues by Deficit Round Robin */
+    for (;;) {
+        const BOOL is_new = (queue->new_flows.flow_head != NULL);
+        PFORT_PACKET_FLOW_LIST flow_list = is_new ? &queue->new_flows : &queue->old_flows;
 
-    PFORT_FLOW_PACKET pkt_tail = NULL;
-    PFORT_FLOW_PACKET pkt = pkt_chain;
-    do {
-        const UINT64 pkt_length = pkt->data_length;
+        PFORT_PACKET_FLOW_QUEUE fq = flow_list->flow_head;
+        if (fq == NULL)
+            break;
+
+        if (fq->deficit <= 0) {
+            /* The flow used its quantum: move it to the next round */
+            fq->deficit += FORT_QUEUE_FLOW_QUANTUM;
+
+            fort_shaper_flow_list_pop(flow_list);
+            fort_shaper_flow_list_push(&queue->old_flows, fq);
+            continue;
+        }
+
+        PFORT_FLOW_PACKET pkt =
+                fort_shaper_flow_queue_codel_head(shaper, queue, fq, now, &pkt_drop_chain);
+
+        if (pkt == NULL) {
+            fort_shaper_flow_list_pop(flow_list);
+
+            /* The emptied new flow waits for its turn to not starve the old ones */
+            if (is_new && queue->old_flows.flow_head != NULL) {
+                fort_shaper_flow_list_push(&queue->old_flows, fq);
+            } else {
+                fq->is_active = FALSE;
+            }
+            continue;
+        }
+
+        const UINT32 pkt_length = pkt->data_length;
 
         if (queue->available_bytes < pkt_length)
             break;
 
         queue->available_bytes -= pkt_length;
-        queue->queued_bytes -= pkt_length;
-
-        pkt->latency_start = now;
+        fq->deficit -= (LONG) pkt_length;
 
-        pkt_tail = pkt;
-        pkt = pkt->next;
-    } while (pkt != NULL);
+        fort_shaper_flow_queue_pop(queue, fq);
 
-    if (pkt_tail != NULL) {
-        fort_shaper_packet_list_cut_chain(&queue->bandwidth_list, pkt_tail);
+        pkt->latency_start = now;
 
-        fort_shaper_packet_list_add_chain(&queue->latency_list, pkt_chain, pkt_tail);
+        fort_shaper_packet_list_add_chain(&queue->latency_list, pkt, pkt);
     }
+
+    return pkt_drop_chain;
 }
 
 static PFORT_FLOW_PACKET fort_shaper_queue_process_latency(
@@ -613,6 +937,22 @@ static PFORT_FLOW_PACKET fort_shaper_queue_process_latency(
     return NULL;
 }
 
+static PFORT_FLOW_PACKET fort_shaper_flow_list_get_packets(
+        PFORT_PACKET_FLOW_LIST flow_list, PFORT_FLOW_PACKET pkt)
+{
+    while (flow_list->flow_head != NULL) {
+        PFORT_PACKET_FLOW_QUEUE fq = fort_shaper_flow_list_pop(flow_list);
+
+        pkt = fort_shaper_packet_list_get(&fq->packet_list, pkt);
+
+        fq->queued_bytes = 0;
+        fq->is_active = FALSE;
+        fq->codel_dropping = FALSE;
+    }
+
+    return pkt;
+}
+
 static PFORT_FLOW_PACKET fort_shaper_queue_get_packets(
         PFORT_PACKET_QUEUE queue, PFORT_FLOW_PACKET pkt)
 {
@@ -622,7 +962,9 @@ static PFORT_FLOW_PACKET fort_shaper_queue_get_packets(
     queue->queued_bytes = 0;
 
     pkt = fort_shaper_packet_list_get(&queue->latency_list, pkt);
-    pkt = fort_shaper_packet_list_get(&queue->bandwidth_list, pkt);
+
+    pkt = fort_shaper_flow_list_get_packets(&queue->new_flows, pkt);
+    pkt = fort_shaper_flow_list_get_packets(&queue->old_flows, pkt);
 
     KeReleaseInStackQueuedSpinLock(&lock_queue);
 
@@ -635,8 +977,18 @@ static PFORT_FLOW_PACKET fort_shaper_queue_get_flow_packets(
     KLOCK_QUEUE_HANDLE lock_queue;
     KeAcquireInStackQueuedSpinLock(&queue->lock, &lock_queue);
 
-    pkt = fort_shaper_packet_list_get_flow_packets(&queue->bandwidth_list, flow, pkt);
-    pkt = fort_shaper_packet_list_get_flow_packets(&queue->latency_list, flow, pkt);
+    /* Only the flow's sub-queue has to be looked up */
+    PFORT_PACKET_FLOW_QUEUE fq = fort_shaper_queue_flow_queue(queue, flow);
+
+    PFORT_FLOW_PACKET pkt_chain =
+            fort_shaper_packet_list_get_flow_packets(&fq->packet_list, flow, pkt);
+
+    for (PFORT_FLOW_PACKET pkt_flow = pkt_chain; pkt_flow != pkt; pkt_flow = pkt_flow->next) {
+        fq->queued_bytes -= pkt_flow->data_length;
+        queue->queued_bytes -= pkt_flow->data_length;
+    }
+
+    pkt = fort_shaper_packet_list_get_flow_packets(&queue->latency_list, flow, pkt_chain);
 
     KeReleaseInStackQueuedSpinLock(&lock_queue);
 
@@ -645,33 +997,96 @@ static PFORT_FLOW_PACKET fort_shaper_queue_get_flow_packets(
 
 inline static BOOL fort_shaper_queue_is_empty(PFORT_PACKET_QUEUE queue)
 {
-    return fort_shaper_packet_list_is_empty(&queue->bandwidth_list)
+    return !fort_shaper_queue_has_flows(queue)
             && fort_shaper_packet_list_is_empty(&queue->latency_list);
 }
 
-static BOOL fort_shaper_queue_process(PFORT_SHAPER shaper, PFORT_PACKET_QUEUE queue)
+static INT64 fort_shaper_queue_latency_ticks(PFORT_SHAPER shaper, PFORT_PACKET_QUEUE queue)
+{
+    const INT64 qpcFrequency = shaper->qpcFrequency.QuadPart;
+
+    /* As the elapsed time is rounded to the closest ms */
+    return ((INT64) queue->limit.latency_ms * qpcFrequency - qpcFrequency / 2000LL + 999) / 1000;
+}
+
+static void fort_shaper_queue_update_next_tick(
+        PFORT_SHAPER shaper, PFORT_PACKET_QUEUE queue, const LARGE_INTEGER now)
+{
+    INT64 next_tick = FORT_QUEUE_NEXT_TICK_NONE;
+
+    /* Arrival of the bandwidth's tokens for the packet to be served next */
+    PFORT_PACKET_FLOW_QUEUE fq = (queue->new_flows.flow_head != NULL)
+            ? queue->new_flows.flow_head
+            : queue->old_flows.flow_head;
+
+    if (fq != NULL) {
+        const INT64 qpcFrequency = shaper->qpcFrequency.QuadPart;
+        const UINT64 bps = queue->limit.bps;
+
+        const UINT64 wait_bytes = fq->packet_list.packet_head->data_length - queue->available_bytes;
+
+        next_tick = now.QuadPart
+                + (bps != 0 ? (INT64) ((wait_bytes * qpcFrequency + bps - 1) / bps) : qpcFrequency);
+    }
+
+    /* Expiration of the oldest packet's latency */
+    PFORT_FLOW_PACKET pkt = queue->latency_list.packet_head;
+
+    if (pkt != NULL) {
+        const INT64 latency_tick =
+                pkt->latency_start.QuadPart + fort_shaper_queue_latency_ticks(shaper, queue);
+
+        if (latency_tick < next_tick) {
+            next_tick = latency_tick;
+        }
+    }
+
+    queue->next_tick.QuadPart = next_tick;
+}
+
+FORT_API PFORT_FLOW_PACKET fort_shaper_queue_process_locked(PFORT_SHAPER shaper,
+        PFORT_PACKET_QUEUE queue, const LARGE_INTEGER now, PFORT_FLOW_PACKET *pkt_drop_chain)
+{
+    fort_shaper_queue_advance_available(shaper, queue, now);
+
+    *pkt_drop_chain = fort_shaper_queue_process_bandwidth(shaper, queue, now);
+
+    PFORT_FLOW_PACKET pkt_chain = fort_shaper_queue_process_latency(shaper, queue, now);
+
+    fort_shaper_queue_update_next_tick(shaper, queue, now);
+
+    return pkt_chain;
+}
+
+static BOOL fort_shaper_queue_process(
+        PFORT_SHAPER shaper, PFORT_PACKET_QUEUE queue, const LARGE_INTEGER now, INT64 *next_tick)
 {
     PFORT_FLOW_PACKET pkt_chain = NULL;
+    PFORT_FLOW_PACKET pkt_drop_chain = NULL;
     BOOL is_active = FALSE;
 
     KLOCK_QUEUE_HANDLE lock_queue;
     KeAcquireInStackQueuedSpinLock(&queue->lock, &lock_queue);
 
     if (!fort_shaper_queue_is_empty(queue)) {
-        const LARGE_INTEGER now = KeQueryPerformanceCounter(NULL);
-
-        fort_shaper_queue_advance_available(shaper, queue, now);
-        fort_shaper_queue_process_bandwidth(shaper, queue, now);
-
-        pkt_chain = fort_shaper_queue_process_latency(shaper, queue, now);
+        /* Skip the queue until its next packet becomes eligible */
+        if (now.QuadPart >= queue->next_tick.QuadPart) {
+            pkt_chain = fort_shaper_queue_process_locked(shaper, queue, now, &pkt_drop_chain);
+        }
 
         is_active = !fort_shaper_queue_is_empty(queue);
+
+        *next_tick = queue->next_tick.QuadPart;
     }
 
     KeReleaseInStackQueuedSpinLock(&lock_queue);
 
+    if (pkt_drop_chain != NULL) {
+        fort_shaper_packet_foreach(shaper, pkt_drop_chain, &fort_shaper_packet_drop);
+    }
+
     if (pkt_chain != NULL) {
-        fort_shaper_packet_foreach(shaper, pkt_chain, &fort_shaper_packet_inject);
+        fort_shaper_packet_inject(shaper, pkt_chain);
     }
 
     return is_active;
@@ -716,6 +1131,7 @@ static void fort_shaper_create_queues(
 
         queue->available_bytes = FORT_QUEUE_INITIAL_TOKEN_COUNT;
         queue->last_tick = now;
+        queue->next_tick.QuadPart = 0;
     }
 }
 
@@ -735,10 +1151,13 @@ inline static void fort_shaper_thread_set_event(PFORT_SHAPER shaper)
     KeSetEvent(&shaper->thread_event, IO_NO_INCREMENT, FALSE);
 }
 
-inline static ULONG fort_shaper_thread_process_queues(PFORT_SHAPER shaper, ULONG active_io_bits)
+inline static ULONG fort_shaper_thread_process_queues(
+        PFORT_SHAPER shaper, ULONG active_io_bits, INT64 *next_tick)
 {
     ULONG new_active_io_bits = 0;
 
+    const LARGE_INTEGER now = KeQueryPerformanceCounter(NULL);
+
     for (int i = 0; active_io_bits != 0; ++i) {
         const BOOL queue_exists = (active_io_bits & 1) != 0;
         active_io_bits >>= 1;
@@ -750,15 +1169,22 @@ inline static ULONG fort_shaper_thread_process_queues(PFORT_SHAPER shaper, ULONG
         if (queue == NULL)
             continue;
 
-        if (fort_shaper_queue_process(shaper, queue)) {
+        INT64 queue_next_tick = FORT_QUEUE_NEXT_TICK_NONE;
+
+        if (fort_shaper_queue_process(shaper, queue, now, &queue_next_tick)) {
             new_active_io_bits |= (1 << i);
+
+            /* Keep the earliest time, 0 is due now */
+            if (queue_next_tick < *next_tick) {
+                *next_tick = queue_next_tick;
+            }
         }
     }
 
     return new_active_io_bits;
 }
 
-inline static BOOL fort_shaper_thread_process(PFORT_SHAPER shaper)
+inline static BOOL fort_shaper_thread_process(PFORT_SHAPER shaper, INT64 *next_tick)
 {
     ULONG active_io_bits =
             fort_shaper_io_bits_set(&shaper->active_io_bits, FORT_PACKET_FLUSH_ALL, FALSE);
@@ -766,7 +1192,7 @@ inline static BOOL fort_shaper_thread_process(PFORT_SHAPER shaper)
     if (active_io_bits == 0)
         return FALSE;
 
-    active_io_bits = fort_shaper_thread_process_queues(shaper, active_io_bits);
+    active_io_bits = fort_shaper_thread_process_queues(shaper, active_io_bits, next_tick);
 
     if (active_io_bits != 0) {
         fort_shaper_io_bits_set(&shaper->active_io_bits, active_io_bits, TRUE);
@@ -777,21 +1203,39 @@ inline static BOOL fort_shaper_thread_process(PFORT_SHAPER shaper)
     return FALSE;
 }
 
+static void fort_shaper_thread_delay(PFORT_SHAPER shaper, INT64 next_tick, PLARGE_INTEGER delay)
+{
+    const INT64 qpcFrequency = shaper->qpcFrequency.QuadPart;
+
+    const LARGE_INTEGER now = KeQueryPerformanceCounter(NULL);
+
+    INT64 ticks = next_tick - now.QuadPart;
+    if (ticks > qpcFrequency) {
+        ticks = qpcFrequency; /* 1 second at most */
+    }
+
+    /* Relative time in 100ns units */
+    delay->QuadPart = (ticks > 0) ? -((ticks * 10 * 1000 * 1000) / qpcFrequency) : 0;
+}
+
 static void fort_shaper_thread_loop(PVOID context)
 {
     PFORT_SHAPER shaper = context;
     PKEVENT thread_event = &shaper->thread_event;
 
-    LARGE_INTEGER delay = {
-        .QuadPart = -2 * 1000 * 10 /* sleep 2000us (2ms) */
-    };
-
+    LARGE_INTEGER delay;
     PLARGE_INTEGER timeout = NULL;
 
     do {
         KeWaitForSingleObject(thread_event, Executive, KernelMode, FALSE, timeout);
 
-        const BOOL is_active = fort_shaper_thread_process(shaper);
+        INT64 next_tick = FORT_QUEUE_NEXT_TICK_NONE;
+        const BOOL is_active = fort_shaper_thread_process(shaper, &next_tick);
+
+        /* Sleep until the earliest eligible packet of the active queues */
+        if (is_active) {
+            fort_shaper_thread_delay(shaper, next_tick, &delay);
+        }
 
         timeout = is_active ? &delay : NULL;
 
@@ -838,8 +1282,23 @@ static void fort_shaper_flush(PFORT_SHAPER shaper, UINT32 group_io_bits, BOOL dr
 
     /* Process the packets */
     if (pkt_chain != NULL) {
-        fort_shaper_packet_foreach(
-                shaper, pkt_chain, (drop ? &fort_shaper_packet_drop : &fort_shaper_packet_inject));
+        if (drop) {
+            fort_shaper_packet_foreach(shaper, pkt_chain, &fort_shaper_packet_drop);
+        } else {
+            fort_shaper_packet_inject(shaper, pkt_chain);
+        }
+    }
+}
+
+static void fort_shaper_wait_packets(PFORT_SHAPER shaper)
+{
+    while (InterlockedAdd(&shaper->packet_count, 0) > 0) {
+        /* Wait for the injections' completion */
+        LARGE_INTEGER delay = {
+            .QuadPart = -50 * 1000 * 10 /* sleep 50000us (50ms) */
+        };
+
+        KeDelayExecutionThread(KernelMode, FALSE, &delay);
     }
 }
 
@@ -850,6 +1309,9 @@ FORT_API void fort_shaper_open(PFORT_SHAPER shaper)
 
     KeInitializeSpinLock(&shaper->lock);
 
+    ExInitializeNPagedLookasideList(&shaper->packet_lookaside, NULL, NULL, POOL_NX_ALLOCATION,
+            sizeof(FORT_FLOW_PACKET), FORT_PACKET_POOL_TAG, 0);
+
     KeInitializeEvent(&shaper->thread_event, SynchronizationEvent, FALSE);
 
     fort_thread_run(&shaper->thread, &fort_shaper_thread_loop, shaper, /*priorityIncrement=*/0);
@@ -863,15 +1325,17 @@ FORT_API void fort_shaper_close(PFORT_SHAPER shaper)
 
     fort_shaper_drop_packets(shaper);
     fort_shaper_free_queues(shaper);
+
+    fort_shaper_wait_packets(shaper);
+
+    ExDeleteNPagedLookasideList(&shaper->packet_lookaside);
 }
 
-FORT_API void fort_shaper_conf_update(PFORT_SHAPER shaper, PCFORT_CONF_IO conf_io)
+FORT_API void fort_shaper_conf_update(
+        PFORT_SHAPER shaper, PCFORT_CONF_GROUP conf_group, const FORT_CONF_FLAGS conf_flags)
 {
-    PCFORT_CONF_GROUP conf_group = &conf_io->conf_group;
-    PCFORT_CONF_FLAGS conf_flags = &conf_io->conf.flags;
-
     const UINT32 limit_io_bits = conf_group->limit_io_bits;
-    const UINT32 group_io_bits = conf_flags->filter_enabled
+    const UINT32 group_io_bits = conf_flags.filter_enabled
             ? (limit_io_bits & fort_bits_duplicate16(conf_group->group_bits))
             : 0;
     UINT32 flush_io_bits;
@@ -911,19 +1375,58 @@ void fort_shaper_conf_flags_update(PFORT_SHAPER shaper, const FORT_CONF_FLAGS co
     fort_shaper_flush(shaper, flush_io_bits, /*drop=*/FALSE);
 }
 
+static PFORT_FLOW_PACKET fort_shaper_packet_queue_make_room(
+        PFORT_PACKET_QUEUE queue, ULONG data_length)
+{
+    PFORT_FLOW_PACKET pkt_drop_chain = NULL;
+
+    const UINT32 buffer_bytes = queue->limit.buffer_bytes;
+    if (buffer_bytes == 0)
+        return NULL;
+
+    /* Drop from the head of the fattest flow instead of the tail drop */
+    while ((UINT64) buffer_bytes < (queue->queued_bytes + data_length)) {
+        PFORT_PACKET_FLOW_QUEUE fq = fort_shaper_queue_fattest_flow_queue(queue);
+        if (fq == NULL)
+            break;
+
+        fort_shaper_flow_queue_drop_head(queue, fq, &pkt_drop_chain);
+    }
+
+    return pkt_drop_chain;
+}
+
+FORT_API PFORT_FLOW_PACKET fort_shaper_queue_add_packet_locked(
+        PFORT_PACKET_QUEUE queue, PFORT_FLOW_PACKET pkt)
+{
+    PFORT_FLOW_PACKET pkt_drop_chain = fort_shaper_packet_queue_make_room(queue, pkt->data_length);
+
+    fort_shaper_queue_add_flow_packet(queue, pkt);
+
+    queue->next_tick.QuadPart = 0; /* the new packet may be eligible earlier */
+
+    return pkt_drop_chain;
+}
+
 static void fort_shaper_packet_queue_add_packet(
         PFORT_SHAPER shaper, PFORT_PACKET_QUEUE queue, PFORT_FLOW_PACKET pkt, UINT32 queue_bit)
 {
+    PFORT_FLOW_PACKET pkt_drop_chain;
+
+    pkt->latency_start = KeQueryPerformanceCounter(NULL);
+
     KLOCK_QUEUE_HANDLE lock_queue;
     KeAcquireInStackQueuedSpinLock(&queue->lock, &lock_queue);
     {
-        queue->queued_bytes += pkt->data_length;
-
-        fort_shaper_packet_list_add_chain(&queue->bandwidth_list, pkt, pkt);
+        pkt_drop_chain = fort_shaper_queue_add_packet_locked(queue, pkt);
 
         fort_shaper_io_bits_set(&shaper->active_io_bits, queue_bit, TRUE);
     }
     KeReleaseInStackQueuedSpinLock(&lock_queue);
+
+    if (pkt_drop_chain != NULL) {
+        fort_shaper_packet_foreach(shaper, pkt_drop_chain, &fort_shaper_packet_drop);
+    }
 }
 
 inline static BOOL fort_shaper_packet_queue_check_plr(PFORT_SHAPER shaper, PFORT_PACKET_QUEUE queue)
@@ -942,7 +1445,8 @@ inline static BOOL fort_shaper_packet_queue_check_buffer(
 {
     const UINT32 buffer_bytes = queue->limit.buffer_bytes;
 
-    return buffer_bytes == 0 || (UINT64) buffer_bytes >= (queue->queued_bytes + data_length);
+    /* The packet, which does not fit the whole buffer, can't be queued by dropping others */
+    return buffer_bytes == 0 || data_length <= buffer_bytes;
 }
 
 static BOOL fort_shaper_packet_queue_check_packet(
@@ -982,7 +1486,7 @@ inline static NTSTATUS fort_shaper_packet_queue(
     }
 
     /* Create the Packet */
-    PFORT_FLOW_PACKET pkt = fort_shaper_packet_new();
+    PFORT_FLOW_PACKET pkt = fort_shaper_packet_new(shaper);
     if (pkt == NULL)
         return STATUS_INSUFFICIENT_RESOURCES;
 
@@ -1084,41 +1588,41 @@ FORT_API void fort_shaper_drop_packets(PFORT_SHAPER shaper)
     fort_shaper_flush(shaper, FORT_PACKET_FLUSH_ALL, /*drop=*/TRUE);
 }
 
-static PFORT_PENDING_PROC fort_pending_proc_find_locked(PFORT_PENDING pending, UINT32 process_id)
+#define fort_pending_proc_hash(process_id) tommy_inthash_u32((UINT32) (process_id))
+
+static UINT32 fort_pending_conn_key(PCFORT_CONF_META_CONN conn)
 {
-    PFORT_PENDING_PROC proc = pending->procs_head;
+    const UINT64 seed = ((UINT64) conn->ip_proto << 40) | ((UINT64) conn->inbound << 32)
+            | ((UINT32) conn->remote_port << 16) | conn->local_port;
 
-    for (; proc != NULL; proc = proc->next) {
-        if (proc->process_id == process_id)
-            return proc;
-    }
+    const UINT64 key = tommy_hash_u64(
+            seed, &conn->remote_ip, conn->isIPv6 ? sizeof(ip6_addr_t) : sizeof(UINT32));
 
-    return NULL;
+    return (UINT32) key | 1; /* 0 is the unused key */
 }
 
-static BOOL fort_pending_proc_check_limits(PFORT_PENDING pending, UINT32 process_id)
+static PFORT_PENDING_PROC fort_pending_proc_find_locked(
+        PFORT_PENDING pending, UINT32 process_id, tommy_key_t pid_hash)
 {
-    UINT16 proc_count = 0;
-    UINT16 packet_count = 0;
-
-    KLOCK_QUEUE_HANDLE lock_queue;
-    KeAcquireInStackQueuedSpinLock(&pending->lock, &lock_queue);
+    PFORT_PENDING_PROC proc =
+            (PFORT_PENDING_PROC) tommy_hashdyn_bucket(&pending->procs_map, pid_hash);
 
-    proc_count = pending->proc_count;
+    while (proc != NULL) {
+        if (proc->process_id == process_id)
+            return proc;
 
-    PFORT_PENDING_PROC proc = fort_pending_proc_find_locked(pending, process_id);
-    if (proc != NULL) {
-        packet_count = proc->packet_count;
+        proc = proc->next;
     }
 
-    KeReleaseInStackQueuedSpinLock(&lock_queue);
-
-    return proc_count < FORT_PENDING_PROC_COUNT_MAX
-            && packet_count < FORT_PENDING_PROC_PACKET_COUNT_MAX;
+    return NULL;
 }
 
-static PFORT_PENDING_PROC fort_pending_proc_get_locked(PFORT_PENDING pending, UINT32 process_id)
+static PFORT_PENDING_PROC fort_pending_proc_add_locked(
+        PFORT_PENDING pending, UINT32 process_id, tommy_key_t pid_hash)
 {
+    if (pending->proc_count >= FORT_PENDING_PROC_COUNT_MAX)
+        return NULL;
+
     PFORT_PENDING_PROC proc;
 
     if (pending->proc_free != NULL) {
@@ -1134,45 +1638,123 @@ static PFORT_PENDING_PROC fort_pending_proc_get_locked(PFORT_PENDING pending, UI
         proc = tommy_arrayof_ref(&pending->procs, size);
     }
 
-    proc->packets_head = NULL;
-    proc->packet_count = 0;
+    tommy_hashdyn_insert(&pending->procs_map, (tommy_hashdyn_node *) proc, NULL, pid_hash);
+
     proc->process_id = process_id;
+    proc->packet_count = 0;
+    proc->packets_head = NULL;
+    proc->packets_tail = NULL;
 
-    proc->next = pending->procs_head;
-    pending->procs_head = proc;
+    proc->aged_out_index = 0;
+    RtlZeroMemory(proc->aged_out_keys, sizeof(proc->aged_out_keys));
 
     pending->proc_count++;
 
     return proc;
 }
 
-static PFORT_PENDING_PROC fort_pending_proc_get_check(PFORT_PENDING pending, UINT32 process_id)
+static PFORT_PENDING_PROC fort_pending_proc_get_locked(PFORT_PENDING pending, UINT32 process_id)
 {
-    PFORT_PENDING_PROC proc = fort_pending_proc_find_locked(pending, process_id);
+    const tommy_key_t pid_hash = fort_pending_proc_hash(process_id);
+
+    PFORT_PENDING_PROC proc = fort_pending_proc_find_locked(pending, process_id, pid_hash);
 
     if (proc == NULL) {
-        return fort_pending_proc_get_locked(pending, process_id);
+        proc = fort_pending_proc_add_locked(pending, process_id, pid_hash);
     }
 
-    if (proc->packet_count >= FORT_PENDING_PROC_PACKET_COUNT_MAX)
-        return NULL;
-
     return proc;
 }
 
 static void fort_pending_proc_put_locked(PFORT_PENDING pending, PFORT_PENDING_PROC proc)
 {
+    tommy_hashdyn_remove_existing(&pending->procs_map, (tommy_hashdyn_node *) proc);
+
     pending->proc_count--;
 
     proc->next = pending->proc_free;
     pending->proc_free = proc;
 }
 
+static void fort_pending_proc_push_packet_locked(PFORT_PENDING_PROC proc, PFORT_PENDING_PACKET pkt)
+{
+    pkt->next = NULL;
+
+    if (proc->packets_tail == NULL) {
+        proc->packets_head = pkt;
+    } else {
+        proc->packets_tail->next = pkt;
+    }
+
+    proc->packets_tail = pkt;
+    proc->packet_count++;
+}
+
+static PFORT_PENDING_PACKET fort_pending_proc_pop_packet_locked(PFORT_PENDING_PROC proc)
+{
+    PFORT_PENDING_PACKET pkt = proc->packets_head;
+
+    proc->packets_head = pkt->next;
+
+    if (proc->packets_head == NULL) {
+        proc->packets_tail = NULL;
+    }
+
+    proc->packet_count--;
+
+    pkt->next = NULL;
+
+    return pkt;
+}
+
+static void fort_pending_proc_age_out_packet_locked(
+        PFORT_PENDING_PROC proc, PFORT_PENDING_PACKET pkt)
+{
+    /* Overwrite the oldest key: at worst, its re-authorization is held again */
+    const UINT16 index = proc->aged_out_index++ & (FORT_PENDING_PROC_AGED_OUT_COUNT - 1);
+
+    proc->aged_out_keys[index] = pkt->conn_key;
+}
+
+static BOOL fort_pending_proc_take_aged_out_locked(PFORT_PENDING_PROC proc, UINT32 conn_key)
+{
+    for (int i = 0; i < FORT_PENDING_PROC_AGED_OUT_COUNT; ++i) {
+        if (proc->aged_out_keys[i] == conn_key) {
+            proc->aged_out_keys[i] = 0;
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+static BOOL fort_pending_proc_is_aged_out(PFORT_PENDING pending, PCFORT_CONF_META_CONN conn)
+{
+    BOOL res = FALSE;
+
+    KLOCK_QUEUE_HANDLE lock_queue;
+    KeAcquireInStackQueuedSpinLock(&pending->lock, &lock_queue);
+
+    const UINT32 process_id = conn->process_id;
+
+    PFORT_PENDING_PROC proc = fort_pending_proc_find_locked(
+            pending, process_id, fort_pending_proc_hash(process_id));
+
+    if (proc != NULL) {
+        res = fort_pending_proc_take_aged_out_locked(proc, fort_pending_conn_key(conn));
+    }
+
+    KeReleaseInStackQueuedSpinLock(&lock_queue);
+
+    return res;
+}
+
 static NTSTATUS fort_pending_proc_add_packet_locked(PFORT_PENDING pending, PCFORT_CALLOUT_ARG ca,
-        PCFORT_CONF_META_CONN conn, PFORT_PENDING_PACKET pkt)
+        PCFORT_CONF_META_CONN conn, PFORT_PENDING_PACKET pkt, UINT16 packet_count_max,
+        PFORT_PENDING_PACKET *old_pkt)
 {
-    /* Create the Pending Process */
-    PFORT_PENDING_PROC proc = fort_pending_proc_get_check(pending, conn->process_id);
+    /* Find or Create the Pending Process */
+    PFORT_PENDING_PROC proc = fort_pending_proc_get_locked(pending, conn->process_id);
     if (proc == NULL)
         return STATUS_INSUFFICIENT_RESOURCES;
 
@@ -1186,32 +1768,53 @@ static NTSTATUS fort_pending_proc_add_packet_locked(PFORT_PENDING pending, PCFOR
         return status;
     }
 
-    proc->packet_count++;
+    /* Age out the oldest packet */
+    if (proc->packet_count >= packet_count_max) {
+        *old_pkt = fort_pending_proc_pop_packet_locked(proc);
+
+        fort_pending_proc_age_out_packet_locked(proc, *old_pkt);
+    }
 
-    pkt->next = proc->packets_head;
-    proc->packets_head = pkt;
+    fort_pending_proc_push_packet_locked(proc, pkt);
 
     return STATUS_SUCCESS;
 }
 
 static NTSTATUS fort_pending_proc_add_packet(PFORT_PENDING pending, PCFORT_CALLOUT_ARG ca,
-        PCFORT_CONF_META_CONN conn, PFORT_PENDING_PACKET pkt)
+        PCFORT_CONF_META_CONN conn, PFORT_PENDING_PACKET pkt, UINT16 packet_count_max,
+        PFORT_PENDING_PACKET *old_pkt)
 {
     NTSTATUS status;
 
     KLOCK_QUEUE_HANDLE lock_queue;
     KeAcquireInStackQueuedSpinLock(&pending->lock, &lock_queue);
 
-    status = fort_pending_proc_add_packet_locked(pending, ca, conn, pkt);
+    status = fort_pending_proc_add_packet_locked(
+            pending, ca, conn, pkt, packet_count_max, old_pkt);
 
     KeReleaseInStackQueuedSpinLock(&lock_queue);
 
     return status;
 }
 
+static void fort_pending_packets_drop(PFORT_PENDING_PACKET pkt)
+{
+    while (pkt != NULL) {
+        PFORT_PENDING_PACKET pkt_next = pkt->next;
+
+        /* The completed operation is re-authorized without the packet */
+        FwpsCompleteOperation0(pkt->completion_context, NULL);
+
+        fort_pending_packet_free(pkt);
+
+        pkt = pkt_next;
+    }
+}
+
 static void fort_pending_init(PFORT_PENDING pending)
 {
     tommy_arrayof_init(&pending->procs, sizeof(FORT_PENDING_PROC));
+    tommy_hashdyn_init(&pending->procs_map);
 }
 
 FORT_API void fort_pending_open(PFORT_PENDING pending)
@@ -1233,6 +1836,7 @@ FORT_API void fort_pending_open(PFORT_PENDING pending)
 static void fort_pending_done(PFORT_PENDING pending)
 {
     tommy_arrayof_done(&pending->procs);
+    tommy_hashdyn_done(&pending->procs_map);
 }
 
 FORT_API void fort_pending_close(PFORT_PENDING pending)
@@ -1245,31 +1849,63 @@ FORT_API void fort_pending_close(PFORT_PENDING pending)
     FwpsInjectionHandleDestroy0(pending->injection_transport6_out_id);
 }
 
-static void fort_pending_clear_locked(PFORT_PENDING pending)
+static void fort_pending_proc_collect_packets(PVOID pkt_chain_arg, PVOID proc_node)
 {
-    if (pending->proc_count == 0)
+    PFORT_PENDING_PACKET *pkt_chain = pkt_chain_arg;
+    PFORT_PENDING_PROC proc = proc_node;
+
+    if (proc->packets_tail == NULL)
         return;
 
+    proc->packets_tail->next = *pkt_chain;
+    *pkt_chain = proc->packets_head;
+}
+
+static PFORT_PENDING_PACKET fort_pending_clear_locked(PFORT_PENDING pending)
+{
+    PFORT_PENDING_PACKET pkt_chain = NULL;
+
+    if (pending->proc_count == 0)
+        return NULL;
+
+    tommy_hashdyn_foreach_node_arg(
+            &pending->procs_map, &fort_pending_proc_collect_packets, &pkt_chain);
+
     pending->proc_count = 0;
     pending->proc_free = NULL;
-    pending->procs_head = NULL;
 
     fort_pending_done(pending);
     fort_pending_init(pending);
+
+    return pkt_chain;
 }
 
 FORT_API void fort_pending_clear(PFORT_PENDING pending)
 {
+    PFORT_PENDING_PACKET pkt_chain;
+
     KLOCK_QUEUE_HANDLE lock_queue;
     KeAcquireInStackQueuedSpinLock(&pending->lock, &lock_queue);
 
-    fort_pending_clear_locked(pending);
+    pkt_chain = fort_pending_clear_locked(pending);
 
     KeReleaseInStackQueuedSpinLock(&lock_queue);
+
+    fort_pending_packets_drop(pkt_chain);
 }
 
-FORT_API BOOL fort_pending_add_packet(
-        PFORT_PENDING pending, PCFORT_CALLOUT_ARG ca, PCFORT_CONF_META_CONN conn)
+inline static UINT16 fort_pending_packet_count_max(UINT16 packet_count_max)
+{
+    if (packet_count_max == 0)
+        return FORT_PENDING_PROC_PACKET_COUNT_DEFAULT;
+
+    return (packet_count_max < FORT_PENDING_PROC_PACKET_COUNT_MAX)
+            ? packet_count_max
+            : FORT_PENDING_PROC_PACKET_COUNT_MAX;
+}
+
+FORT_API BOOL fort_pending_add_packet(PFORT_PENDING pending, PCFORT_CALLOUT_ARG ca,
+        PCFORT_CONF_META_CONN conn, UINT16 packet_count_max)
 {
     NTSTATUS status;
 
@@ -1277,8 +1913,8 @@ FORT_API BOOL fort_pending_add_packet(
     if (fort_packet_injected_by_self(ca))
         return FALSE;
 
-    /* Check the Process's Limits */
-    if (!fort_pending_proc_check_limits(pending, conn->process_id))
+    /* Skip the re-authorization of the aged out packet's completed operation */
+    if (conn->is_reauth && fort_pending_proc_is_aged_out(pending, conn))
         return FALSE;
 
     /* Create the Packet */
@@ -1288,12 +1924,17 @@ FORT_API BOOL fort_pending_add_packet(
 
     RtlZeroMemory(pkt, sizeof(FORT_PENDING_PACKET));
 
+    pkt->conn_key = fort_pending_conn_key(conn);
+
     const UCHAR ipsec_flag = fort_packet_is_ipsec_protected(ca) ? FORT_PACKET_IPSEC_PROTECTED : 0;
 
+    PFORT_PENDING_PACKET old_pkt = NULL;
+
     status = fort_packet_fill(ca, &pkt->io, ipsec_flag | FORT_PACKET_TYPE_PENDING);
     if (NT_SUCCESS(status)) {
         /* Add the Packet to Pending Process */
-        status = fort_pending_proc_add_packet(pending, ca, conn, pkt);
+        status = fort_pending_proc_add_packet(pending, ca, conn, pkt,
+                fort_pending_packet_count_max(packet_count_max), &old_pkt);
     }
 
     if (!NT_SUCCESS(status)) {
@@ -1301,5 +1942,8 @@ FORT_API BOOL fort_pending_add_packet(
         return FALSE;
     }
 
+    /* Drop the aged out packet */
+    fort_pending_packets_drop(old_pkt);
+
     return TRUE;
 }
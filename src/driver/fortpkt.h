@@ -61,16 +61,46 @@ typedef struct fort_flow_packet
 
     PVOID flow; /* to drop on flow deletion */
 
-    LARGE_INTEGER latency_start; /* Time it was placed in the latency queue */
+    LARGE_INTEGER latency_start; /* Time it was placed in the bandwidth/latency queue */
     UINT32 data_length; /* Size of the packet (in bytes) */
 } FORT_FLOW_PACKET, *PFORT_FLOW_PACKET;
 
+typedef const FORT_FLOW_PACKET *PCFORT_FLOW_PACKET;
+
 typedef struct fort_packet_list
 {
     PFORT_FLOW_PACKET packet_head;
     PFORT_FLOW_PACKET packet_tail;
 } FORT_PACKET_LIST, *PFORT_PACKET_LIST;
 
+#define FORT_PACKET_QUEUE_FLOWS_COUNT 64 /* power of 2 */
+
+#define FORT_PACKET_INJECT_CHAIN_MAX 32 /* max packets injected by one call */
+
+typedef struct fort_packet_flow_list
+{
+    struct fort_packet_flow_queue *flow_head;
+    struct fort_packet_flow_queue *flow_tail;
+} FORT_PACKET_FLOW_LIST, *PFORT_PACKET_FLOW_LIST;
+
+typedef struct fort_packet_flow_queue
+{
+    FORT_PACKET_LIST packet_list;
+
+    struct fort_packet_flow_queue *next_active;
+
+    LONG deficit; /* bytes allowed to be sent in the current round */
+    UINT32 queued_bytes;
+
+    UCHAR is_active : 1;
+    UCHAR codel_dropping : 1;
+
+    UINT32 codel_count; /* packets dropped since entering the dropping state */
+
+    LARGE_INTEGER codel_first_above; /* time when the delay will be above target for interval */
+    LARGE_INTEGER codel_drop_next;
+} FORT_PACKET_FLOW_QUEUE, *PFORT_PACKET_FLOW_QUEUE;
+
 typedef struct fort_packet_queue
 {
     /* All packets are first buffered into the bandwidth queue and released
@@ -79,8 +109,14 @@ typedef struct fort_packet_queue
      * entered and they are released when the appropriate latency has expired.
      * Only the bandwidth queue is affected by the queue buffer size.
      * The latency queue has no limit.
+     *
+     * The bandwidth queue consists of the flows' sub-queues hashed by the flow,
+     * which are served by Deficit Round Robin to share the bandwidth fairly.
+     * The new (sparse) flows are served before the old (backlogged) ones.
      */
-    FORT_PACKET_LIST bandwidth_list;
+    FORT_PACKET_FLOW_LIST new_flows;
+    FORT_PACKET_FLOW_LIST old_flows;
+
     FORT_PACKET_LIST latency_list;
 
     FORT_SPEED_LIMIT limit;
@@ -88,8 +124,11 @@ typedef struct fort_packet_queue
     UINT64 queued_bytes; /* accumulated size of queued packets */
     UINT64 available_bytes; /* accumulated bytes available for sending */
     LARGE_INTEGER last_tick; /* last time the queue was checked */
+    LARGE_INTEGER next_tick; /* time when the next packet becomes eligible, 0 when due now */
 
     KSPIN_LOCK lock;
+
+    FORT_PACKET_FLOW_QUEUE flow_queues[FORT_PACKET_QUEUE_FLOWS_COUNT];
 } FORT_PACKET_QUEUE, *PFORT_PACKET_QUEUE;
 
 typedef struct fort_pending_packet
@@ -99,20 +138,35 @@ typedef struct fort_pending_packet
     struct fort_pending_packet *next;
 
     HANDLE completion_context;
+
+    UINT32 conn_key; /* to recognize its re-authorization, see fort_pending_conn_key() */
 } FORT_PENDING_PACKET, *PFORT_PENDING_PACKET;
 
-#define FORT_PENDING_PROC_COUNT_MAX        1024
-#define FORT_PENDING_PROC_PACKET_COUNT_MAX 3
+#define FORT_PENDING_PROC_COUNT_MAX            1024
+#define FORT_PENDING_PROC_PACKET_COUNT_DEFAULT 3
+#define FORT_PENDING_PROC_PACKET_COUNT_MAX     64
+#define FORT_PENDING_PROC_AGED_OUT_COUNT       4 /* power of 2 */
 
+/* Synchronize with tommy_hashdyn_node! */
 typedef struct fort_pending_proc
 {
     struct fort_pending_proc *next;
+    struct fort_pending_proc *prev;
 
-    PFORT_PENDING_PACKET packets_head;
+    void *data; /* tommy_hashdyn_node::data */
 
-    UINT16 packet_count;
+    tommy_key_t pid_hash; /* tommy_hashdyn_node::index */
 
     UINT32 process_id;
+
+    UINT16 packet_count;
+
+    PFORT_PENDING_PACKET packets_head; /* the oldest packet */
+    PFORT_PENDING_PACKET packets_tail;
+
+    /* Connection keys of the aged out packets, whose re-authorizations are not held again */
+    UINT16 aged_out_index;
+    UINT32 aged_out_keys[FORT_PENDING_PROC_AGED_OUT_COUNT];
 } FORT_PENDING_PROC, *PFORT_PENDING_PROC;
 
 typedef struct fort_pending
@@ -127,7 +181,7 @@ typedef struct fort_pending
     PFORT_PENDING_PROC proc_free;
     tommy_arrayof procs;
 
-    PFORT_PENDING_PROC procs_head;
+    tommy_hashdyn procs_map;
 
     KSPIN_LOCK lock;
 } FORT_PENDING, *PFORT_PENDING;
@@ -146,6 +200,10 @@ typedef struct fort_shaper
     UINT32 randomSeed;
     LARGE_INTEGER qpcFrequency;
 
+    LONG volatile packet_count; /* allocated packets, including the being injected ones */
+
+    NPAGED_LOOKASIDE_LIST packet_lookaside;
+
     KEVENT thread_event;
     FORT_THREAD thread;
 
@@ -162,7 +220,8 @@ FORT_API void fort_shaper_open(PFORT_SHAPER shaper);
 
 FORT_API void fort_shaper_close(PFORT_SHAPER shaper);
 
-FORT_API void fort_shaper_conf_update(PFORT_SHAPER shaper, PCFORT_CONF_IO conf_io);
+FORT_API void fort_shaper_conf_update(
+        PFORT_SHAPER shaper, PCFORT_CONF_GROUP conf_group, const FORT_CONF_FLAGS conf_flags);
 
 FORT_API void fort_shaper_conf_flags_update(PFORT_SHAPER shaper, const FORT_CONF_FLAGS conf_flags);
 
@@ -172,14 +231,20 @@ FORT_API void fort_shaper_drop_flow_packets(PFORT_SHAPER shaper, UINT64 flowCont
 
 FORT_API void fort_shaper_drop_packets(PFORT_SHAPER shaper);
 
+FORT_API PFORT_FLOW_PACKET fort_shaper_queue_add_packet_locked(
+        PFORT_PACKET_QUEUE queue, PFORT_FLOW_PACKET pkt);
+
+FORT_API PFORT_FLOW_PACKET fort_shaper_queue_process_locked(PFORT_SHAPER shaper,
+        PFORT_PACKET_QUEUE queue, const LARGE_INTEGER now, PFORT_FLOW_PACKET *pkt_drop_chain);
+
 FORT_API void fort_pending_open(PFORT_PENDING pending);
 
 FORT_API void fort_pending_close(PFORT_PENDING pending);
 
 FORT_API void fort_pending_clear(PFORT_PENDING pending);
 
-FORT_API BOOL fort_pending_add_packet(
-        PFORT_PENDING pending, PCFORT_CALLOUT_ARG ca, PCFORT_CONF_META_CONN conn);
+FORT_API BOOL fort_pending_add_packet(PFORT_PENDING pending, PCFORT_CALLOUT_ARG ca,
+        PCFORT_CONF_META_CONN conn, UINT16 packet_count_max);
 
 #ifdef __cplusplus
 } // extern "C"
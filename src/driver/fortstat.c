@@ -2,11 +2,15 @@
 
 #include "fortstat.h"
 
+#include "common/fortlog.h"
+
 #define FORT_STAT_POOL_TAG 'SwfF'
 
 #define FORT_PROC_BAD_INDEX ((UINT16) - 1)
 #define FORT_PROC_COUNT_MAX 0xFFFF
 
+#define FORT_STAT_CPU_BITS 32
+
 #define fort_stat_proc_hash(process_id) tommy_inthash_u32((UINT32) (process_id))
 #define fort_flow_hash(flow_id)         tommy_inthash_u32((UINT32) (flow_id))
 
@@ -24,6 +28,49 @@ static void fort_stat_proc_active_add(PFORT_STAT stat, PFORT_STAT_PROC proc)
     stat->proc_active_count++;
 }
 
+static void fort_stat_cpus_grow(PFORT_STAT stat, tommy_size_t proc_count)
+{
+    const tommy_size_t words_count = (proc_count + FORT_STAT_CPU_BITS - 1) / FORT_STAT_CPU_BITS;
+
+    for (UINT32 i = 0; i < stat->cpu_count; ++i) {
+        PFORT_STAT_CPU cpu = &stat->cpus[i];
+
+        tommy_arrayof_grow(&cpu->trafs, proc_count);
+        tommy_arrayof_grow(&cpu->active_bits, words_count);
+    }
+}
+
+static void fort_stat_cpu_proc_merge(PFORT_STAT stat, PFORT_STAT_CPU cpu, UINT16 proc_index)
+{
+    PFORT_TRAF cpu_traf = tommy_arrayof_ref(&cpu->trafs, proc_index);
+
+    const FORT_TRAF traf = {
+        .in_bytes = (UINT64) InterlockedExchange64((LONG64 volatile *) &cpu_traf->in_bytes, 0),
+        .out_bytes = (UINT64) InterlockedExchange64((LONG64 volatile *) &cpu_traf->out_bytes, 0),
+    };
+
+    if (traf.in_bytes == 0 && traf.out_bytes == 0)
+        return;
+
+    PFORT_STAT_PROC proc = tommy_arrayof_ref(&stat->procs, proc_index);
+
+    if (!proc->log_stat)
+        return;
+
+    /* Add traffic to process's bytes */
+    proc->traf.in_bytes += traf.in_bytes;
+    proc->traf.out_bytes += traf.out_bytes;
+
+    fort_stat_proc_active_add(stat, proc);
+}
+
+static void fort_stat_proc_merge(PFORT_STAT stat, PFORT_STAT_PROC proc)
+{
+    for (UINT32 i = 0; i < stat->cpu_count; ++i) {
+        fort_stat_cpu_proc_merge(stat, &stat->cpus[i], proc->proc_index);
+    }
+}
+
 static PFORT_STAT_PROC fort_stat_proc_get(PFORT_STAT stat, UINT32 process_id, tommy_key_t pid_hash)
 {
     PFORT_STAT_PROC proc = (PFORT_STAT_PROC) tommy_hashdyn_bucket(&stat->procs_map, pid_hash);
@@ -65,6 +112,8 @@ static PFORT_STAT_PROC fort_stat_proc_add(PFORT_STAT stat, UINT32 process_id)
         if (tommy_arrayof_grow(&stat->procs, size + 1), 0)
             return NULL;
 
+        fort_stat_cpus_grow(stat, size + 1);
+
         proc = tommy_arrayof_ref(&stat->procs, size);
 
         proc->proc_index = (UINT16) size;
@@ -73,7 +122,8 @@ static PFORT_STAT_PROC fort_stat_proc_add(PFORT_STAT stat, UINT32 process_id)
     tommy_hashdyn_insert(&stat->procs_map, (tommy_hashdyn_node *) proc, 0, pid_hash);
 
     proc->process_id = process_id;
-    proc->traf.v = 0;
+    proc->traf.in_bytes = 0;
+    proc->traf.out_bytes = 0;
     proc->log_stat = FALSE;
     proc->active = FALSE;
     proc->refcount = 0;
@@ -97,7 +147,13 @@ inline static void fort_stat_proc_dec(PFORT_STAT stat, UINT16 proc_index)
 {
     PFORT_STAT_PROC proc = tommy_arrayof_ref(&stat->procs, proc_index);
 
-    if (--proc->refcount != 0 || proc->active)
+    if (--proc->refcount != 0)
+        return;
+
+    /* Take the process's pending traffic before its index may be reused */
+    fort_stat_proc_merge(stat, proc);
+
+    if (proc->active)
         return;
 
     if (proc->log_stat) {
@@ -336,6 +392,21 @@ FORT_API void fort_stat_open(PFORT_STAT stat)
     tommy_arrayof_init(&stat->flows, sizeof(FORT_FLOW));
     tommy_hashdyn_init(&stat->flows_map);
 
+    const ULONG cpu_count = KeQueryMaximumProcessorCountEx(ALL_PROCESSOR_GROUPS);
+
+    stat->cpus = fort_mem_alloc(cpu_count * sizeof(FORT_STAT_CPU), FORT_STAT_POOL_TAG);
+
+    if (stat->cpus != NULL) {
+        stat->cpu_count = cpu_count;
+
+        for (UINT32 i = 0; i < cpu_count; ++i) {
+            PFORT_STAT_CPU cpu = &stat->cpus[i];
+
+            tommy_arrayof_init(&cpu->trafs, sizeof(FORT_TRAF));
+            tommy_arrayof_init(&cpu->active_bits, sizeof(LONG));
+        }
+    }
+
     KeInitializeSpinLock(&stat->lock);
 }
 
@@ -383,6 +454,20 @@ FORT_API void fort_stat_close(PFORT_STAT stat)
     tommy_arrayof_done(&stat->flows);
     tommy_hashdyn_done(&stat->flows_map);
 
+    if (stat->cpus != NULL) {
+        for (UINT32 i = 0; i < stat->cpu_count; ++i) {
+            PFORT_STAT_CPU cpu = &stat->cpus[i];
+
+            tommy_arrayof_done(&cpu->trafs);
+            tommy_arrayof_done(&cpu->active_bits);
+        }
+
+        fort_mem_free(stat->cpus, FORT_STAT_POOL_TAG);
+
+        stat->cpus = NULL;
+        stat->cpu_count = 0;
+    }
+
     KeReleaseInStackQueuedSpinLock(&lock_queue);
 }
 
@@ -397,6 +482,7 @@ FORT_API void fort_stat_log_update(PFORT_STAT stat, BOOL log_stat)
     KeAcquireInStackQueuedSpinLock(&stat->lock, &lock_queue);
 
     /* Clear the processes' active list */
+    fort_stat_traf_merge(stat);
     fort_stat_traf_flush(stat, /*proc_count=*/FORT_PROC_COUNT_MAX, /*out=*/NULL);
 
     /* Clear the processes' logged flag */
@@ -502,6 +588,24 @@ FORT_API void fort_flow_delete(PFORT_STAT stat, UINT64 flowContext)
     KeReleaseInStackQueuedSpinLock(&lock_queue);
 }
 
+static void fort_flow_classify_cpu(
+        PFORT_STAT_CPU cpu, UINT16 proc_index, UINT32 data_len, BOOL inbound)
+{
+    PFORT_TRAF traf = tommy_arrayof_ref(&cpu->trafs, proc_index);
+    UINT64 *traf_bytes = inbound ? &traf->in_bytes : &traf->out_bytes;
+
+    /* The thread may migrate to another CPU meanwhile, so the counters are updated atomically */
+    InterlockedAdd64((LONG64 volatile *) traf_bytes, (LONG64) data_len);
+
+    /* Mark the process as having pending traffic */
+    LONG volatile *bits = tommy_arrayof_ref(&cpu->active_bits, proc_index / FORT_STAT_CPU_BITS);
+    const LONG bit = (LONG) (1UL << (proc_index % FORT_STAT_CPU_BITS));
+
+    if ((*bits & bit) == 0) {
+        InterlockedOr(bits, bit);
+    }
+}
+
 FORT_API void fort_flow_classify(PFORT_STAT stat, UINT64 flowContext, UINT32 data_len, BOOL inbound)
 {
     if (data_len == 0)
@@ -509,13 +613,29 @@ FORT_API void fort_flow_classify(PFORT_STAT stat, UINT64 flowContext, UINT32 dat
 
     PFORT_FLOW flow = (PFORT_FLOW) flowContext;
 
+    const UINT32 cpu_count = stat->cpu_count;
+
+    if (cpu_count != 0) {
+        const UINT16 proc_index = flow->opt.proc_index;
+
+        /* The procs' segments are never moved, so the reads are safe without the lock */
+        PFORT_STAT_PROC proc = tommy_arrayof_ref(&stat->procs, proc_index);
+
+        if (proc->log_stat) {
+            const ULONG cpu_index = KeGetCurrentProcessorNumberEx(NULL) % cpu_count;
+
+            fort_flow_classify_cpu(&stat->cpus[cpu_index], proc_index, data_len, inbound);
+        }
+        return;
+    }
+
     KLOCK_QUEUE_HANDLE lock_queue;
     KeAcquireInStackQueuedSpinLock(&stat->lock, &lock_queue);
 
     PFORT_STAT_PROC proc = tommy_arrayof_ref(&stat->procs, flow->opt.proc_index);
 
     if (proc->log_stat) {
-        UINT32 *proc_bytes = inbound ? &proc->traf.in_bytes : &proc->traf.out_bytes;
+        UINT64 *proc_bytes = inbound ? &proc->traf.in_bytes : &proc->traf.out_bytes;
 
         /* Add traffic to process's bytes */
         *proc_bytes += data_len;
@@ -536,31 +656,77 @@ FORT_API void fort_stat_dpc_end(PKLOCK_QUEUE_HANDLE lock_queue)
     KeReleaseInStackQueuedSpinLockFromDpcLevel(lock_queue);
 }
 
-static void fort_stat_traf_flush_proc(PFORT_STAT stat, PFORT_STAT_PROC proc, PCHAR *out)
+FORT_API void fort_stat_traf_merge(PFORT_STAT stat)
 {
-    PUINT32 out_proc = (PUINT32) *out;
-    PFORT_TRAF out_traf = (PFORT_TRAF) (out_proc + 1);
+    const tommy_size_t proc_count = tommy_arrayof_size(&stat->procs);
+    const tommy_size_t words_count = (proc_count + FORT_STAT_CPU_BITS - 1) / FORT_STAT_CPU_BITS;
+
+    for (UINT32 i = 0; i < stat->cpu_count; ++i) {
+        PFORT_STAT_CPU cpu = &stat->cpus[i];
+
+        for (tommy_size_t word_index = 0; word_index < words_count; ++word_index) {
+            LONG volatile *bits_ref = tommy_arrayof_ref(&cpu->active_bits, word_index);
+
+            if (*bits_ref == 0)
+                continue;
 
-    *out = (PCHAR) (out_traf + 1);
+            ULONG bits = (ULONG) InterlockedExchange(bits_ref, 0);
 
-    /* Write bytes */
-    *out_traf = proc->traf;
+            while (bits != 0) {
+                unsigned long bit_index;
+                _BitScanForward(&bit_index, bits);
 
-    /* Write process_id */
-    *out_proc = proc->process_id
+                bits &= bits - 1;
+
+                const UINT16 proc_index = (UINT16) (word_index * FORT_STAT_CPU_BITS + bit_index);
+
+                fort_stat_cpu_proc_merge(stat, cpu, proc_index);
+            }
+        }
+    }
+}
+
+inline static UINT32 fort_stat_proc_pid_flag(PFORT_STAT_PROC proc)
+{
+    return proc->process_id
             /* The process is terminated */
             | (proc->refcount == 0 ? 1 : 0);
 }
 
-FORT_API void fort_stat_traf_flush(PFORT_STAT stat, UINT16 proc_count, PCHAR out)
+FORT_API UINT32 fort_stat_traf_flush_size(PFORT_STAT stat, UINT32 max_len, UINT16 *proc_count)
 {
     PFORT_STAT_PROC proc = stat->proc_active;
+    UINT32 len = 0;
+    UINT16 count = 0;
+
+    for (; proc != NULL && count < FORT_PROC_COUNT_MAX; proc = proc->next_active) {
+        const UINT32 proc_len =
+                fort_log_stat_traf_proc_size(fort_stat_proc_pid_flag(proc), &proc->traf);
+
+        if (len + proc_len > max_len)
+            break;
+
+        len += proc_len;
+        ++count;
+    }
+
+    *proc_count = count;
+
+    return len;
+}
+
+FORT_API UINT64 fort_stat_traf_flush(PFORT_STAT stat, UINT16 proc_count, PCHAR out)
+{
+    PFORT_STAT_PROC proc = stat->proc_active;
+    UINT64 traf_bytes = 0;
 
     for (; proc != NULL && proc_count != 0; --proc_count) {
         PFORT_STAT_PROC proc_next = proc->next_active;
 
+        traf_bytes += proc->traf.in_bytes + proc->traf.out_bytes;
+
         if (out != NULL) {
-            fort_stat_traf_flush_proc(stat, proc, &out);
+            out = fort_log_stat_traf_proc_write(out, fort_stat_proc_pid_flag(proc), &proc->traf);
         }
 
         if (proc->refcount == 0) {
@@ -570,7 +736,8 @@ FORT_API void fort_stat_traf_flush(PFORT_STAT stat, UINT16 proc_count, PCHAR out
             proc->active = FALSE;
 
             /* Clear process's bytes */
-            proc->traf.v = 0;
+            proc->traf.in_bytes = 0;
+            proc->traf.out_bytes = 0;
         }
 
         proc = proc_next;
@@ -579,4 +746,6 @@ FORT_API void fort_stat_traf_flush(PFORT_STAT stat, UINT16 proc_count, PCHAR out
     }
 
     stat->proc_active = proc;
+
+    return traf_bytes;
 }
@@ -15,22 +15,12 @@ typedef struct fort_stat_proc
     struct fort_stat_proc *prev;
 
     union {
-#if defined(_WIN64)
-        FORT_TRAF traf;
-#else
         UINT32 process_id;
-#endif
         void *data; /* tommy_hashdyn_node::data */
     };
 
     tommy_key_t proc_hash; /* tommy_hashdyn_node::index */
 
-#if defined(_WIN64)
-    UINT32 process_id;
-#else
-    FORT_TRAF traf;
-#endif
-
     UINT16 proc_index;
 
     UINT16 log_stat : 1;
@@ -38,6 +28,8 @@ typedef struct fort_stat_proc
 
     UINT32 refcount;
 
+    FORT_TRAF traf;
+
     struct fort_stat_proc *next_active;
 } FORT_STAT_PROC, *PFORT_STAT_PROC;
 
@@ -120,6 +112,13 @@ enum FORT_STAT_CALLOUT_ID_TYPE {
     FORT_STAT_IN_IPPACKET_DISCARD6_ID,
 };
 
+/* Per-CPU traffic, merged into the processes on flush */
+typedef struct fort_stat_cpu
+{
+    tommy_arrayof trafs; /* FORT_TRAF by process index */
+    tommy_arrayof active_bits; /* LONG words: processes with pending traffic */
+} FORT_STAT_CPU, *PFORT_STAT_CPU;
+
 typedef struct fort_stat
 {
     UCHAR volatile flags;
@@ -141,6 +140,9 @@ typedef struct fort_stat
     tommy_arrayof flows;
     tommy_hashdyn flows_map;
 
+    UINT32 cpu_count;
+    PFORT_STAT_CPU cpus;
+
     FORT_CONF_GROUP conf_group;
 
     LARGE_INTEGER system_time;
@@ -183,7 +185,11 @@ FORT_API void fort_stat_dpc_begin(PFORT_STAT stat, PKLOCK_QUEUE_HANDLE lock_queu
 
 FORT_API void fort_stat_dpc_end(PKLOCK_QUEUE_HANDLE lock_queue);
 
-FORT_API void fort_stat_traf_flush(PFORT_STAT stat, UINT16 proc_count, PCHAR out);
+FORT_API void fort_stat_traf_merge(PFORT_STAT stat);
+
+FORT_API UINT32 fort_stat_traf_flush_size(PFORT_STAT stat, UINT32 max_len, UINT16 *proc_count);
+
+FORT_API UINT64 fort_stat_traf_flush(PFORT_STAT stat, UINT16 proc_count, PCHAR out);
 
 #ifdef __cplusplus
 } // extern "C"
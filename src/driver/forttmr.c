@@ -62,6 +62,19 @@ FORT_API BOOL fort_timer_is_running(PFORT_TIMER timer)
     return (flags & FORT_TIMER_RUNNING) != 0;
 }
 
+static void fort_timer_set(PFORT_TIMER timer, UCHAR flags)
+{
+    const ULONG period = timer->period;
+    const ULONG interval = (flags & FORT_TIMER_ONESHOT) != 0 ? 0 : period;
+    const ULONG delay = (flags & FORT_TIMER_COALESCABLE) != 0 ? 500 : 0;
+
+    const LARGE_INTEGER due = {
+        .QuadPart = (INT64) period * -10000LL /* ms -> us */
+    };
+
+    KeSetCoalescableTimer(&timer->id, due, interval, delay, &timer->dpc);
+}
+
 void fort_timer_set_running(PFORT_TIMER timer, BOOL run)
 {
     const UCHAR flags = fort_timer_flags_set(timer, FORT_TIMER_RUNNING, run);
@@ -71,16 +84,28 @@ void fort_timer_set_running(PFORT_TIMER timer, BOOL run)
         return;
 
     if (run) {
-        const ULONG period = timer->period;
-        const ULONG interval = (flags & FORT_TIMER_ONESHOT) != 0 ? 0 : period;
-        const ULONG delay = (flags & FORT_TIMER_COALESCABLE) != 0 ? 500 : 0;
+        fort_timer_set(timer, flags);
+    } else {
+        KeCancelTimer(&timer->id);
+    }
+}
 
-        const LARGE_INTEGER due = {
-            .QuadPart = (INT64) period * -10000LL /* ms -> us */
-        };
+FORT_API void fort_timer_set_period(PFORT_TIMER timer, ULONG period)
+{
+    if (timer->period == period)
+        return;
 
-        KeSetCoalescableTimer(&timer->id, due, interval, delay, &timer->dpc);
-    } else {
+    timer->period = period;
+
+    /* Re-arm the running periodic timer */
+    const UCHAR flags = fort_timer_flags(timer);
+    if ((flags & (FORT_TIMER_RUNNING | FORT_TIMER_ONESHOT)) != FORT_TIMER_RUNNING)
+        return;
+
+    fort_timer_set(timer, flags);
+
+    /* Was the timer stopped meanwhile? */
+    if (!fort_timer_is_running(timer)) {
         KeCancelTimer(&timer->id);
     }
 }
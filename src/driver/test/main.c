@@ -6,8 +6,19 @@
 
 #include <assert.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
+#include "../common/fortconf.h"
+#include "../common/fortdef.h"
+#include "../fortbuf.h"
 #include "../fortcb.h"
+#include "../fortcnf_cache.h"
+#include "../fortcnf_rule.h"
+#include "../fortcnf_scope.h"
+#include "../fortcnf_zone.h"
+#include "../fortpkt.h"
+#include "../fortstat.h"
 #include "../fortutl.h"
 #include "../proxycb/fortpcb_drv.h"
 #include "../proxycb/fortpcb_src.h"
@@ -96,15 +107,1274 @@ static void test_utl_bits(void)
     assert(v == 0x33333333);
 }
 
+#define TEST_SHAPER_FREQUENCY   1000000 /* ticks per second of the virtual clock */
+#define TEST_SHAPER_DURATION_MS 20000
+#define TEST_SHAPER_WARMUP_MS   2000 /* to let CoDel find its drop rate */
+#define TEST_SHAPER_BPS         125000 /* 1 Mbit/s */
+#define TEST_SHAPER_BUFFER      (256 * 1024)
+#define TEST_SHAPER_FLOWS_COUNT 3
+
+#define TEST_SHAPER_CODEL_TARGET_MS   5 /* FORT_QUEUE_CODEL_TARGET_MS */
+#define TEST_SHAPER_CODEL_INTERVAL_MS 100 /* FORT_QUEUE_CODEL_INTERVAL_MS */
+
+typedef struct test_shaper_packet
+{
+    FORT_FLOW_PACKET pkt; /* must be first! */
+
+    INT64 enqueue_tick;
+} TEST_SHAPER_PACKET, *PTEST_SHAPER_PACKET;
+
+typedef struct test_shaper_flow
+{
+    FORT_FLOW flow; /* must be first! */
+
+    UINT32 packet_size;
+    UINT32 period_ms;
+    UINT32 phase_ms;
+
+    UINT32 queued_count;
+    UINT32 sent_count;
+    UINT32 drop_count;
+
+    UINT64 sent_bytes; /* after the warm-up */
+
+    INT64 sojourn_min;
+    INT64 sojourn_max;
+    INT64 sojourn_sum;
+} TEST_SHAPER_FLOW, *PTEST_SHAPER_FLOW;
+
+static void test_shaper_packets_done(PFORT_FLOW_PACKET pkt, INT64 now, BOOL drop)
+{
+    while (pkt != NULL) {
+        PFORT_FLOW_PACKET pkt_next = pkt->next;
+
+        PTEST_SHAPER_PACKET test_pkt = (PTEST_SHAPER_PACKET) pkt;
+        PTEST_SHAPER_FLOW test_flow = (PTEST_SHAPER_FLOW) pkt->flow;
+
+        if (drop) {
+            ++test_flow->drop_count;
+        } else {
+            const INT64 sojourn = now - test_pkt->enqueue_tick;
+
+            ++test_flow->sent_count;
+            test_flow->sojourn_sum += sojourn;
+
+            if (test_flow->sent_count == 1 || test_flow->sojourn_min > sojourn) {
+                test_flow->sojourn_min = sojourn;
+            }
+
+            if (test_flow->sojourn_max < sojourn) {
+                test_flow->sojourn_max = sojourn;
+            }
+
+            if (now >= (INT64) TEST_SHAPER_WARMUP_MS * TEST_SHAPER_FREQUENCY / 1000
+                    && now < (INT64) TEST_SHAPER_DURATION_MS * TEST_SHAPER_FREQUENCY / 1000) {
+                test_flow->sent_bytes += pkt->data_length;
+            }
+        }
+
+        free(test_pkt);
+
+        pkt = pkt_next;
+    }
+}
+
+static void test_shaper_queue_packet(
+        PFORT_PACKET_QUEUE queue, PTEST_SHAPER_FLOW test_flow, INT64 now)
+{
+    PTEST_SHAPER_PACKET test_pkt = calloc(1, sizeof(TEST_SHAPER_PACKET));
+    assert(test_pkt != NULL);
+
+    test_pkt->enqueue_tick = now;
+
+    PFORT_FLOW_PACKET pkt = &test_pkt->pkt;
+    pkt->flow = &test_flow->flow;
+    pkt->data_length = test_flow->packet_size;
+    pkt->latency_start.QuadPart = now;
+
+    ++test_flow->queued_count;
+
+    PFORT_FLOW_PACKET pkt_drop_chain = fort_shaper_queue_add_packet_locked(queue, pkt);
+
+    test_shaper_packets_done(pkt_drop_chain, now, /*drop=*/TRUE);
+}
+
+/* Replay the synthetic trace of an interactive flow and two bulk flows,
+ * which together offer more than the queue's bandwidth */
+static void test_shaper_trace(PTEST_SHAPER_FLOW test_flows, UINT16 limit_flags)
+{
+    FORT_SHAPER shaper;
+    RtlZeroMemory(&shaper, sizeof(FORT_SHAPER));
+
+    shaper.qpcFrequency.QuadPart = TEST_SHAPER_FREQUENCY;
+
+    PFORT_PACKET_QUEUE queue = calloc(1, sizeof(FORT_PACKET_QUEUE));
+    assert(queue != NULL);
+
+    queue->limit.flags = limit_flags;
+    queue->limit.buffer_bytes = TEST_SHAPER_BUFFER;
+    queue->limit.bps = TEST_SHAPER_BPS;
+    queue->available_bytes = 1500;
+
+    const TEST_SHAPER_FLOW flows[TEST_SHAPER_FLOWS_COUNT] = {
+        { .flow.flow_hash = 1, .packet_size = 200, .period_ms = 20, .phase_ms = 0 },
+        { .flow.flow_hash = 2, .packet_size = 1500, .period_ms = 16, .phase_ms = 3 },
+        { .flow.flow_hash = 3, .packet_size = 1500, .period_ms = 16, .phase_ms = 11 },
+    };
+
+    for (int i = 0; i < TEST_SHAPER_FLOWS_COUNT; ++i) {
+        test_flows[i] = flows[i];
+    }
+
+    /* Step the virtual clock by 1 ms until the queue drains after the trace's end */
+    for (UINT32 ms = 0;; ++ms) {
+        const LARGE_INTEGER now = { .QuadPart = (INT64) ms * TEST_SHAPER_FREQUENCY / 1000 };
+
+        if (ms < TEST_SHAPER_DURATION_MS) {
+            for (int i = 0; i < TEST_SHAPER_FLOWS_COUNT; ++i) {
+                PTEST_SHAPER_FLOW test_flow = &test_flows[i];
+
+                if (ms % test_flow->period_ms == test_flow->phase_ms) {
+                    test_shaper_queue_packet(queue, test_flow, now.QuadPart);
+                }
+            }
+        }
+
+        /* Skip the queue until its next packet becomes eligible */
+        if (now.QuadPart >= queue->next_tick.QuadPart) {
+            PFORT_FLOW_PACKET pkt_drop_chain;
+            PFORT_FLOW_PACKET pkt_chain =
+                    fort_shaper_queue_process_locked(&shaper, queue, now, &pkt_drop_chain);
+
+            test_shaper_packets_done(pkt_drop_chain, now.QuadPart, /*drop=*/TRUE);
+            test_shaper_packets_done(pkt_chain, now.QuadPart, /*drop=*/FALSE);
+        }
+
+        if (ms >= TEST_SHAPER_DURATION_MS && queue->queued_bytes == 0
+                && queue->latency_list.packet_head == NULL)
+            break;
+    }
+
+    free(queue);
+
+    for (int i = 0; i < TEST_SHAPER_FLOWS_COUNT; ++i) {
+        PTEST_SHAPER_FLOW test_flow = &test_flows[i];
+
+        assert(test_flow->queued_count == test_flow->sent_count + test_flow->drop_count);
+
+        printf("test_shaper: flags=%x flow=%d sent=%u dropped=%u bytes/s=%u"
+               " sojourn_avg_ms=%.1f sojourn_max_ms=%.1f\n",
+                limit_flags, i, test_flow->sent_count, test_flow->drop_count,
+                (UINT32) (test_flow->sent_bytes * 1000
+                        / (TEST_SHAPER_DURATION_MS - TEST_SHAPER_WARMUP_MS)),
+                (double) test_flow->sojourn_sum * 1000 / TEST_SHAPER_FREQUENCY
+                        / (test_flow->sent_count ? test_flow->sent_count : 1),
+                (double) test_flow->sojourn_max * 1000 / TEST_SHAPER_FREQUENCY);
+    }
+}
+
+static INT64 test_shaper_sojourn_avg_ms(PTEST_SHAPER_FLOW test_flow)
+{
+    return test_flow->sojourn_sum * 1000 / TEST_SHAPER_FREQUENCY / test_flow->sent_count;
+}
+
+static void test_shaper_check_share(PTEST_SHAPER_FLOW test_flows)
+{
+    PTEST_SHAPER_FLOW interactive = &test_flows[0];
+    PTEST_SHAPER_FLOW bulk1 = &test_flows[1];
+    PTEST_SHAPER_FLOW bulk2 = &test_flows[2];
+
+    /* The sparse flow is not affected by the backlogged ones */
+    assert(interactive->drop_count == 0);
+    assert(test_shaper_sojourn_avg_ms(interactive) < TEST_SHAPER_CODEL_TARGET_MS);
+    assert(interactive->sojourn_max
+            <= (INT64) 3 * 1500 * TEST_SHAPER_FREQUENCY / TEST_SHAPER_BPS);
+
+    /* The backlogged flows share the rest of the bandwidth equally */
+    const INT64 bulk_diff = (INT64) bulk1->sent_bytes - (INT64) bulk2->sent_bytes;
+    assert(llabs(bulk_diff) * 20 <= (INT64) (bulk1->sent_bytes + bulk2->sent_bytes) / 2);
+
+    /* The bandwidth is fully used, but not exceeded */
+    const UINT64 limit_bytes =
+            (UINT64) TEST_SHAPER_BPS * (TEST_SHAPER_DURATION_MS - TEST_SHAPER_WARMUP_MS) / 1000;
+    const UINT64 sent_bytes = interactive->sent_bytes + bulk1->sent_bytes + bulk2->sent_bytes;
+
+    assert(sent_bytes * 20 >= limit_bytes * 19);
+    assert(sent_bytes <= limit_bytes + 1500);
+}
+
+static void test_shaper(void)
+{
+    TEST_SHAPER_FLOW tail_flows[TEST_SHAPER_FLOWS_COUNT];
+    TEST_SHAPER_FLOW codel_flows[TEST_SHAPER_FLOWS_COUNT];
+
+    test_shaper_trace(tail_flows, /*limit_flags=*/0);
+    test_shaper_trace(codel_flows, FORT_SPEED_LIMIT_CODEL);
+
+    test_shaper_check_share(tail_flows);
+    test_shaper_check_share(codel_flows);
+
+    /* CoDel keeps the backlogged flows' queueing delay near its target */
+    for (int i = 1; i < TEST_SHAPER_FLOWS_COUNT; ++i) {
+        const INT64 tail_sojourn_ms = test_shaper_sojourn_avg_ms(&tail_flows[i]);
+        const INT64 codel_sojourn_ms = test_shaper_sojourn_avg_ms(&codel_flows[i]);
+
+        assert(codel_sojourn_ms < TEST_SHAPER_CODEL_INTERVAL_MS);
+        assert(codel_sojourn_ms * 10 < tail_sojourn_ms);
+    }
+}
+
+#define TEST_SHAPER_LATENCY_MS 20
+#define TEST_SHAPER_POLL_MS    2 /* the thread's period before the event-driven wakeups */
+
+/* Replay an overloading bulk flow, waking up only when a packet arrives
+ * or when the queue's next packet becomes eligible */
+static void test_shaper_wakeups(void)
+{
+    FORT_SHAPER shaper;
+    RtlZeroMemory(&shaper, sizeof(FORT_SHAPER));
+
+    shaper.qpcFrequency.QuadPart = TEST_SHAPER_FREQUENCY;
+
+    PFORT_PACKET_QUEUE queue = calloc(1, sizeof(FORT_PACKET_QUEUE));
+    assert(queue != NULL);
+
+    queue->limit.latency_ms = TEST_SHAPER_LATENCY_MS;
+    queue->limit.buffer_bytes = TEST_SHAPER_BUFFER;
+    queue->limit.bps = TEST_SHAPER_BPS;
+    queue->available_bytes = 1500;
+
+    TEST_SHAPER_FLOW test_flow = { .flow.flow_hash = 1, .packet_size = 1500, .period_ms = 10 };
+
+    const INT64 period_ticks = (INT64) test_flow.period_ms * TEST_SHAPER_FREQUENCY / 1000;
+    const INT64 duration_ticks = (INT64) TEST_SHAPER_DURATION_MS * TEST_SHAPER_FREQUENCY / 1000;
+
+    INT64 next_arrival = 0;
+    UINT32 wakeups = 0;
+
+    LARGE_INTEGER now = { .QuadPart = 0 };
+    for (;;) {
+        if (now.QuadPart == next_arrival) {
+            test_shaper_queue_packet(queue, &test_flow, now.QuadPart);
+
+            next_arrival += period_ticks;
+            if (next_arrival >= duration_ticks) {
+                next_arrival = MAXLONGLONG;
+            }
+        }
+
+        if (now.QuadPart >= queue->next_tick.QuadPart) {
+            PFORT_FLOW_PACKET pkt_drop_chain;
+            PFORT_FLOW_PACKET pkt_chain =
+                    fort_shaper_queue_process_locked(&shaper, queue, now, &pkt_drop_chain);
+
+            test_shaper_packets_done(pkt_drop_chain, now.QuadPart, /*drop=*/TRUE);
+            test_shaper_packets_done(pkt_chain, now.QuadPart, /*drop=*/FALSE);
+
+            ++wakeups;
+        }
+
+        const BOOL is_empty =
+                (queue->queued_bytes == 0 && queue->latency_list.packet_head == NULL);
+
+        if (is_empty && next_arrival == MAXLONGLONG)
+            break;
+
+        /* Sleep until the earliest event */
+        const INT64 next_tick = is_empty ? MAXLONGLONG : queue->next_tick.QuadPart;
+        const INT64 wakeup_tick = (next_tick < next_arrival) ? next_tick : next_arrival;
+
+        /* The processed queue must not be due again at once */
+        assert(wakeup_tick > now.QuadPart);
+
+        now.QuadPart = wakeup_tick;
+    }
+
+    free(queue);
+
+    const UINT32 poll_wakeups = (UINT32) (now.QuadPart * 1000 / TEST_SHAPER_FREQUENCY)
+            / TEST_SHAPER_POLL_MS;
+
+    printf("test_shaper_wakeups: sent=%u dropped=%u bytes/s=%u sojourn_min_ms=%.1f"
+           " wakeups=%u poll_wakeups=%u\n",
+            test_flow.sent_count, test_flow.drop_count,
+            (UINT32) (test_flow.sent_bytes * 1000
+                    / (TEST_SHAPER_DURATION_MS - TEST_SHAPER_WARMUP_MS)),
+            (double) test_flow.sojourn_min * 1000 / TEST_SHAPER_FREQUENCY, wakeups,
+            poll_wakeups);
+
+    assert(test_flow.queued_count == test_flow.sent_count + test_flow.drop_count);
+
+    /* The exact rate */
+    const UINT64 limit_bytes =
+            (UINT64) TEST_SHAPER_BPS * (TEST_SHAPER_DURATION_MS - TEST_SHAPER_WARMUP_MS) / 1000;
+
+    assert(test_flow.sent_bytes + 1500 >= limit_bytes);
+    assert(test_flow.sent_bytes <= limit_bytes + 1500);
+
+    /* The latency, which is rounded to the closest ms */
+    assert(test_flow.sojourn_min * 2000
+            >= (INT64) (2 * TEST_SHAPER_LATENCY_MS - 1) * TEST_SHAPER_FREQUENCY);
+
+    assert(wakeups < poll_wakeups);
+}
+
+static PFORT_CONF_ADDR_LIST test_zones_addr_list_new(const UINT32 *ip4_arr, UINT32 ip4_n,
+        const UINT32 *pair4_arr, UINT32 pair4_n, const ip6_addr_t *ip6_arr, UINT32 ip6_n)
+{
+    PFORT_CONF_ADDR_LIST addr_list =
+            malloc(FORT_CONF_ADDR_LIST_SIZE(ip4_n, pair4_n, ip6_n, /*pair6_n=*/0));
+    assert(addr_list != NULL);
+
+    addr_list->ip_n = ip4_n;
+    addr_list->eytzinger = FALSE;
+    addr_list->pair_n = pair4_n;
+
+    memcpy(addr_list->ip, ip4_arr, FORT_CONF_IP4_ARR_SIZE(ip4_n));
+    memcpy(&addr_list->ip[ip4_n], pair4_arr, FORT_CONF_IP4_RANGE_SIZE(pair4_n));
+
+    PFORT_CONF_ADDR_LIST addr6_list = (PFORT_CONF_ADDR_LIST) ((PCHAR) addr_list
+            + FORT_CONF_ADDR4_LIST_SIZE(addr_list->ip_n, addr_list->pair_n));
+    addr6_list->ip_n = ip6_n;
+    addr6_list->eytzinger = FALSE;
+    addr6_list->pair_n = 0;
+
+    memcpy(addr6_list->ip, ip6_arr, FORT_CONF_IP6_ARR_SIZE(ip6_n));
+
+    return addr_list;
+}
+
+static UINT32 test_zones_index_ip4_mask(PCFORT_CONF_ZONES_INDEX zones_index, UINT32 ip)
+{
+    const ip_addr_t ip_addr = { .v4 = ip };
+    return fort_conf_zones_index_ip_mask(zones_index, ip_addr, /*isIPv6=*/FALSE);
+}
+
+static void test_zones_index(void)
+{
+    /* Zone 1: 10.0.0.0/24 and 10.0.5.5; Zone 3: 10.0.0.128-10.0.1.0 and 255.255.255.0/24 */
+    const UINT32 zone1_ip4[] = { 0x0A000505 };
+    const UINT32 zone1_pair4[] = { 0x0A000000, 0x0A0000FF };
+    const UINT32 zone3_pair4[] = { 0x0A000080, 0xFFFFFF00, 0x0A000100, 0xFFFFFFFF };
+
+    ip6_addr_t zone3_ip6[1];
+    memset(zone3_ip6, 0, sizeof(zone3_ip6));
+    zone3_ip6[0].data[15] = 1; /* ::1 */
+
+    FORT_CONF_ZONES_RT zones_rt;
+    memset(&zones_rt, 0, sizeof(zones_rt));
+
+    zones_rt.mask = (1 << 0) | (1 << 2);
+    zones_rt.enabled_mask = zones_rt.mask;
+    zones_rt.addr_lists[0] = test_zones_addr_list_new(zone1_ip4, 1, zone1_pair4, 1, NULL, 0);
+    zones_rt.addr_lists[2] = test_zones_addr_list_new(NULL, 0, zone3_pair4, 2, zone3_ip6, 1);
+
+    PFORT_CONF_BLOB_REF index_ref = fort_conf_zones_index_new(&zones_rt);
+    assert(index_ref != NULL);
+
+    PCFORT_CONF_ZONES_INDEX zones_index = (PCFORT_CONF_ZONES_INDEX) index_ref->data;
+
+    /* Only the points, where the zones' mask changes */
+    printf("test_zones_index: ip4_n=%u ip6_n=%u\n", zones_index->ip4_n, zones_index->ip6_n);
+    assert(zones_index->ip4_n == 7);
+    assert(zones_index->ip6_n == 2);
+
+    assert(test_zones_index_ip4_mask(zones_index, 0x09FFFFFF) == 0);
+    assert(test_zones_index_ip4_mask(zones_index, 0x0A000000) == (1 << 0));
+    assert(test_zones_index_ip4_mask(zones_index, 0x0A000080) == ((1 << 0) | (1 << 2)));
+    assert(test_zones_index_ip4_mask(zones_index, 0x0A0000FF) == ((1 << 0) | (1 << 2)));
+    assert(test_zones_index_ip4_mask(zones_index, 0x0A000100) == (1 << 2));
+    assert(test_zones_index_ip4_mask(zones_index, 0x0A000101) == 0);
+    assert(test_zones_index_ip4_mask(zones_index, 0x0A000505) == (1 << 0));
+    assert(test_zones_index_ip4_mask(zones_index, 0x0A000506) == 0);
+    assert(test_zones_index_ip4_mask(zones_index, 0xFFFFFEFF) == 0);
+    assert(test_zones_index_ip4_mask(zones_index, 0xFFFFFFFF) == (1 << 2));
+
+    /* The index agrees with the zones' lists */
+    FORT_CONF_ZONES_RT zones_indexed = zones_rt;
+    zones_indexed.zones_index = zones_index;
+
+    for (UINT32 ip = 0x0A000000 - 2; ip < 0x0A000600; ++ip) {
+        const FORT_CONF_META_CONN conn = { .remote_ip = { .v4 = ip } };
+
+        UCHAR zone_id = 0;
+        UCHAR zone_id_indexed = 0;
+
+        const BOOL included = fort_conf_zones_ip_included(&zones_rt, &conn, &zone_id, 0xFF);
+        const BOOL included_indexed =
+                fort_conf_zones_ip_included(&zones_indexed, &conn, &zone_id_indexed, 0xFF);
+
+        assert(included == included_indexed);
+        assert(zone_id == zone_id_indexed);
+    }
+
+    ip_addr_t ip6_addr;
+    memset(&ip6_addr, 0, sizeof(ip6_addr));
+
+    assert(fort_conf_zones_index_ip_mask(zones_index, ip6_addr, /*isIPv6=*/TRUE) == 0);
+    ip6_addr.v6.data[15] = 1;
+    assert(fort_conf_zones_index_ip_mask(zones_index, ip6_addr, /*isIPv6=*/TRUE) == (1 << 2));
+    ip6_addr.v6.data[15] = 2;
+    assert(fort_conf_zones_index_ip_mask(zones_index, ip6_addr, /*isIPv6=*/TRUE) == 0);
+
+    fort_conf_blob_ref_put(index_ref);
+
+    free((PVOID) zones_rt.addr_lists[0]);
+    free((PVOID) zones_rt.addr_lists[2]);
+}
+
+#define TEST_SCOPE_RULE_COUNT 4
+#define TEST_SCOPE_RULE_SIZE  16
+
+static void test_conf_scope_rule_add(
+        PFORT_CONF_RULES rules, UINT16 rule_id, UINT32 accept_mask, UINT16 set_rule_id)
+{
+    const UINT32 rule_off = FORT_CONF_RULES_OFFSETS_SIZE(rules->max_rule_id)
+            + (rule_id - 1) * TEST_SCOPE_RULE_SIZE;
+
+    UINT32 *rule_offsets = (UINT32 *) rules->data - 1; /* exclude zero index */
+    rule_offsets[rule_id] = rule_off;
+
+    PFORT_CONF_RULE rule = (PFORT_CONF_RULE) (rules->data + rule_off);
+    rule->enabled = TRUE;
+    rule->has_zones = (accept_mask != 0);
+    rule->set_count = (set_rule_id != 0) ? 1 : 0;
+
+    if (rule->has_zones) {
+        PFORT_CONF_RULE_ZONES rule_zones = (PFORT_CONF_RULE_ZONES) (rule + 1);
+        rule_zones->accept_mask = accept_mask;
+    }
+
+    if (set_rule_id != 0) {
+        UINT16 *rule_ids = (UINT16 *) ((PCHAR) rule + FORT_CONF_RULE_SET_INDEXES_OFFSET(rule));
+        rule_ids[0] = set_rule_id;
+    }
+}
+
+static void test_conf_scope(void)
+{
+    /* Rule 1 includes rule 2, which includes rule 3, which includes rule 1 back */
+    const ULONG rules_len = FORT_CONF_RULES_DATA_OFF
+            + FORT_CONF_RULES_OFFSETS_SIZE(TEST_SCOPE_RULE_COUNT)
+            + TEST_SCOPE_RULE_COUNT * TEST_SCOPE_RULE_SIZE;
+
+    PFORT_CONF_RULES rules = calloc(1, rules_len);
+    assert(rules != NULL);
+
+    rules->max_rule_id = TEST_SCOPE_RULE_COUNT;
+
+    test_conf_scope_rule_add(rules, 1, /*accept_mask=*/0, /*set_rule_id=*/2);
+    test_conf_scope_rule_add(rules, 2, /*accept_mask=*/0x4, /*set_rule_id=*/3);
+    test_conf_scope_rule_add(rules, 3, /*accept_mask=*/0x8, /*set_rule_id=*/1);
+    test_conf_scope_rule_add(rules, 4, /*accept_mask=*/0x10, /*set_rule_id=*/0);
+
+    FORT_DEVICE_CONF device_conf;
+    memset(&device_conf, 0, sizeof(device_conf));
+
+    fort_device_conf_open(&device_conf);
+    fort_conf_rules_set(&device_conf, fort_conf_rules_new(rules, rules_len));
+
+    FORT_CONF_SCOPE scope;
+    memset(&scope, 0, sizeof(scope));
+
+    /* No connection depends on the conf yet */
+    assert(!fort_conf_scope_rule_used(&scope, &device_conf, 1));
+    assert(!fort_conf_scope_zones_used(&scope, &device_conf, 0x4));
+
+    /* The used rule marks its nested sets and their zones */
+    const FORT_APP_DATA rule_app_data = { .rule_id = 1 };
+    fort_conf_scope_conn_add(&scope, rule_app_data);
+
+    assert(fort_conf_scope_rule_used(&scope, &device_conf, 1));
+    assert(fort_conf_scope_rule_used(&scope, &device_conf, 2));
+    assert(fort_conf_scope_rule_used(&scope, &device_conf, 3));
+    assert(!fort_conf_scope_rule_used(&scope, &device_conf, 4));
+
+    assert(fort_conf_scope_zones_used(&scope, &device_conf, 0x4));
+    assert(fort_conf_scope_zones_used(&scope, &device_conf, 0x8));
+    assert(!fort_conf_scope_zones_used(&scope, &device_conf, 0x10));
+
+    assert(!fort_conf_scope_rule_used(&scope, &device_conf, 0));
+    assert(!fort_conf_scope_rule_used(&scope, &device_conf, FORT_CONF_RULE_MAX + 1));
+
+    /* The app's own zones */
+    const FORT_APP_DATA zones_app_data = { .zones = { .accept_mask = 0x10 } };
+    fort_conf_scope_conn_add(&scope, zones_app_data);
+
+    assert(fort_conf_scope_zones_used(&scope, &device_conf, 0x10));
+
+    /* The app's path hash marks its bit */
+    static const WCHAR app_path_buf[] = L"\\Device\\HarddiskVolume1\\app1.exe";
+    static const WCHAR other_path_buf[] = L"\\Device\\HarddiskVolume1\\app2.exe";
+
+    const FORT_APP_PATH app_path = { .len = sizeof(app_path_buf), .buffer = app_path_buf };
+    const FORT_APP_PATH other_path = { .len = sizeof(other_path_buf), .buffer = other_path_buf };
+
+    fort_conf_scope_app_add(&scope, &app_path);
+
+    assert(fort_conf_scope_app_used(&scope, &app_path));
+    assert(!fort_conf_scope_app_used(&scope, &other_path));
+
+    /* The reset keeps the previous set for the racing classifiers */
+    fort_conf_scope_reset(&scope);
+
+    assert(fort_conf_scope_app_used(&scope, &app_path));
+    assert(fort_conf_scope_rule_used(&scope, &device_conf, 3));
+
+    /* The next reset drops it */
+    fort_conf_scope_reset(&scope);
+
+    assert(!fort_conf_scope_app_used(&scope, &app_path));
+    assert(!fort_conf_scope_rule_used(&scope, &device_conf, 1));
+    assert(!fort_conf_scope_zones_used(&scope, &device_conf, 0x10));
+
+    FORT_CONF_STAT conf_stat;
+    memset(&conf_stat, 0, sizeof(conf_stat));
+
+    fort_conf_scope_stat(&scope, &conf_stat);
+
+    assert(conf_stat.scope_reauths == 2);
+    assert(conf_stat.scope_skips == 10);
+
+    fort_conf_rules_set(&device_conf, NULL);
+
+    free(rules);
+}
+
+static void test_conf_cache_stat(PFORT_CONF_CACHE cache, UINT64 hits, UINT64 misses)
+{
+    FORT_CONF_STAT conf_stat;
+    memset(&conf_stat, 0, sizeof(conf_stat));
+
+    fort_conf_cache_stat(cache, &conf_stat);
+
+    assert(conf_stat.cache_hits == hits);
+    assert(conf_stat.cache_misses == misses);
+}
+
+static void test_conf_cache(void)
+{
+    FORT_CONF_CACHE cache;
+    memset(&cache, 0, sizeof(cache));
+
+    fort_conf_cache_open(&cache);
+    assert(cache.slots != NULL);
+
+    const FORT_APP_DATA app_data = { .rule_id = 5 };
+    const UINT32 port_filter_types = (1u << FORT_RULE_FILTER_TYPE_PORT);
+
+    FORT_CONF_META_CONN conn = {
+        .remote_ip = { .v4 = 0x0A000001 },
+        .remote_port = 1234,
+        .ip_proto = 6,
+    };
+
+    /* Miss, then hit with the put verdict */
+    assert(!fort_conf_cache_get(&cache, /*conf_gen=*/1, 0, &conn, app_data));
+    test_conf_cache_stat(&cache, 0, 1);
+
+    conn.blocked = TRUE;
+    conn.reason = FORT_CONN_REASON_IP_INET;
+    conn.zone_id = 3;
+    conn.rule_id = 7;
+
+    fort_conf_cache_put(&cache, /*conf_gen=*/1, 0, &conn, app_data);
+
+    FORT_CONF_META_CONN conn_found = {
+        .remote_ip = conn.remote_ip,
+        .remote_port = 4321, /* the rules do not filter ports */
+        .ip_proto = conn.ip_proto,
+    };
+
+    assert(fort_conf_cache_get(&cache, /*conf_gen=*/1, 0, &conn_found, app_data));
+    test_conf_cache_stat(&cache, 1, 1);
+
+    assert(conn_found.blocked);
+    assert(conn_found.reason == FORT_CONN_REASON_IP_INET);
+    assert(conn_found.zone_id == 3);
+    assert(conn_found.rule_id == 7);
+
+    /* The port filtering rules key the ports */
+    assert(!fort_conf_cache_get(&cache, /*conf_gen=*/1, port_filter_types, &conn_found, app_data));
+
+    /* Other app's data */
+    const FORT_APP_DATA other_app_data = { .rule_id = 6 };
+    assert(!fort_conf_cache_get(&cache, /*conf_gen=*/1, 0, &conn_found, other_app_data));
+
+    /* The conf's change invalidates the verdicts */
+    assert(!fort_conf_cache_get(&cache, /*conf_gen=*/2, 0, &conn_found, app_data));
+    test_conf_cache_stat(&cache, 1, 4);
+
+    fort_conf_cache_put(&cache, /*conf_gen=*/2, 0, &conn, app_data);
+
+    assert(fort_conf_cache_get(&cache, /*conf_gen=*/2, 0, &conn_found, app_data));
+    assert(!fort_conf_cache_get(&cache, /*conf_gen=*/1, 0, &conn_found, app_data));
+    test_conf_cache_stat(&cache, 2, 5);
+
+    fort_conf_cache_close(&cache);
+}
+
+static ULONG test_buffer_paths_read(PFORT_BUFFER buf, PCHAR out, ULONG out_len)
+{
+    FORT_IRP_INFO irp_info = { 0 };
+
+    const NTSTATUS status = fort_buffer_xmove(buf, &irp_info, out, out_len);
+    if (status == STATUS_PENDING)
+        return 0; /* no data */
+
+    assert(status == STATUS_SUCCESS);
+
+    return (ULONG) irp_info.info;
+}
+
+static UINT32 test_buffer_paths_check(PCHAR out, UINT16 expected_path_len)
+{
+    UINT32 pid;
+    UINT32 path_id;
+    UINT16 path_len;
+    fort_log_proc_new_header_read(out, &pid, &path_id, &path_len);
+
+    assert(fort_log_type(out) == FORT_LOG_TYPE_PROC_NEW);
+    assert(pid == 123);
+    assert(path_id != 0);
+    assert(path_len == expected_path_len);
+
+    return path_id;
+}
+
+static void test_buffer_paths_log(void)
+{
+    static const WCHAR path_buf[] = L"\\Device\\HarddiskVolume1\\test.exe";
+    const UINT16 path_len = sizeof(path_buf) - sizeof(WCHAR);
+
+    const FORT_CONF_META_CONN conn = {
+        .process_id = 123,
+        .real_path = { .len = path_len, .buffer = path_buf },
+    };
+
+    FORT_BUFFER buf;
+    memset(&buf, 0, sizeof(buf));
+
+    fort_buffer_open(&buf);
+    assert(buf.rings != NULL);
+
+    char out[1024];
+    FORT_IRP_INFO irp_info = { 0 };
+
+    /* The first record has the path, the next one refers to it by its id */
+    assert(fort_buffer_conn_write(&buf, &conn, &irp_info, FORT_BUFFER_CONN_WRITE_PROC_NEW)
+            == STATUS_SUCCESS);
+    assert(fort_buffer_conn_write(&buf, &conn, &irp_info, FORT_BUFFER_CONN_WRITE_PROC_NEW)
+            == STATUS_SUCCESS);
+
+    ULONG out_len = test_buffer_paths_read(&buf, out, sizeof(out));
+    assert(out_len == FORT_LOG_PROC_NEW_SIZE(path_len) + FORT_LOG_PROC_NEW_SIZE(0));
+
+    const UINT32 path_id = test_buffer_paths_check(out, path_len);
+    assert(memcmp(out + FORT_LOG_PROC_NEW_HEADER_SIZE, path_buf, path_len) == 0);
+
+    assert(test_buffer_paths_check(out + FORT_LOG_PROC_NEW_SIZE(path_len), 0) == path_id);
+
+    /* The unread records are discarded on clear and the path gets a new id */
+    assert(fort_buffer_conn_write(&buf, &conn, &irp_info, FORT_BUFFER_CONN_WRITE_PROC_NEW)
+            == STATUS_SUCCESS);
+
+    fort_buffer_clear(&buf);
+
+    assert(test_buffer_paths_read(&buf, out, sizeof(out)) == 0);
+
+    assert(fort_buffer_conn_write(&buf, &conn, &irp_info, FORT_BUFFER_CONN_WRITE_PROC_NEW)
+            == STATUS_SUCCESS);
+
+    out_len = test_buffer_paths_read(&buf, out, sizeof(out));
+    assert(out_len == FORT_LOG_PROC_NEW_SIZE(path_len));
+
+    assert(test_buffer_paths_check(out, path_len) > path_id);
+
+    fort_buffer_close(&buf);
+}
+
+static PFORT_BUFFER_PATH test_buffer_path_get(PFORT_BUFFER_PATHS paths, PCFORT_APP_PATH path)
+{
+    return fort_buffer_path_get_locked(paths, path, fort_buffer_path_hash(path));
+}
+
+static void test_buffer_paths_ring_bits(void)
+{
+    static const WCHAR path_buf[] = L"test.exe";
+    const FORT_APP_PATH path = { .len = sizeof(path_buf), .buffer = path_buf };
+
+    FORT_BUFFER_PATHS paths;
+    memset(&paths, 0, sizeof(paths));
+
+    fort_buffer_paths_open(&paths, /*ring_count=*/72);
+
+    PFORT_BUFFER_PATH node = test_buffer_path_get(&paths, &path);
+    assert(node != NULL);
+    assert(test_buffer_path_get(&paths, &path) == node);
+
+    /* The rings past the 64th have their own bits */
+    fort_buffer_path_ring_set_written(node, 70);
+
+    assert(fort_buffer_path_ring_written(node, 70));
+    assert(!fort_buffer_path_ring_written(node, 6));
+    assert(!fort_buffer_path_ring_written(node, 71));
+
+    fort_buffer_path_ring_set_written(node, 0);
+
+    assert(fort_buffer_path_ring_written(node, 0));
+    assert(!fort_buffer_path_ring_written(node, 64));
+
+    fort_buffer_paths_close(&paths);
+}
+
+static void test_buffer_paths_limits(void)
+{
+    const UINT16 big_path_len = 32 * 1024;
+    PWCHAR path_buf = calloc(1, big_path_len);
+    assert(path_buf != NULL);
+
+    FORT_APP_PATH path = { .len = 2 * sizeof(UINT32), .buffer = path_buf };
+
+    FORT_BUFFER_PATHS paths;
+    memset(&paths, 0, sizeof(paths));
+
+    fort_buffer_paths_open(&paths, /*ring_count=*/1);
+
+    /* The paths' count is bounded */
+    UINT32 *path_index = (UINT32 *) path_buf;
+
+    for (*path_index = 0; *path_index < FORT_BUFFER_PATH_COUNT_MAX; ++*path_index) {
+        assert(test_buffer_path_get(&paths, &path) != NULL);
+    }
+
+    assert(test_buffer_path_get(&paths, &path) == NULL);
+
+    *path_index = 0;
+    assert(test_buffer_path_get(&paths, &path) != NULL);
+
+    /* The paths' size is bounded */
+    fort_buffer_paths_clear_locked(&paths);
+
+    path.len = big_path_len;
+
+    UINT32 count = 0;
+    for (*path_index = 0; test_buffer_path_get(&paths, &path) != NULL; ++*path_index) {
+        ++count;
+    }
+
+    /* The nodes' headers take less, than a path */
+    assert(count == FORT_BUFFER_PATHS_SIZE_MAX / big_path_len - 1);
+    assert(paths.paths_size <= FORT_BUFFER_PATHS_SIZE_MAX);
+
+    /* The cleared table interns the paths again */
+    fort_buffer_paths_clear_locked(&paths);
+
+    assert(test_buffer_path_get(&paths, &path) != NULL);
+
+    fort_buffer_paths_close(&paths);
+
+    free(path_buf);
+}
+
+#define TEST_CONF_LIST_COUNT_MAX 17 /* past the linear find's limit */
+
+static UINT64 g_test_conf_list_data[64];
+
+static PFORT_CONF_PORT_LIST test_conf_port_list_new(UINT32 count, UINT32 shift)
+{
+    PFORT_CONF_PORT_LIST port_list = (PFORT_CONF_PORT_LIST) ((PCHAR) g_test_conf_list_data + shift);
+
+    port_list->port_n = (UINT8) count;
+    port_list->pair_n = (UINT8) count;
+
+    UINT16 *from_arr = &port_list->port[count];
+    UINT16 *to_arr = &from_arr[count];
+
+    /* The high ports check the unsigned comparison */
+    for (UINT32 i = 0; i < count; ++i) {
+        port_list->port[i] = (UINT16) (65400 + 8 * i);
+        from_arr[i] = (UINT16) (65000 + 16 * i);
+        to_arr[i] = from_arr[i] + 7;
+    }
+
+    return port_list;
+}
+
+static BOOL test_conf_port_inlist_scalar(UINT16 port, PCFORT_CONF_PORT_LIST port_list)
+{
+    const UINT32 count = port_list->port_n;
+    const UINT16 *from_arr = &port_list->port[count];
+    const UINT16 *to_arr = &from_arr[count];
+
+    for (UINT32 i = 0; i < count; ++i) {
+        if (port == port_list->port[i] || (port >= from_arr[i] && port <= to_arr[i]))
+            return TRUE;
+    }
+
+    return FALSE;
+}
+
+static PFORT_CONF_ADDR_LIST test_conf_ip4_list_new(UINT32 count, UINT32 shift)
+{
+    PFORT_CONF_ADDR_LIST addr_list = (PFORT_CONF_ADDR_LIST) ((PCHAR) g_test_conf_list_data + shift);
+
+    addr_list->ip_n = count;
+    addr_list->eytzinger = FALSE;
+    addr_list->pair_n = count;
+
+    UINT32 *from_arr = &addr_list->ip[count];
+    UINT32 *to_arr = &from_arr[count];
+
+    /* The addresses cross the sign bit */
+    for (UINT32 i = 0; i < count; ++i) {
+        addr_list->ip[i] = 0x7FFFFFC0 + 16 * i;
+        from_arr[i] = 0x7FFFFF00 + 64 * i;
+        to_arr[i] = from_arr[i] + 31;
+    }
+
+    return addr_list;
+}
+
+static BOOL test_conf_ip4_inlist_scalar(UINT32 ip, PCFORT_CONF_ADDR_LIST addr_list)
+{
+    const UINT32 count = addr_list->ip_n;
+    const UINT32 *from_arr = &addr_list->ip[count];
+    const UINT32 *to_arr = &from_arr[count];
+
+    for (UINT32 i = 0; i < count; ++i) {
+        if (ip == addr_list->ip[i] || (ip >= from_arr[i] && ip <= to_arr[i]))
+            return TRUE;
+    }
+
+    return FALSE;
+}
+
+static void test_conf_linear_find(void)
+{
+    /* The vector widths are 8 ports and 4 addresses; the shifts unalign the lists' arrays */
+    for (UINT32 count = 0; count <= TEST_CONF_LIST_COUNT_MAX; ++count) {
+        for (UINT32 shift = 0; shift < 16; shift += 4) {
+            PCFORT_CONF_PORT_LIST port_list = test_conf_port_list_new(count, shift + 2);
+
+            for (UINT32 port = 0; port <= 0xFFFF; ++port) {
+                assert(fort_conf_port_inlist((UINT16) port, port_list)
+                        == test_conf_port_inlist_scalar((UINT16) port, port_list));
+            }
+
+            PCFORT_CONF_ADDR_LIST addr_list = test_conf_ip4_list_new(count, shift);
+
+            for (UINT32 ip = 0x7FFFFE00; ip < 0x80000200; ++ip) {
+                const ip_addr_t addr = { .v4 = ip };
+
+                assert(fort_conf_ip_inlist(addr_list, addr, /*isIPv6=*/FALSE)
+                        == test_conf_ip4_inlist_scalar(ip, addr_list));
+            }
+        }
+    }
+}
+
+static void test_conf_ip6_set(ip6_addr_t *ip6, UINT32 v)
+{
+    memset(ip6, 0, sizeof(ip6_addr_t));
+
+    /* Big-endian, as the addresses are compared by bytes */
+    ip6->data[12] = (char) (v >> 24);
+    ip6->data[13] = (char) (v >> 16);
+    ip6->data[14] = (char) (v >> 8);
+    ip6->data[15] = (char) v;
+}
+
+static PFORT_CONF_ADDR_LIST test_conf_addr_list_new(UINT32 count, BOOL eytzinger)
+{
+    PFORT_CONF_ADDR_LIST addr_list = malloc(FORT_CONF_ADDR_LIST_SIZE(count, count, count, count));
+    assert(addr_list != NULL);
+
+    UINT32 *order = malloc(count * sizeof(UINT32));
+    assert(order != NULL);
+
+    if (eytzinger) {
+        fort_conf_eytzinger_order(order, count);
+    } else {
+        for (UINT32 i = 0; i < count; ++i) {
+            order[i] = i;
+        }
+    }
+
+    addr_list->ip_n = count;
+    addr_list->eytzinger = eytzinger;
+    addr_list->pair_n = count;
+
+    UINT32 *from_arr = &addr_list->ip[count];
+    UINT32 *to_arr = &from_arr[count];
+
+    PFORT_CONF_ADDR_LIST addr6_list = (PFORT_CONF_ADDR_LIST) ((PCHAR) addr_list
+            + FORT_CONF_ADDR4_LIST_SIZE(addr_list->ip_n, addr_list->pair_n));
+
+    addr6_list->ip_n = count;
+    addr6_list->eytzinger = eytzinger;
+    addr6_list->pair_n = count;
+
+    ip6_addr_t *ip6_arr = (ip6_addr_t *) addr6_list->ip;
+    ip6_addr_t *from6_arr = &ip6_arr[count];
+    ip6_addr_t *to6_arr = &from6_arr[count];
+
+    for (UINT32 i = 0; i < count; ++i) {
+        const UINT32 k = order[i];
+
+        addr_list->ip[i] = 0x7FFFFF00 + 16 * k;
+        from_arr[i] = 0x7FFFF000 + 64 * k;
+        to_arr[i] = from_arr[i] + 31;
+
+        test_conf_ip6_set(&ip6_arr[i], 0x100 + 16 * k);
+        test_conf_ip6_set(&from6_arr[i], 64 * k);
+        test_conf_ip6_set(&to6_arr[i], 64 * k + 31);
+    }
+
+    free(order);
+
+    return addr_list;
+}
+
+static void test_conf_eytzinger(void)
+{
+    static const UINT32 counts[] = { 1, 2, 3, 5, 7, 8, 15, 16, 17, 31, 33, 100, 1000 };
+
+    for (UINT32 n = 0; n < sizeof(counts) / sizeof(counts[0]); ++n) {
+        const UINT32 count = counts[n];
+
+        PFORT_CONF_ADDR_LIST sorted_list = test_conf_addr_list_new(count, /*eytzinger=*/FALSE);
+        PFORT_CONF_ADDR_LIST eytzinger_list = test_conf_addr_list_new(count, /*eytzinger=*/TRUE);
+
+        UINT32 found = 0;
+
+        for (UINT32 ip = 0x7FFFEF00; ip < 0x7FFFF000 + 64 * count + 0x100; ++ip) {
+            const ip_addr_t addr = { .v4 = ip };
+
+            const BOOL is_found = fort_conf_ip_inlist(eytzinger_list, addr, /*isIPv6=*/FALSE);
+
+            assert(is_found == fort_conf_ip_inlist(sorted_list, addr, /*isIPv6=*/FALSE));
+
+            /* The short lists are checked by the plain loop too */
+            if (count <= 100) {
+                assert(is_found == test_conf_ip4_inlist_scalar(ip, sorted_list));
+            }
+
+            found += is_found;
+        }
+
+        assert(found >= 32 * count);
+
+        for (UINT32 v = 0; v < 64 * count + 0x200; ++v) {
+            ip_addr_t addr;
+            test_conf_ip6_set(&addr.v6, v);
+
+            assert(fort_conf_ip_inlist(eytzinger_list, addr, /*isIPv6=*/TRUE)
+                    == fort_conf_ip_inlist(sorted_list, addr, /*isIPv6=*/TRUE));
+        }
+
+        free(sorted_list);
+        free(eytzinger_list);
+    }
+}
+
+#define TEST_BUFFER_RECORD_LEN  FORT_LOG_PROC_NEW_SIZE(0)
+#define TEST_BUFFER_RECORD_SIZE FORT_BUFFER_RING_RECORD_SIZE(TEST_BUFFER_RECORD_LEN)
+
+static NTSTATUS test_buffer_ring_write(PFORT_BUFFER buf)
+{
+    const FORT_CONF_META_CONN conn = { .process_id = 123 };
+
+    FORT_IRP_INFO irp_info = { 0 };
+
+    return fort_buffer_conn_write(buf, &conn, &irp_info, FORT_BUFFER_CONN_WRITE_PROC_NEW);
+}
+
+static UINT32 test_buffer_ring_fill(PFORT_BUFFER buf)
+{
+    UINT32 count = 0;
+
+    while (test_buffer_ring_write(buf) == STATUS_SUCCESS) {
+        ++count;
+    }
+
+    return count;
+}
+
+static UINT32 test_buffer_ring_pid(PCHAR out, UINT32 index)
+{
+    PCHAR p = out + index * TEST_BUFFER_RECORD_LEN;
+
+    UINT32 pid;
+    UINT32 path_id;
+    UINT16 path_len;
+    fort_log_proc_new_header_read(p, &pid, &path_id, &path_len);
+
+    assert(fort_log_type(p) == FORT_LOG_TYPE_PROC_NEW);
+    assert(path_len == 0);
+
+    return pid;
+}
+
+/* Returns the dropped records' count, which follows the read records */
+static UINT32 test_buffer_ring_read(PFORT_BUFFER buf, PCHAR out, ULONG out_len, UINT32 count)
+{
+    const ULONG read_len = test_buffer_paths_read(buf, out, out_len);
+    const ULONG records_len = count * TEST_BUFFER_RECORD_LEN;
+
+    assert(read_len >= records_len);
+
+    for (UINT32 i = 0; i < count; ++i) {
+        test_buffer_ring_pid(out, i);
+    }
+
+    if (read_len == records_len)
+        return 0;
+
+    assert(read_len == records_len + FORT_LOG_BUFFER_STAT_SIZE);
+    assert(fort_log_type(out + records_len) == FORT_LOG_TYPE_BUFFER_STAT);
+
+    UINT32 ring_size;
+    UINT32 drop_count;
+    fort_log_buffer_stat_read(out + records_len, &ring_size, &drop_count);
+
+    assert(ring_size == buf->rings[0].size_mask + 1);
+
+    return drop_count;
+}
+
+static void test_buffer_ring_wrap(void)
+{
+    FORT_BUFFER buf;
+    memset(&buf, 0, sizeof(buf));
+
+    fort_buffer_open(&buf);
+    assert(buf.rings != NULL);
+
+    PFORT_BUFFER_RING ring = &buf.rings[0];
+    const UINT32 ring_size = ring->size_mask + 1;
+
+    const ULONG out_len = 2 * ring_size;
+    PCHAR out = malloc(out_len);
+    assert(out != NULL);
+
+    /* The full ring drops the records and reports their count */
+    const UINT32 count = test_buffer_ring_fill(&buf);
+    assert(count == ring_size / TEST_BUFFER_RECORD_SIZE);
+
+    assert(test_buffer_ring_write(&buf) == STATUS_BUFFER_OVERFLOW);
+    assert(buf.drop_count == 2);
+
+    assert(test_buffer_ring_read(&buf, out, out_len, count) == 2);
+    assert(buf.drop_count == 0);
+    assert(ring->tail == ring->head);
+
+    /* The record, which doesn't fit the ring's end, is written from its start */
+    const LONG64 head = ring->head;
+    assert(((UINT32) head & ring->size_mask) + TEST_BUFFER_RECORD_SIZE > ring_size);
+
+    assert(test_buffer_ring_write(&buf) == STATUS_SUCCESS);
+    assert(test_buffer_ring_write(&buf) == STATUS_SUCCESS);
+    assert(ring->head == (head | ring->size_mask) + 1 + 2 * TEST_BUFFER_RECORD_SIZE);
+
+    /* The padding to the ring's end is skipped */
+    assert(test_buffer_ring_read(&buf, out, out_len, 2) == 0);
+    assert(ring->tail == ring->head);
+
+    fort_buffer_close(&buf);
+
+    free(out);
+}
+
+static void test_buffer_ring_commit_race(void)
+{
+    FORT_BUFFER buf;
+    memset(&buf, 0, sizeof(buf));
+
+    fort_buffer_open(&buf);
+    assert(buf.rings != NULL);
+
+    PFORT_BUFFER_RING ring = &buf.rings[0];
+
+    char out[1024];
+
+    /* The producer has reserved the record, but not committed it yet */
+    const LONG64 pos = ring->head;
+    ring->head += TEST_BUFFER_RECORD_SIZE;
+
+    /* The next committed record waits for it */
+    assert(test_buffer_ring_write(&buf) == STATUS_SUCCESS);
+
+    assert(!fort_buffer_log_written(&buf));
+    assert(test_buffer_paths_read(&buf, out, sizeof(out)) == 0);
+    assert(ring->tail == 0);
+
+    const FORT_APP_PATH path = { 0 };
+
+    PFORT_BUFFER_RING_HEADER header =
+            (PFORT_BUFFER_RING_HEADER) (ring->data + ((UINT32) pos & ring->size_mask));
+
+    fort_log_proc_new_write((PCHAR) (header + 1), /*pid=*/456, /*path_id=*/0, &path);
+
+    header->len = TEST_BUFFER_RECORD_LEN;
+    InterlockedExchange(&header->seq, fort_buffer_ring_seq(pos));
+
+    /* The records are read in the reservations' order */
+    assert(fort_buffer_log_written(&buf));
+    assert(test_buffer_ring_read(&buf, out, sizeof(out), 2) == 0);
+
+    assert(test_buffer_ring_pid(out, 0) == 456);
+    assert(test_buffer_ring_pid(out, 1) == 123);
+
+    assert(ring->tail == ring->head);
+
+    fort_buffer_close(&buf);
+}
+
+static void test_buffer_ring_tail(void)
+{
+    FORT_BUFFER buf;
+    memset(&buf, 0, sizeof(buf));
+
+    fort_buffer_open(&buf);
+    assert(buf.rings != NULL);
+
+    PFORT_BUFFER_RING ring = &buf.rings[0];
+    const UINT32 ring_size = ring->size_mask + 1;
+
+    const ULONG out_len = 2 * ring_size;
+    PCHAR out = malloc(out_len);
+    assert(out != NULL);
+
+    /* The positions exceed 32 bits, so the tail is compared whole */
+    const LONG64 start = ((LONG64) 1 << 32) - 2 * TEST_BUFFER_RECORD_SIZE;
+
+    ring->head = start;
+    ring->tail = start;
+
+    for (int i = 0; i < 4; ++i) {
+        assert(test_buffer_ring_write(&buf) == STATUS_SUCCESS);
+    }
+
+    assert(test_buffer_ring_read(&buf, out, out_len, 4) == 0);
+    assert(ring->tail == start + 4 * TEST_BUFFER_RECORD_SIZE);
+
+    const UINT32 count = test_buffer_ring_fill(&buf);
+    assert(count == ring_size / TEST_BUFFER_RECORD_SIZE);
+
+    assert(test_buffer_ring_read(&buf, out, out_len, count) == 1);
+    assert(ring->tail == ring->head);
+
+    fort_buffer_close(&buf);
+
+    free(out);
+}
+
+#define BENCH_ADDR_LIST_COUNT   (2 * 1024 * 1024)
+#define BENCH_ADDR_LOOKUP_COUNT (4 * 1024 * 1024)
+#define BENCH_ADDR_STEP         2039
+
+static PFORT_CONF_ADDR_LIST bench_addr_list_new(BOOL eytzinger)
+{
+    const UINT32 count = BENCH_ADDR_LIST_COUNT;
+
+    PFORT_CONF_ADDR_LIST addr_list =
+            malloc(FORT_CONF_ADDR_LIST_SIZE(count, /*pair4_n=*/0, /*ip6_n=*/0, /*pair6_n=*/0));
+    assert(addr_list != NULL);
+
+    addr_list->ip_n = count;
+    addr_list->eytzinger = eytzinger;
+    addr_list->pair_n = 0;
+
+    UINT32 *order = NULL;
+    if (eytzinger) {
+        order = malloc(count * sizeof(UINT32));
+        assert(order != NULL);
+
+        fort_conf_eytzinger_order(order, count);
+    }
+
+    for (UINT32 i = 0; i < count; ++i) {
+        const UINT32 sorted_index = order ? order[i] : i;
+        addr_list->ip[i] = sorted_index * BENCH_ADDR_STEP;
+    }
+
+    PFORT_CONF_ADDR_LIST addr6_list = (PFORT_CONF_ADDR_LIST) ((PCHAR) addr_list
+            + FORT_CONF_ADDR4_LIST_SIZE(addr_list->ip_n, addr_list->pair_n));
+    addr6_list->ip_n = 0;
+    addr6_list->eytzinger = FALSE;
+    addr6_list->pair_n = 0;
+
+    free(order);
+
+    return addr_list;
+}
+
+static UINT32 bench_addr_list_lookup(PCFORT_CONF_ADDR_LIST addr_list, const char *name)
+{
+    LARGE_INTEGER freq;
+    UINT32 seed = 1;
+    UINT32 found = 0;
+
+    const LARGE_INTEGER start = KeQueryPerformanceCounter(&freq);
+
+    for (int i = 0; i < BENCH_ADDR_LOOKUP_COUNT; ++i) {
+        seed = seed * 1664525 + 1013904223; /* LCG */
+
+        const ip_addr_t ip = { .v4 = (seed % BENCH_ADDR_LIST_COUNT) * BENCH_ADDR_STEP + (i & 1) };
+
+        found += fort_conf_ip_inlist(addr_list, ip, /*isIPv6=*/FALSE);
+    }
+
+    const LARGE_INTEGER end = KeQueryPerformanceCounter(NULL);
+
+    const double nsec = (double) (end.QuadPart - start.QuadPart) * 1e9 / (double) freq.QuadPart;
+
+    printf("bench_addr_list: %s: %.1f ns/lookup (found=%u)\n", name,
+            nsec / BENCH_ADDR_LOOKUP_COUNT, found);
+
+    return found;
+}
+
+static void bench_addr_list(void)
+{
+    PFORT_CONF_ADDR_LIST sorted_list = bench_addr_list_new(/*eytzinger=*/FALSE);
+    PFORT_CONF_ADDR_LIST eytzinger_list = bench_addr_list_new(/*eytzinger=*/TRUE);
+
+    const UINT32 sorted_found = bench_addr_list_lookup(sorted_list, "sorted");
+    const UINT32 eytzinger_found = bench_addr_list_lookup(eytzinger_list, "eytzinger");
+
+    assert(sorted_found == eytzinger_found);
+    assert(sorted_found == BENCH_ADDR_LOOKUP_COUNT / 2);
+
+    free(sorted_list);
+    free(eytzinger_list);
+}
+
 int main(int argc, char *argv[])
 {
-    (void) argc;
-    (void) argv;
+    if (argc > 1 && strcmp(argv[1], "bench") == 0) {
+        bench_addr_list();
+        return 0;
+    }
 
     test_proxycb();
     test_major();
     test_utl_ascii();
     test_utl_bits();
+    test_shaper();
+    test_shaper_wakeups();
+    test_zones_index();
+    test_conf_scope();
+    test_conf_cache();
+    test_conf_linear_find();
+    test_conf_eytzinger();
+    test_buffer_paths_log();
+    test_buffer_paths_ring_bits();
+    test_buffer_paths_limits();
+    test_buffer_ring_wrap();
+    test_buffer_ring_commit_race();
+    test_buffer_ring_tail();
 
     return 0;
 }
@@ -44,6 +44,70 @@ PVOID ExAllocatePool2(POOL_FLAGS flags, SIZE_T size, ULONG tag)
     return HeapAlloc(GetProcessHeap(), 0, size);
 }
 
+PMDL IoAllocateMdl(
+        PVOID virtualAddress, ULONG length, BOOLEAN secondaryBuffer, BOOLEAN chargeQuota, PIRP irp)
+{
+    UNUSED(length);
+    UNUSED(secondaryBuffer);
+    UNUSED(chargeQuota);
+    UNUSED(irp);
+    return virtualAddress;
+}
+
+void IoFreeMdl(PMDL mdl)
+{
+    UNUSED(mdl);
+}
+
+void MmBuildMdlForNonPagedPool(PMDL mdl)
+{
+    UNUSED(mdl);
+}
+
+PVOID MmMapLockedPagesSpecifyCache(PMDL mdl, KPROCESSOR_MODE accessMode,
+        MEMORY_CACHING_TYPE cacheType, PVOID requestedAddress, ULONG bugCheckOnFailure,
+        ULONG priority)
+{
+    UNUSED(accessMode);
+    UNUSED(cacheType);
+    UNUSED(requestedAddress);
+    UNUSED(bugCheckOnFailure);
+    UNUSED(priority);
+    return mdl;
+}
+
+void MmUnmapLockedPages(PVOID baseAddress, PMDL mdl)
+{
+    UNUSED(baseAddress);
+    UNUSED(mdl);
+}
+
+void ExInitializeNPagedLookasideList(PNPAGED_LOOKASIDE_LIST lookaside, PALLOCATE_FUNCTION allocate,
+        PFREE_FUNCTION free, ULONG flags, SIZE_T size, ULONG tag, USHORT depth)
+{
+    UNUSED(allocate);
+    UNUSED(free);
+    UNUSED(flags);
+    UNUSED(depth);
+    lookaside->size = size;
+    lookaside->tag = tag;
+}
+
+void ExDeleteNPagedLookasideList(PNPAGED_LOOKASIDE_LIST lookaside)
+{
+    UNUSED(lookaside);
+}
+
+PVOID ExAllocateFromNPagedLookasideList(PNPAGED_LOOKASIDE_LIST lookaside)
+{
+    return ExAllocatePoolWithTag(NonPagedPoolNx, lookaside->size, lookaside->tag);
+}
+
+void ExFreeToNPagedLookasideList(PNPAGED_LOOKASIDE_LIST lookaside, PVOID entry)
+{
+    ExFreePoolWithTag(entry, lookaside->tag);
+}
+
 PIO_STACK_LOCATION IoGetCurrentIrpStackLocation(PIRP irp)
 {
     UNUSED(irp);
@@ -217,6 +281,28 @@ KIRQL KeGetCurrentIrql(void)
     return 0;
 }
 
+ULONG KeQueryMaximumProcessorCountEx(USHORT groupNumber)
+{
+    UNUSED(groupNumber);
+    return 1;
+}
+
+ULONG KeGetCurrentProcessorNumberEx(PPROCESSOR_NUMBER procNumber)
+{
+    UNUSED(procNumber);
+    return 0;
+}
+
+KIRQL KeRaiseIrqlToDpcLevel(void)
+{
+    return 0;
+}
+
+void KeLowerIrql(KIRQL newIrql)
+{
+    UNUSED(newIrql);
+}
+
 void IoCompleteRequest(PIRP irp, CCHAR priorityBoost)
 {
     UNUSED(irp);
@@ -337,8 +423,12 @@ NTSTATUS PsCreateSystemThread(PHANDLE threadHandle, ULONG desiredAccess,
 
 LARGE_INTEGER KeQueryPerformanceCounter(PLARGE_INTEGER performanceFrequency)
 {
-    UNUSED(performanceFrequency);
-    const LARGE_INTEGER res = { 0 };
+    if (performanceFrequency != NULL) {
+        QueryPerformanceFrequency(performanceFrequency);
+    }
+
+    LARGE_INTEGER res;
+    QueryPerformanceCounter(&res);
     return res;
 }
 
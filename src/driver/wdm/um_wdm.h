@@ -322,6 +322,47 @@ typedef ULONG64 POOL_FLAGS;
 #define POOL_FLAG_PAGED             0x0000000000000100UI64 // Paged pool
 FORT_API PVOID ExAllocatePool2(POOL_FLAGS flags, SIZE_T size, ULONG tag);
 
+#if !defined(PAGE_SIZE)
+#    define PAGE_SIZE 0x1000
+#endif
+
+typedef PVOID MDL, *PMDL;
+
+typedef enum _MEMORY_CACHING_TYPE {
+    MmNonCached = FALSE,
+    MmCached = TRUE,
+} MEMORY_CACHING_TYPE;
+
+#define NormalPagePriority  16
+#define MdlMappingNoExecute 0x40000000
+
+FORT_API PMDL IoAllocateMdl(
+        PVOID virtualAddress, ULONG length, BOOLEAN secondaryBuffer, BOOLEAN chargeQuota, PIRP irp);
+FORT_API void IoFreeMdl(PMDL mdl);
+FORT_API void MmBuildMdlForNonPagedPool(PMDL mdl);
+FORT_API PVOID MmMapLockedPagesSpecifyCache(PMDL mdl, KPROCESSOR_MODE accessMode,
+        MEMORY_CACHING_TYPE cacheType, PVOID requestedAddress, ULONG bugCheckOnFailure,
+        ULONG priority);
+FORT_API void MmUnmapLockedPages(PVOID baseAddress, PMDL mdl);
+
+#define POOL_NX_ALLOCATION 512
+
+typedef struct _NPAGED_LOOKASIDE_LIST
+{
+    SIZE_T size;
+    ULONG tag;
+} NPAGED_LOOKASIDE_LIST, *PNPAGED_LOOKASIDE_LIST;
+
+typedef PVOID PALLOCATE_FUNCTION;
+typedef PVOID PFREE_FUNCTION;
+
+FORT_API void ExInitializeNPagedLookasideList(PNPAGED_LOOKASIDE_LIST lookaside,
+        PALLOCATE_FUNCTION allocate, PFREE_FUNCTION free, ULONG flags, SIZE_T size, ULONG tag,
+        USHORT depth);
+FORT_API void ExDeleteNPagedLookasideList(PNPAGED_LOOKASIDE_LIST lookaside);
+FORT_API PVOID ExAllocateFromNPagedLookasideList(PNPAGED_LOOKASIDE_LIST lookaside);
+FORT_API void ExFreeToNPagedLookasideList(PNPAGED_LOOKASIDE_LIST lookaside, PVOID entry);
+
 FORT_API PIO_STACK_LOCATION IoGetCurrentIrpStackLocation(PIRP irp);
 FORT_API void IoMarkIrpPending(PIRP irp);
 FORT_API PDRIVER_CANCEL IoSetCancelRoutine(PIRP irp, PDRIVER_CANCEL routine);
@@ -374,6 +415,14 @@ FORT_API void ExReleaseSpinLockExclusive(PEX_SPIN_LOCK lock, KIRQL oldIrql);
 
 FORT_API KIRQL KeGetCurrentIrql(void);
 
+FORT_API ULONG KeQueryMaximumProcessorCountEx(USHORT groupNumber);
+FORT_API ULONG KeGetCurrentProcessorNumberEx(PPROCESSOR_NUMBER procNumber);
+
+#define KeMemoryBarrier() MemoryBarrier()
+
+FORT_API KIRQL KeRaiseIrqlToDpcLevel(void);
+FORT_API void KeLowerIrql(KIRQL newIrql);
+
 #define IO_NO_INCREMENT 0
 FORT_API void IoCompleteRequest(PIRP irp, CCHAR priorityBoost);
 
@@ -8,6 +8,7 @@
 #include <log/logbuffer.h>
 #include <log/logentryapp.h>
 #include <log/logentryconn.h>
+#include <log/logentrystattraf.h>
 #include <log/logentrytime.h>
 #include <util/dateutil.h>
 
@@ -183,6 +184,40 @@ TEST_F(LogBufferTest, blockedIp6WriteRead)
     ASSERT_EQ(index, testCount);
 }
 
+TEST_F(LogBufferTest, pathIdWriteRead)
+{
+    const QString path("C:\\test\\");
+
+    const int entrySize = DriverCommon::logConnHeaderSize() * 2 + path.size() * sizeof(wchar_t);
+
+    LogBuffer buf(entrySize);
+
+    const quint32 pathId = 7;
+
+    LogEntryConn entry;
+    entry.setPathId(pathId);
+
+    // Write the path with its id, then the id only
+    entry.setKernelPath(path);
+    buf.writeEntryConn(&entry);
+
+    entry.setKernelPath({});
+    buf.writeEntryConn(&entry);
+
+    // Read
+    ASSERT_EQ(buf.peekEntryType(), FORT_LOG_TYPE_CONN);
+    buf.readEntryConn(&entry);
+    ASSERT_EQ(entry.pathId(), pathId);
+    ASSERT_EQ(entry.kernelPath(), path);
+
+    ASSERT_EQ(buf.peekEntryType(), FORT_LOG_TYPE_CONN);
+    buf.readEntryConn(&entry);
+    ASSERT_EQ(entry.pathId(), pathId);
+    ASSERT_TRUE(entry.kernelPath().isEmpty());
+
+    ASSERT_EQ(buf.peekEntryType(), FORT_LOG_TYPE_NONE);
+}
+
 TEST_F(LogBufferTest, timeWriteRead)
 {
     const int entrySize = DriverCommon::logTimeSize();
@@ -200,3 +235,39 @@ TEST_F(LogBufferTest, timeWriteRead)
     buf.readEntryTime(&entry);
     ASSERT_EQ(entry.unixTime(), unixTime);
 }
+
+TEST_F(LogBufferTest, statTrafWriteRead)
+{
+    const QVector<ProcTraf> procTrafs = {
+        { 4, 0, 1 },
+        { 8, 127, 128 },
+        { 13, 0x123456789ULL, 0xFFFFFFFFFFFFFFFFULL }, // terminated, over 32 bits
+    };
+
+    LogBuffer buf(DriverCommon::logStatSize(DriverCommon::logStatBufferDataSize()));
+
+    LogEntryStatTraf entry(procTrafs);
+
+    // Write
+    buf.writeEntryStatTraf(&entry);
+    buf.writeEntryStatTraf(&entry);
+
+    // Read
+    for (int n = 0; n < 2; ++n) {
+        LogEntryStatTraf readEntry;
+
+        ASSERT_EQ(buf.peekEntryType(), FORT_LOG_TYPE_STAT_TRAF);
+        buf.readEntryStatTraf(&readEntry);
+        ASSERT_EQ(readEntry.procCount(), procTrafs.size());
+
+        for (int i = 0; i < procTrafs.size(); ++i) {
+            const ProcTraf &pt = readEntry.procTrafs().at(i);
+
+            ASSERT_EQ(pt.pidFlag, procTrafs[i].pidFlag);
+            ASSERT_EQ(pt.inBytes, procTrafs[i].inBytes);
+            ASSERT_EQ(pt.outBytes, procTrafs[i].outBytes);
+        }
+    }
+
+    ASSERT_EQ(buf.peekEntryType(), FORT_LOG_TYPE_NONE);
+}
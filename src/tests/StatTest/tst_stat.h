@@ -16,6 +16,7 @@
 #include <log/logentrystattraf.h>
 #include <stat/quotamanager.h>
 #include <stat/statmanager.h>
+#include <stat/statsql.h>
 #include <util/dateutil.h>
 #include <util/fileutil.h>
 #include <util/ioc/ioccontainer.h>
@@ -96,6 +97,47 @@ void debugStatTraf(SqliteDb *sqliteDb)
             "  FROM traffic_app;");
 }
 
+struct TrafSum
+{
+    qint64 rows = 0;
+    qint64 inBytes = 0;
+    qint64 outBytes = 0;
+};
+
+TrafSum selectTrafSum(SqliteDb *sqliteDb, const char *table, qint32 trafTime = 0)
+{
+    const QByteArray sql = QString("SELECT COUNT(*), SUM(in_bytes), SUM(out_bytes) FROM %1"
+                                   "  WHERE ?1 = 0 OR traf_time = ?1;")
+                                   .arg(table)
+                                   .toLatin1();
+
+    TrafSum sum;
+
+    SqliteStmt stmt;
+    if (!stmt.prepare(sqliteDb->db(), sql.constData()))
+        return sum;
+
+    stmt.bindInt(1, trafTime);
+
+    if (stmt.step() == SqliteStmt::StepRow) {
+        sum.rows = stmt.columnInt64(0);
+        sum.inBytes = stmt.columnInt64(1);
+        sum.outBytes = stmt.columnInt64(2);
+    }
+
+    return sum;
+}
+
+void checkTrafSum(SqliteDb *sqliteDb, const char *table, qint32 trafTime, qint64 rows,
+        qint64 inBytes, qint64 outBytes)
+{
+    const TrafSum sum = selectTrafSum(sqliteDb, table, trafTime);
+
+    ASSERT_EQ(sum.rows, rows) << table;
+    ASSERT_EQ(sum.inBytes, inBytes) << table;
+    ASSERT_EQ(sum.outBytes, outBytes) << table;
+}
+
 }
 
 TEST_F(StatTest, dbWriteRead)
@@ -131,9 +173,13 @@ TEST_F(StatTest, dbWriteRead)
 
     // Add app traffics
     {
-        const quint32 trafBytes[procCount * 3] = { 10, 100, 200, 20, 300, 400, 30, 500, 600 };
+        const QVector<ProcTraf> procTrafs = {
+            { 10, 100, 200 },
+            { 20, 300, 400 },
+            { 30, 500, 600 },
+        };
 
-        LogEntryStatTraf entry(procCount, trafBytes);
+        LogEntryStatTraf entry(procTrafs);
         statManager.logStatTraf(entry);
         statManager.logStatTraf(entry);
     }
@@ -142,17 +188,111 @@ TEST_F(StatTest, dbWriteRead)
 
     // Delete apps
     {
-        const quint32 trafBytes[procCount * 3] = { 11, 10, 20, 21, 30, 40, 31, 50, 60 };
+        const QVector<ProcTraf> procTrafs = { { 11, 10, 20 }, { 21, 30, 40 }, { 31, 50, 60 } };
 
-        LogEntryStatTraf entry(procCount, trafBytes);
+        LogEntryStatTraf entry(procTrafs);
         statManager.logStatTraf(entry);
     }
 
+    statManager.flushTraffic();
+
     qDebug() << "elapsed>" << timer.elapsed() << "msec";
 
     debugStatTraf(statManager.sqliteDb());
 }
 
+TEST_F(StatTest, logStatTrafFlush)
+{
+    IocContainer ioc;
+    ioc.pinToThread();
+
+    NiceMock<MockQuotaManager> quotaManager;
+    ioc.set<QuotaManager>(quotaManager);
+
+    FirewallConf conf;
+    conf.setLogStat(true);
+
+    StatManager statManager(":memory:");
+    statManager.setConf(&conf);
+    statManager.setUp();
+
+    QSignalSpy appCreatedSpy(&statManager, &StatManager::appCreated);
+
+    // More apps than the rows of one upsert statement
+    constexpr int appsCount = 300;
+
+    const qint64 hourTime = QDateTime(QDate(2024, 3, 12), QTime(10, 0, 30)).toSecsSinceEpoch();
+    const qint64 nextHourTime = hourTime + 60 * 60;
+
+    QVector<ProcTraf> procTrafs;
+    for (int i = 1; i <= appsCount; ++i) {
+        const quint32 pid = quint32(i) * 4;
+
+        LogEntryProcNew entry(pid, QString("C:\\test\\app%1.exe").arg(i));
+        ASSERT_TRUE(statManager.logProcNew(entry, hourTime));
+
+        procTrafs.append({ pid, quint64(i), quint64(2 * i) });
+    }
+
+    // 3 ticks in the hour, then 2 ticks in the next one
+    const LogEntryStatTraf entry(procTrafs);
+
+    for (const qint64 unixTime :
+            { hourTime, hourTime + 60, hourTime + 120, nextHourTime, nextHourTime + 60 }) {
+        ASSERT_TRUE(statManager.logStatTraf(entry, unixTime));
+    }
+
+    statManager.flushTraffic();
+
+    ASSERT_EQ(appCreatedSpy.count(), appsCount);
+
+    SqliteDb *sqliteDb = statManager.sqliteDb();
+
+    constexpr qint64 tickInBytes = qint64(appsCount) * (appsCount + 1) / 2;
+    constexpr qint64 tickOutBytes = 2 * tickInBytes;
+
+    const qint32 trafHour = DateUtil::getUnixHour(hourTime);
+    const qint32 nextTrafHour = DateUtil::getUnixHour(nextHourTime);
+    const qint32 trafDay = DateUtil::getUnixDay(hourTime);
+    const qint32 trafMonth = DateUtil::getUnixMonth(hourTime, conf.ini().monthStart());
+
+    ASSERT_NE(trafHour, nextTrafHour);
+    ASSERT_EQ(DateUtil::getUnixDay(nextHourTime), trafDay);
+
+    // Apps' traffic
+    checkTrafSum(sqliteDb, "traffic_app_hour", trafHour, appsCount, 3 * tickInBytes,
+            3 * tickOutBytes);
+    checkTrafSum(sqliteDb, "traffic_app_hour", nextTrafHour, appsCount, 2 * tickInBytes,
+            2 * tickOutBytes);
+    checkTrafSum(sqliteDb, "traffic_app_hour", 0, 2 * appsCount, 5 * tickInBytes,
+            5 * tickOutBytes);
+    checkTrafSum(sqliteDb, "traffic_app_day", trafDay, appsCount, 5 * tickInBytes,
+            5 * tickOutBytes);
+    checkTrafSum(sqliteDb, "traffic_app_month", trafMonth, appsCount, 5 * tickInBytes,
+            5 * tickOutBytes);
+    checkTrafSum(sqliteDb, "traffic_app", 0, appsCount, 5 * tickInBytes, 5 * tickOutBytes);
+
+    // Sum traffic
+    checkTrafSum(sqliteDb, "traffic_hour", trafHour, 1, 3 * tickInBytes, 3 * tickOutBytes);
+    checkTrafSum(sqliteDb, "traffic_hour", nextTrafHour, 1, 2 * tickInBytes, 2 * tickOutBytes);
+    checkTrafSum(sqliteDb, "traffic_day", trafDay, 1, 5 * tickInBytes, 5 * tickOutBytes);
+    checkTrafSum(sqliteDb, "traffic_month", trafMonth, 1, 5 * tickInBytes, 5 * tickOutBytes);
+
+    // The last app's traffic
+    SqliteStmt stmt;
+    ASSERT_TRUE(stmt.prepare(sqliteDb->db(), "SELECT app_id FROM app WHERE path = ?1;"));
+
+    stmt.bindText(1, QString("C:\\test\\app%1.exe").arg(appsCount));
+    ASSERT_EQ(stmt.step(), SqliteStmt::StepRow);
+
+    const qint64 lastAppId = stmt.columnInt64(0);
+    qint64 inBytes, outBytes;
+
+    statManager.getTraffic(StatSql::sqlSelectTrafAppTotal, 1, inBytes, outBytes, lastAppId);
+    ASSERT_EQ(inBytes, 5 * appsCount);
+    ASSERT_EQ(outBytes, 5 * 2 * appsCount);
+}
+
 TEST_F(StatTest, monthStart)
 {
     const QDate d1(2018, 1, 8);
@@ -5,6 +5,7 @@
 #include <googletest.h>
 
 #include <conf/addressgroup.h>
+#include <conf/app.h>
 #include <conf/appgroup.h>
 #include <conf/confrulemanager.h>
 #include <conf/firewallconf.h>
@@ -16,6 +17,7 @@
 #include <util/conf/confbuffer.h>
 #include <util/conf/confruleswalker.h>
 #include <util/fileutil.h>
+#include <util/net/iprange.h>
 #include <util/net/netformatutil.h>
 #include <util/net/netutil.h>
 #include <util/stringutil.h>
@@ -339,6 +341,15 @@ TEST_F(ConfUtilTest, rulesOneFilter)
     // Check the buffer
     const char *data = confBuf.data();
 
+    // Used filter types
+    {
+        const quint32 filterTypes = DriverCommon::confRulesFilterTypes(data);
+
+        ASSERT_NE(filterTypes & (1u << FORT_RULE_FILTER_TYPE_ADDRESS), 0);
+        ASSERT_NE(filterTypes & (1u << FORT_RULE_FILTER_TYPE_PORT), 0);
+        ASSERT_EQ(filterTypes & (1u << FORT_RULE_FILTER_TYPE_LOCAL_PORT), 0);
+    }
+
     // Blocked IP
     {
         FORT_CONF_META_CONN conn = {
@@ -647,3 +658,393 @@ TEST_F(ConfUtilTest, ruleFilterAction)
         ASSERT_FALSE(DriverCommon::confRulesConnBlocked(data, &conn, /*ruleId=*/1));
     }
 }
+
+TEST_F(ConfUtilTest, rulesNotNestedList)
+{
+    static Rule g_rules[] = {
+        {
+                .blocked = true,
+                .ruleId = 1,
+                .ruleText = "!dir(IN):{tcp(80)\n"
+                            "udp(53)}\n",
+        },
+    };
+
+    class TestRules : public ConfRulesWalker
+    {
+    public:
+        bool walkRules(
+                WalkRulesArgs &wra, const std::function<walkRulesCallback> &func) const override
+        {
+            wra.maxRuleId = 1;
+
+            return walkRulesLoop(func);
+        }
+
+    private:
+        bool walkRulesLoop(const std::function<walkRulesCallback> &func) const
+        {
+            for (const auto &rule : g_rules) {
+                if (!func(rule))
+                    return false;
+            }
+
+            return true;
+        }
+    };
+
+    TestRules testRules;
+
+    ConfBuffer confBuf;
+
+    if (!confBuf.writeRules(testRules)) {
+        qCritical() << "Error:" << confBuf.errorMessage();
+        Q_UNREACHABLE();
+    }
+
+    // Check the buffer
+    const char *data = confBuf.data();
+
+    // Blocked TCP Port
+    {
+        FORT_CONF_META_CONN conn = {
+            .inbound = false,
+            .ip_proto = IpProto_TCP,
+            .remote_port = 80,
+        };
+
+        ASSERT_TRUE(DriverCommon::confRulesConnBlocked(data, &conn, /*ruleId=*/1));
+    }
+
+    // Blocked UDP Port
+    {
+        FORT_CONF_META_CONN conn = {
+            .inbound = false,
+            .ip_proto = IpProto_UDP,
+            .remote_port = 53,
+        };
+
+        ASSERT_TRUE(DriverCommon::confRulesConnBlocked(data, &conn, /*ruleId=*/1));
+    }
+
+    // Allowed Direction
+    {
+        FORT_CONF_META_CONN conn = {
+            .inbound = true,
+            .ip_proto = IpProto_TCP,
+            .remote_port = 80,
+        };
+
+        ASSERT_FALSE(DriverCommon::confRulesConnBlocked(data, &conn, /*ruleId=*/1));
+    }
+
+    // Allowed Port
+    {
+        FORT_CONF_META_CONN conn = {
+            .inbound = false,
+            .ip_proto = IpProto_TCP,
+            .remote_port = 443,
+        };
+
+        ASSERT_FALSE(DriverCommon::confRulesConnBlocked(data, &conn, /*ruleId=*/1));
+    }
+}
+
+TEST_F(ConfUtilTest, zonesWriteRead)
+{
+    const QStringList zonesText = { "10.0.0.0/8\n::1\n", "10.1.0.0/16\n192.168.0.1\n" };
+
+    constexpr quint32 zonesMask = (1 << 0) | (1 << 2); // Zones: 1, 3
+
+    QList<QByteArray> zonesData;
+    quint32 dataSize = 0;
+
+    for (const QString &text : zonesText) {
+        IpRange ipRange;
+        ASSERT_TRUE(ipRange.fromText(text));
+
+        ConfBuffer confBuf;
+        confBuf.writeZone(ipRange);
+
+        zonesData.append(confBuf.buffer());
+        dataSize += confBuf.buffer().size();
+    }
+
+    ConfBuffer confBuf;
+    confBuf.writeZones(zonesMask, /*enabledMask=*/zonesMask, dataSize, zonesData);
+
+    const char *data = confBuf.data();
+
+    const auto zoneIdIp4 = [&](const char *ip, quint32 mask) {
+        const ip_addr_t ip_addr = { .v4 = NetFormatUtil::textToIp4(ip) };
+        return DriverCommon::confZonesIpIncluded(data, ip_addr, /*isIPv6=*/false, mask);
+    };
+
+    ASSERT_EQ(zoneIdIp4("10.1.2.3", zonesMask), 1);
+    ASSERT_EQ(zoneIdIp4("10.1.2.3", (1 << 2)), 3);
+    ASSERT_EQ(zoneIdIp4("10.2.0.0", (1 << 2)), 0);
+    ASSERT_EQ(zoneIdIp4("10.255.255.255", zonesMask), 1);
+    ASSERT_EQ(zoneIdIp4("11.0.0.0", zonesMask), 0);
+    ASSERT_EQ(zoneIdIp4("192.168.0.1", zonesMask), 3);
+    ASSERT_EQ(zoneIdIp4("192.168.0.2", zonesMask), 0);
+
+    const ip_addr_t ip6_addr = { .v6 = NetFormatUtil::textToIp6("::1") };
+    ASSERT_EQ(DriverCommon::confZonesIpIncluded(data, ip6_addr, /*isIPv6=*/true, zonesMask), 1);
+    ASSERT_EQ(DriverCommon::confZonesIpIncluded(data, ip6_addr, /*isIPv6=*/true, (1 << 2)), 0);
+
+    // Disable the Zone 1
+    PFORT_CONF_ZONES(confBuf.data())->enabled_mask = (1 << 2);
+
+    ASSERT_EQ(zoneIdIp4("10.1.2.3", zonesMask), 3);
+    ASSERT_EQ(zoneIdIp4("10.2.0.0", zonesMask), 0);
+}
+
+TEST_F(ConfUtilTest, zoneUpdateWriteRead)
+{
+    const QStringList zonesText = { "10.0.0.0/8\n::1\n", "10.1.0.0/16\n192.168.0.1\n" };
+
+    QList<QByteArray> zonesData;
+
+    for (const QString &text : zonesText) {
+        IpRange ipRange;
+        ASSERT_TRUE(ipRange.fromText(text));
+
+        ConfBuffer confBuf;
+        confBuf.writeZone(ipRange);
+
+        zonesData.append(confBuf.buffer());
+    }
+
+    const auto zoneIdIp4 = [&](const char *data, const char *ip) {
+        const ip_addr_t ip_addr = { .v4 = NetFormatUtil::textToIp4(ip) };
+        return DriverCommon::confZoneIpIncluded(data, ip_addr, /*isIPv6=*/false);
+    };
+
+    // Zone 3 alone
+    {
+        ConfBuffer confBuf;
+        ASSERT_TRUE(confBuf.writeZoneUpdate(/*zoneId=*/3, /*enabled=*/true, zonesData[1]));
+
+        const QByteArray &buf = confBuf.buffer();
+        ASSERT_TRUE(DriverCommon::confZoneValid(buf.data(), buf.size()));
+        ASSERT_FALSE(DriverCommon::confZoneValid(buf.data(), buf.size() - 1));
+
+        ASSERT_EQ(zoneIdIp4(buf.data(), "10.1.2.3"), 3);
+        ASSERT_EQ(zoneIdIp4(buf.data(), "192.168.0.1"), 3);
+        ASSERT_EQ(zoneIdIp4(buf.data(), "10.2.0.0"), 0);
+    }
+
+    // Zone 3 with the addresses' counts beyond its size
+    {
+        ConfBuffer confBuf;
+        ASSERT_TRUE(confBuf.writeZoneUpdate(/*zoneId=*/3, /*enabled=*/true, zonesData[1]));
+
+        QByteArray buf = confBuf.buffer();
+        PFORT_CONF_ZONE zone = PFORT_CONF_ZONE(buf.data());
+        PFORT_CONF_ADDR_LIST addrList = PFORT_CONF_ADDR_LIST(zone->data);
+
+        addrList->pair_n += 1;
+        ASSERT_FALSE(DriverCommon::confZoneValid(buf.data(), buf.size()));
+        addrList->pair_n -= 1;
+
+        PFORT_CONF_ADDR_LIST addr6List = PFORT_CONF_ADDR_LIST(
+                zone->data + FORT_CONF_ADDR4_LIST_SIZE(addrList->ip_n, addrList->pair_n));
+
+        addr6List->ip_n += 1;
+        ASSERT_FALSE(DriverCommon::confZoneValid(buf.data(), buf.size()));
+        addr6List->ip_n -= 1;
+
+        addrList->ip_n = 0x7FFFFFFF;
+        ASSERT_FALSE(DriverCommon::confZoneValid(buf.data(), buf.size()));
+    }
+
+    // Zone 1 removed
+    {
+        ConfBuffer confBuf;
+        ASSERT_TRUE(confBuf.writeZoneUpdate(/*zoneId=*/1, /*enabled=*/true, QByteArray()));
+
+        const QByteArray &buf = confBuf.buffer();
+        ASSERT_TRUE(DriverCommon::confZoneValid(buf.data(), buf.size()));
+
+        ASSERT_EQ(zoneIdIp4(buf.data(), "10.2.0.0"), 0);
+    }
+}
+
+TEST_F(ConfUtilTest, zoneEytzingerWriteRead)
+{
+    constexpr int ipCount = FORT_CONF_ADDR_LIST_EYTZINGER_MIN + 3;
+
+    QString text;
+    for (int i = 0; i < ipCount; ++i) {
+        text += NetFormatUtil::ip4ToText(0x0A000000 + i * 3) + '\n';
+    }
+
+    IpRange ipRange;
+    ASSERT_TRUE(ipRange.fromText(text));
+    ASSERT_EQ(ipRange.ip4Size(), ipCount);
+
+    ConfBuffer confBuf;
+    confBuf.writeZone(ipRange);
+
+    ASSERT_TRUE(PCFORT_CONF_ADDR_LIST(confBuf.data())->eytzinger);
+
+    IpRange loadedRange;
+    ASSERT_TRUE(confBuf.loadZone(loadedRange));
+
+    ASSERT_EQ(loadedRange.ip4Array(), ipRange.ip4Array());
+}
+
+TEST_F(ConfUtilTest, wildAppsIndex)
+{
+    EnvManager envManager;
+    FirewallConf conf;
+
+    AppGroup *appGroup1 = new AppGroup();
+    appGroup1->setName("Base");
+    appGroup1->setEnabled(true);
+    appGroup1->setAllowText("C:\\Users\\*\\AppData\\Local\\*.exe\n"
+                            "**\\Tools\\svc.exe\n"
+                            "**\\Portable\\**\n");
+
+    AppGroup *appGroup2 = new AppGroup();
+    appGroup2->setName("Scripts");
+    appGroup2->setEnabled(true);
+    appGroup2->setAllowText("**\\Scripts\\python?.exe\n"
+                            "D:\\Games\\*\\Bin\\**\n");
+
+    conf.addAppGroup(appGroup1);
+    conf.addAppGroup(appGroup2);
+
+    conf.resetEdited(FirewallConf::AllEdited);
+    conf.prepareToSave();
+
+    ConfBuffer confBuf;
+    ASSERT_TRUE(confBuf.writeConf(conf, nullptr, envManager));
+
+    const char *data = confBuf.data() + DriverCommon::confIoConfOff();
+
+    ASSERT_NE(PCFORT_CONF(data)->wild_index_off, 0);
+
+    const auto appGroupIndex = [&](const char *path) {
+        const auto appData = DriverCommon::confAppFind(data, FileUtil::pathToKernelPath(path));
+        return appData.flags.found ? int(appData.group_index) : -1;
+    };
+
+    ASSERT_EQ(appGroupIndex("C:\\Users\\Test\\AppData\\Local\\app.exe"), 0);
+    ASSERT_EQ(appGroupIndex("C:\\Users\\Test\\AppData\\Roaming\\app.exe"), -1);
+    ASSERT_EQ(appGroupIndex("C:\\Tools\\svc.exe"), 0);
+    ASSERT_EQ(appGroupIndex("C:\\Portable\\App\\app.exe"), 0);
+    ASSERT_EQ(appGroupIndex("E:\\Scripts\\python3.exe"), 1);
+    ASSERT_EQ(appGroupIndex("E:\\Scripts\\python.exe"), -1);
+    ASSERT_EQ(appGroupIndex("D:\\Games\\Test\\Bin\\game.exe"), 1);
+    ASSERT_EQ(appGroupIndex("D:\\Games\\game.exe"), -1);
+}
+
+TEST_F(ConfUtilTest, confDeltaWriteApply)
+{
+    EnvManager envManager;
+    FirewallConf conf;
+
+    AddressGroup *inetGroup = conf.inetAddressGroup();
+    inetGroup->setIncludeAll(true);
+    inetGroup->setExcludeText("10.0.0.0/8");
+
+    AppGroup *appGroup1 = new AppGroup();
+    appGroup1->setName("Base");
+    appGroup1->setEnabled(true);
+    appGroup1->setAllowText("**\\Tools\\*.exe\n");
+
+    AppGroup *appGroup2 = new AppGroup();
+    appGroup2->setName("Scripts");
+    appGroup2->setEnabled(true);
+    appGroup2->setAllowText("**\\Scripts\\python?.exe\n");
+
+    conf.addAppGroup(appGroup1);
+    conf.addAppGroup(appGroup2);
+
+    conf.resetEdited(FirewallConf::AllEdited);
+    conf.prepareToSave();
+
+    ConfBuffer confBuf;
+    ASSERT_TRUE(confBuf.writeConf(conf, nullptr, envManager));
+
+    const char *confData = confBuf.data() + DriverCommon::confIoConfOff();
+
+    // Change the wildcard apps
+    appGroup2->setAllowText("**\\Scripts\\node.exe\n");
+
+    const WriteConfDeltaArgs wda = { .wildApps = true };
+
+    ConfBuffer deltaBuf;
+    ASSERT_TRUE(deltaBuf.writeConfDelta(conf, wda, nullptr, envManager));
+    ASSERT_FALSE(deltaBuf.wildExeApps());
+
+    const char *deltaData = deltaBuf.data();
+
+    ASSERT_TRUE(DriverCommon::confDeltaValid(deltaData, deltaBuf.buffer().size()));
+    ASSERT_EQ(PCFORT_CONF_DELTA(deltaData)->ops_n, 1);
+
+    // A looping bucket chain of the wildcard apps' index is rejected
+    {
+        QByteArray badDelta = deltaBuf.buffer();
+
+        PFORT_CONF_DELTA_OP op = PFORT_CONF_DELTA_OP(PFORT_CONF_DELTA(badDelta.data())->data);
+        PFORT_CONF_DELTA_WILD_APPS wildApps = PFORT_CONF_DELTA_WILD_APPS(op->data);
+        ASSERT_NE(wildApps->wild_index_off, 0);
+
+        PFORT_CONF_WILD_INDEX wildIndex =
+                PFORT_CONF_WILD_INDEX(wildApps->data + wildApps->wild_index_off);
+        PFORT_CONF_WILD_ENTRY(wildIndex->data)[0].next = 1;
+
+        ASSERT_FALSE(DriverCommon::confDeltaValid(badDelta.constData(), badDelta.size()));
+    }
+
+    const QByteArray newConf = DriverCommon::confDeltaApply(confData, deltaData);
+    ASSERT_FALSE(newConf.isEmpty());
+
+    const char *data = newConf.constData();
+
+    // The address groups are kept
+    ASSERT_TRUE(DriverCommon::confIp4InRange(data, NetFormatUtil::textToIp4("10.0.0.1")));
+    ASSERT_FALSE(DriverCommon::confIp4InRange(data, NetFormatUtil::textToIp4("192.168.0.1")));
+
+    const auto appGroupIndex = [&](const char *path) {
+        const auto appData = DriverCommon::confAppFind(data, FileUtil::pathToKernelPath(path));
+        return appData.flags.found ? int(appData.group_index) : -1;
+    };
+
+    ASSERT_EQ(appGroupIndex("C:\\Tools\\app.exe"), 0);
+    ASSERT_EQ(appGroupIndex("E:\\Scripts\\python3.exe"), -1);
+    ASSERT_EQ(appGroupIndex("E:\\Scripts\\node.exe"), 1);
+
+}
+
+TEST_F(ConfUtilTest, appsBatchWrite)
+{
+    App app1;
+    app1.appPath = "C:\\Tools\\app1.exe";
+    app1.blocked = true;
+
+    App app2;
+    app2.appPath = "C:\\Tools\\app2.exe";
+
+    const QVector<App> apps = { app1, app2 };
+    const QStringList deletedAppPaths = { "C:\\Tools\\old.exe" };
+
+    ConfBuffer confBuf;
+    ASSERT_TRUE(confBuf.writeAppsBatch(apps, deletedAppPaths));
+
+    const int size = confBuf.buffer().size();
+    const char *data = confBuf.data();
+
+    PCFORT_CONF_APPS_BATCH appsBatch = PCFORT_CONF_APPS_BATCH(data);
+    ASSERT_EQ(appsBatch->del_apps_n, 1);
+    ASSERT_EQ(appsBatch->add_apps_n, 2);
+
+    ASSERT_TRUE(DriverCommon::confAppsBatchValid(data, size));
+    ASSERT_FALSE(DriverCommon::confAppsBatchValid(data, size - 1));
+
+    PCFORT_APP_ENTRY addedEntry = PCFORT_APP_ENTRY(appsBatch->data + appsBatch->add_apps_off);
+    ASSERT_TRUE(addedEntry->app_data.flags.found);
+    ASSERT_TRUE(addedEntry->app_data.flags.blocked);
+}
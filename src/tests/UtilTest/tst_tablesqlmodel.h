@@ -0,0 +1,306 @@
+#pragma once
+
+#include <QDebug>
+#include <QSignalSpy>
+#include <QTemporaryDir>
+
+#include <googletest.h>
+
+#include <sqlite/sqlitedb.h>
+#include <sqlite/sqlitestmt.h>
+
+#include <util/model/tablesqljob.h>
+#include <util/model/tablesqlloader.h>
+#include <util/model/tablesqlmodel.h>
+#include <util/model/tablesqlrows.h>
+
+namespace {
+
+constexpr int itemCount = 1000;
+
+struct ItemRow : TableRow
+{
+    qint64 id = 0;
+    qint64 value = 0;
+};
+
+class ItemSqlModel : public TableSqlModel
+{
+public:
+    explicit ItemSqlModel(SqliteDb *sqliteDb) : m_sqliteDb(sqliteDb) { }
+
+    SqliteDb *sqliteDb() const override { return m_sqliteDb; }
+
+    int columnCount(const QModelIndex & /*parent*/ = {}) const override { return 1; }
+
+    QVariant data(const QModelIndex & /*index*/, int /*role*/ = Qt::DisplayRole) const override
+    {
+        return {};
+    }
+
+    const ItemRow &itemRowAt(int row) const
+    {
+        updateRowCache(row);
+
+        return m_itemRow;
+    }
+
+    int blockFirst() const { return rowsBlockFirst(); }
+
+    void setupLoader() { setupSqlLoader(); }
+
+    bool isLoading(int row) const { return isRowLoading(row); }
+
+    void invalidateRange(int firstRow, int lastRow = INT_MAX) const
+    {
+        invalidateRowCacheRange(firstRow, lastRow);
+    }
+
+protected:
+    TableSqlRowsPtr createTableRows() const override
+    {
+        return TableSqlRowsPtr(new TableSqlRowList<ItemRow>(&fillItemRow));
+    }
+
+    bool loadTableRow(const TableSqlRows &rows, int blockIndex) const override
+    {
+        m_itemRow = static_cast<const TableSqlRowList<ItemRow> &>(rows).at(blockIndex);
+
+        return true;
+    }
+
+    TableRow &tableRow() const override { return m_itemRow; }
+
+    QString sqlBase() const override { return "SELECT id, value, name FROM item"; }
+
+    QString sqlOrderColumn() const override
+    {
+        return "name" + sqlOrderAsc() + ", id" + sqlOrderAsc();
+    }
+
+    QStringList sqlKeysetColumns() const override { return { "name", "id" }; }
+
+private:
+    static void fillItemRow(ItemRow &itemRow, SqliteStmt &stmt)
+    {
+        itemRow.id = stmt.columnInt64(0);
+        itemRow.value = stmt.columnInt64(1);
+    }
+
+private:
+    SqliteDb *m_sqliteDb = nullptr;
+
+    mutable ItemRow m_itemRow;
+};
+
+bool createItemTable(SqliteDb &sqliteDb)
+{
+    return sqliteDb.open()
+            && sqliteDb.execute("CREATE TABLE item("
+                                "  id INTEGER PRIMARY KEY,"
+                                "  name TEXT NOT NULL,"
+                                "  value INTEGER NOT NULL"
+                                ");")
+            && sqliteDb.execute("WITH RECURSIVE n(i) AS ("
+                                "  SELECT 1 UNION ALL SELECT i + 1 FROM n WHERE i < 1000"
+                                ")"
+                                "INSERT INTO item(id, name, value)"
+                                "  SELECT i, printf('name%04d', (i - 1) / 2), i FROM n;");
+}
+
+bool waitSignals(QSignalSpy &spy, int count)
+{
+    while (spy.count() < count) {
+        if (!spy.wait(5000))
+            return false;
+    }
+    return true;
+}
+
+// Item's id at the row: 2 items per name, ordered by the name and id
+qint64 itemIdAt(int row, bool isAscending)
+{
+    return isAscending ? (row + 1) : (itemCount - row);
+}
+
+}
+
+class TableSqlModelTest : public Test
+{
+    // Test interface
+protected:
+    void SetUp();
+    void TearDown();
+
+    SqliteDb m_sqliteDb { ":memory:" };
+};
+
+void TableSqlModelTest::SetUp()
+{
+    ASSERT_TRUE(createItemTable(m_sqliteDb));
+}
+
+void TableSqlModelTest::TearDown()
+{
+    m_sqliteDb.close();
+}
+
+TEST_F(TableSqlModelTest, keysetPaging)
+{
+    ItemSqlModel model(&m_sqliteDb);
+
+    for (const auto order : { Qt::AscendingOrder, Qt::DescendingOrder }) {
+        model.sort(0, order);
+
+        const bool isAscending = (order == Qt::AscendingOrder);
+
+        ASSERT_EQ(model.rowCount(), itemCount);
+
+        // Scroll down by the keyset of the cached previous row
+        for (int row = 0; row < itemCount; ++row) {
+            ASSERT_EQ(model.itemRowAt(row).id, itemIdAt(row, isAscending));
+        }
+
+        // Scroll up by the offset
+        for (int row = itemCount - 1; row >= 0; --row) {
+            ASSERT_EQ(model.itemRowAt(row).id, itemIdAt(row, isAscending));
+        }
+    }
+}
+
+TEST_F(TableSqlModelTest, rowsBlockCache)
+{
+    ItemSqlModel model(&m_sqliteDb);
+    model.sort(0, Qt::AscendingOrder);
+
+    ASSERT_EQ(model.itemRowAt(0).id, 1);
+    ASSERT_EQ(model.blockFirst(), 0);
+
+    // The changed rows are invisible until the invalidation
+    ASSERT_TRUE(m_sqliteDb.execute("UPDATE item SET value = 0;"));
+
+    ASSERT_EQ(model.itemRowAt(255).value, 256);
+    ASSERT_EQ(model.blockFirst(), 0);
+
+    // The next block is seeked after the cached row, so the deleted rows don't shift it
+    ASSERT_TRUE(m_sqliteDb.execute("DELETE FROM item WHERE id BETWEEN 2 AND 5;"));
+
+    const ItemRow &nextRow = model.itemRowAt(256);
+    ASSERT_EQ(nextRow.id, 257);
+    ASSERT_EQ(nextRow.value, 0);
+    ASSERT_EQ(model.blockFirst(), 256 - 16);
+
+    // The block starts right after the keyset's row
+    ASSERT_EQ(model.itemRowAt(240).id, 241);
+}
+
+TEST_F(TableSqlModelTest, rowsBlockInvalidateRange)
+{
+    ItemSqlModel model(&m_sqliteDb);
+    model.sort(0, Qt::AscendingOrder);
+
+    ASSERT_EQ(model.itemRowAt(100).value, 101);
+
+    ASSERT_TRUE(m_sqliteDb.execute("UPDATE item SET value = 0;"));
+
+    // The range after the block keeps it
+    model.invalidateRange(500);
+
+    ASSERT_EQ(model.itemRowAt(100).value, 101);
+    ASSERT_EQ(model.itemRowAt(101).value, 102);
+
+    // The range in the block drops it
+    model.invalidateRange(200, 300);
+
+    ASSERT_EQ(model.itemRowAt(102).value, 0);
+
+    // The next block after the dropped one is fetched by the offset
+    ASSERT_TRUE(m_sqliteDb.execute("DELETE FROM item WHERE id BETWEEN 2 AND 5;"));
+
+    model.invalidateRange(0);
+
+    ASSERT_EQ(model.itemRowAt(300).id, 305);
+}
+
+TEST_F(TableSqlModelTest, sqlJobCancel)
+{
+    QTemporaryDir tempDir;
+    const QString filePath = tempDir.filePath("items.db");
+
+    SqliteDb sqliteDb(filePath);
+    ASSERT_TRUE(createItemTable(sqliteDb));
+
+    TableSqlLoader loader(filePath);
+    ASSERT_TRUE(loader.open());
+
+    QSignalSpy jobFinishedSpy(&loader, &TableSqlLoader::jobFinished);
+
+    const auto countSql = "SELECT COUNT(*) FROM item;";
+
+    // The cancelled job is not run
+    const auto cancelledJob = TableSqlJobPtr::create(countSql, QVariantHash());
+    loader.cancelJob(cancelledJob.data());
+    loader.enqueueJob(cancelledJob);
+
+    const auto failedJob = TableSqlJobPtr::create("SELECT COUNT(*) FROM missing;", QVariantHash());
+    loader.enqueueJob(failedJob);
+
+    const auto countJob = TableSqlJobPtr::create(countSql, QVariantHash());
+    loader.enqueueJob(countJob);
+
+    ASSERT_TRUE(waitSignals(jobFinishedSpy, 2));
+
+    ASSERT_FALSE(cancelledJob->isFinished());
+
+    // The failed count is not taken as zero rows
+    ASSERT_TRUE(failedJob->isFinished());
+    ASSERT_FALSE(failedJob->isOk());
+
+    ASSERT_TRUE(countJob->isFinished());
+    ASSERT_TRUE(countJob->isOk());
+    ASSERT_EQ(countJob->resultCount(), itemCount);
+}
+
+TEST_F(TableSqlModelTest, staleRowsBlockReplace)
+{
+    QTemporaryDir tempDir;
+    const QString filePath = tempDir.filePath("items.db");
+
+    SqliteDb sqliteDb(filePath);
+    ASSERT_TRUE(createItemTable(sqliteDb));
+
+    ItemSqlModel model(&sqliteDb);
+    model.setupLoader();
+    model.sort(0, Qt::AscendingOrder);
+
+    ASSERT_TRUE(model.isAsyncLoad());
+
+    QSignalSpy rowsInsertedSpy(&model, &QAbstractItemModel::rowsInserted);
+    QSignalSpy dataChangedSpy(&model, &QAbstractItemModel::dataChanged);
+
+    // The count is loaded in the background
+    ASSERT_EQ(model.rowCount(), 0);
+    ASSERT_TRUE(waitSignals(rowsInsertedSpy, 1));
+    ASSERT_EQ(model.rowCount(), itemCount);
+
+    // The placeholder is replaced by the loaded row
+    ASSERT_TRUE(model.isLoading(100));
+    ASSERT_TRUE(waitSignals(dataChangedSpy, 1));
+    ASSERT_FALSE(model.isLoading(100));
+    ASSERT_EQ(model.itemRowAt(100).value, 101);
+
+    ASSERT_TRUE(sqliteDb.execute("UPDATE item SET value = 0;"));
+
+    model.invalidateRange(0, 200);
+
+    // The stale row is shown, while the block is reloading
+    ASSERT_FALSE(model.isLoading(100));
+    ASSERT_EQ(model.itemRowAt(100).value, 101);
+
+    ASSERT_TRUE(waitSignals(dataChangedSpy, 2));
+    ASSERT_FALSE(model.isLoading(100));
+    ASSERT_EQ(model.itemRowAt(100).value, 0);
+
+    // The rows count is kept
+    ASSERT_EQ(model.rowCount(), itemCount);
+}
@@ -159,6 +159,13 @@ int SqliteDb::changes() const
     return sqlite3_changes(m_db);
 }
 
+void SqliteDb::interrupt()
+{
+    if (m_db) {
+        sqlite3_interrupt(m_db);
+    }
+}
+
 bool SqliteDb::beginTransaction()
 {
     return execute("BEGIN;");
@@ -684,7 +691,9 @@ bool SqliteDb::isIoError(int errCode)
 
 bool SqliteDb::isDebugError(int errCode)
 {
-    return qint8(errCode) == SQLITE_SCHEMA;
+    const qint8 primaryCode = qint8(errCode);
+
+    return primaryCode == SQLITE_SCHEMA || primaryCode == SQLITE_INTERRUPT;
 }
 
 bool SqliteDb::setErrorLogCallback(SQLITEDB_ERRORLOG_FUNC errorLogFunc, void *context)
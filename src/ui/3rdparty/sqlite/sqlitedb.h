@@ -99,6 +99,9 @@ public:
     qint64 lastInsertRowid() const;
     int changes() const;
 
+    // Abort the running queries; thread-safe
+    void interrupt();
+
     bool beginTransaction();
     bool beginWriteTransaction();
     bool endTransaction(bool ok = true);
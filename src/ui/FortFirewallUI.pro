@@ -134,6 +134,7 @@ SOURCES += \
     log/logbuffer.cpp \
     log/logentry.cpp \
     log/logentryapp.cpp \
+    log/logentrybufferstat.cpp \
     log/logentryconn.cpp \
     log/logentryprocnew.cpp \
     log/logentrystattraf.cpp \
@@ -230,6 +231,8 @@ SOURCES += \
     util/model/ftstablesqlmodel.cpp \
     util/model/stringlistmodel.cpp \
     util/model/tableitemmodel.cpp \
+    util/model/tablesqljob.cpp \
+    util/model/tablesqlloader.cpp \
     util/model/tablesqlmodel.cpp \
     util/net/actionrange.cpp \
     util/net/arearange.cpp \
@@ -397,6 +400,7 @@ HEADERS += \
     log/logbuffer.h \
     log/logentry.h \
     log/logentryapp.h \
+    log/logentrybufferstat.h \
     log/logentryconn.h \
     log/logentryprocnew.h \
     log/logentrystattraf.h \
@@ -502,7 +506,10 @@ HEADERS += \
     util/model/ftstablesqlmodel.h \
     util/model/stringlistmodel.h \
     util/model/tableitemmodel.h \
+    util/model/tablesqljob.h \
+    util/model/tablesqlloader.h \
     util/model/tablesqlmodel.h \
+    util/model/tablesqlrows.h \
     util/net/actionrange.h \
     util/net/arearange.h \
     util/net/dirrange.h \
@@ -117,6 +117,14 @@ void AppGroup::setLimitBufferSizeOut(quint32 v)
     }
 }
 
+void AppGroup::setLimitCodel(bool on)
+{
+    if (m_limitCodel != on) {
+        m_limitCodel = on;
+        setEdited(true);
+    }
+}
+
 void AppGroup::setName(const QString &name)
 {
     if (m_name != name) {
@@ -219,6 +227,7 @@ void AppGroup::copy(const AppGroup &o)
     m_limitLatency = o.limitLatency();
     m_limitBufferSizeIn = o.limitBufferSizeIn();
     m_limitBufferSizeOut = o.limitBufferSizeOut();
+    m_limitCodel = o.limitCodel();
 
     m_id = o.id();
     m_name = o.name();
@@ -253,6 +262,7 @@ QVariant AppGroup::toVariant() const
     map["limitLatency"] = limitLatency();
     map["limitBufferSizeIn"] = limitBufferSizeIn();
     map["limitBufferSizeOut"] = limitBufferSizeOut();
+    map["limitCodel"] = limitCodel();
 
     map["id"] = id();
     map["name"] = name();
@@ -289,6 +299,7 @@ void AppGroup::fromVariant(const QVariant &v)
     m_limitLatency = map["limitLatency"].toUInt();
     m_limitBufferSizeIn = map["limitBufferSizeIn"].toUInt();
     m_limitBufferSizeOut = map["limitBufferSizeOut"].toUInt();
+    m_limitCodel = map["limitCodel"].toBool();
 
     m_id = map["id"].toLongLong();
     m_name = map["name"].toString();
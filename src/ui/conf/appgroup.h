@@ -60,6 +60,9 @@ public:
     quint32 limitBufferSizeOut() const { return m_limitBufferSizeOut; }
     void setLimitBufferSizeOut(quint32 v);
 
+    bool limitCodel() const { return m_limitCodel; }
+    void setLimitCodel(bool on);
+
     quint32 enabledSpeedLimitIn() const { return limitInEnabled() ? speedLimitIn() : 0; }
     quint32 enabledSpeedLimitOut() const { return limitOutEnabled() ? speedLimitOut() : 0; }
 
@@ -113,6 +116,7 @@ private:
 
     bool m_limitInEnabled : 1 = false;
     bool m_limitOutEnabled : 1 = false;
+    bool m_limitCodel : 1 = false;
 
     quint16 m_limitPacketLoss = 0; // Percent
     quint32 m_limitLatency = 0; // Milliseconds
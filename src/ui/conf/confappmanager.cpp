@@ -68,6 +68,12 @@ const char *const sqlSelectApps = "SELECT" SELECT_APP_FIELDS "  FROM app t"
                                   "    LEFT JOIN app_alert alert ON alert.app_id = t.app_id"
                                   "  ORDER BY t.path;";
 
+const char *const sqlSelectWildcardApps = "SELECT" SELECT_APP_FIELDS "  FROM app t"
+                                          "    JOIN app_group g ON g.app_group_id = t.app_group_id"
+                                          "    LEFT JOIN app_alert alert ON alert.app_id = t.app_id"
+                                          "  WHERE t.is_wildcard = 1"
+                                          "  ORDER BY t.path;";
+
 const char *const sqlSelectAppsToPurge = "SELECT app_id, path FROM app"
                                          "  WHERE is_wildcard = 0 AND parked = 0;";
 
@@ -135,6 +141,14 @@ using AppIdsArray = QVector<qint64>;
 
 }
 
+struct UpdateDriverAppsArgs
+{
+    bool isWildcard = false;
+
+    QVector<App> apps;
+    QStringList deletedAppPaths;
+};
+
 ConfAppManager::ConfAppManager(QObject *parent) : ConfManagerBase(parent)
 {
     connect(&m_appAlertedTimer, &QTimer::timeout, this, [&] { emit appAlerted(); });
@@ -408,18 +422,16 @@ bool ConfAppManager::updateAppName(qint64 appId, const QString &appName)
 bool ConfAppManager::deleteApps(const QVector<qint64> &appIdList)
 {
     bool ok = true;
-    bool isWildcard = false;
+    UpdateDriverAppsArgs uda;
 
     for (const qint64 appId : appIdList) {
-        if (!deleteApp(appId, isWildcard)) {
+        if (!deleteApp(appId, uda)) {
             ok = false;
             break;
         }
     }
 
-    if (isWildcard) {
-        updateDriverConf();
-    }
+    updateDriverApps(uda);
 
     return ok;
 }
@@ -459,7 +471,7 @@ bool ConfAppManager::clearAlerts()
     return ok;
 }
 
-bool ConfAppManager::deleteApp(qint64 appId, bool &isWildcard)
+bool ConfAppManager::deleteApp(qint64 appId, UpdateDriverAppsArgs &uda)
 {
     bool ok = false;
 
@@ -477,11 +489,11 @@ bool ConfAppManager::deleteApp(qint64 appId, bool &isWildcard)
 
     if (ok && !resList.isEmpty()) {
         if (resList.at(0).toBool()) {
-            isWildcard = true;
+            uda.isWildcard = true;
         } else {
             const QString appPath = resList.at(1).toString();
 
-            updateDriverDeleteApp(appPath);
+            uda.deletedAppPaths.append(appPath);
         }
 
         emitAppsChanged();
@@ -509,24 +521,22 @@ bool ConfAppManager::updateAppsBlocked(
         const QVector<qint64> &appIdList, bool blocked, bool killProcess)
 {
     bool ok = true;
-    bool isWildcard = (appIdList.size() > 7);
+    UpdateDriverAppsArgs uda;
 
     for (const qint64 appId : appIdList) {
-        if (!updateAppBlocked(appId, blocked, killProcess, isWildcard)) {
+        if (!updateAppBlocked(appId, blocked, killProcess, uda)) {
             ok = false;
             break;
         }
     }
 
-    if (isWildcard) {
-        updateDriverConf();
-    }
+    updateDriverApps(uda);
 
     return ok;
 }
 
 bool ConfAppManager::updateAppBlocked(
-        qint64 appId, bool blocked, bool killProcess, bool &isWildcard)
+        qint64 appId, bool blocked, bool killProcess, UpdateDriverAppsArgs &uda)
 {
     App app;
     if (!loadAppById(app, appId))
@@ -539,9 +549,9 @@ bool ConfAppManager::updateAppBlocked(
         return false;
 
     if (app.isWildcard) {
-        isWildcard = true;
+        uda.isWildcard = true;
     } else {
-        updateDriverUpdateApp(app);
+        uda.apps.append(app);
     }
 
     return true;
@@ -590,9 +600,20 @@ QVector<qint64> ConfAppManager::collectObsoleteApps(quint32 driveMask)
 }
 
 bool ConfAppManager::walkApps(const std::function<walkAppsCallback> &func) const
+{
+    return walkAppsBySql(sqlSelectApps, func);
+}
+
+bool ConfAppManager::walkWildcardApps(const std::function<walkAppsCallback> &func) const
+{
+    return walkAppsBySql(sqlSelectWildcardApps, func);
+}
+
+bool ConfAppManager::walkAppsBySql(
+        const char *sql, const std::function<walkAppsCallback> &func) const
 {
     SqliteStmt stmt;
-    if (!DbQuery(sqliteDb()).sql(sqlSelectApps).prepare(stmt))
+    if (!DbQuery(sqliteDb()).sql(sql).prepare(stmt))
         return false;
 
     while (stmt.step() == SqliteStmt::StepRow) {
@@ -740,6 +761,39 @@ bool ConfAppManager::updateDriverConf(bool onlyFlags)
 
     m_driveMask = confBuf.driveMask();
 
+    if (!onlyFlags) {
+        m_wildExeApps = confBuf.wildExeApps();
+    }
+
+    return true;
+}
+
+bool ConfAppManager::updateDriverConfWildApps()
+{
+    // The driver's exe apps are not patched by the delta
+    if (m_wildExeApps)
+        return updateDriverConf();
+
+    ConfBuffer confBuf;
+
+    const WriteConfDeltaArgs wda = { .wildApps = true };
+
+    if (!confBuf.writeConfDelta(*conf(), wda, this, *IoC<EnvManager>())) {
+        qCWarning(LC) << "Driver config error:" << confBuf.errorMessage();
+        return false;
+    }
+
+    if (confBuf.wildExeApps())
+        return updateDriverConf();
+
+    auto driverManager = IoC<DriverManager>();
+    if (!driverManager->writeConfDelta(confBuf.buffer())) {
+        qCWarning(LC) << "Update driver delta error:" << driverManager->errorMessage();
+        return updateDriverConf();
+    }
+
+    m_driveMask |= confBuf.driveMask();
+
     return true;
 }
 
@@ -781,15 +835,33 @@ void ConfAppManager::fillApp(App &app, const SqliteStmt &stmt)
     app.alerted = stmt.columnBool(22);
 }
 
-bool ConfAppManager::updateDriverDeleteApp(const QString &appPath)
+bool ConfAppManager::updateDriverApps(const UpdateDriverAppsArgs &uda)
 {
-    App app;
-    app.appPath = appPath;
+    if (uda.isWildcard)
+        return updateDriverConfWildApps();
+
+    if (uda.apps.isEmpty() && uda.deletedAppPaths.isEmpty())
+        return true;
+
+    ConfBuffer confBuf;
+
+    if (!confBuf.writeAppsBatch(uda.apps, uda.deletedAppPaths)) {
+        qCWarning(LC) << "Driver config error:" << confBuf.errorMessage();
+        return false;
+    }
+
+    auto driverManager = IoC<DriverManager>();
+    if (!driverManager->writeApps(confBuf.buffer())) {
+        qCWarning(LC) << "Update driver error:" << driverManager->errorMessage();
+        return false;
+    }
+
+    m_driveMask |= confBuf.driveMask();
 
-    return updateDriverUpdateApp(app, /*remove=*/true);
+    return true;
 }
 
-bool ConfAppManager::updateDriverUpdateApp(const App &app, bool remove)
+bool ConfAppManager::updateDriverUpdateApp(const App &app)
 {
     ConfBuffer confBuf;
 
@@ -799,17 +871,17 @@ bool ConfAppManager::updateDriverUpdateApp(const App &app, bool remove)
     }
 
     auto driverManager = IoC<DriverManager>();
-    if (!driverManager->writeApp(confBuf.buffer(), remove)) {
+    if (!driverManager->writeApp(confBuf.buffer())) {
         qCWarning(LC) << "Update driver error:" << driverManager->errorMessage();
         return false;
     }
 
-    m_driveMask |= remove ? 0 : confBuf.driveMask();
+    m_driveMask |= confBuf.driveMask();
 
     return true;
 }
 
 bool ConfAppManager::updateDriverUpdateAppConf(const App &app)
 {
-    return app.isWildcard ? updateDriverConf() : updateDriverUpdateApp(app);
+    return app.isWildcard ? updateDriverConfWildApps() : updateDriverUpdateApp(app);
 }
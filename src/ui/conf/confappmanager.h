@@ -16,6 +16,8 @@ class ConfManager;
 class FirewallConf;
 class LogEntryApp;
 
+struct UpdateDriverAppsArgs;
+
 class ConfAppManager : public ConfManagerBase, public ConfAppsWalker, public IocService
 {
     Q_OBJECT
@@ -47,6 +49,7 @@ public:
             const QVector<qint64> &appIdList, bool blocked, bool killProcess);
 
     bool walkApps(const std::function<walkAppsCallback> &func) const override;
+    bool walkWildcardApps(const std::function<walkAppsCallback> &func) const override;
 
     bool saveAppBlocked(const App &app);
     void updateAppEndTimes();
@@ -76,13 +79,16 @@ private:
     void beginAddOrUpdateApp(App &app, const AppGroup &appGroup, bool onlyUpdate, bool &ok);
     void endAddOrUpdateApp(const App &app, bool onlyUpdate);
 
-    bool deleteApp(qint64 appId, bool &isWildcard);
+    bool deleteApp(qint64 appId, UpdateDriverAppsArgs &uda);
 
-    bool updateAppBlocked(qint64 appId, bool blocked, bool killProcess, bool &isWildcard);
+    bool updateAppBlocked(
+            qint64 appId, bool blocked, bool killProcess, UpdateDriverAppsArgs &uda);
     bool checkAppBlockedChanged(App &app, bool blocked, bool killProcess);
 
     QVector<qint64> collectObsoleteApps(quint32 driveMask);
 
+    bool walkAppsBySql(const char *sql, const std::function<walkAppsCallback> &func) const;
+
 private:
     void emitAppAlerted();
     void emitAppsChanged();
@@ -91,13 +97,16 @@ private:
     bool loadAppById(App &app, qint64 appId);
     static void fillApp(App &app, const SqliteStmt &stmt);
 
-    bool updateDriverDeleteApp(const QString &appPath);
-    bool updateDriverUpdateApp(const App &app, bool remove = false);
+    bool updateDriverConfWildApps();
+    bool updateDriverApps(const UpdateDriverAppsArgs &uda);
+    bool updateDriverUpdateApp(const App &app);
     bool updateDriverUpdateAppConf(const App &app);
 
 private:
     quint32 m_driveMask = 0;
 
+    bool m_wildExeApps = true; // until the whole conf is written
+
     TriggerTimer m_appAlertedTimer;
     TriggerTimer m_appsChangedTimer;
     TriggerTimer m_appUpdatedTimer;
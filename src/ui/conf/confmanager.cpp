@@ -30,7 +30,7 @@ namespace {
 
 const QLoggingCategory LC("conf");
 
-constexpr int DATABASE_USER_VERSION = 51;
+constexpr int DATABASE_USER_VERSION = 52;
 
 constexpr int CONF_PERIODS_UPDATE_INTERVAL = 60 * 1000; // 1 minute
 
@@ -57,7 +57,7 @@ const char *const sqlSelectAppGroups = "SELECT app_group_id, enabled, apply_chil
                                        "    limit_in_enabled, limit_out_enabled,"
                                        "    speed_limit_in, speed_limit_out,"
                                        "    limit_packet_loss, limit_latency,"
-                                       "    limit_bufsize_in, limit_bufsize_out,"
+                                       "    limit_bufsize_in, limit_bufsize_out, limit_codel,"
                                        "    name, kill_text, block_text, allow_text,"
                                        "    period_from, period_to"
                                        "  FROM app_group"
@@ -68,11 +68,11 @@ const char *const sqlInsertAppGroup = "INSERT INTO app_group(app_group_id, order
                                       "    period_enabled, limit_in_enabled, limit_out_enabled,"
                                       "    speed_limit_in, speed_limit_out,"
                                       "    limit_packet_loss, limit_latency,"
-                                      "    limit_bufsize_in, limit_bufsize_out,"
+                                      "    limit_bufsize_in, limit_bufsize_out, limit_codel,"
                                       "    name, kill_text, block_text, allow_text,"
                                       "    period_from, period_to)"
                                       "  VALUES(?1, ?2, ?3, ?4, ?5, ?6, ?7, ?8, ?9, ?10, ?11, ?12,"
-                                      "    ?13, ?14, ?15, ?16, ?17, ?18, ?19, ?20, ?21, ?22);";
+                                      "    ?13, ?14, ?15, ?16, ?17, ?18, ?19, ?20, ?21, ?22, ?23);";
 
 const char *const sqlUpdateAppGroup = "UPDATE app_group"
                                       "  SET order_index = ?2, enabled = ?3,"
@@ -82,8 +82,9 @@ const char *const sqlUpdateAppGroup = "UPDATE app_group"
                                       "    speed_limit_in = ?11, speed_limit_out = ?12,"
                                       "    limit_packet_loss = ?13, limit_latency = ?14,"
                                       "    limit_bufsize_in = ?15, limit_bufsize_out = ?16,"
-                                      "    name = ?17, kill_text = ?18, block_text = ?19,"
-                                      "    allow_text = ?20, period_from = ?21, period_to = ?22"
+                                      "    limit_codel = ?17, name = ?18, kill_text = ?19,"
+                                      "    block_text = ?20, allow_text = ?21, period_from = ?22,"
+                                      "    period_to = ?23"
                                       "  WHERE app_group_id = ?1;";
 
 const char *const sqlDeleteAppGroup = "DELETE FROM app_group"
@@ -337,12 +338,13 @@ bool loadAppGroups(SqliteDb *db, FirewallConf &conf)
         appGroup->setLimitLatency(quint32(stmt.columnInt(12)));
         appGroup->setLimitBufferSizeIn(quint32(stmt.columnInt(13)));
         appGroup->setLimitBufferSizeOut(quint32(stmt.columnInt(14)));
-        appGroup->setName(stmt.columnText(15));
-        appGroup->setKillText(stmt.columnText(16));
-        appGroup->setBlockText(stmt.columnText(17));
-        appGroup->setAllowText(stmt.columnText(18));
-        appGroup->setPeriodFrom(stmt.columnText(19));
-        appGroup->setPeriodTo(stmt.columnText(20));
+        appGroup->setLimitCodel(stmt.columnBool(15));
+        appGroup->setName(stmt.columnText(16));
+        appGroup->setKillText(stmt.columnText(17));
+        appGroup->setBlockText(stmt.columnText(18));
+        appGroup->setAllowText(stmt.columnText(19));
+        appGroup->setPeriodFrom(stmt.columnText(20));
+        appGroup->setPeriodTo(stmt.columnText(21));
         appGroup->setEdited(false);
 
         conf.addAppGroup(appGroup);
@@ -374,6 +376,7 @@ bool saveAppGroup(SqliteDb *db, AppGroup *appGroup, int orderIndex)
         appGroup->limitLatency(),
         appGroup->limitBufferSizeIn(),
         appGroup->limitBufferSizeOut(),
+        appGroup->limitCodel(),
         appGroup->name(),
         appGroup->killText(),
         appGroup->blockText(),
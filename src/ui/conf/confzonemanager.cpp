@@ -266,13 +266,73 @@ bool ConfZoneManager::updateZoneResult(const Zone &zone)
 }
 
 void ConfZoneManager::updateDriverZones(quint32 zonesMask, quint32 enabledMask, quint32 dataSize,
-        const QList<QByteArray> &zonesData)
+        const QList<QByteArray> &zonesData, const QStringList &zonesChecksums)
 {
     ConfBuffer confBuf;
 
     confBuf.writeZones(zonesMask, enabledMask, dataSize, zonesData);
 
-    driverWriteZones(confBuf);
+    if (driverWriteZones(confBuf)) {
+        setDriverZones(zonesMask, enabledMask, zonesChecksums);
+    } else {
+        m_driverZonesLoaded = false;
+    }
+}
+
+void ConfZoneManager::updateDriverZonesChanged(quint32 zonesMask, quint32 enabledMask,
+        quint32 dataSize, const QList<QByteArray> &zonesData, const QStringList &zonesChecksums)
+{
+    if (!m_driverZonesLoaded) {
+        updateDriverZones(zonesMask, enabledMask, dataSize, zonesData, zonesChecksums);
+        return;
+    }
+
+    quint32 changedMask = driverZonesChangedMask(zonesMask, enabledMask, zonesChecksums);
+    if (changedMask == 0)
+        return;
+
+    QVector<QByteArray> zonesDataById(ConfUtil::zoneMaxCount());
+    {
+        quint32 mask = zonesMask;
+        for (const auto &zoneData : zonesData) {
+            const int zoneIndex = BitUtil::bitScanForward(mask);
+            if (Q_UNLIKELY(zoneIndex == -1))
+                break;
+
+            zonesDataById[zoneIndex] = zoneData;
+
+            mask ^= (quint32(1) << zoneIndex);
+        }
+    }
+
+    auto driverManager = IoC<DriverManager>();
+
+    // Upload only the changed or removed zones
+    while (changedMask != 0) {
+        const int zoneIndex = BitUtil::bitScanForward(changedMask);
+        if (Q_UNLIKELY(zoneIndex == -1))
+            break;
+
+        const quint32 zoneMask = (quint32(1) << zoneIndex);
+        const bool enabled = (enabledMask & zoneMask) != 0;
+
+        changedMask ^= zoneMask;
+
+        ConfBuffer confBuf;
+
+        const bool ok =
+                confBuf.writeZoneUpdate(zoneIndex + 1, enabled, zonesDataById[zoneIndex]);
+
+        if (!ok || !driverManager->writeZone(confBuf.buffer())) {
+            qCWarning(LC) << "Update driver zone error:"
+                          << (ok ? driverManager->errorMessage() : confBuf.errorMessage());
+
+            updateDriverZones(zonesMask, enabledMask, dataSize, zonesData, zonesChecksums);
+            return;
+        }
+    }
+
+    setDriverZones(zonesMask, enabledMask, zonesChecksums);
 }
 
 bool ConfZoneManager::updateDriverZoneFlag(quint8 zoneId, bool enabled)
@@ -281,7 +341,60 @@ bool ConfZoneManager::updateDriverZoneFlag(quint8 zoneId, bool enabled)
 
     confBuf.writeZoneFlag(zoneId, enabled);
 
-    return driverWriteZones(confBuf, /*onlyFlags=*/true);
+    if (!driverWriteZones(confBuf, /*onlyFlags=*/true))
+        return false;
+
+    const quint32 zoneMask = (quint32(1) << (zoneId - 1));
+
+    m_driverEnabledMask = enabled ? (m_driverEnabledMask | zoneMask)
+                                  : (m_driverEnabledMask & ~zoneMask);
+
+    return true;
+}
+
+quint32 ConfZoneManager::driverZonesChangedMask(
+        quint32 zonesMask, quint32 enabledMask, const QStringList &zonesChecksums) const
+{
+    // Removed zones and zones with the changed enabled flag
+    quint32 changedMask = (m_driverZonesMask & ~zonesMask)
+            | ((m_driverEnabledMask ^ enabledMask) & zonesMask);
+
+    for (const auto &checksum : zonesChecksums) {
+        const int zoneIndex = BitUtil::bitScanForward(zonesMask);
+        if (Q_UNLIKELY(zoneIndex == -1))
+            break;
+
+        const quint32 zoneMask = (quint32(1) << zoneIndex);
+        const quint8 zoneId = zoneIndex + 1;
+
+        if (checksum.isEmpty() || checksum != m_driverZonesChecksums.value(zoneId)) {
+            changedMask |= zoneMask;
+        }
+
+        zonesMask ^= zoneMask;
+    }
+
+    return changedMask;
+}
+
+void ConfZoneManager::setDriverZones(
+        quint32 zonesMask, quint32 enabledMask, const QStringList &zonesChecksums)
+{
+    m_driverZonesLoaded = true;
+    m_driverZonesMask = zonesMask;
+    m_driverEnabledMask = enabledMask;
+
+    m_driverZonesChecksums.clear();
+
+    for (const auto &checksum : zonesChecksums) {
+        const int zoneIndex = BitUtil::bitScanForward(zonesMask);
+        if (Q_UNLIKELY(zoneIndex == -1))
+            break;
+
+        m_driverZonesChecksums.insert(zoneIndex + 1, checksum);
+
+        zonesMask ^= (quint32(1) << zoneIndex);
+    }
 }
 
 void ConfZoneManager::setupZoneNamesCache()
@@ -30,7 +30,9 @@ public:
     bool updateZoneResult(const Zone &zone);
 
     void updateDriverZones(quint32 zonesMask, quint32 enabledMask, quint32 dataSize,
-            const QList<QByteArray> &zonesData);
+            const QList<QByteArray> &zonesData, const QStringList &zonesChecksums);
+    void updateDriverZonesChanged(quint32 zonesMask, quint32 enabledMask, quint32 dataSize,
+            const QList<QByteArray> &zonesData, const QStringList &zonesChecksums);
 
 signals:
     void zoneAdded();
@@ -40,11 +42,21 @@ signals:
 private:
     bool updateDriverZoneFlag(quint8 zoneId, bool enabled);
 
+    quint32 driverZonesChangedMask(
+            quint32 zonesMask, quint32 enabledMask, const QStringList &zonesChecksums) const;
+    void setDriverZones(quint32 zonesMask, quint32 enabledMask, const QStringList &zonesChecksums);
+
     void setupZoneNamesCache();
     void clearZoneNamesCache();
 
 private:
     mutable QHash<quint8, QString> m_zoneNamesCache;
+
+    // Zones, which were uploaded to the driver
+    bool m_driverZonesLoaded = false;
+    quint32 m_driverZonesMask = 0;
+    quint32 m_driverEnabledMask = 0;
+    QHash<quint8, QString> m_driverZonesChecksums;
 };
 
 #endif // CONFZONEMANAGER_H
@@ -5,12 +5,15 @@
 
 #define DEFAULT_FILTER_OFF_SECONDS     0 // Disabled
 #define DEFAULT_AUTO_LEARN_SECONDS     60
+#define DEFAULT_ASK_PACKETS_MAX        3
 #define DEFAULT_APP_GROUP_BITS         quint32(-1)
 #define DEFAULT_MONTH_START            1
 #define DEFAULT_TRAF_HOUR_KEEP_DAYS    90 // ~3 months
 #define DEFAULT_TRAF_DAY_KEEP_DAYS     365 // ~1 year
 #define DEFAULT_TRAF_MONTH_KEEP_MONTHS 36 // ~3 years
 #define DEFAULT_LOG_CONN_KEEP_COUNT    10000
+#define DEFAULT_LOG_BUFFER_SIZE_KB     256
+#define DEFAULT_TRAF_FLUSH_SECONDS     60
 
 class IniOptions : public MapSettings
 {
@@ -43,6 +46,9 @@ public:
     }
     void setAutoLearnSeconds(int v) { setValue("conf/autoLearnSeconds", v); }
 
+    int askPacketsMax() const { return valueInt("conf/askPacketsMax", DEFAULT_ASK_PACKETS_MAX); }
+    void setAskPacketsMax(int v) { setValue("conf/askPacketsMax", v); }
+
     bool taskInfoListSet() const { return contains("task/infoList_"); }
 
     QVariant taskInfoList() const { return value("task/infoList_"); }
@@ -101,6 +107,18 @@ public:
     }
     void setConnKeepCount(int v) { setValue("stat/connKeepCount", v); }
 
+    int logBufferSizeKb() const
+    {
+        return valueInt("stat/logBufferSizeKb", DEFAULT_LOG_BUFFER_SIZE_KB);
+    }
+    void setLogBufferSizeKb(int v) { setValue("stat/logBufferSizeKb", v); }
+
+    int trafFlushSeconds() const
+    {
+        return valueInt("stat/trafFlushSeconds", DEFAULT_TRAF_FLUSH_SECONDS);
+    }
+    void setTrafFlushSeconds(int v) { setValue("stat/trafFlushSeconds", v); }
+
     bool updateKeepCurrentVersion() const { return valueBool("autoUpdate/keepCurrentVersion"); }
     void setUpdateKeepCurrentVersion(bool v) { setValue("autoUpdate/keepCurrentVersion", v); }
 
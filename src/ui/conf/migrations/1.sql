@@ -43,6 +43,7 @@ CREATE TABLE app_group(
   limit_latency INTEGER NOT NULL DEFAULT 0,
   limit_bufsize_in INTEGER NOT NULL DEFAULT 150000,
   limit_bufsize_out INTEGER NOT NULL DEFAULT 150000,
+  limit_codel BOOLEAN NOT NULL DEFAULT 0,
   name TEXT NOT NULL,
   kill_text TEXT,
   block_text TEXT NOT NULL,
@@ -1,5 +1,7 @@
 #include "drivercommon.h"
 
+#include <atomic>
+
 #include <common/fortconf.h>
 #include <common/fortioctl.h>
 #include <common/fortlog.h>
@@ -67,6 +69,31 @@ quint32 ioctlSetRuleFlag()
     return FORT_IOCTL_SETRULEFLAG;
 }
 
+quint32 ioctlUpdateApps()
+{
+    return FORT_IOCTL_UPDATEAPPS;
+}
+
+quint32 ioctlMapLog()
+{
+    return FORT_IOCTL_MAPLOG;
+}
+
+quint32 ioctlSetConfDelta()
+{
+    return FORT_IOCTL_SETCONFDELTA;
+}
+
+quint32 ioctlSetZone()
+{
+    return FORT_IOCTL_SETZONE;
+}
+
+quint32 ioctlGetConfStat()
+{
+    return FORT_IOCTL_GETCONFSTAT;
+}
+
 quint32 userErrorCode()
 {
     return FORT_ERROR_USER_ERROR;
@@ -122,14 +149,14 @@ quint32 logStatHeaderSize()
     return FORT_LOG_STAT_HEADER_SIZE;
 }
 
-quint32 logStatTrafSize(quint16 procCount)
+quint32 logStatSize(quint32 dataLen)
 {
-    return FORT_LOG_STAT_TRAF_SIZE(procCount);
+    return FORT_LOG_STAT_SIZE(dataLen);
 }
 
-quint32 logStatSize(quint16 procCount)
+quint32 logStatBufferDataSize()
 {
-    return FORT_LOG_STAT_SIZE(procCount);
+    return FORT_LOG_STAT_BUFFER_DATA_SIZE;
 }
 
 quint32 logTimeSize()
@@ -137,44 +164,83 @@ quint32 logTimeSize()
     return FORT_LOG_TIME_SIZE;
 }
 
+quint32 logBufferStatSize()
+{
+    return FORT_LOG_BUFFER_STAT_SIZE;
+}
+
 quint8 logType(const char *input)
 {
     return fort_log_type(input);
 }
 
-void logAppHeaderWrite(char *output, bool blocked, quint32 pid, quint16 pathLen)
+void logAppHeaderWrite(char *output, bool blocked, quint32 pid, quint32 pathId, quint16 pathLen)
 {
-    fort_log_app_header_write(output, blocked, pid, pathLen);
+    fort_log_app_header_write(output, blocked, pid, pathId, pathLen);
 }
 
-void logAppHeaderRead(const char *input, int *blocked, quint32 *pid, quint16 *pathLen)
+void logAppHeaderRead(
+        const char *input, int *blocked, quint32 *pid, quint32 *pathId, quint16 *pathLen)
 {
-    fort_log_app_header_read(input, blocked, pid, pathLen);
+    fort_log_app_header_read(input, blocked, pid, pathId, pathLen);
 }
 
-void logConnHeaderWrite(char *output, PCFORT_CONF_META_CONN conn, quint16 pathLen)
+void logConnHeaderWrite(char *output, PCFORT_CONF_META_CONN conn, quint32 pathId, quint16 pathLen)
 {
-    fort_log_conn_header_write(output, conn, pathLen);
+    fort_log_conn_header_write(output, conn, pathId, pathLen);
 }
 
-void logConnHeaderRead(const char *input, PFORT_CONF_META_CONN conn, quint16 *pathLen)
+void logConnHeaderRead(
+        const char *input, PFORT_CONF_META_CONN conn, quint32 *pathId, quint16 *pathLen)
 {
-    fort_log_conn_header_read(input, conn, pathLen);
+    fort_log_conn_header_read(input, conn, pathId, pathLen);
 }
 
-void logProcNewHeaderWrite(char *output, quint32 pid, quint16 pathLen)
+void logProcNewHeaderWrite(char *output, quint32 pid, quint32 pathId, quint16 pathLen)
 {
-    fort_log_proc_new_header_write(output, pid, pathLen);
+    fort_log_proc_new_header_write(output, pid, pathId, pathLen);
 }
 
-void logProcNewHeaderRead(const char *input, quint32 *pid, quint16 *pathLen)
+void logProcNewHeaderRead(const char *input, quint32 *pid, quint32 *pathId, quint16 *pathLen)
 {
-    fort_log_proc_new_header_read(input, pid, pathLen);
+    fort_log_proc_new_header_read(input, pid, pathId, pathLen);
 }
 
-void logStatTrafHeaderRead(const char *input, quint16 *procCount)
+void logStatTrafHeaderWrite(char *output, quint16 procCount, quint32 dataLen)
 {
-    fort_log_stat_traf_header_read(input, procCount);
+    fort_log_stat_traf_header_write(output, procCount, dataLen);
+}
+
+void logStatTrafHeaderRead(const char *input, quint16 *procCount, quint32 *dataLen)
+{
+    fort_log_stat_traf_header_read(input, procCount, dataLen);
+}
+
+quint32 logStatTrafProcSize(quint32 pidFlag, quint64 inBytes, quint64 outBytes)
+{
+    const FORT_TRAF traf = { inBytes, outBytes };
+
+    return fort_log_stat_traf_proc_size(pidFlag, &traf);
+}
+
+char *logStatTrafProcWrite(char *output, quint32 pidFlag, quint64 inBytes, quint64 outBytes)
+{
+    const FORT_TRAF traf = { inBytes, outBytes };
+
+    return fort_log_stat_traf_proc_write(output, pidFlag, &traf);
+}
+
+const char *logStatTrafProcRead(const char *input, const char *end, quint32 *pidFlag,
+        quint64 *inBytes, quint64 *outBytes)
+{
+    FORT_TRAF traf;
+
+    const char *next = fort_log_stat_traf_proc_read(input, end, pidFlag, &traf);
+
+    *inBytes = traf.in_bytes;
+    *outBytes = traf.out_bytes;
+
+    return next;
 }
 
 void logTimeWrite(char *output, int systemTimeChanged, qint64 unixTime)
@@ -187,6 +253,58 @@ void logTimeRead(const char *input, int *systemTimeChanged, qint64 *unixTime)
     fort_log_time_read(input, systemTimeChanged, unixTime);
 }
 
+void logBufferStatRead(const char *input, quint32 *ringSize, quint32 *dropCount)
+{
+    fort_log_buffer_stat_read(input, ringSize, dropCount);
+}
+
+int logSharedMapSize()
+{
+    return sizeof(FORT_LOG_SHARED_MAP);
+}
+
+void logSharedMapWrite(char *output, quint32 size)
+{
+    PFORT_LOG_SHARED_MAP shared_map = PFORT_LOG_SHARED_MAP(output);
+
+    shared_map->size = size;
+    shared_map->reserved = 0;
+    shared_map->address = 0;
+}
+
+void *logSharedMapRead(const char *input)
+{
+    PCFORT_LOG_SHARED_MAP shared_map = PCFORT_LOG_SHARED_MAP(input);
+
+    return reinterpret_cast<void *>(quintptr(shared_map->address));
+}
+
+int logSharedRead(void *logShared, const char **data)
+{
+    PFORT_LOG_SHARED shared = PFORT_LOG_SHARED(logShared);
+
+    const quint32 tail = shared->tail;
+    const quint32 head = shared->head;
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+
+    const quint32 off = tail & (shared->size - 1);
+    const quint32 len = qMin(head - tail, shared->size - off);
+
+    *data = shared->data + off;
+
+    return int(len);
+}
+
+void logSharedConsume(void *logShared, int len)
+{
+    PFORT_LOG_SHARED shared = PFORT_LOG_SHARED(logShared);
+
+    std::atomic_thread_fence(std::memory_order_release);
+
+    shared->tail += quint32(len);
+}
+
 bool confIpInRange(
         const void *drvConf, const ip_addr_t ip, bool isIPv6, bool included, int addrGroupIndex)
 {
@@ -218,6 +336,25 @@ bool confIp6InRange(const void *drvConf, const ip6_addr_t ip, bool included, int
     return confIpInRange(drvConf, ip_addr, /*isIPv6=*/true, included, addrGroupIndex);
 }
 
+quint8 confZonesIpIncluded(
+        const void *drvZones, const ip_addr_t ip, bool isIPv6, quint32 zonesMask)
+{
+    PCFORT_CONF_ZONES zones = PCFORT_CONF_ZONES(drvZones);
+
+    FORT_CONF_ZONES_RT zones_rt;
+    fort_conf_zones_rt_init(&zones_rt, zones);
+
+    const FORT_CONF_META_CONN conn = {
+        .isIPv6 = isIPv6,
+        .remote_ip = ip,
+    };
+
+    UCHAR zoneId = 0;
+    fort_conf_zones_ip_included(&zones_rt, &conn, &zoneId, zonesMask);
+
+    return zoneId;
+}
+
 FORT_APP_DATA confAppFind(const void *drvConf, const QString &kernelPath)
 {
     PCFORT_CONF conf = PCFORT_CONF(drvConf);
@@ -248,6 +385,76 @@ bool confRulesConnBlocked(const void *drvRules, PFORT_CONF_META_CONN conn, quint
     return confRulesConnFiltered(drvRules, conn, ruleId) && conn->blocked;
 }
 
+quint32 confRulesFilterTypes(const void *drvRules)
+{
+    PCFORT_CONF_RULES rules = PCFORT_CONF_RULES(drvRules);
+
+    return fort_conf_rules_filter_types(rules);
+}
+
+bool confAppsBatchValid(const void *drvAppsBatch, quint32 size)
+{
+    PCFORT_CONF_APPS_BATCH apps_batch = PCFORT_CONF_APPS_BATCH(drvAppsBatch);
+
+    return fort_conf_apps_batch_valid(apps_batch, size);
+}
+
+bool confDeltaValid(const void *drvConfDelta, quint32 size)
+{
+    PCFORT_CONF_DELTA delta = PCFORT_CONF_DELTA(drvConfDelta);
+
+    return fort_conf_delta_valid(delta, size);
+}
+
+QByteArray confDeltaApply(const void *drvConf, const void *drvConfDelta)
+{
+    PCFORT_CONF conf = PCFORT_CONF(drvConf);
+    PCFORT_CONF_DELTA delta = PCFORT_CONF_DELTA(drvConfDelta);
+
+    const quint32 confLen = fort_conf_delta_conf_len(conf, delta);
+
+    // The exe apps are not copied
+    QByteArray newConf(int(confLen), '\0');
+
+    fort_conf_delta_conf_write(PFORT_CONF(newConf.data()), conf, delta);
+
+    return newConf;
+}
+
+bool confZoneValid(const void *drvZone, quint32 size)
+{
+    PCFORT_CONF_ZONE zone = PCFORT_CONF_ZONE(drvZone);
+
+    return fort_conf_zone_valid(zone, size);
+}
+
+quint8 confZoneIpIncluded(const void *drvZone, const ip_addr_t ip, bool isIPv6)
+{
+    PCFORT_CONF_ZONE zone = PCFORT_CONF_ZONE(drvZone);
+
+    const int zoneIndex = zone->zone_id - 1;
+    const quint32 zoneMask = (quint32(1) << zoneIndex);
+
+    // The driver's view of the zone, as it is set alone
+    FORT_CONF_ZONES_RT zones_rt = {};
+
+    if (zone->addr_len != 0) {
+        zones_rt.mask = zoneMask;
+        zones_rt.enabled_mask = zone->enabled ? zoneMask : 0;
+        zones_rt.addr_lists[zoneIndex] = PCFORT_CONF_ADDR_LIST(zone->data);
+    }
+
+    const FORT_CONF_META_CONN conn = {
+        .isIPv6 = isIPv6,
+        .remote_ip = ip,
+    };
+
+    UCHAR zoneId = 0;
+    fort_conf_zones_ip_included(&zones_rt, &conn, &zoneId, zoneMask);
+
+    return zoneId;
+}
+
 bool provRegister(bool bootFilter)
 {
     const FORT_PROV_BOOT_CONF boot_conf = {
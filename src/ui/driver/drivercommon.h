@@ -20,6 +20,11 @@ quint32 ioctlSetZones();
 quint32 ioctlSetZoneFlag();
 quint32 ioctlSetRules();
 quint32 ioctlSetRuleFlag();
+quint32 ioctlUpdateApps();
+quint32 ioctlMapLog();
+quint32 ioctlSetConfDelta();
+quint32 ioctlSetZone();
+quint32 ioctlGetConfStat();
 
 quint32 userErrorCode();
 
@@ -39,37 +44,67 @@ quint32 logProcNewHeaderSize();
 quint32 logProcNewSize(quint16 pathLen);
 
 quint32 logStatHeaderSize();
-quint32 logStatTrafSize(quint16 procCount);
-quint32 logStatSize(quint16 procCount);
+quint32 logStatSize(quint32 dataLen);
+quint32 logStatBufferDataSize();
 
 quint32 logTimeSize();
 
+quint32 logBufferStatSize();
+
 quint8 logType(const char *input);
 
-void logAppHeaderWrite(char *output, bool blocked, quint32 pid, quint16 pathLen);
-void logAppHeaderRead(const char *input, int *blocked, quint32 *pid, quint16 *pathLen);
+void logAppHeaderWrite(char *output, bool blocked, quint32 pid, quint32 pathId, quint16 pathLen);
+void logAppHeaderRead(
+        const char *input, int *blocked, quint32 *pid, quint32 *pathId, quint16 *pathLen);
+
+void logConnHeaderWrite(char *output, PCFORT_CONF_META_CONN conn, quint32 pathId, quint16 pathLen);
+void logConnHeaderRead(
+        const char *input, PFORT_CONF_META_CONN conn, quint32 *pathId, quint16 *pathLen);
 
-void logConnHeaderWrite(char *output, PCFORT_CONF_META_CONN conn, quint16 pathLen);
-void logConnHeaderRead(const char *input, PFORT_CONF_META_CONN conn, quint16 *pathLen);
+void logProcNewHeaderWrite(char *output, quint32 pid, quint32 pathId, quint16 pathLen);
+void logProcNewHeaderRead(const char *input, quint32 *pid, quint32 *pathId, quint16 *pathLen);
 
-void logProcNewHeaderWrite(char *output, quint32 pid, quint16 pathLen);
-void logProcNewHeaderRead(const char *input, quint32 *pid, quint16 *pathLen);
+void logStatTrafHeaderWrite(char *output, quint16 procCount, quint32 dataLen);
+void logStatTrafHeaderRead(const char *input, quint16 *procCount, quint32 *dataLen);
 
-void logStatTrafHeaderRead(const char *input, quint16 *procCount);
+quint32 logStatTrafProcSize(quint32 pidFlag, quint64 inBytes, quint64 outBytes);
+char *logStatTrafProcWrite(char *output, quint32 pidFlag, quint64 inBytes, quint64 outBytes);
+const char *logStatTrafProcRead(const char *input, const char *end, quint32 *pidFlag,
+        quint64 *inBytes, quint64 *outBytes);
 
 void logTimeWrite(char *output, int systemTimeChanged, qint64 unixTime);
 void logTimeRead(const char *input, int *systemTimeChanged, qint64 *unixTime);
 
+void logBufferStatRead(const char *input, quint32 *ringSize, quint32 *dropCount);
+
+int logSharedMapSize();
+void logSharedMapWrite(char *output, quint32 size);
+void *logSharedMapRead(const char *input);
+
+int logSharedRead(void *logShared, const char **data);
+void logSharedConsume(void *logShared, int len);
+
 bool confIpInRange(const void *drvConf, const ip_addr_t ip, bool isIPv6 = false,
         bool included = false, int addrGroupIndex = 0);
 bool confIp4InRange(const void *drvConf, quint32 ip, bool included = false, int addrGroupIndex = 0);
 bool confIp6InRange(
         const void *drvConf, const ip6_addr_t ip, bool included = false, int addrGroupIndex = 0);
 
+quint8 confZonesIpIncluded(
+        const void *drvZones, const ip_addr_t ip, bool isIPv6, quint32 zonesMask);
+
 FORT_APP_DATA confAppFind(const void *drvConf, const QString &kernelPath);
 
 bool confRulesConnFiltered(const void *drvRules, PFORT_CONF_META_CONN conn, quint16 ruleId);
 bool confRulesConnBlocked(const void *drvRules, PFORT_CONF_META_CONN conn, quint16 ruleId);
+quint32 confRulesFilterTypes(const void *drvRules);
+
+bool confAppsBatchValid(const void *drvAppsBatch, quint32 size);
+bool confDeltaValid(const void *drvConfDelta, quint32 size);
+QByteArray confDeltaApply(const void *drvConf, const void *drvConfDelta);
+
+bool confZoneValid(const void *drvZone, quint32 size);
+quint8 confZoneIpIncluded(const void *drvZone, const ip_addr_t ip, bool isIPv6);
 
 bool provRegister(bool bootFilter);
 void provUnregister();
@@ -89,6 +89,8 @@ bool DriverManager::openDevice()
 
 bool DriverManager::closeDevice()
 {
+    driverWorker()->resetLogShared();
+
     const bool res = device()->close();
 
     updateErrorCode(true);
@@ -110,14 +112,28 @@ bool DriverManager::writeServices(QByteArray &buf)
 
 bool DriverManager::writeConf(QByteArray &buf, bool onlyFlags)
 {
+    if (!onlyFlags) {
+        logConfStat(); // of the replaced conf
+    }
+
     return writeData(onlyFlags ? DriverCommon::ioctlSetFlags() : DriverCommon::ioctlSetConf(), buf);
 }
 
+bool DriverManager::writeConfDelta(QByteArray &buf)
+{
+    return writeData(DriverCommon::ioctlSetConfDelta(), buf);
+}
+
 bool DriverManager::writeApp(QByteArray &buf, bool remove)
 {
     return writeData(remove ? DriverCommon::ioctlDelApp() : DriverCommon::ioctlAddApp(), buf);
 }
 
+bool DriverManager::writeApps(QByteArray &buf)
+{
+    return writeData(DriverCommon::ioctlUpdateApps(), buf);
+}
+
 bool DriverManager::writeZones(QByteArray &buf, bool onlyFlags)
 {
     const auto code = onlyFlags ? DriverCommon::ioctlSetZoneFlag() : DriverCommon::ioctlSetZones();
@@ -125,6 +141,11 @@ bool DriverManager::writeZones(QByteArray &buf, bool onlyFlags)
     return writeData(code, buf);
 }
 
+bool DriverManager::writeZone(QByteArray &buf)
+{
+    return writeData(DriverCommon::ioctlSetZone(), buf);
+}
+
 bool DriverManager::writeRules(QByteArray &buf, bool onlyFlags)
 {
     const auto code = onlyFlags ? DriverCommon::ioctlSetRuleFlag() : DriverCommon::ioctlSetRules();
@@ -132,6 +153,22 @@ bool DriverManager::writeRules(QByteArray &buf, bool onlyFlags)
     return writeData(code, buf);
 }
 
+bool DriverManager::readConfStat(FORT_CONF_STAT &confStat)
+{
+    return readData(DriverCommon::ioctlGetConfStat(), (char *) &confStat, sizeof(FORT_CONF_STAT));
+}
+
+void DriverManager::logConfStat()
+{
+    FORT_CONF_STAT confStat;
+    if (!readConfStat(confStat))
+        return;
+
+    qCDebug(LC) << "Conf stat: cache hits:" << confStat.cache_hits
+                << "misses:" << confStat.cache_misses << "scope reauths:" << confStat.scope_reauths
+                << "skips:" << confStat.scope_skips;
+}
+
 bool DriverManager::writeData(quint32 code, QByteArray &buf)
 {
     if (!isDeviceOpened())
@@ -150,6 +187,23 @@ bool DriverManager::writeData(quint32 code, QByteArray &buf)
     return res;
 }
 
+bool DriverManager::readData(quint32 code, char *out, int outSize)
+{
+    if (!isDeviceOpened())
+        return false;
+
+    const bool wasCancelled = driverWorker()->cancelAsyncIo();
+
+    qsizetype retSize = 0;
+    const bool res = device()->ioctl(code, nullptr, 0, out, outSize, &retSize);
+
+    if (wasCancelled) {
+        driverWorker()->continueAsyncIo();
+    }
+
+    return res && retSize == outSize;
+}
+
 bool DriverManager::checkReinstallDriver()
 {
     return executeCommand("check-reinstall.bat");
@@ -3,6 +3,8 @@
 
 #include <QObject>
 
+#include <common/fortconf.h>
+
 #include <util/classhelpers.h>
 #include <util/ioc/iocservice.h>
 
@@ -45,10 +47,15 @@ public slots:
 
     bool writeServices(QByteArray &buf);
     bool writeConf(QByteArray &buf, bool onlyFlags = false);
+    bool writeConfDelta(QByteArray &buf);
     bool writeApp(QByteArray &buf, bool remove = false);
+    bool writeApps(QByteArray &buf);
     bool writeZones(QByteArray &buf, bool onlyFlags = false);
+    bool writeZone(QByteArray &buf);
     bool writeRules(QByteArray &buf, bool onlyFlags = false);
 
+    bool readConfStat(FORT_CONF_STAT &confStat);
+
 protected:
     void setErrorCode(quint32 v);
 
@@ -59,6 +66,9 @@ private:
     void closeWorker();
 
     bool writeData(quint32 code, QByteArray &buf);
+    bool readData(quint32 code, char *out, int outSize);
+
+    void logConfStat();
 
     static bool executeCommand(const QString &fileName);
 
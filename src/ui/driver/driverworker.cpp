@@ -5,6 +5,12 @@
 #include <util/device.h>
 #include <util/osutil.h>
 
+namespace {
+
+constexpr quint32 logSharedSize = 4 * 1024 * 1024;
+
+}
+
 DriverWorker::DriverWorker(Device *device, QObject *parent) : QObject(parent), m_device(device) { }
 
 void DriverWorker::run()
@@ -62,6 +68,21 @@ void DriverWorker::continueAsyncIo()
     }
 }
 
+void *DriverWorker::logShared()
+{
+    QMutexLocker locker(&m_mutex);
+
+    return m_logShared;
+}
+
+void DriverWorker::resetLogShared()
+{
+    QMutexLocker locker(&m_mutex);
+
+    m_logShared = nullptr;
+    m_logSharedChecked = false;
+}
+
 void DriverWorker::close()
 {
     if (m_aborted)
@@ -104,16 +125,48 @@ void DriverWorker::emitReadLogResult(bool success, quint32 errorCode)
     }
 }
 
+void *DriverWorker::checkLogShared()
+{
+    QMutexLocker locker(&m_mutex);
+
+    if (!m_logSharedChecked) {
+        m_logSharedChecked = true;
+
+        mapLogShared();
+    }
+
+    return m_logShared;
+}
+
+void DriverWorker::mapLogShared()
+{
+    QByteArray buf(DriverCommon::logSharedMapSize(), Qt::Uninitialized);
+    DriverCommon::logSharedMapWrite(buf.data(), logSharedSize);
+
+    qsizetype nr = 0;
+
+    // Fall back to the log reading, when the driver can't map its log
+    if (m_device->ioctl(DriverCommon::ioctlMapLog(), buf.data(), buf.size(), buf.data(),
+                buf.size(), &nr)) {
+        m_logShared = DriverCommon::logSharedMapRead(buf.constData());
+    }
+}
+
 void DriverWorker::readLog()
 {
     if (!waitLogBuffer())
         return;
 
+    void *logShared = checkLogShared();
+
     QByteArray &array = m_logBuffer->array();
     qsizetype nr = 0;
 
-    const bool success = m_device->ioctl(
-            DriverCommon::ioctlGetLog(), nullptr, 0, array.data(), array.size(), &nr);
+    // The shared log's request is a doorbell only
+    const bool success = logShared
+            ? m_device->ioctl(DriverCommon::ioctlGetLog(), nullptr, 0, nullptr, 0, &nr)
+            : m_device->ioctl(
+                      DriverCommon::ioctlGetLog(), nullptr, 0, array.data(), array.size(), &nr);
 
     quint32 errorCode = 0;
 
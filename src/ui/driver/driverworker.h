@@ -16,6 +16,8 @@ class DriverWorker : public QObject, public QRunnable
 public:
     explicit DriverWorker(Device *device, QObject *parent = nullptr);
 
+    void *logShared();
+
     void run() override;
 
 signals:
@@ -25,23 +27,30 @@ public slots:
     bool readLogAsync(LogBuffer *logBuffer);
     bool cancelAsyncIo();
     void continueAsyncIo();
+    void resetLogShared();
     void close();
 
 private:
     bool waitLogBuffer();
     void emitReadLogResult(bool success, quint32 errorCode = 0);
 
+    void *checkLogShared();
+    void mapLogShared();
+
     void readLog();
 
 private:
     volatile bool m_isLogReading = false;
     volatile bool m_cancelled = false;
     volatile bool m_aborted = false;
+    bool m_logSharedChecked = false;
 
     Device *m_device = nullptr;
 
     LogBuffer *m_logBuffer = nullptr;
 
+    void *m_logShared = nullptr; // mapped by the driver
+
     QMutex m_mutex;
     QWaitCondition m_bufferWaitCondition;
     QWaitCondition m_cancelledWaitCondition;
@@ -166,6 +166,7 @@ void ApplicationsPage::onRetranslateUi()
     m_limitPacketLoss->label()->setText(tr("Packet Loss:"));
     m_limitBufferSizeIn->label()->setText(tr("Download Buffer Size:"));
     m_limitBufferSizeOut->label()->setText(tr("Upload Buffer Size:"));
+    m_cbLimitCodel->setText(tr("Drop packets by queueing delay (CoDel)"));
 
     m_cbGroupEnabled->setText(tr("Enabled"));
     m_ctpGroupPeriod->checkBox()->setText(tr("time period:"));
@@ -413,12 +414,14 @@ void ApplicationsPage::setupGroupOptions()
     setupGroupLimitLatency();
     setupGroupLimitPacketLoss();
     setupGroupLimitBufferSize();
+    setupGroupLimitCodel();
 
     // Menu
     auto layout = ControlUtil::createVLayoutByWidgets(
             { m_cbApplyChild, ControlUtil::createSeparator(), m_cbLogBlocked, m_cbLogConn,
                     ControlUtil::createSeparator(), m_cscLimitIn, m_cscLimitOut, m_limitLatency,
-                    m_limitPacketLoss, m_limitBufferSizeIn, m_limitBufferSizeOut });
+                    m_limitPacketLoss, m_limitBufferSizeIn, m_limitBufferSizeOut,
+                    m_cbLimitCodel });
 
     auto menu = ControlUtil::createMenuByLayout(layout, this);
 
@@ -508,6 +511,12 @@ void ApplicationsPage::setupGroupLimitBufferSize()
     });
 }
 
+void ApplicationsPage::setupGroupLimitCodel()
+{
+    m_cbLimitCodel = ControlUtil::createCheckBox(false,
+            [&](bool checked) { pageAppGroupSetChecked(this, &AppGroup::setLimitCodel, checked); });
+}
+
 void ApplicationsPage::setupKillApps()
 {
     m_killApps = new AppsColumn(":/icons/scull.png");
@@ -595,6 +604,7 @@ void ApplicationsPage::updateGroup()
     m_limitPacketLoss->spinBox()->setValue(double(appGroup->limitPacketLoss()) / 100.0);
     m_limitBufferSizeIn->spinBox()->setValue(int(appGroup->limitBufferSizeIn()));
     m_limitBufferSizeOut->spinBox()->setValue(int(appGroup->limitBufferSizeOut()));
+    m_cbLimitCodel->setChecked(appGroup->limitCodel());
 
     m_cbGroupEnabled->setChecked(appGroup->enabled());
 
@@ -473,7 +473,7 @@ void FortManager::setupTaskManager()
     });
 
     connect(taskManager, &TaskManager::zonesUpdated, IoC<ConfZoneManager>(),
-            &ConfZoneManager::updateDriverZones);
+            &ConfZoneManager::updateDriverZonesChanged);
 
     connect(taskManager, &TaskManager::taskDoubleClicked, this, [&](qint8 taskType) {
         auto windowManager = IoC<WindowManager>();
@@ -543,8 +543,8 @@ bool FortManager::setupDriverConf()
     {
         auto zd = IoC<TaskManager>()->taskInfoZoneDownloader();
 
-        IoC<ConfZoneManager>()->updateDriverZones(
-                zd->dataZonesMask(), zd->enabledMask(), zd->dataSize(), zd->zonesData());
+        IoC<ConfZoneManager>()->updateDriverZones(zd->dataZonesMask(), zd->enabledMask(),
+                zd->dataSize(), zd->zonesData(), zd->zonesChecksums());
     }
 
     // Rules
@@ -3,6 +3,7 @@
 #include <driver/drivercommon.h>
 
 #include "logentryapp.h"
+#include "logentrybufferstat.h"
 #include "logentryconn.h"
 #include "logentryprocnew.h"
 #include "logentrystattraf.h"
@@ -14,6 +15,11 @@ LogBuffer::LogBuffer(int bufferSize, QObject *parent) :
 {
 }
 
+LogBuffer::LogBuffer(const char *data, int size, QObject *parent) :
+    QObject(parent), m_top(size), m_array(QByteArray::fromRawData(data, size))
+{
+}
+
 void LogBuffer::reset(int top)
 {
     m_top = top;
@@ -61,7 +67,8 @@ void LogBuffer::writeEntryApp(const LogEntryApp *logEntry)
 
     char *output = this->output();
 
-    DriverCommon::logAppHeaderWrite(output, logEntry->blocked(), logEntry->pid(), pathLen);
+    DriverCommon::logAppHeaderWrite(
+            output, logEntry->blocked(), logEntry->pid(), logEntry->pathId(), pathLen);
 
     if (pathLen > 0) {
         output += DriverCommon::logAppHeaderSize();
@@ -79,8 +86,9 @@ void LogBuffer::readEntryApp(LogEntryApp *logEntry)
 
     int blocked;
     quint32 pid;
+    quint32 pathId;
     quint16 pathLen;
-    DriverCommon::logAppHeaderRead(input, &blocked, &pid, &pathLen);
+    DriverCommon::logAppHeaderRead(input, &blocked, &pid, &pathId, &pathLen);
 
     QString path;
     if (pathLen > 0) {
@@ -90,6 +98,7 @@ void LogBuffer::readEntryApp(LogEntryApp *logEntry)
 
     logEntry->setBlocked(blocked);
     logEntry->setPid(pid);
+    logEntry->setPathId(pathId);
     logEntry->setKernelPath(path);
 
     const int entrySize = int(DriverCommon::logAppSize(pathLen));
@@ -122,7 +131,7 @@ void LogBuffer::writeEntryConn(const LogEntryConn *logEntry)
         .remote_ip = logEntry->remoteIp(),
     };
 
-    DriverCommon::logConnHeaderWrite(output, &conn, pathLen);
+    DriverCommon::logConnHeaderWrite(output, &conn, logEntry->pathId(), pathLen);
 
     if (pathLen) {
         output += DriverCommon::logConnHeaderSize(logEntry->isIPv6());
@@ -139,9 +148,10 @@ void LogBuffer::readEntryConn(LogEntryConn *logEntry)
     const char *input = this->input();
 
     FORT_CONF_META_CONN conn;
+    quint32 pathId;
     quint16 pathLen;
 
-    DriverCommon::logConnHeaderRead(input, &conn, &pathLen);
+    DriverCommon::logConnHeaderRead(input, &conn, &pathId, &pathLen);
 
     QString path;
     if (pathLen > 0) {
@@ -162,6 +172,7 @@ void LogBuffer::readEntryConn(LogEntryConn *logEntry)
     logEntry->setLocalIp(conn.local_ip);
     logEntry->setRemoteIp(conn.remote_ip);
     logEntry->setPid(conn.process_id);
+    logEntry->setPathId(pathId);
     logEntry->setKernelPath(path);
 
     const int entrySize = int(DriverCommon::logConnSize(pathLen, conn.isIPv6));
@@ -178,7 +189,7 @@ void LogBuffer::writeEntryProcNew(const LogEntryProcNew *logEntry)
 
     char *output = this->output();
 
-    DriverCommon::logProcNewHeaderWrite(output, logEntry->pid(), pathLen);
+    DriverCommon::logProcNewHeaderWrite(output, logEntry->pid(), logEntry->pathId(), pathLen);
 
     if (pathLen > 0) {
         output += DriverCommon::logProcNewHeaderSize();
@@ -195,8 +206,9 @@ void LogBuffer::readEntryProcNew(LogEntryProcNew *logEntry)
     const char *input = this->input();
 
     quint32 pid;
+    quint32 pathId;
     quint16 pathLen;
-    DriverCommon::logProcNewHeaderRead(input, &pid, &pathLen);
+    DriverCommon::logProcNewHeaderRead(input, &pid, &pathId, &pathLen);
 
     QString path;
     if (pathLen > 0) {
@@ -205,12 +217,37 @@ void LogBuffer::readEntryProcNew(LogEntryProcNew *logEntry)
     }
 
     logEntry->setPid(pid);
+    logEntry->setPathId(pathId);
     logEntry->setKernelPath(path);
 
     const int entrySize = int(DriverCommon::logProcNewSize(pathLen));
     m_offset += entrySize;
 }
 
+void LogBuffer::writeEntryStatTraf(const LogEntryStatTraf *logEntry)
+{
+    const QVector<ProcTraf> &procTrafs = logEntry->procTrafs();
+
+    quint32 dataLen = 0;
+    for (const ProcTraf &pt : procTrafs) {
+        dataLen += DriverCommon::logStatTrafProcSize(pt.pidFlag, pt.inBytes, pt.outBytes);
+    }
+
+    const int entrySize = int(DriverCommon::logStatSize(dataLen));
+    prepareFor(entrySize);
+
+    char *output = this->output();
+
+    DriverCommon::logStatTrafHeaderWrite(output, logEntry->procCount(), dataLen);
+    output += DriverCommon::logStatHeaderSize();
+
+    for (const ProcTraf &pt : procTrafs) {
+        output = DriverCommon::logStatTrafProcWrite(output, pt.pidFlag, pt.inBytes, pt.outBytes);
+    }
+
+    m_top += entrySize;
+}
+
 void LogBuffer::readEntryStatTraf(LogEntryStatTraf *logEntry)
 {
     Q_ASSERT(m_offset < m_top);
@@ -218,16 +255,28 @@ void LogBuffer::readEntryStatTraf(LogEntryStatTraf *logEntry)
     const char *input = this->input();
 
     quint16 procCount;
-    DriverCommon::logStatTrafHeaderRead(input, &procCount);
+    quint32 dataLen;
+    DriverCommon::logStatTrafHeaderRead(input, &procCount, &dataLen);
+
+    const quint32 headerSize = DriverCommon::logStatHeaderSize();
+    const quint32 dataSize = qMin(dataLen, quint32(m_top - m_offset) - headerSize);
+
+    input += headerSize;
+    const char *end = input + dataSize;
 
-    logEntry->setProcCount(procCount);
+    logEntry->clear();
 
-    if (procCount != 0) {
-        input += DriverCommon::logStatHeaderSize();
-        logEntry->setProcTrafBytes(reinterpret_cast<const quint32 *>(input));
+    for (int i = 0; i < procCount && input != nullptr; ++i) {
+        ProcTraf pt;
+        input = DriverCommon::logStatTrafProcRead(
+                input, end, &pt.pidFlag, &pt.inBytes, &pt.outBytes);
+
+        if (input != nullptr) {
+            logEntry->addProcTraf(pt);
+        }
     }
 
-    const int entrySize = int(DriverCommon::logStatSize(procCount));
+    const int entrySize = int(DriverCommon::logStatSize(dataLen));
     m_offset += entrySize;
 }
 
@@ -259,3 +308,20 @@ void LogBuffer::readEntryTime(LogEntryTime *logEntry)
     const int entrySize = int(DriverCommon::logTimeSize());
     m_offset += entrySize;
 }
+
+void LogBuffer::readEntryBufferStat(LogEntryBufferStat *logEntry)
+{
+    Q_ASSERT(m_offset < m_top);
+
+    const char *input = this->input();
+
+    quint32 ringSize;
+    quint32 dropCount;
+    DriverCommon::logBufferStatRead(input, &ringSize, &dropCount);
+
+    logEntry->setRingSize(ringSize);
+    logEntry->setDropCount(dropCount);
+
+    const int entrySize = int(DriverCommon::logBufferStatSize());
+    m_offset += entrySize;
+}
@@ -7,6 +7,7 @@
 #include "logentry.h"
 
 class LogEntryApp;
+class LogEntryBufferStat;
 class LogEntryConn;
 class LogEntryProcNew;
 class LogEntryStatTraf;
@@ -18,6 +19,7 @@ class LogBuffer : public QObject
 
 public:
     explicit LogBuffer(int bufferSize = 0, QObject *parent = nullptr);
+    explicit LogBuffer(const char *data, int size, QObject *parent = nullptr);
 
     int top() const { return m_top; }
     int offset() const { return m_offset; }
@@ -35,11 +37,14 @@ public:
     void writeEntryProcNew(const LogEntryProcNew *logEntry);
     void readEntryProcNew(LogEntryProcNew *logEntry);
 
+    void writeEntryStatTraf(const LogEntryStatTraf *logEntry);
     void readEntryStatTraf(LogEntryStatTraf *logEntry);
 
     void writeEntryTime(const LogEntryTime *logEntry);
     void readEntryTime(LogEntryTime *logEntry);
 
+    void readEntryBufferStat(LogEntryBufferStat *logEntry);
+
 public slots:
     void reset(int top = 0);
 
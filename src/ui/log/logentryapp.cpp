@@ -7,5 +7,5 @@ LogEntryApp::LogEntryApp(quint32 pid, const QString &kernelPath) :
 
 QString LogEntryApp::path() const
 {
-    return getAppPath(m_kernelPath, m_pid);
+    return m_appPath.isEmpty() ? getAppPath(m_kernelPath, m_pid) : m_appPath;
 }
@@ -19,16 +19,23 @@ public:
     quint32 pid() const { return m_pid; }
     void setPid(quint32 v) { m_pid = v; }
 
+    quint32 pathId() const { return m_pathId; }
+    void setPathId(quint32 v) { m_pathId = v; }
+
     QString kernelPath() const { return m_kernelPath; }
     void setKernelPath(const QString &v) { m_kernelPath = v; }
 
+    void setAppPath(const QString &v) { m_appPath = v; }
+
     QString path() const;
 
 private:
     bool m_blocked : 1 = true;
     bool m_alerted : 1 = true;
     quint32 m_pid = 0;
+    quint32 m_pathId = 0;
     QString m_kernelPath;
+    QString m_appPath; // resolved by the interned path
 };
 
 #endif // LOGENTRYAPP_H
@@ -0,0 +1,16 @@
+#include "logentrybufferstat.h"
+
+LogEntryBufferStat::LogEntryBufferStat(quint32 ringSize, quint32 dropCount) :
+    m_ringSize(ringSize), m_dropCount(dropCount)
+{
+}
+
+void LogEntryBufferStat::setRingSize(quint32 ringSize)
+{
+    m_ringSize = ringSize;
+}
+
+void LogEntryBufferStat::setDropCount(quint32 dropCount)
+{
+    m_dropCount = dropCount;
+}
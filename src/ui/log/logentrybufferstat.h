@@ -0,0 +1,24 @@
+#ifndef LOGENTRYBUFFERSTAT_H
+#define LOGENTRYBUFFERSTAT_H
+
+#include "logentry.h"
+
+class LogEntryBufferStat : public LogEntry
+{
+public:
+    explicit LogEntryBufferStat(quint32 ringSize = 0, quint32 dropCount = 0);
+
+    FortLogType type() const override { return FORT_LOG_TYPE_BUFFER_STAT; }
+
+    quint32 ringSize() const { return m_ringSize; }
+    void setRingSize(quint32 ringSize);
+
+    quint32 dropCount() const { return m_dropCount; }
+    void setDropCount(quint32 dropCount);
+
+private:
+    quint32 m_ringSize = 0;
+    quint32 m_dropCount = 0;
+};
+
+#endif // LOGENTRYBUFFERSTAT_H
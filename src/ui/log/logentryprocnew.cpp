@@ -10,12 +10,22 @@ void LogEntryProcNew::setPid(quint32 pid)
     m_pid = pid;
 }
 
+void LogEntryProcNew::setPathId(quint32 pathId)
+{
+    m_pathId = pathId;
+}
+
 void LogEntryProcNew::setKernelPath(const QString &kernelPath)
 {
     m_kernelPath = kernelPath;
 }
 
+void LogEntryProcNew::setAppPath(const QString &appPath)
+{
+    m_appPath = appPath;
+}
+
 QString LogEntryProcNew::path() const
 {
-    return getAppPath(m_kernelPath, m_pid);
+    return m_appPath.isEmpty() ? getAppPath(m_kernelPath, m_pid) : m_appPath;
 }
@@ -13,14 +13,21 @@ public:
     quint32 pid() const { return m_pid; }
     void setPid(quint32 pid);
 
+    quint32 pathId() const { return m_pathId; }
+    void setPathId(quint32 pathId);
+
     QString kernelPath() const { return m_kernelPath; }
     void setKernelPath(const QString &kernelPath);
 
+    void setAppPath(const QString &appPath);
+
     QString path() const;
 
 private:
     quint32 m_pid = 0;
+    quint32 m_pathId = 0;
     QString m_kernelPath;
+    QString m_appPath; // resolved by the interned path
 };
 
 #endif // LOGENTRYPROCNEW_H
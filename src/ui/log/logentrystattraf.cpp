@@ -1,16 +1,8 @@
 #include "logentrystattraf.h"
 
-LogEntryStatTraf::LogEntryStatTraf(quint16 procCount, const quint32 *procTrafBytes) :
-    m_procCount(procCount), m_procTrafBytes(procTrafBytes)
-{
-}
-
-void LogEntryStatTraf::setProcCount(quint16 procCount)
-{
-    m_procCount = procCount;
-}
+LogEntryStatTraf::LogEntryStatTraf(const QVector<ProcTraf> &procTrafs) : m_procTrafs(procTrafs) { }
 
-void LogEntryStatTraf::setProcTrafBytes(const quint32 *procTrafBytes)
+void LogEntryStatTraf::setProcTrafs(const QVector<ProcTraf> &procTrafs)
 {
-    m_procTrafBytes = procTrafBytes;
+    m_procTrafs = procTrafs;
 }
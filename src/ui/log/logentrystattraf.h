@@ -1,24 +1,34 @@
 #ifndef LOGENTRYSTATTRAF_H
 #define LOGENTRYSTATTRAF_H
 
+#include <QVector>
+
 #include "logentry.h"
 
+struct ProcTraf
+{
+    quint32 pidFlag = 0; // pid | terminated flag
+    quint64 inBytes = 0;
+    quint64 outBytes = 0;
+};
+
 class LogEntryStatTraf : public LogEntry
 {
 public:
-    explicit LogEntryStatTraf(quint16 procCount = 0, const quint32 *procTrafBytes = nullptr);
+    explicit LogEntryStatTraf(const QVector<ProcTraf> &procTrafs = {});
 
     FortLogType type() const override { return FORT_LOG_TYPE_STAT_TRAF; }
 
-    quint16 procCount() const { return m_procCount; }
-    void setProcCount(quint16 procCount);
+    quint16 procCount() const { return quint16(m_procTrafs.size()); }
+
+    const QVector<ProcTraf> &procTrafs() const { return m_procTrafs; }
+    void setProcTrafs(const QVector<ProcTraf> &procTrafs);
 
-    const quint32 *procTrafBytes() const { return m_procTrafBytes; }
-    void setProcTrafBytes(const quint32 *procTrafBytes);
+    void clear() { m_procTrafs.clear(); }
+    void addProcTraf(const ProcTraf &procTraf) { m_procTrafs.append(procTraf); }
 
 private:
-    quint16 m_procCount = 0;
-    const quint32 *m_procTrafBytes = nullptr;
+    QVector<ProcTraf> m_procTrafs;
 };
 
 #endif // LOGENTRYSTATTRAF_H
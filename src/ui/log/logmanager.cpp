@@ -4,6 +4,7 @@
 
 #include <conf/confappmanager.h>
 #include <conf/confmanager.h>
+#include <conf/firewallconf.h>
 #include <driver/drivercommon.h>
 #include <driver/drivermanager.h>
 #include <driver/driverworker.h>
@@ -11,11 +12,14 @@
 #include <stat/statconnmanager.h>
 #include <stat/statmanager.h>
 #include <util/dateutil.h>
+#include <util/fileutil.h>
 #include <util/ioc/ioccontainer.h>
 #include <util/osutil.h>
+#include <util/processinfo.h>
 
 #include "logbuffer.h"
 #include "logentryapp.h"
+#include "logentrybufferstat.h"
 #include "logentryconn.h"
 #include "logentryprocnew.h"
 #include "logentrystattraf.h"
@@ -66,6 +70,12 @@ void LogManager::setUp()
 
     connect(driverManager->driverWorker(), &DriverWorker::readLogResult, this,
             &LogManager::processLogBuffer, Qt::QueuedConnection);
+
+    // The driver forgets the written paths, when the device is closed
+    connect(driverManager, &DriverManager::isDeviceOpenedChanged, this,
+            &LogManager::clearKernelPaths);
+
+    setupConfManager();
 }
 
 void LogManager::tearDown()
@@ -73,6 +83,24 @@ void LogManager::tearDown()
     const auto driverManager = IoC<DriverManager>();
 
     driverManager->driverWorker()->disconnect(this);
+    driverManager->disconnect(this);
+}
+
+void LogManager::setupConfManager()
+{
+    auto confManager = IoCDependency<ConfManager>();
+
+    setupByConf(confManager->conf()->ini());
+
+    connect(confManager, &ConfManager::iniChanged, this, &LogManager::setupByConf);
+}
+
+void LogManager::setupByConf(const IniOptions &ini)
+{
+    constexpr int maxBufferSize = 1024 * 1024;
+
+    // The driver fills the buffer with as many entries as fit into it
+    m_bufferSize = qBound(DriverCommon::bufferSize(), ini.logBufferSizeKb() * 1024, maxBufferSize);
 }
 
 void LogManager::readLogAsync()
@@ -93,13 +121,74 @@ void LogManager::cancelAsyncIo()
     driverManager->driverWorker()->cancelAsyncIo();
 }
 
+void LogManager::clearKernelPaths()
+{
+    m_kernelPaths.clear();
+}
+
+bool LogManager::internKernelPath(
+        quint32 &pathId, quint32 pid, QString &kernelPath, QString &appPath)
+{
+    if (pathId == 0)
+        return true;
+
+    // The path is written with its id once, then only the id refers to it
+    if (!kernelPath.isEmpty()) {
+        appPath = FileUtil::kernelPathToPath(kernelPath);
+
+        m_kernelPaths.insert(pathId, { kernelPath, appPath });
+        return true;
+    }
+
+    const auto it = m_kernelPaths.constFind(pathId);
+    if (it != m_kernelPaths.constEnd()) {
+        kernelPath = it->kernelPath;
+        appPath = it->appPath;
+        return true;
+    }
+
+    // The id's path was missed, e.g. by the restarted UI: take the process' path.
+    // The pid may be reused by another program already, so the id is not bound to it.
+    kernelPath = ProcessInfo(pid).path(/*isKernelPath=*/true);
+    if (kernelPath.isEmpty()) {
+        qCWarning(LC) << "Log entry dropped: Unknown path id:" << pathId << "pid:" << pid;
+        return false;
+    }
+
+    pathId = 0;
+
+    return true;
+}
+
+template<class T>
+bool LogManager::internEntryPath(T &entry)
+{
+    quint32 pathId = entry.pathId();
+    QString kernelPath = entry.kernelPath();
+    QString appPath;
+
+    if (!internKernelPath(pathId, entry.pid(), kernelPath, appPath))
+        return false;
+
+    entry.setPathId(pathId);
+    entry.setKernelPath(kernelPath);
+    entry.setAppPath(appPath);
+
+    return true;
+}
+
 LogBuffer *LogManager::getFreeBuffer()
 {
-    if (!m_freeBuffers.isEmpty()) {
-        return m_freeBuffers.takeLast();
+    while (!m_freeBuffers.isEmpty()) {
+        LogBuffer *logBuffer = m_freeBuffers.takeLast();
+
+        if (logBuffer->array().size() == m_bufferSize)
+            return logBuffer;
+
+        delete logBuffer; // the buffer size is changed
     }
 
-    return new LogBuffer(DriverCommon::bufferSize(), this);
+    return new LogBuffer(m_bufferSize, this);
 }
 
 void LogManager::addFreeBuffer(LogBuffer *logBuffer)
@@ -115,12 +204,14 @@ void LogManager::addFreeBuffer(LogBuffer *logBuffer)
 
 void LogManager::processLogBuffer(LogBuffer *logBuffer, bool success, quint32 errorCode)
 {
-    if (m_active && (success || errorCode == 0)) {
-        readLogAsync();
-    }
-
     if (success) {
-        processLogEntries(logBuffer);
+        void *logShared = IoC<DriverManager>()->driverWorker()->logShared();
+
+        if (logShared) {
+            processLogShared(logShared);
+        } else {
+            processLogEntries(logBuffer);
+        }
     } else if (errorCode != 0) {
         const auto errorMessage = OsUtil::errorMessage(errorCode);
         setErrorMessage(errorMessage);
@@ -128,6 +219,28 @@ void LogManager::processLogBuffer(LogBuffer *logBuffer, bool success, quint32 er
 
     logBuffer->reset();
     addFreeBuffer(logBuffer);
+
+    // Re-arm after the shared log is drained, else the read completes at once on its unread data
+    if (m_active && (success || errorCode == 0)) {
+        readLogAsync();
+    }
+}
+
+void LogManager::processLogShared(void *logShared)
+{
+    // The unread data may wrap around the ring's end once
+    for (int i = 0; i < 2; ++i) {
+        const char *data;
+        const int len = DriverCommon::logSharedRead(logShared, &data);
+        if (len == 0)
+            break;
+
+        LogBuffer logBuffer(data, len);
+
+        processLogEntries(&logBuffer);
+
+        DriverCommon::logSharedConsume(logShared, len);
+    }
 }
 
 void LogManager::processLogEntries(LogBuffer *logBuffer)
@@ -147,6 +260,8 @@ void LogManager::processLogEntries(LogBuffer *logBuffer)
 bool LogManager::processLogEntry(LogBuffer *logBuffer, FortLogType logType)
 {
     switch (logType) {
+    case FORT_LOG_TYPE_NONE:
+        return false; // the end of data or the skipped end of the shared log
     case FORT_LOG_TYPE_APP:
         return processLogEntryApp(logBuffer);
     case FORT_LOG_TYPE_CONN:
@@ -157,6 +272,8 @@ bool LogManager::processLogEntry(LogBuffer *logBuffer, FortLogType logType)
         return processLogEntryStatTraf(logBuffer);
     case FORT_LOG_TYPE_TIME:
         return processLogEntryTime(logBuffer);
+    case FORT_LOG_TYPE_BUFFER_STAT:
+        return processLogEntryBufferStat(logBuffer);
     default:
         return processLogEntryError(logBuffer, logType);
     }
@@ -167,6 +284,9 @@ bool LogManager::processLogEntryApp(LogBuffer *logBuffer)
     LogEntryApp appEntry;
     logBuffer->readEntryApp(&appEntry);
 
+    if (!internEntryPath(appEntry))
+        return true; // skip the entry
+
     IoC<ConfAppManager>()->logApp(appEntry);
 
     return true;
@@ -177,6 +297,9 @@ bool LogManager::processLogEntryConn(LogBuffer *logBuffer)
     LogEntryConn connEntry;
     logBuffer->readEntryConn(&connEntry);
 
+    if (!internEntryPath(connEntry))
+        return true; // skip the entry
+
     connEntry.setConnTime(currentUnixTime());
 
     if (connEntry.isAskPending()) {
@@ -193,6 +316,9 @@ bool LogManager::processLogEntryProcNew(LogBuffer *logBuffer)
     LogEntryProcNew procNewEntry;
     logBuffer->readEntryProcNew(&procNewEntry);
 
+    if (!internEntryPath(procNewEntry))
+        return true; // skip the entry
+
     IoC<StatManager>()->logProcNew(procNewEntry, currentUnixTime());
 
     return true;
@@ -222,6 +348,17 @@ bool LogManager::processLogEntryTime(LogBuffer *logBuffer)
     return true;
 }
 
+bool LogManager::processLogEntryBufferStat(LogBuffer *logBuffer)
+{
+    LogEntryBufferStat bufferStatEntry;
+    logBuffer->readEntryBufferStat(&bufferStatEntry);
+
+    qCWarning(LC) << "Log entries dropped:" << bufferStatEntry.dropCount()
+                  << "ring size:" << bufferStatEntry.ringSize();
+
+    return true;
+}
+
 bool LogManager::processLogEntryError(LogBuffer *logBuffer, FortLogType logType)
 {
     if (logBuffer->offset() < logBuffer->top()) {
@@ -1,11 +1,13 @@
 #ifndef LOGMANAGER_H
 #define LOGMANAGER_H
 
+#include <QHash>
 #include <QObject>
 
 #include <common/fortdef.h>
 #include <util/ioc/iocservice.h>
 
+class IniOptions;
 class LogBuffer;
 class LogEntry;
 
@@ -31,18 +33,29 @@ signals:
 private slots:
     void processLogBuffer(LogBuffer *logBuffer, bool success, quint32 errorCode);
 
+    void setupByConf(const IniOptions &ini);
+
 private:
     void setErrorMessage(const QString &errorMessage);
 
+    void setupConfManager();
+
     qint64 currentUnixTime() const;
     void setCurrentUnixTime(qint64 unixTime);
 
     void readLogAsync();
     void cancelAsyncIo();
 
+    void clearKernelPaths();
+    bool internKernelPath(quint32 &pathId, quint32 pid, QString &kernelPath, QString &appPath);
+
+    template<class T>
+    bool internEntryPath(T &entry);
+
     LogBuffer *getFreeBuffer();
     void addFreeBuffer(LogBuffer *logBuffer);
 
+    void processLogShared(void *logShared);
     void processLogEntries(LogBuffer *logBuffer);
     bool processLogEntry(LogBuffer *logBuffer, FortLogType logType);
     bool processLogEntryApp(LogBuffer *logBuffer);
@@ -50,13 +63,25 @@ private:
     bool processLogEntryProcNew(LogBuffer *logBuffer);
     bool processLogEntryStatTraf(LogBuffer *logBuffer);
     bool processLogEntryTime(LogBuffer *logBuffer);
+    bool processLogEntryBufferStat(LogBuffer *logBuffer);
     bool processLogEntryError(LogBuffer *logBuffer, FortLogType logType);
 
 private:
+    struct KernelPath
+    {
+        QString kernelPath;
+        QString appPath;
+    };
+
     bool m_active = false;
 
+    int m_bufferSize = 0;
+
     QList<LogBuffer *> m_freeBuffers;
 
+    // Kept for the UI's lifetime, until the driver clears its paths
+    QHash<quint32, KernelPath> m_kernelPaths; // pathId => paths
+
     QString m_errorMessage;
 
     qint64 m_currentUnixTime = 0;
@@ -52,3 +52,15 @@ qint64 AppConnListModel::connIdByIndex(int row) const
 
     return m_connIds.value(row);
 }
+
+void AppConnListModel::fillQueryVars(QVariantHash &vars) const
+{
+    vars.insert(":path", appPath());
+}
+
+QString AppConnListModel::sqlWhere() const
+{
+    // Use the app's index for the keyset of its conn_id-s
+    return ConnListModel::sqlWhere()
+            + " AND t.app_id = (SELECT app_id FROM app WHERE path = :path)";
+}
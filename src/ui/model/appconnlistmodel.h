@@ -23,6 +23,10 @@ protected:
 
     qint64 connIdByIndex(int row) const override;
 
+    void fillQueryVars(QVariantHash &vars) const override;
+
+    QString sqlWhere() const override;
+
     int doSqlCount() const override { return m_connIds.size(); }
 
 private:
@@ -10,6 +10,7 @@
 #include <manager/translationmanager.h>
 #include <util/conf/confutil.h>
 #include <util/ioc/ioccontainer.h>
+#include <util/model/tablesqlrows.h>
 #include <util/net/netutil.h>
 
 #include "applistmodeldata.h"
@@ -88,6 +89,8 @@ void AppListModel::initialize()
     setSortColumn(int(AppListColumn::CreationTime));
     setSortOrder(Qt::DescendingOrder);
 
+    setupSqlLoader();
+
     connect(confManager(), &ConfManager::confChanged, this, &AppListModel::refresh);
 
     connect(confAppManager(), &ConfAppManager::appsChanged, this, &TableItemModel::reset);
@@ -126,7 +129,7 @@ QVariant AppListModel::headerData(int section, Qt::Orientation orientation, int
 
 QVariant AppListModel::data(const QModelIndex &index, int role) const
 {
-    if (!index.isValid())
+    if (!index.isValid() || isRowLoading(index.row()))
         return {};
 
     switch (role) {
@@ -216,42 +219,46 @@ AppStatesCount AppListModel::appStatesCount() const
     };
 }
 
-bool AppListModel::updateTableRow(const QVariantHash &vars, int /*row*/) const
+TableSqlRowsPtr AppListModel::createTableRows() const
 {
-    SqliteStmt stmt;
-    if (!DbQuery(sqliteDb()).sql(sql()).vars(vars).prepareRow(stmt)) {
-        m_appRow.invalidate();
-        return false;
-    }
+    return TableSqlRowsPtr(new TableSqlRowList<AppRow>(&fillAppRow));
+}
 
-    m_appRow.appId = stmt.columnInt64(0);
-    m_appRow.appOriginPath = stmt.columnText(1);
-    m_appRow.appPath = stmt.columnText(2);
-    m_appRow.appName = stmt.columnText(3);
-    m_appRow.notes = stmt.columnText(4);
-    m_appRow.isWildcard = stmt.columnBool(5);
-    m_appRow.applyParent = stmt.columnBool(6);
-    m_appRow.applyChild = stmt.columnBool(7);
-    m_appRow.applySpecChild = stmt.columnBool(8);
-    m_appRow.killChild = stmt.columnBool(9);
-    m_appRow.lanOnly = stmt.columnBool(10);
-    m_appRow.parked = stmt.columnBool(11);
-    m_appRow.logAllowedConn = stmt.columnBool(12);
-    m_appRow.logBlockedConn = stmt.columnBool(13);
-    m_appRow.blocked = stmt.columnBool(14);
-    m_appRow.killProcess = stmt.columnBool(15);
-    m_appRow.zones.accept_mask = stmt.columnUInt(16);
-    m_appRow.zones.reject_mask = stmt.columnUInt(17);
-    m_appRow.ruleId = stmt.columnUInt(18);
-    m_appRow.scheduleAction = stmt.columnInt(19);
-    m_appRow.scheduleTime = stmt.columnDateTime(20);
-    m_appRow.creatTime = stmt.columnDateTime(21);
-    m_appRow.groupIndex = stmt.columnInt(22);
-    m_appRow.alerted = stmt.columnBool(23);
+bool AppListModel::loadTableRow(const TableSqlRows &rows, int blockIndex) const
+{
+    m_appRow = static_cast<const TableSqlRowList<AppRow> &>(rows).at(blockIndex);
 
     return true;
 }
 
+void AppListModel::fillAppRow(AppRow &appRow, SqliteStmt &stmt)
+{
+    appRow.appId = stmt.columnInt64(0);
+    appRow.appOriginPath = stmt.columnText(1);
+    appRow.appPath = stmt.columnText(2);
+    appRow.appName = stmt.columnText(3);
+    appRow.notes = stmt.columnText(4);
+    appRow.isWildcard = stmt.columnBool(5);
+    appRow.applyParent = stmt.columnBool(6);
+    appRow.applyChild = stmt.columnBool(7);
+    appRow.applySpecChild = stmt.columnBool(8);
+    appRow.killChild = stmt.columnBool(9);
+    appRow.lanOnly = stmt.columnBool(10);
+    appRow.parked = stmt.columnBool(11);
+    appRow.logAllowedConn = stmt.columnBool(12);
+    appRow.logBlockedConn = stmt.columnBool(13);
+    appRow.blocked = stmt.columnBool(14);
+    appRow.killProcess = stmt.columnBool(15);
+    appRow.zones.accept_mask = stmt.columnUInt(16);
+    appRow.zones.reject_mask = stmt.columnUInt(17);
+    appRow.ruleId = stmt.columnUInt(18);
+    appRow.scheduleAction = stmt.columnInt(19);
+    appRow.scheduleTime = stmt.columnDateTime(20);
+    appRow.creatTime = stmt.columnDateTime(21);
+    appRow.groupIndex = stmt.columnInt(22);
+    appRow.alerted = stmt.columnBool(23);
+}
+
 QString AppListModel::sqlBase() const
 {
     return "SELECT"
@@ -353,6 +360,33 @@ QString AppListModel::sqlOrderColumn() const
     return sortStateStr + columnsStr + sqlOrderAsc() + ", " + postColumnsStr;
 }
 
+QStringList AppListModel::sqlKeysetColumns() const
+{
+    // The sort state's fixed direction doesn't fit the keyset
+    if (sortState() != SortNone)
+        return {};
+
+    // Nullable columns are compared as empty
+    static const QString nameColumn = "IFNULL(lower(name), '')";
+    static const QString pathColumn = "IFNULL(path, '')";
+
+    static const QList<QStringList> keysetColumns = {
+        { nameColumn, pathColumn }, // Name
+        { "accept_zones", "reject_zones", nameColumn }, // Zones
+        { "IFNULL(rule_id, 0)", nameColumn }, // Rule
+        { "end_action", "IFNULL(end_time, 0)", nameColumn }, // Scheduled
+        { "blocked", nameColumn }, // Action
+        { "group_index", nameColumn }, // Group
+        { pathColumn }, // File Path
+        {}, // Creation Time ~ App ID
+        { "IFNULL(notes, '')", nameColumn }, // Notes
+    };
+
+    Q_ASSERT(sortColumn() >= 0 && sortColumn() < keysetColumns.size());
+
+    return keysetColumns.at(sortColumn()) + QStringList { "app_id" };
+}
+
 void AppListModel::addSqlFilter(QStringList &list, const QString &name, FilterFlag flag) const
 {
     if (filters().testFlag(flag)) {
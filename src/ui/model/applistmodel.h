@@ -89,13 +89,17 @@ signals:
     void filtersChanged();
 
 protected:
-    bool updateTableRow(const QVariantHash &vars, int row) const override;
+    TableSqlRowsPtr createTableRows() const override;
+    bool loadTableRow(const TableSqlRows &rows, int blockIndex) const override;
     TableRow &tableRow() const override { return m_appRow; }
 
+    static void fillAppRow(AppRow &appRow, SqliteStmt &stmt);
+
     QString sqlBase() const override;
     QString sqlWhere() const override;
     QString sqlWhereFts() const override;
     QString sqlOrderColumn() const override;
+    QStringList sqlKeysetColumns() const override;
 
     void addSqlFilter(QStringList &list, const QString &name, FilterFlag flag) const;
 
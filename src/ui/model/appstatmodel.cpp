@@ -14,6 +14,7 @@
 #include <util/fileutil.h>
 #include <util/iconcache.h>
 #include <util/ioc/ioccontainer.h>
+#include <util/model/tablesqlrows.h>
 
 #include "traflistmodel.h"
 
@@ -39,6 +40,8 @@ void AppStatModel::initialize()
     setSortColumn(int(AppStatColumn::Program));
     setSortOrder(Qt::AscendingOrder);
 
+    setupSqlLoader();
+
     connect(statManager(), &StatManager::appStatRemoved, this, &AppStatModel::refresh);
     connect(statManager(), &StatManager::appCreated, this, &AppStatModel::refresh);
 
@@ -93,7 +96,7 @@ QVariant AppStatModel::headerDataDecoration(int section) const
 
 QVariant AppStatModel::data(const QModelIndex &index, int role) const
 {
-    if (!index.isValid())
+    if (!index.isValid() || isRowLoading(index.row()))
         return {};
 
     switch (role) {
@@ -165,22 +168,26 @@ void AppStatModel::remove(int row)
     statManager()->deleteStatApp(m_appStatRow.appId);
 }
 
-bool AppStatModel::updateTableRow(const QVariantHash &vars, int /*row*/) const
+TableSqlRowsPtr AppStatModel::createTableRows() const
 {
-    SqliteStmt stmt;
-    if (!DbQuery(sqliteDb()).sql(sql()).vars(vars).prepareRow(stmt)) {
-        m_appStatRow.invalidate();
-        return false;
-    }
+    return TableSqlRowsPtr(new TableSqlRowList<AppStatRow>(&fillAppStatRow));
+}
 
-    m_appStatRow.appId = stmt.columnInt64(0);
-    m_appStatRow.appPath = stmt.columnText(1);
-    m_appStatRow.downloadBytes = stmt.columnInt64(2);
-    m_appStatRow.uploadBytes = stmt.columnInt64(3);
+bool AppStatModel::loadTableRow(const TableSqlRows &rows, int blockIndex) const
+{
+    m_appStatRow = static_cast<const TableSqlRowList<AppStatRow> &>(rows).at(blockIndex);
 
     return true;
 }
 
+void AppStatModel::fillAppStatRow(AppStatRow &appStatRow, SqliteStmt &stmt)
+{
+    appStatRow.appId = stmt.columnInt64(0);
+    appStatRow.appPath = stmt.columnText(1);
+    appStatRow.downloadBytes = stmt.columnInt64(2);
+    appStatRow.uploadBytes = stmt.columnInt64(3);
+}
+
 QString AppStatModel::sqlBase() const
 {
     return "SELECT * FROM ("
@@ -206,6 +213,19 @@ QString AppStatModel::sqlOrderColumn() const
     return columnsStr + sqlOrderAsc() + ", path";
 }
 
+QStringList AppStatModel::sqlKeysetColumns() const
+{
+    static const QList<QStringList> keysetColumns = {
+        { "path" }, // Program
+        { "download", "path" }, // Download
+        { "upload", "path" }, // Upload
+    };
+
+    Q_ASSERT(sortColumn() >= 0 && sortColumn() < keysetColumns.size());
+
+    return keysetColumns.at(sortColumn()) + QStringList { "app_id" };
+}
+
 QString AppStatModel::columnName(const AppStatColumn column)
 {
     static QStringList g_columnNames;
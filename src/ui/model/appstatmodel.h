@@ -47,11 +47,15 @@ public slots:
     void remove(int row = -1);
 
 protected:
-    bool updateTableRow(const QVariantHash &vars, int row) const override;
+    TableSqlRowsPtr createTableRows() const override;
+    bool loadTableRow(const TableSqlRows &rows, int blockIndex) const override;
     TableRow &tableRow() const override { return m_appStatRow; }
 
+    static void fillAppStatRow(AppStatRow &appStatRow, SqliteStmt &stmt);
+
     QString sqlBase() const override;
     QString sqlOrderColumn() const override;
+    QStringList sqlKeysetColumns() const override;
 
 private:
     QVariant headerDataDisplay(int section, int role) const;
@@ -1,6 +1,7 @@
 #include "connlistmodel.h"
 
 #include <QFont>
+#include <QHash>
 #include <QIcon>
 #include <QLoggingCategory>
 
@@ -17,6 +18,7 @@
 #include <stat/statconnmanager.h>
 #include <util/iconcache.h>
 #include <util/ioc/ioccontainer.h>
+#include <util/model/tablesqlrows.h>
 #include <util/net/netformatutil.h>
 #include <util/net/netutil.h>
 
@@ -200,6 +202,64 @@ static const dataDisplay_func dataDisplay_funcList[] = {
     &dataDisplayTime,
 };
 
+// Rows of the block by conn_id
+class ConnRows : public TableSqlRows
+{
+public:
+    explicit ConnRows(int count) : m_count(count) { }
+
+    const ConnRow *connRow(qint64 connId) const
+    {
+        const auto it = m_connRows.constFind(connId);
+
+        return (it != m_connRows.constEnd()) ? &it.value() : nullptr;
+    }
+
+    int fetchRows(SqliteStmt &stmt) override;
+
+private:
+    const int m_count;
+
+    QHash<qint64, ConnRow> m_connRows;
+};
+
+int ConnRows::fetchRows(SqliteStmt &stmt)
+{
+    while (stmt.step() == SqliteStmt::StepRow) {
+        ConnRow connRow;
+
+        connRow.connId = stmt.columnInt64(0);
+        connRow.appId = stmt.columnInt64(1);
+        connRow.connTime = stmt.columnUnixTime(2);
+        connRow.pid = stmt.columnInt(3);
+        connRow.reason = stmt.columnInt(4);
+        connRow.blocked = stmt.columnBool(5);
+        connRow.inherited = stmt.columnBool(6);
+        connRow.inbound = stmt.columnBool(7);
+        connRow.ipProto = stmt.columnInt(8);
+        connRow.localPort = stmt.columnInt(9);
+        connRow.remotePort = stmt.columnInt(10);
+
+        connRow.isIPv6 = stmt.columnIsNull(11);
+        if (!connRow.isIPv6) {
+            connRow.localIp.v4 = stmt.columnInt(11);
+            connRow.remoteIp.v4 = stmt.columnInt(12);
+        } else {
+            connRow.localIp.v6 = NetUtil::arrayViewToIp6(stmt.columnBlob(13, /*isView=*/true));
+            connRow.remoteIp.v6 = NetUtil::arrayViewToIp6(stmt.columnBlob(14, /*isView=*/true));
+        }
+
+        connRow.zoneId = stmt.columnInt(15);
+        connRow.ruleId = stmt.columnInt(16);
+
+        connRow.appPath = stmt.columnText(17);
+
+        m_connRows.insert(connRow.connId, connRow);
+    }
+
+    return m_count;
+}
+
 }
 
 ConnListModel::ConnListModel(QObject *parent) : TableSqlModel(parent) { }
@@ -234,6 +294,8 @@ void ConnListModel::initialize()
     setSortColumn(int(ConnListColumn::Time));
     setSortOrder(Qt::DescendingOrder);
 
+    setupSqlLoader();
+
     connect(appInfoCache(), &AppInfoCache::cacheChanged, this, &ConnListModel::refresh);
     connect(hostInfoCache(), &HostInfoCache::cacheChanged, this, &ConnListModel::refresh);
     connect(statConnManager(), &StatConnManager::connChanged, this,
@@ -268,7 +330,7 @@ QVariant ConnListModel::headerData(int section, Qt::Orientation orientation, int
 
 QVariant ConnListModel::data(const QModelIndex &index, int role) const
 {
-    if (!index.isValid())
+    if (!index.isValid() || isRowLoading(index.row()))
         return {};
 
     switch (role) {
@@ -390,41 +452,36 @@ void ConnListModel::updateConnIdRange()
     updateConnRows(oldIdMin, oldIdMax, idMin, idMax);
 }
 
-bool ConnListModel::updateTableRow(const QVariantHash & /*vars*/, int row) const
+TableSqlRowsPtr ConnListModel::createTableRows() const
+{
+    return TableSqlRowsPtr(new ConnRows(m_connRowsCount));
+}
+
+bool ConnListModel::loadTableRow(const TableSqlRows &rows, int blockIndex) const
 {
-    const qint64 connId = connIdByIndex(row);
+    const qint64 connId = connIdByIndex(rowsBlockFirst() + blockIndex);
 
-    SqliteStmt stmt;
-    if (!DbQuery(sqliteDb()).sql(sql()).vars({ connId }).prepareRow(stmt))
+    const ConnRow *connRow = static_cast<const ConnRows &>(rows).connRow(connId);
+    if (!connRow)
         return false;
 
-    m_connRow.connId = stmt.columnInt64(0);
-    m_connRow.appId = stmt.columnInt64(1);
-    m_connRow.connTime = stmt.columnUnixTime(2);
-    m_connRow.pid = stmt.columnInt(3);
-    m_connRow.reason = stmt.columnInt(4);
-    m_connRow.blocked = stmt.columnBool(5);
-    m_connRow.inherited = stmt.columnBool(6);
-    m_connRow.inbound = stmt.columnBool(7);
-    m_connRow.ipProto = stmt.columnInt(8);
-    m_connRow.localPort = stmt.columnInt(9);
-    m_connRow.remotePort = stmt.columnInt(10);
-
-    m_connRow.isIPv6 = stmt.columnIsNull(11);
-    if (!m_connRow.isIPv6) {
-        m_connRow.localIp.v4 = stmt.columnInt(11);
-        m_connRow.remoteIp.v4 = stmt.columnInt(12);
-    } else {
-        m_connRow.localIp.v6 = NetUtil::arrayViewToIp6(stmt.columnBlob(13, /*isView=*/true));
-        m_connRow.remoteIp.v6 = NetUtil::arrayViewToIp6(stmt.columnBlob(14, /*isView=*/true));
-    }
+    m_connRow = *connRow;
 
-    m_connRow.zoneId = stmt.columnInt(15);
-    m_connRow.ruleId = stmt.columnInt(16);
+    return true;
+}
 
-    m_connRow.appPath = stmt.columnText(17);
+void ConnListModel::fillQueryVarsForRows(QVariantHash &vars, int firstRow, int count) const
+{
+    const int lastRow = qMax(firstRow, qMin(firstRow + count, rowCount()) - 1);
 
-    return true;
+    m_connRowsCount = lastRow - firstRow + 1;
+
+    // Keyset of the block: range of the conn_id-s
+    const qint64 firstId = connIdByIndex(firstRow);
+    const qint64 lastId = connIdByIndex(lastRow);
+
+    vars.insert(":id_min", qMin(firstId, lastId));
+    vars.insert(":id_max", qMax(firstId, lastId));
 }
 
 void ConnListModel::fillConnIdRange(qint64 &idMin, qint64 &idMax)
@@ -478,7 +535,7 @@ QString ConnListModel::sqlBase() const
 
 QString ConnListModel::sqlWhere() const
 {
-    return " WHERE t.conn_id = ?1";
+    return " WHERE t.conn_id BETWEEN :id_min AND :id_max";
 }
 
 QString ConnListModel::sqlLimitOffset() const
@@ -520,7 +577,8 @@ void ConnListModel::removeConnRows(qint64 idMin, int count)
 {
     beginRemoveRows({}, 0, count - 1);
     m_connIdMin = idMin;
-    invalidateRowCache();
+    // The rows are shifted by the conn_id-s order
+    invalidateRowCacheRange(isAscendingOrder() ? 0 : doSqlCount());
     endRemoveRows();
 }
 
@@ -528,7 +586,7 @@ void ConnListModel::insertConnRows(qint64 idMax, int endRow, int count)
 {
     beginInsertRows({}, endRow, endRow + count - 1);
     m_connIdMax = idMax;
-    invalidateRowCache();
+    invalidateRowCacheRange(isAscendingOrder() ? endRow : 0);
     endInsertRows();
 }
 
@@ -77,10 +77,11 @@ protected slots:
     void updateConnIdRange();
 
 protected:
-    bool updateTableRow(const QVariantHash &vars, int row) const override;
+    TableSqlRowsPtr createTableRows() const override;
+    bool loadTableRow(const TableSqlRows &rows, int blockIndex) const override;
     TableRow &tableRow() const override { return m_connRow; }
 
-    void fillQueryVarsForRow(QVariantHash & /*vars*/, int /*row*/) const override { }
+    void fillQueryVarsForRows(QVariantHash &vars, int firstRow, int count) const override;
 
     virtual void fillConnIdRange(qint64 &idMin, qint64 &idMax);
 
@@ -89,6 +90,7 @@ protected:
 
     virtual qint64 connIdByIndex(int row) const;
 
+    bool isSqlCountAsync() const override { return false; } // by the conn_id-s range
     int doSqlCount() const override;
     QString sqlBase() const override;
     QString sqlWhere() const override;
@@ -118,6 +120,8 @@ private:
     qint64 m_connIdMin = 0;
     qint64 m_connIdMax = 0;
 
+    mutable int m_connRowsCount = 0;
+
     mutable ConnRow m_connRow;
 };
 
@@ -13,6 +13,7 @@
 #include <util/guiutil.h>
 #include <util/iconcache.h>
 #include <util/ioc/ioccontainer.h>
+#include <util/model/tablesqlrows.h>
 
 namespace {
 
@@ -286,9 +287,16 @@ RuleRow RuleListModel::ruleRowById(int ruleId, Rule::RuleType ruleType) const
     return ruleRow;
 }
 
-bool RuleListModel::updateTableRow(const QVariantHash &vars, int /*row*/) const
+TableSqlRowsPtr RuleListModel::createTableRows() const
 {
-    return updateRuleRow(sql(), vars, m_ruleRow);
+    return TableSqlRowsPtr(new TableSqlRowList<RuleRow>(&fillRuleRow));
+}
+
+bool RuleListModel::loadTableRow(const TableSqlRows &rows, int blockIndex) const
+{
+    m_ruleRow = static_cast<const TableSqlRowList<RuleRow> &>(rows).at(blockIndex);
+
+    return true;
 }
 
 bool RuleListModel::updateRuleRow(
@@ -300,6 +308,13 @@ bool RuleListModel::updateRuleRow(
         return false;
     }
 
+    fillRuleRow(ruleRow, stmt);
+
+    return true;
+}
+
+void RuleListModel::fillRuleRow(RuleRow &ruleRow, SqliteStmt &stmt)
+{
     ruleRow.ruleId = stmt.columnInt(0);
     ruleRow.enabled = stmt.columnBool(1);
     ruleRow.blocked = stmt.columnBool(2);
@@ -313,8 +328,6 @@ bool RuleListModel::updateRuleRow(
     ruleRow.zones.accept_mask = stmt.columnUInt(10);
     ruleRow.zones.reject_mask = stmt.columnUInt(11);
     ruleRow.modTime = stmt.columnDateTime(12);
-
-    return true;
 }
 
 QString RuleListModel::sqlBase() const
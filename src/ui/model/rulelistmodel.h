@@ -60,10 +60,12 @@ protected:
 
     void fillQueryVars(QVariantHash &vars) const override;
 
-    bool updateTableRow(const QVariantHash &vars, int row) const override;
+    TableSqlRowsPtr createTableRows() const override;
+    bool loadTableRow(const TableSqlRows &rows, int blockIndex) const override;
     TableRow &tableRow() const override { return m_ruleRow; }
 
     bool updateRuleRow(const QString &sql, const QVariantHash &vars, RuleRow &ruleRow) const;
+    static void fillRuleRow(RuleRow &ruleRow, SqliteStmt &stmt);
 
     QString sqlBase() const override;
     QString sqlWhereFts() const override;
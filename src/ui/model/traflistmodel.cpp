@@ -180,6 +180,9 @@ void TrafListModel::resetTraf()
 
     beginResetModel();
 
+    // Flush the accumulated traffic once for all the rows
+    statManager()->flushTraffic();
+
     m_minTrafTime = statManager()->getTrafficTime(sqlMinTrafTime, m_appId);
 
     m_maxTrafTime = getMaxTrafTime(type());
@@ -202,6 +205,8 @@ void TrafListModel::reset()
     if (m_isEmpty) {
         resetTraf();
     } else {
+        statManager()->flushTraffic();
+
         TableItemModel::reset();
     }
 }
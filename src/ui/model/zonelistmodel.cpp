@@ -13,6 +13,7 @@
 #include <util/fileutil.h>
 #include <util/ioc/ioccontainer.h>
 #include <util/json/jsonutil.h>
+#include <util/model/tablesqlrows.h>
 
 #include "zonesourcewrapper.h"
 #include "zonetypewrapper.h"
@@ -187,18 +188,20 @@ QVariant ZoneListModel::zoneSourceByCode(const QString &sourceCode) const
     return zoneSourceById(sourceId);
 }
 
-bool ZoneListModel::updateTableRow(const QVariantHash &vars, int /*row*/) const
+TableSqlRowsPtr ZoneListModel::createTableRows() const
 {
-    return updateZoneRow(sql(), vars, m_zoneRow);
+    return TableSqlRowsPtr(new TableSqlRowList<ZoneRow>(&fillZoneRow));
 }
 
-bool ZoneListModel::updateZoneRow(
-        const QString &sql, const QVariantHash &vars, ZoneRow &zoneRow) const
+bool ZoneListModel::loadTableRow(const TableSqlRows &rows, int blockIndex) const
 {
-    SqliteStmt stmt;
-    if (!DbQuery(sqliteDb()).sql(sql).vars(vars).prepareRow(stmt))
-        return false;
+    m_zoneRow = static_cast<const TableSqlRowList<ZoneRow> &>(rows).at(blockIndex);
+
+    return true;
+}
 
+void ZoneListModel::fillZoneRow(ZoneRow &zoneRow, SqliteStmt &stmt)
+{
     zoneRow.zoneId = stmt.columnInt(0);
     zoneRow.enabled = stmt.columnBool(1);
     zoneRow.customUrl = stmt.columnBool(2);
@@ -213,8 +216,6 @@ bool ZoneListModel::updateZoneRow(
     zoneRow.sourceModTime = stmt.columnDateTime(11);
     zoneRow.lastRun = stmt.columnDateTime(12);
     zoneRow.lastSuccess = stmt.columnDateTime(13);
-
-    return true;
 }
 
 QString ZoneListModel::sqlBase() const
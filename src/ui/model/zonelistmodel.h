@@ -50,10 +50,11 @@ public:
 protected:
     Qt::ItemFlags flagIsUserCheckable(const QModelIndex &index) const override;
 
-    bool updateTableRow(const QVariantHash &vars, int row) const override;
+    TableSqlRowsPtr createTableRows() const override;
+    bool loadTableRow(const TableSqlRows &rows, int blockIndex) const override;
     TableRow &tableRow() const override { return m_zoneRow; }
 
-    bool updateZoneRow(const QString &sql, const QVariantHash &vars, ZoneRow &zoneRow) const;
+    static void fillZoneRow(ZoneRow &zoneRow, SqliteStmt &stmt);
 
     QString sqlBase() const override;
 
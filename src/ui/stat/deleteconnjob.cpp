@@ -43,6 +43,9 @@ void DeleteConnJob::processJob()
 
     commitTransaction();
 
+    // The apps without connections are deleted too
+    manager()->clearAppIdCache();
+
     if (isDeleteAll) {
         sqliteDb()->vacuum(); // Vacuum outside of transaction
     }
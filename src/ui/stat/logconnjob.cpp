@@ -58,7 +58,7 @@ void LogConnJob::emitFinished()
 
 bool LogConnJob::processEntry(const LogEntryConn &entry)
 {
-    const qint64 appId = getOrCreateAppId(entry.path(), entry.connTime());
+    const qint64 appId = getEntryAppId(entry);
     if (appId == INVALID_APP_ID)
         return false;
 
@@ -114,6 +114,23 @@ qint64 LogConnJob::getOrCreateAppId(const QString &appPath, qint64 unixTime)
     return appId;
 }
 
+qint64 LogConnJob::getEntryAppId(const LogEntryConn &entry)
+{
+    // The interned path is resolved once by the log manager
+    const QString appPath = entry.path();
+
+    qint64 appId = manager()->getCachedAppId(appPath);
+    if (appId == INVALID_APP_ID) {
+        appId = getOrCreateAppId(appPath, entry.connTime());
+
+        if (appId != INVALID_APP_ID) {
+            manager()->addCachedAppId(appPath, appId);
+        }
+    }
+
+    return appId;
+}
+
 qint64 LogConnJob::insertConn(const LogEntryConn &entry, qint64 appId)
 {
     SqliteStmt *stmt = getStmt(StatSql::sqlInsertConn);
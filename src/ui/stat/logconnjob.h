@@ -29,6 +29,7 @@ private:
     qint64 getAppId(const QString &appPath);
     qint64 createAppId(const QString &appPath, qint64 unixTime);
     qint64 getOrCreateAppId(const QString &appPath, qint64 unixTime = 0);
+    qint64 getEntryAppId(const LogEntryConn &entry);
 
     qint64 insertConn(const LogEntryConn &entry, qint64 appId);
 
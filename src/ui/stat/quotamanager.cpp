@@ -200,6 +200,8 @@ void QuotaManager::setupByConf(const IniOptions &ini)
     auto statManager = IoC<StatManager>();
     qint64 inBytes, outBytes;
 
+    statManager->flushTraffic();
+
     statManager->getTraffic(StatSql::sqlSelectTrafDay, trafDay, inBytes, outBytes);
     setTrafDayBytes(inBytes);
 
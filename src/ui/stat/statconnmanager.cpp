@@ -22,6 +22,8 @@ const QLoggingCategory LC("statConn");
 
 constexpr int DATABASE_USER_VERSION = 2;
 
+constexpr qint64 INVALID_APP_ID = Q_INT64_C(-1);
+
 bool migrateFunc(SqliteDb *db, int version, bool isNewDb, void *ctx)
 {
     Q_UNUSED(db);
@@ -103,6 +105,21 @@ void StatConnManager::getConnIdRange(SqliteDb *db, qint64 &connIdMin, qint64 &co
     connIdMax = vars.value(1).toLongLong();
 }
 
+void StatConnManager::addCachedAppId(const QString &appPath, qint64 appId)
+{
+    m_appPathIdCache.insert(appPath, appId);
+}
+
+qint64 StatConnManager::getCachedAppId(const QString &appPath) const
+{
+    return m_appPathIdCache.value(appPath, INVALID_APP_ID);
+}
+
+void StatConnManager::clearAppIdCache()
+{
+    m_appPathIdCache.clear();
+}
+
 void StatConnManager::onLogConnFinished(int count, qint64 /*newConnId*/)
 {
     emitConnChanged();
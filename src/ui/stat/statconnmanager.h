@@ -1,6 +1,7 @@
 #ifndef STATCONNMANAGER_H
 #define STATCONNMANAGER_H
 
+#include <QHash>
 #include <QObject>
 
 #include <sqlite/sqlite_types.h>
@@ -35,6 +36,11 @@ public:
 
     static void getConnIdRange(SqliteDb *db, qint64 &rowIdMin, qint64 &rowIdMax);
 
+    // Used by the worker's jobs only
+    void addCachedAppId(const QString &appPath, qint64 appId);
+    qint64 getCachedAppId(const QString &appPath) const;
+    void clearAppIdCache();
+
 signals:
     void connChanged();
 
@@ -75,6 +81,8 @@ private:
     SqliteDbPtr m_roSqliteDb;
 
     TriggerTimer m_connChangedTimer;
+
+    QHash<QString, qint64> m_appPathIdCache; // appPath => appId
 };
 
 #endif // STATCONNMANAGER_H
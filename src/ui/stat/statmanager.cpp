@@ -26,6 +26,8 @@ constexpr int DATABASE_USER_VERSION = 7;
 
 constexpr qint64 INVALID_APP_ID = Q_INT64_C(-1);
 
+constexpr int TRAF_UPSERT_MAX_ROWS = 256;
+
 bool migrateFunc(SqliteDb *db, int version, bool isNewDb, void *ctx)
 {
     Q_UNUSED(ctx);
@@ -63,6 +65,19 @@ SqliteDb::MigrateOptions migrateOptions()
     return opt;
 }
 
+QString trafAppValuesSql(int rowCount)
+{
+    QStringList values;
+    values.reserve(rowCount);
+
+    // ?1 is the traffic time, the rows' parameters follow it
+    for (int i = 0, index = 2; i < rowCount; ++i, index += 3) {
+        values << QString("(?%1, ?1, ?%2, ?%3)").arg(index).arg(index + 1).arg(index + 2);
+    }
+
+    return values.join(',');
+}
+
 }
 
 StatManager::StatManager(const QString &filePath, QObject *parent, quint32 openFlags) :
@@ -87,6 +102,11 @@ void StatManager::setUp()
     setupDb();
 }
 
+void StatManager::tearDown()
+{
+    flushTraffic();
+}
+
 void StatManager::setupTrafDate()
 {
     m_trafHour = m_trafDay = m_trafMonth = 0;
@@ -137,7 +157,7 @@ void StatManager::clearQuotas(bool isNewDay, bool isNewMonth)
     quotaManager->clear(isNewDay && m_trafDay != 0, isNewMonth && m_trafMonth != 0);
 }
 
-void StatManager::checkQuotas(quint32 inBytes)
+void StatManager::checkQuotas(quint64 inBytes)
 {
     if (!m_isActivePeriod)
         return;
@@ -177,6 +197,8 @@ bool StatManager::clearTraffic()
 {
     bool ok;
 
+    clearTrafBytes();
+
     beginWriteTransaction();
 
     ok = sqliteDb()->execute(StatSql::sqlDeleteAllTraffic);
@@ -276,73 +298,49 @@ bool StatManager::logStatTraf(const LogEntryStatTraf &entry, qint64 unixTime)
 
     const bool logStat = conf() && conf()->logStat() && m_isActivePeriod;
 
-    const bool isNewDay = updateTrafDay(unixTime);
+    // Flush the accumulated traffic of the previous hour
+    if (DateUtil::getUnixHour(unixTime) != m_trafHour) {
+        flushTraffic();
+    }
 
-    beginWriteTransaction();
+    const bool isNewDay = updateTrafDay(unixTime);
 
     // Delete old data
     if (isNewDay) {
+        beginWriteTransaction();
+
         deleteOldTraffic(m_trafHour);
+
+        commitTransaction();
     }
 
     // Sum traffic bytes
-    quint32 sumInBytes = 0;
-    quint32 sumOutBytes = 0;
-
-    const quint16 procCount = entry.procCount();
-    {
-        const quint32 *procTrafBytes = entry.procTrafBytes();
-
-        const SqliteStmtList insertTrafAppStmts = {
-            getTrafficStmt(StatSql::sqlInsertTrafAppHour, m_trafHour),
-            getTrafficStmt(StatSql::sqlInsertTrafAppDay, m_trafDay),
-            getTrafficStmt(StatSql::sqlInsertTrafAppMonth, m_trafMonth),
-            getTrafficStmt(StatSql::sqlInsertTrafAppTotal, m_trafHour),
-        };
-
-        const SqliteStmtList updateTrafAppStmts = {
-            getTrafficStmt(StatSql::sqlUpdateTrafAppHour, m_trafHour),
-            getTrafficStmt(StatSql::sqlUpdateTrafAppDay, m_trafDay),
-            getTrafficStmt(StatSql::sqlUpdateTrafAppMonth, m_trafMonth),
-            getTrafficStmt(StatSql::sqlUpdateTrafAppTotal, -1),
-        };
-
-        for (int i = 0; i < procCount; ++i) {
-            const quint32 pidFlag = *procTrafBytes++;
-            const quint32 inBytes = *procTrafBytes++;
-            const quint32 outBytes = *procTrafBytes++;
+    quint64 sumInBytes = 0;
+    quint64 sumOutBytes = 0;
 
-            const bool inactive = (pidFlag & 1) != 0;
-            const quint32 pid = pidFlag & ~quint32(1);
+    for (const ProcTraf &pt : entry.procTrafs()) {
+        const bool inactive = (pt.pidFlag & 1) != 0;
+        const quint32 pid = pt.pidFlag & ~quint32(1);
 
-            logTrafBytes(insertTrafAppStmts, updateTrafAppStmts, sumInBytes, sumOutBytes, pid,
-                    inBytes, outBytes, unixTime, logStat);
+        logTrafBytes(sumInBytes, sumOutBytes, pid, pt.inBytes, pt.outBytes, unixTime, logStat);
 
-            if (inactive) {
-                removeLoggedProcessId(pid);
-            }
+        if (inactive) {
+            removeLoggedProcessId(pid);
         }
     }
 
     if (logStat) {
-        const SqliteStmtList insertTrafStmts = {
-            getTrafficStmt(StatSql::sqlInsertTrafHour, m_trafHour),
-            getTrafficStmt(StatSql::sqlInsertTrafDay, m_trafDay),
-            getTrafficStmt(StatSql::sqlInsertTrafMonth, m_trafMonth),
-        };
+        m_trafBytes.inBytes += sumInBytes;
+        m_trafBytes.outBytes += sumOutBytes;
+    }
 
-        const SqliteStmtList updateTrafStmts = {
-            getTrafficStmt(StatSql::sqlUpdateTrafHour, m_trafHour),
-            getTrafficStmt(StatSql::sqlUpdateTrafDay, m_trafDay),
-            getTrafficStmt(StatSql::sqlUpdateTrafMonth, m_trafMonth),
-        };
+    // Flush the accumulated traffic periodically or to notify about the new apps
+    if (!m_createdAppPaths.isEmpty() || qAbs(unixTime - m_trafFlushTime) >= trafFlushSecs()) {
+        m_trafFlushTime = unixTime;
 
-        // Update or insert total bytes
-        updateTrafficList(insertTrafStmts, updateTrafStmts, sumInBytes, sumOutBytes);
+        flushTraffic();
     }
 
-    commitTransaction();
-
     // Check quotas
     checkQuotas(sumInBytes);
 
@@ -352,8 +350,66 @@ bool StatManager::logStatTraf(const LogEntryStatTraf &entry, qint64 unixTime)
     return true;
 }
 
+qint64 StatManager::trafFlushSecs() const
+{
+    constexpr int maxFlushSecs = 60 * 60;
+
+    // Longer periods write less often, but the readers of the database see older traffic
+    const int flushSecs = conf() ? ini()->trafFlushSeconds() : DEFAULT_TRAF_FLUSH_SECONDS;
+
+    return qBound(1, flushSecs, maxFlushSecs);
+}
+
+void StatManager::flushTraffic()
+{
+    if (m_appTrafBytes.isEmpty() && m_trafBytes.inBytes == 0 && m_trafBytes.outBytes == 0)
+        return;
+
+    beginWriteTransaction();
+
+    // Upsert apps' bytes
+    const QList<qint64> appIds = m_appTrafBytes.keys();
+
+    for (int i = 0; i < appIds.size(); i += TRAF_UPSERT_MAX_ROWS) {
+        const QList<qint64> rowAppIds = appIds.mid(i, TRAF_UPSERT_MAX_ROWS);
+        const QString valuesSql = trafAppValuesSql(rowAppIds.size());
+
+        upsertAppTraffic(StatSql::sqlUpsertTrafAppHour, valuesSql, m_trafHour, rowAppIds);
+        upsertAppTraffic(StatSql::sqlUpsertTrafAppDay, valuesSql, m_trafDay, rowAppIds);
+        upsertAppTraffic(StatSql::sqlUpsertTrafAppMonth, valuesSql, m_trafMonth, rowAppIds);
+        upsertAppTraffic(StatSql::sqlUpsertTrafAppTotal, valuesSql, m_trafHour, rowAppIds);
+    }
+
+    // Upsert sum bytes
+    if (m_trafBytes.inBytes != 0 || m_trafBytes.outBytes != 0) {
+        const SqliteStmtList upsertTrafStmts = {
+            getTrafficStmt(StatSql::sqlUpsertTrafHour, m_trafHour),
+            getTrafficStmt(StatSql::sqlUpsertTrafDay, m_trafDay),
+            getTrafficStmt(StatSql::sqlUpsertTrafMonth, m_trafMonth),
+        };
+
+        for (SqliteStmt *stmt : upsertTrafStmts) {
+            upsertTraffic(stmt, m_trafBytes.inBytes, m_trafBytes.outBytes);
+        }
+    }
+
+    commitTransaction();
+
+    const QHash<qint64, QString> createdAppPaths = m_createdAppPaths;
+
+    clearTrafBytes();
+
+    // Notify about the apps, which got their first traffic
+    for (auto it = createdAppPaths.constBegin(); it != createdAppPaths.constEnd(); ++it) {
+        emit appCreated(it.key(), it.value());
+    }
+}
+
 bool StatManager::deleteStatApp(qint64 appId)
 {
+    m_appTrafBytes.remove(appId);
+    m_createdAppPaths.remove(appId);
+
     beginWriteTransaction();
 
     DbUtil::doList({ getIdStmt(StatSql::sqlDeleteAppTrafHour, appId),
@@ -372,6 +428,8 @@ bool StatManager::deleteStatApp(qint64 appId)
 
 bool StatManager::resetAppTrafTotals()
 {
+    flushTraffic();
+
     SqliteStmt *stmt = getStmt(StatSql::sqlResetAppTrafTotals);
     const qint64 unixTime = DateUtil::getUnixTime();
 
@@ -492,9 +550,8 @@ void StatManager::deleteOldTraffic(qint32 trafHour)
     DbUtil::doList(deleteTrafStmts);
 }
 
-void StatManager::logTrafBytes(const SqliteStmtList &insertStmtList,
-        const SqliteStmtList &updateStmtList, quint32 &sumInBytes, quint32 &sumOutBytes,
-        quint32 pid, quint32 inBytes, quint32 outBytes, qint64 unixTime, bool logStat)
+void StatManager::logTrafBytes(quint64 &sumInBytes, quint64 &sumOutBytes, quint32 pid,
+        quint64 inBytes, quint64 outBytes, qint64 unixTime, bool logStat)
 {
     const QString appPath = getLoggedProcessIdPath(pid);
 
@@ -511,12 +568,7 @@ void StatManager::logTrafBytes(const SqliteStmtList &insertStmtList,
     Q_ASSERT(appId != INVALID_APP_ID);
 
     if (logStat) {
-        if (!hasAppTraf(appId)) {
-            emit appCreated(appId, appPath);
-        }
-
-        // Update or insert app bytes
-        updateTrafficList(insertStmtList, updateStmtList, inBytes, outBytes, appId);
+        addAppTrafBytes(appId, appPath, inBytes, outBytes);
     }
 
     // Update sum traffic bytes
@@ -524,33 +576,68 @@ void StatManager::logTrafBytes(const SqliteStmtList &insertStmtList,
     sumOutBytes += outBytes;
 }
 
-void StatManager::updateTrafficList(const SqliteStmtList &insertStmtList,
-        const SqliteStmtList &updateStmtList, quint32 inBytes, quint32 outBytes, qint64 appId)
+void StatManager::addAppTrafBytes(
+        qint64 appId, const QString &appPath, quint64 inBytes, quint64 outBytes)
 {
-    int i = 0;
-    for (SqliteStmt *stmtUpdate : updateStmtList) {
-        if (!updateTraffic(stmtUpdate, inBytes, outBytes, appId)) {
-            SqliteStmt *stmtInsert = insertStmtList.at(i);
-            if (!updateTraffic(stmtInsert, inBytes, outBytes, appId)) {
-                qCCritical(LC) << "Update traffic error:" << sqliteDb()->errorMessage()
-                               << "inBytes:" << inBytes << "outBytes:" << outBytes
-                               << "appId:" << appId << "index:" << i;
-            }
+    auto it = m_appTrafBytes.find(appId);
+
+    if (it == m_appTrafBytes.end()) {
+        if (!hasAppTraf(appId)) {
+            m_createdAppPaths.insert(appId, appPath);
         }
-        ++i;
+
+        it = m_appTrafBytes.insert(appId, {});
+    }
+
+    // Accumulate app bytes till the flush
+    it->inBytes += inBytes;
+    it->outBytes += outBytes;
+}
+
+void StatManager::clearTrafBytes()
+{
+    m_trafBytes = {};
+    m_appTrafBytes.clear();
+    m_createdAppPaths.clear();
+}
+
+void StatManager::upsertAppTraffic(const char *sqlFormat, const QString &valuesSql,
+        qint32 trafTime, const QList<qint64> &appIds)
+{
+    const QByteArray sql = QString::fromLatin1(sqlFormat).arg(valuesSql).toLatin1();
+
+    SqliteStmt stmt;
+    if (!stmt.prepare(sqliteDb()->db(), sql.constData())) {
+        qCCritical(LC) << "Upsert app traffic prepare error:" << sqliteDb()->errorMessage();
+        return;
+    }
+
+    stmt.bindInt(1, trafTime);
+
+    int index = 1;
+    for (const qint64 appId : appIds) {
+        const TrafBytes bytes = m_appTrafBytes.value(appId);
+
+        stmt.bindInt64(++index, appId);
+        stmt.bindInt64(++index, bytes.inBytes);
+        stmt.bindInt64(++index, bytes.outBytes);
+    }
+
+    if (stmt.step() != SqliteStmt::StepDone) {
+        qCCritical(LC) << "Upsert app traffic error:" << sqliteDb()->errorMessage()
+                       << "appIds:" << appIds.size() << "trafTime:" << trafTime;
     }
 }
 
-bool StatManager::updateTraffic(SqliteStmt *stmt, quint32 inBytes, quint32 outBytes, qint64 appId)
+void StatManager::upsertTraffic(SqliteStmt *stmt, quint64 inBytes, quint64 outBytes)
 {
     stmt->bindInt64(2, inBytes);
     stmt->bindInt64(3, outBytes);
 
-    if (appId != 0) {
-        stmt->bindInt64(4, appId);
+    if (!sqliteDb()->done(stmt)) {
+        qCCritical(LC) << "Upsert traffic error:" << sqliteDb()->errorMessage()
+                       << "inBytes:" << inBytes << "outBytes:" << outBytes;
     }
-
-    return sqliteDb()->done(stmt);
 }
 
 qint32 StatManager::getTrafficTime(const char *sql, qint64 appId)
@@ -609,6 +696,8 @@ bool StatManager::exportBackup(const QString &path)
 
 bool StatManager::exportMasterBackup(const QString &path)
 {
+    flushTraffic();
+
     // Export Db
     if (!backupDbFile(path)) {
         qCWarning(LC) << "Export Db error:" << sqliteDb()->errorMessage();
@@ -633,6 +722,9 @@ bool StatManager::importBackup(const QString &path)
 
 bool StatManager::importMasterBackup(const QString &path)
 {
+    // The imported DB replaces the accumulated traffic too
+    clearTrafBytes();
+
     // Import Db
     SqliteDb::MigrateOptions opt = migrateOptions();
 
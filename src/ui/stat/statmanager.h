@@ -33,15 +33,19 @@ public:
     SqliteDb *sqliteDb() const { return m_sqliteDb.data(); }
 
     void setUp() override;
+    void tearDown() override;
 
     bool logProcNew(const LogEntryProcNew &entry, qint64 unixTime = 0);
     bool logStatTraf(const LogEntryStatTraf &entry, qint64 unixTime = 0);
 
+    void flushTraffic();
+
     virtual bool deleteStatApp(qint64 appId);
 
     virtual bool resetAppTrafTotals();
     bool hasAppTraf(qint64 appId);
 
+    // Read the flushed traffic only: call flushTraffic() once before a series of reads
     qint32 getTrafficTime(const char *sql, qint64 appId = 0);
 
     void getTraffic(
@@ -58,7 +62,7 @@ signals:
 
     void appStatRemoved(qint64 appId);
     void appCreated(qint64 appId, const QString &appPath);
-    void trafficAdded(qint64 unixTime, quint32 inBytes, quint32 outBytes);
+    void trafficAdded(qint64 unixTime, quint64 inBytes, quint64 outBytes);
 
     void appTrafTotalsResetted();
 
@@ -66,6 +70,12 @@ public slots:
     virtual bool clearTraffic();
 
 private:
+    struct TrafBytes
+    {
+        quint64 inBytes = 0;
+        quint64 outBytes = 0;
+    };
+
     bool setupDb();
 
     void setupTrafDate();
@@ -76,7 +86,7 @@ private:
     void updateActivePeriod(qint32 tickSecs);
 
     void clearQuotas(bool isNewDay, bool isNewMonth);
-    void checkQuotas(quint32 inBytes);
+    void checkQuotas(quint64 inBytes);
 
     bool updateTrafDay(qint64 unixTime);
 
@@ -98,15 +108,16 @@ private:
 
     void deleteOldTraffic(qint32 trafHour);
 
-    void logTrafBytes(const SqliteStmtList &insertStmtList, const SqliteStmtList &updateStmtList,
-            quint32 &sumInBytes, quint32 &sumOutBytes, quint32 pid, quint32 inBytes,
-            quint32 outBytes, qint64 unixTime, bool logStat);
+    void logTrafBytes(quint64 &sumInBytes, quint64 &sumOutBytes, quint32 pid, quint64 inBytes,
+            quint64 outBytes, qint64 unixTime, bool logStat);
+    void addAppTrafBytes(qint64 appId, const QString &appPath, quint64 inBytes, quint64 outBytes);
+    void clearTrafBytes();
 
-    void updateTrafficList(const SqliteStmtList &insertStmtList,
-            const SqliteStmtList &updateStmtList, quint32 inBytes, quint32 outBytes,
-            qint64 appId = 0);
+    qint64 trafFlushSecs() const;
 
-    bool updateTraffic(SqliteStmt *stmt, quint32 inBytes, quint32 outBytes, qint64 appId = 0);
+    void upsertAppTraffic(const char *sqlFormat, const QString &valuesSql, qint32 trafTime,
+            const QList<qint64> &appIds);
+    void upsertTraffic(SqliteStmt *stmt, quint64 inBytes, quint64 outBytes);
 
     SqliteStmt *getStmt(const char *sql);
     SqliteStmt *getTrafficStmt(const char *sql, qint32 trafTime);
@@ -121,6 +132,8 @@ private:
 
     qint32 m_tickSecs = 0;
 
+    qint64 m_trafFlushTime = 0;
+
     QTime m_activePeriodFrom;
     QTime m_activePeriodTo;
 
@@ -130,6 +143,10 @@ private:
 
     QHash<quint32, QString> m_appPidPathMap; // pid => appPath
     QHash<QString, qint64> m_appPathIdCache; // appPath => appId
+
+    TrafBytes m_trafBytes; // sum traffic bytes to flush
+    QHash<qint64, TrafBytes> m_appTrafBytes; // appId => traffic bytes to flush
+    QHash<qint64, QString> m_createdAppPaths; // appId => appPath, notified after the flush
 };
 
 #endif // STATMANAGER_H
@@ -8,68 +8,54 @@ const char *const StatSql::sqlDeleteAppId = "DELETE FROM app WHERE app_id = ?1 R
 
 const char *const StatSql::sqlSelectStatAppExists = "SELECT 1 FROM traffic_app WHERE app_id = ?1;";
 
-const char *const StatSql::sqlInsertTrafAppHour =
+const char *const StatSql::sqlUpsertTrafAppHour =
         "INSERT INTO traffic_app_hour(app_id, traf_time, in_bytes, out_bytes)"
-        "  VALUES(?4, ?1, ?2, ?3);";
+        "  VALUES %1"
+        "  ON CONFLICT(app_id, traf_time) DO UPDATE"
+        "  SET in_bytes = in_bytes + excluded.in_bytes,"
+        "    out_bytes = out_bytes + excluded.out_bytes;";
 
-const char *const StatSql::sqlInsertTrafAppDay =
+const char *const StatSql::sqlUpsertTrafAppDay =
         "INSERT INTO traffic_app_day(app_id, traf_time, in_bytes, out_bytes)"
-        "  VALUES(?4, ?1, ?2, ?3);";
+        "  VALUES %1"
+        "  ON CONFLICT(app_id, traf_time) DO UPDATE"
+        "  SET in_bytes = in_bytes + excluded.in_bytes,"
+        "    out_bytes = out_bytes + excluded.out_bytes;";
 
-const char *const StatSql::sqlInsertTrafAppMonth =
+const char *const StatSql::sqlUpsertTrafAppMonth =
         "INSERT INTO traffic_app_month(app_id, traf_time, in_bytes, out_bytes)"
-        "  VALUES(?4, ?1, ?2, ?3);";
+        "  VALUES %1"
+        "  ON CONFLICT(app_id, traf_time) DO UPDATE"
+        "  SET in_bytes = in_bytes + excluded.in_bytes,"
+        "    out_bytes = out_bytes + excluded.out_bytes;";
 
-const char *const StatSql::sqlInsertTrafAppTotal =
+const char *const StatSql::sqlUpsertTrafAppTotal =
         "INSERT INTO traffic_app(app_id, traf_time, in_bytes, out_bytes)"
-        "  VALUES(?4, ?1, ?2, ?3);";
+        "  VALUES %1"
+        "  ON CONFLICT(app_id) DO UPDATE"
+        "  SET in_bytes = in_bytes + excluded.in_bytes,"
+        "    out_bytes = out_bytes + excluded.out_bytes;";
 
-const char *const StatSql::sqlInsertTrafHour =
+const char *const StatSql::sqlUpsertTrafHour =
         "INSERT INTO traffic_hour(traf_time, in_bytes, out_bytes)"
-        "  VALUES(?1, ?2, ?3);";
+        "  VALUES(?1, ?2, ?3)"
+        "  ON CONFLICT(traf_time) DO UPDATE"
+        "  SET in_bytes = in_bytes + excluded.in_bytes,"
+        "    out_bytes = out_bytes + excluded.out_bytes;";
 
-const char *const StatSql::sqlInsertTrafDay =
+const char *const StatSql::sqlUpsertTrafDay =
         "INSERT INTO traffic_day(traf_time, in_bytes, out_bytes)"
-        "  VALUES(?1, ?2, ?3);";
+        "  VALUES(?1, ?2, ?3)"
+        "  ON CONFLICT(traf_time) DO UPDATE"
+        "  SET in_bytes = in_bytes + excluded.in_bytes,"
+        "    out_bytes = out_bytes + excluded.out_bytes;";
 
-const char *const StatSql::sqlInsertTrafMonth =
+const char *const StatSql::sqlUpsertTrafMonth =
         "INSERT INTO traffic_month(traf_time, in_bytes, out_bytes)"
-        "  VALUES(?1, ?2, ?3);";
-
-const char *const StatSql::sqlUpdateTrafAppHour = "UPDATE traffic_app_hour"
-                                                  "  SET in_bytes = in_bytes + ?2,"
-                                                  "    out_bytes = out_bytes + ?3"
-                                                  "  WHERE app_id = ?4 AND traf_time = ?1;";
-
-const char *const StatSql::sqlUpdateTrafAppDay = "UPDATE traffic_app_day"
-                                                 "  SET in_bytes = in_bytes + ?2,"
-                                                 "    out_bytes = out_bytes + ?3"
-                                                 "  WHERE app_id = ?4 AND traf_time = ?1;";
-
-const char *const StatSql::sqlUpdateTrafAppMonth = "UPDATE traffic_app_month"
-                                                   "  SET in_bytes = in_bytes + ?2,"
-                                                   "    out_bytes = out_bytes + ?3"
-                                                   "  WHERE app_id = ?4 AND traf_time = ?1;";
-
-const char *const StatSql::sqlUpdateTrafAppTotal = "UPDATE traffic_app"
-                                                   "  SET in_bytes = in_bytes + ?2,"
-                                                   "    out_bytes = out_bytes + ?3"
-                                                   "  WHERE app_id = ?4 AND 0 != ?1;";
-
-const char *const StatSql::sqlUpdateTrafHour = "UPDATE traffic_hour"
-                                               "  SET in_bytes = in_bytes + ?2,"
-                                               "    out_bytes = out_bytes + ?3"
-                                               "  WHERE traf_time = ?1;";
-
-const char *const StatSql::sqlUpdateTrafDay = "UPDATE traffic_day"
-                                              "  SET in_bytes = in_bytes + ?2,"
-                                              "    out_bytes = out_bytes + ?3"
-                                              "  WHERE traf_time = ?1;";
-
-const char *const StatSql::sqlUpdateTrafMonth = "UPDATE traffic_month"
-                                                "  SET in_bytes = in_bytes + ?2,"
-                                                "    out_bytes = out_bytes + ?3"
-                                                "  WHERE traf_time = ?1;";
+        "  VALUES(?1, ?2, ?3)"
+        "  ON CONFLICT(traf_time) DO UPDATE"
+        "  SET in_bytes = in_bytes + excluded.in_bytes,"
+        "    out_bytes = out_bytes + excluded.out_bytes;";
 
 const char *const StatSql::sqlSelectMinTrafAppHour = "SELECT min(traf_time) FROM traffic_app_hour"
                                                      "  WHERE app_id = ?1;";
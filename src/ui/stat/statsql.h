@@ -10,24 +10,14 @@ public:
 
     static const char *const sqlSelectStatAppExists;
 
-    static const char *const sqlInsertTrafAppHour;
-    static const char *const sqlInsertTrafAppDay;
-    static const char *const sqlInsertTrafAppMonth;
-    static const char *const sqlInsertTrafAppTotal;
-
-    static const char *const sqlInsertTrafHour;
-    static const char *const sqlInsertTrafDay;
-    static const char *const sqlInsertTrafMonth;
-
-    static const char *const sqlUpdateTrafAppHour;
-    static const char *const sqlUpdateTrafAppDay;
-    static const char *const sqlUpdateTrafAppMonth;
-
-    static const char *const sqlUpdateTrafHour;
-    static const char *const sqlUpdateTrafDay;
-    static const char *const sqlUpdateTrafMonth;
-
-    static const char *const sqlUpdateTrafAppTotal;
+    static const char *const sqlUpsertTrafAppHour;
+    static const char *const sqlUpsertTrafAppDay;
+    static const char *const sqlUpsertTrafAppMonth;
+    static const char *const sqlUpsertTrafAppTotal;
+
+    static const char *const sqlUpsertTrafHour;
+    static const char *const sqlUpsertTrafDay;
+    static const char *const sqlUpsertTrafMonth;
 
     static const char *const sqlSelectMinTrafAppHour;
     static const char *const sqlSelectMinTrafAppDay;
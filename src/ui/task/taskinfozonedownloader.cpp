@@ -168,6 +168,7 @@ void TaskInfoZoneDownloader::clearSubResults()
     m_enabledMask = 0;
     m_dataSize = 0;
     m_zonesData.clear();
+    m_zonesChecksums.clear();
 }
 
 void TaskInfoZoneDownloader::addSubResult(TaskZoneDownloader *worker, bool success)
@@ -186,6 +187,7 @@ void TaskInfoZoneDownloader::addSubResult(TaskZoneDownloader *worker, bool succe
 
     m_dataSize += size;
     m_zonesData.append(zoneData);
+    m_zonesChecksums.append(worker->binChecksum());
 
     insertZoneId(m_dataZonesMask, worker->zoneId());
 
@@ -196,7 +198,8 @@ void TaskInfoZoneDownloader::addSubResult(TaskZoneDownloader *worker, bool succe
 
 void TaskInfoZoneDownloader::emitZonesUpdated()
 {
-    emit taskManager()->zonesUpdated(m_dataZonesMask, m_enabledMask, m_dataSize, m_zonesData);
+    emit taskManager()->zonesUpdated(
+            m_dataZonesMask, m_enabledMask, m_dataSize, m_zonesData, m_zonesChecksums);
 
     removeOrphanCacheFiles();
 
@@ -21,6 +21,7 @@ public:
 
     const QStringList &zoneNames() const { return m_zoneNames; }
     const QList<QByteArray> &zonesData() const { return m_zonesData; }
+    const QStringList &zonesChecksums() const { return m_zonesChecksums; }
 
     TaskZoneDownloader *zoneDownloader() const;
     ZoneListModel *zoneListModel() const;
@@ -67,6 +68,7 @@ private:
 
     QStringList m_zoneNames;
     QList<QByteArray> m_zonesData;
+    QStringList m_zonesChecksums;
 };
 
 #endif // TASKINFOZONEDOWNLOADER_H
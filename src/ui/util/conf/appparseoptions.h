@@ -1,6 +1,7 @@
 #ifndef APPPARSEOPTIONS_H
 #define APPPARSEOPTIONS_H
 
+#include <QByteArray>
 #include <QMap>
 #include <QObject>
 #include <QVarLengthArray>
@@ -20,6 +21,7 @@ public:
 
 public:
     bool procWild = false;
+    bool wildExeApps = false; // wildcard apps have exe paths
 
     quint32 wildAppsSize = 0;
     quint32 prefixAppsSize = 0;
@@ -28,6 +30,8 @@ public:
     appdata_map_t wildAppsMap;
     appdata_map_t prefixAppsMap;
     appdata_map_t exeAppsMap;
+
+    QByteArray wildAppsIndex;
 };
 
 #endif // APPPARSEOPTIONS_H
@@ -13,6 +13,7 @@ class ConfAppsWalker
 {
 public:
     virtual bool walkApps(const std::function<walkAppsCallback> &func) const = 0;
+    virtual bool walkWildcardApps(const std::function<walkAppsCallback> &func) const = 0;
 };
 
 #endif // CONFAPPSWALKER_H
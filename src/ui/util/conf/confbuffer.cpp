@@ -51,6 +51,330 @@ int writeServiceInfo(char *data, const ServiceInfo &serviceInfo)
     return FORT_SERVICE_INFO_NAME_OFF + FORT_CONF_STR_DATA_SIZE(nameLen);
 }
 
+template<typename T>
+struct ZoneIpBound
+{
+    T ip;
+    qint8 zoneIndex;
+    qint8 delta; // +1: zone's range starts at ip, -1: zone's range ends before ip
+};
+
+using ZoneIp4Bounds = QVector<ZoneIpBound<ip4_t>>;
+using ZoneIp6Bounds = QVector<ZoneIpBound<ip6_addr_t>>;
+
+struct ZonesIndexArgs
+{
+    quint32 zonesDataSize = 0;
+
+    ZoneIp4Bounds ip4Bounds;
+    ZoneIp6Bounds ip6Bounds;
+
+    longs_arr_t ip4FromArray;
+    longs_arr_t ip4MaskArray;
+    ip6_arr_t ip6FromArray;
+    longs_arr_t ip6MaskArray;
+};
+
+bool incrementIp6(ip6_addr_t &ip)
+{
+    for (int i = sizeof(ip.data) - 1; i >= 0; --i) {
+        quint8 &b = reinterpret_cast<quint8 &>(ip.data[i]);
+        if (++b != 0)
+            return true;
+    }
+    return false; // overflow
+}
+
+void addZoneIp4Bounds(ZoneIp4Bounds &bounds, int zoneIndex, ip4_t from, ip4_t to)
+{
+    bounds.append({ from, qint8(zoneIndex), 1 });
+
+    if (to != std::numeric_limits<ip4_t>::max()) {
+        bounds.append({ to + 1, qint8(zoneIndex), -1 });
+    }
+}
+
+void addZoneIp6Bounds(ZoneIp6Bounds &bounds, int zoneIndex, ip6_addr_t from, ip6_addr_t to)
+{
+    bounds.append({ from, qint8(zoneIndex), 1 });
+
+    if (incrementIp6(to)) {
+        bounds.append({ to, qint8(zoneIndex), -1 });
+    }
+}
+
+void addZoneBounds(ZonesIndexArgs &zia, int zoneIndex, const IpRange &ipRange)
+{
+    for (const ip4_t ip : ipRange.ip4Array()) {
+        addZoneIp4Bounds(zia.ip4Bounds, zoneIndex, ip, ip);
+    }
+    for (int i = 0, n = ipRange.pair4Size(); i < n; ++i) {
+        const Ip4Pair pair = ipRange.pair4At(i);
+        addZoneIp4Bounds(zia.ip4Bounds, zoneIndex, pair.from, pair.to);
+    }
+
+    for (const ip6_addr_t &ip : ipRange.ip6Array()) {
+        addZoneIp6Bounds(zia.ip6Bounds, zoneIndex, ip, ip);
+    }
+    for (int i = 0, n = ipRange.pair6Size(); i < n; ++i) {
+        const Ip6Pair pair = ipRange.pair6At(i);
+        addZoneIp6Bounds(zia.ip6Bounds, zoneIndex, pair.from, pair.to);
+    }
+}
+
+// Sweep the sorted bounds and keep only the points, where the zones mask changes
+template<typename T, typename LessThan>
+void mergeZoneBounds(QVector<ZoneIpBound<T>> &bounds, QVector<T> &fromArray,
+        longs_arr_t &maskArray, LessThan lessThan)
+{
+    std::stable_sort(bounds.begin(), bounds.end(),
+            [&](const ZoneIpBound<T> &l, const ZoneIpBound<T> &r) { return lessThan(l.ip, r.ip); });
+
+    int zoneCounts[FORT_CONF_ZONE_MAX] = {};
+    quint32 mask = 0;
+
+    const int boundsCount = bounds.size();
+    for (int i = 0; i < boundsCount;) {
+        const T ip = bounds[i].ip;
+
+        do {
+            const ZoneIpBound<T> &bound = bounds[i];
+            const quint32 zoneMask = (quint32(1) << bound.zoneIndex);
+
+            zoneCounts[bound.zoneIndex] += bound.delta;
+
+            mask = (zoneCounts[bound.zoneIndex] > 0) ? (mask | zoneMask) : (mask & ~zoneMask);
+        } while (++i < boundsCount && !lessThan(ip, bounds[i].ip));
+
+        const quint32 prevMask = maskArray.isEmpty() ? 0 : maskArray.last();
+        if (mask != prevMask) {
+            fromArray.append(ip);
+            maskArray.append(mask);
+        }
+    }
+}
+
+bool buildZonesIndex(quint32 zonesMask, const QList<QByteArray> &zonesData, ZonesIndexArgs &zia)
+{
+    for (const auto &zoneData : zonesData) {
+        const int zoneIndex = BitUtil::bitScanForward(zonesMask);
+        if (Q_UNLIKELY(zoneIndex == -1))
+            break;
+
+        IpRange ipRange;
+        uint bufSize = zoneData.size();
+
+        if (!ConfRoData(zoneData.constData()).loadAddressList(ipRange, bufSize))
+            return false;
+
+        // Old zone data may contain only IPv4 list and will be migrated
+        zia.zonesDataSize += ipRange.sizeToWrite();
+
+        addZoneBounds(zia, zoneIndex, ipRange);
+
+        zonesMask ^= (quint32(1) << zoneIndex);
+    }
+
+    mergeZoneBounds(zia.ip4Bounds, zia.ip4FromArray, zia.ip4MaskArray, std::less<ip4_t>());
+    mergeZoneBounds(zia.ip6Bounds, zia.ip6FromArray, zia.ip6MaskArray,
+            [](const ip6_addr_t &l, const ip6_addr_t &r) { return fort_ip6_cmp(&l, &r) < 0; });
+
+    return true;
+}
+
+void writeZonesIndex(ConfData &confData, const ZonesIndexArgs &zia)
+{
+    PFORT_CONF_ZONES_INDEX zonesIndex = PFORT_CONF_ZONES_INDEX(confData.data());
+    zonesIndex->ip4_n = zia.ip4FromArray.size();
+    zonesIndex->ip6_n = zia.ip6FromArray.size();
+
+    ConfData indexData(zonesIndex->data);
+    indexData.writeLongs(zia.ip4FromArray);
+    indexData.writeLongs(zia.ip4MaskArray);
+    indexData.writeIp6Array(zia.ip6FromArray);
+    indexData.writeLongs(zia.ip6MaskArray);
+}
+
+bool isWildSpecialChar(const QChar c)
+{
+    return c == '*' || c == '?' || c == '[';
+}
+
+int wildLiteralPrefixSize(const QString &path)
+{
+    int n = 0;
+    while (n < path.size() && !isWildSpecialChar(path.at(n))) {
+        ++n;
+    }
+    return n;
+}
+
+int wildLiteralSuffixSize(const QString &path)
+{
+    int n = 0;
+    while (n < path.size() && !isWildSpecialChar(path.at(path.size() - 1 - n))) {
+        ++n;
+    }
+
+    // The "**" directory may match nothing together with its separator
+    if (n > 0 && n < path.size() && path.at(path.size() - n) == '\\') {
+        --n;
+    }
+
+    return n;
+}
+
+void setWildEntryKey(FORT_CONF_WILD_ENTRY &entry, const QString &path)
+{
+    const int prefixSize = wildLiteralPrefixSize(path);
+    const int suffixSize = wildLiteralSuffixSize(path);
+
+    // Prefer the longer literal as more selective
+    const bool isSuffix = (suffixSize > prefixSize);
+    const int keySize = isSuffix ? suffixSize : prefixSize;
+
+    quint32 keyHash = FORT_CONF_WILD_HASH_INIT;
+    for (int i = 0; i < keySize; ++i) {
+        const QChar c = path.at(isSuffix ? path.size() - 1 - i : i);
+
+        keyHash = fort_conf_wild_hash(keyHash, c.unicode());
+    }
+
+    entry.key_hash = keyHash;
+    entry.key_len = quint16(keySize);
+    entry.is_suffix = isSuffix;
+}
+
+quint16 wildBucketsCount(int appsCount)
+{
+    quint16 bucketsCount = 1;
+    while (bucketsCount < appsCount && bucketsCount < 0x8000) {
+        bucketsCount <<= 1;
+    }
+    return bucketsCount;
+}
+
+void buildWildAppsIndex(const appdata_map_t &wildAppsMap, QByteArray &wildAppsIndex)
+{
+    const int appsCount = wildAppsMap.size();
+    if (appsCount == 0)
+        return;
+
+    const quint16 bucketsCount = wildBucketsCount(appsCount);
+
+    QVector<FORT_CONF_WILD_ENTRY> entries(appsCount);
+    shorts_arr_t buckets(bucketsCount, 0);
+    shorts_arr_t bucketTails(bucketsCount, 0);
+    shorts_arr_t prefixLens, suffixLens, unkeyed;
+
+    quint32 appOff = 0;
+    int index = 0;
+
+    for (auto it = wildAppsMap.constBegin(); it != wildAppsMap.constEnd(); ++it, ++index) {
+        const QString &kernelPath = it.key();
+
+        FORT_CONF_WILD_ENTRY &entry = entries[index];
+        entry.app_off = appOff;
+
+        appOff += FORT_CONF_APP_ENTRY_SIZE(kernelPath.size() * sizeof(wchar_t));
+
+        setWildEntryKey(entry, kernelPath);
+
+        if (entry.key_len == 0) {
+            unkeyed.append(quint16(index));
+            continue;
+        }
+
+        shorts_arr_t &lens = entry.is_suffix ? suffixLens : prefixLens;
+        if (!lens.contains(entry.key_len)) {
+            lens.append(entry.key_len);
+        }
+
+        // Append to the bucket's chain to keep it in ascending order
+        const int bucketIndex = entry.key_hash & (bucketsCount - 1);
+        const quint16 tail = bucketTails[bucketIndex];
+
+        if (tail == 0) {
+            buckets[bucketIndex] = quint16(index + 1);
+        } else {
+            entries[tail - 1].next = quint16(index + 1);
+        }
+        bucketTails[bucketIndex] = quint16(index + 1);
+    }
+
+    std::sort(prefixLens.begin(), prefixLens.end());
+    std::sort(suffixLens.begin(), suffixLens.end());
+
+    const int shortsCount = bucketsCount + prefixLens.size() + suffixLens.size() + unkeyed.size();
+
+    wildAppsIndex = QByteArray(int(FORT_CONF_WILD_INDEX_SIZE(appsCount, shortsCount)), '\0');
+
+    PFORT_CONF_WILD_INDEX wildIndex = PFORT_CONF_WILD_INDEX(wildAppsIndex.data());
+    wildIndex->buckets_n = bucketsCount;
+    wildIndex->prefix_lens_n = quint16(prefixLens.size());
+    wildIndex->suffix_lens_n = quint16(suffixLens.size());
+    wildIndex->unkeyed_n = quint16(unkeyed.size());
+
+    ConfData confData(wildIndex->data);
+    confData.writeData(entries.constData(), appsCount, sizeof(FORT_CONF_WILD_ENTRY));
+    confData.writeShorts(buckets);
+    confData.writeShorts(prefixLens);
+    confData.writeShorts(suffixLens);
+    confData.writeShorts(unkeyed);
+}
+
+// Returns the op's data and moves to the next op
+char *writeConfDeltaOp(char *&data, quint8 type, int index, quint32 len)
+{
+    PFORT_CONF_DELTA_OP op = PFORT_CONF_DELTA_OP(data);
+
+    op->type = type;
+    op->index = quint8(index);
+    op->len = len;
+
+    data += FORT_CONF_DELTA_OP_SIZE(len);
+
+    return op->data;
+}
+
+enum RuleProgLabel : quint16 {
+    RuleProgLabelTrue = 0,
+    RuleProgLabelFalse,
+};
+
+void initRuleProgLabels(WriteRuleProgArgs &wpa)
+{
+    wpa.labels = { FORT_CONF_RULE_OP_TRUE, FORT_CONF_RULE_OP_FALSE };
+}
+
+int newRuleProgLabel(WriteRuleProgArgs &wpa)
+{
+    wpa.labels.append(FORT_CONF_RULE_OP_FALSE);
+
+    return wpa.labels.size() - 1;
+}
+
+void bindRuleProgLabel(WriteRuleProgArgs &wpa, int label)
+{
+    wpa.labels[label] = quint16(wpa.ops.size());
+}
+
+void addRuleProgOp(WriteRuleProgArgs &wpa, FORT_CONF_RULE_OP op, int trueLabel, int falseLabel)
+{
+    op.jump_true = quint16(trueLabel);
+    op.jump_false = quint16(falseLabel);
+
+    wpa.ops.append(op);
+}
+
+void resolveRuleProgLabels(WriteRuleProgArgs &wpa)
+{
+    for (FORT_CONF_RULE_OP &op : wpa.ops) {
+        op.jump_true = wpa.labels[op.jump_true];
+        op.jump_false = wpa.labels[op.jump_false];
+    }
+}
+
 }
 
 ConfBuffer::ConfBuffer(const QByteArray &buffer, QObject *parent) :
@@ -121,12 +445,16 @@ bool ConfBuffer::writeConf(
         return false;
     }
 
+    buildWildAppsIndex(opt.wildAppsMap, opt.wildAppsIndex);
+
+    m_wildExeApps = opt.wildExeApps;
+
     // Resize the buffer
     const int confIoSize = int(FORT_CONF_IO_CONF_OFF + FORT_CONF_DATA_OFF + addressGroupsSize
             + FORT_CONF_STR_DATA_SIZE(opt.wildAppsSize)
             + FORT_CONF_STR_HEADER_SIZE(opt.prefixAppsMap.size())
             + FORT_CONF_STR_DATA_SIZE(opt.prefixAppsSize)
-            + FORT_CONF_STR_DATA_SIZE(opt.exeAppsSize));
+            + FORT_CONF_STR_DATA_SIZE(opt.exeAppsSize) + opt.wildAppsIndex.size());
 
     buffer().resize(confIoSize);
 
@@ -138,6 +466,52 @@ bool ConfBuffer::writeConf(
     return true;
 }
 
+bool ConfBuffer::writeConfDelta(const FirewallConf &conf, const WriteConfDeltaArgs &wda,
+        const ConfAppsWalker *confAppsWalker, EnvManager &envManager)
+{
+    AppParseOptions opt;
+    quint32 wildAppsSize = 0;
+
+    if (wda.wildApps) {
+        if (!parseWildApps(envManager, conf.appGroups(), confAppsWalker, opt))
+            return false;
+
+        buildWildAppsIndex(opt.wildAppsMap, opt.wildAppsIndex);
+
+        m_wildExeApps = opt.wildExeApps;
+
+        wildAppsSize = FORT_CONF_DELTA_WILD_APPS_DATA_OFF
+                + FORT_CONF_STR_DATA_SIZE(opt.wildAppsSize)
+                + FORT_CONF_STR_HEADER_SIZE(opt.prefixAppsMap.size())
+                + FORT_CONF_STR_DATA_SIZE(opt.prefixAppsSize) + opt.wildAppsIndex.size();
+    }
+
+    // Resize the buffer
+    quint32 deltaSize = FORT_CONF_DELTA_DATA_OFF;
+
+    if (wda.wildApps) {
+        deltaSize += FORT_CONF_DELTA_OP_SIZE(wildAppsSize);
+    }
+
+    buffer().resize(deltaSize);
+    buffer().fill('\0');
+
+    // Fill the buffer
+    PFORT_CONF_DELTA delta = PFORT_CONF_DELTA(data());
+    delta->version = FORT_CONF_DELTA_VERSION;
+    delta->ops_n = (wda.wildApps ? 1 : 0);
+
+    char *deltaData = delta->data;
+
+    if (wda.wildApps) {
+        char *opData = writeConfDeltaOp(deltaData, FORT_CONF_DELTA_OP_WILD_APPS, 0, wildAppsSize);
+
+        ConfData(opData).writeConfDeltaWildApps(opt);
+    }
+
+    return true;
+}
+
 void ConfBuffer::writeFlags(const FirewallConf &conf)
 {
     // Resize the buffer
@@ -170,6 +544,52 @@ bool ConfBuffer::writeAppEntry(const App &app, bool isNew)
     return true;
 }
 
+bool ConfBuffer::writeAppsBatch(const QVector<App> &apps, const QStringList &deletedAppPaths)
+{
+    appdata_map_t delAppsMap;
+    quint32 delAppsSize = 0;
+
+    // The deleted apps' drives are not tracked
+    const quint32 driveMask = m_driveMask;
+
+    for (const QString &appPath : deletedAppPaths) {
+        App app;
+        app.appPath = appPath;
+
+        if (!addApp(app, /*isNew=*/false, delAppsMap, delAppsSize))
+            return false;
+    }
+
+    m_driveMask = driveMask;
+
+    appdata_map_t addAppsMap;
+    quint32 addAppsSize = 0;
+
+    for (const App &app : apps) {
+        if (!addApp(app, /*isNew=*/false, addAppsMap, addAppsSize))
+            return false;
+    }
+
+    const quint32 addAppsOff = FORT_CONF_STR_DATA_SIZE(delAppsSize);
+
+    // Resize the buffer
+    const int batchSize = FORT_CONF_APPS_BATCH_DATA_OFF + addAppsOff + addAppsSize;
+
+    buffer().resize(batchSize);
+
+    // Fill the buffer
+    PFORT_CONF_APPS_BATCH appsBatch = PFORT_CONF_APPS_BATCH(data());
+    appsBatch->del_apps_n = delAppsMap.size();
+    appsBatch->add_apps_n = addAppsMap.size();
+    appsBatch->add_apps_off = addAppsOff;
+
+    ConfData confData(appsBatch->data);
+    confData.writeApps(delAppsMap);
+    confData.writeApps(addAppsMap);
+
+    return true;
+}
+
 void ConfBuffer::writeZone(const IpRange &ipRange)
 {
     // Resize the buffer
@@ -186,8 +606,17 @@ void ConfBuffer::writeZone(const IpRange &ipRange)
 void ConfBuffer::writeZones(quint32 zonesMask, quint32 enabledMask, quint32 dataSize,
         const QList<QByteArray> &zonesData)
 {
+    ZonesIndexArgs zia;
+
+    const bool hasIndex = buildZonesIndex(zonesMask, zonesData, zia);
+
+    const quint32 zonesDataSize = hasIndex ? zia.zonesDataSize : dataSize;
+    const quint32 indexSize = hasIndex
+            ? FORT_CONF_ZONES_INDEX_SIZE(zia.ip4FromArray.size(), zia.ip6FromArray.size())
+            : 0;
+
     // Resize the buffer
-    const int zonesSize = FORT_CONF_ZONES_DATA_OFF + dataSize;
+    const int zonesSize = FORT_CONF_ZONES_DATA_OFF + zonesDataSize + indexSize;
 
     buffer().resize(zonesSize);
 
@@ -196,7 +625,7 @@ void ConfBuffer::writeZones(quint32 zonesMask, quint32 enabledMask, quint32 data
 
     PFORT_CONF_ZONES confZones = PFORT_CONF_ZONES(data);
 
-    memset(confZones, 0, sizeof(FORT_CONF_ZONES_DATA_OFF));
+    memset(confZones, 0, FORT_CONF_ZONES_DATA_OFF);
 
     confZones->mask = zonesMask;
     confZones->enabled_mask = enabledMask;
@@ -221,6 +650,55 @@ void ConfBuffer::writeZones(quint32 zonesMask, quint32 enabledMask, quint32 data
 
         zonesMask ^= zoneMask;
     }
+
+    // Write the merged index of all zones
+    if (hasIndex && confData.dataOffset() != 0) {
+        confZones->index_off = confData.dataOffset();
+
+        writeZonesIndex(confData, zia);
+    }
+}
+
+bool ConfBuffer::writeZoneUpdate(int zoneId, bool enabled, const QByteArray &zoneData)
+{
+    // Empty zone data removes the zone
+    quint32 addrSize = 0;
+    if (!zoneData.isEmpty()) {
+        IpRange ipRange;
+        uint bufSize = zoneData.size();
+
+        if (!ConfRoData(zoneData.constData()).loadAddressList(ipRange, bufSize)) {
+            setErrorMessage(tr("Bad zone data: #%1").arg(zoneId));
+            return false;
+        }
+
+        // Old zone data may contain only IPv4 list and will be migrated
+        addrSize = ipRange.sizeToWrite();
+    }
+
+    // Resize the buffer, the driver rebuilds the merged index of all zones
+    const int zoneSize = FORT_CONF_ZONE_DATA_OFF + addrSize;
+
+    buffer().resize(zoneSize);
+
+    // Fill the buffer
+    char *data = buffer().data();
+
+    PFORT_CONF_ZONE confZone = PFORT_CONF_ZONE(data);
+
+    memset(confZone, 0, FORT_CONF_ZONE_DATA_OFF);
+
+    confZone->zone_id = zoneId;
+    confZone->enabled = enabled;
+    confZone->addr_len = addrSize;
+
+    if (addrSize != 0) {
+        ConfData confData(confZone->data);
+        confData.writeArray(zoneData);
+        confData.migrateZoneData(zoneData);
+    }
+
+    return true;
 }
 
 void ConfBuffer::writeZoneFlag(int zoneId, bool enabled)
@@ -360,6 +838,27 @@ bool ConfBuffer::parseExeApps(
     });
 }
 
+bool ConfBuffer::parseWildApps(EnvManager &envManager, const QList<AppGroup *> &appGroups,
+        const ConfAppsWalker *confAppsWalker, AppParseOptions &opt)
+{
+    const auto parseApp = [&](App &app) -> bool { return parseAppsText(envManager, app, opt); };
+
+    // The exe apps are kept by the driver
+    if (confAppsWalker && !confAppsWalker->walkWildcardApps(parseApp))
+        return false;
+
+    if (!parseAppGroups(envManager, appGroups, opt))
+        return false;
+
+    const quint32 appsSize = opt.wildAppsSize + opt.prefixAppsSize;
+    if (appsSize > FORT_CONF_APPS_LEN_MAX) {
+        setErrorMessage(tr("Too many application paths"));
+        return false;
+    }
+
+    return true;
+}
+
 bool ConfBuffer::parseAppsText(EnvManager &envManager, App &app, AppParseOptions &opt)
 {
     const auto text = envManager.expandString(app.appOriginPath);
@@ -391,6 +890,8 @@ bool ConfBuffer::parseAppLine(App &app, const QStringView line, AppParseOptions
         if (app.isProcWild()) {
             opt.procWild = true;
         }
+    } else if (app.isWildcard) {
+        opt.wildExeApps = true;
     }
 
     appdata_map_t &appsMap = opt.appsMap(isWild, isPrefix);
@@ -582,58 +1083,119 @@ bool ConfBuffer::writeRuleText(const QString &ruleText, int &filtersCount)
     const auto &ruleFilter = parser.ruleFilters().first();
     Q_ASSERT(ruleFilter.isTypeList());
 
-    return writeRuleFilter(ruleFilter);
+    // Compile the filters tree into the flat program
+    WriteRuleProgArgs wpa;
+    initRuleProgLabels(wpa);
+
+    if (!writeRuleFilter(ruleFilter, wpa, RuleProgLabelTrue, RuleProgLabelFalse))
+        return false;
+
+    return writeRuleProg(wpa);
 }
 
-bool ConfBuffer::writeRuleFilter(const RuleFilter &ruleFilter)
+bool ConfBuffer::writeRuleProg(WriteRuleProgArgs &wpa)
 {
+    const int opCount = wpa.ops.size();
+
+    if (opCount > FORT_CONF_RULE_OP_MAX || wpa.labels.size() > FORT_CONF_RULE_OP_MAX) {
+        setErrorMessage(tr("Too many filters"));
+        return false;
+    }
+
+    resolveRuleProgLabels(wpa);
+
     // Resize the buffer
     const int oldSize = buffer().size();
+    const int progDataOff = FORT_CONF_RULE_PROG_DATA_OFF(opCount);
 
-    buffer().resize(oldSize + sizeof(FORT_CONF_RULE_FILTER));
+    buffer().resize(oldSize + progDataOff + wpa.data.size());
 
     // Fill the buffer
-    const bool ok = ruleFilter.isTypeList() ? writeRuleFilterList(ruleFilter)
-                                            : writeRuleFilterValues(ruleFilter);
+    char *data = this->data() + oldSize;
+
+    PFORT_CONF_RULE_PROG confProg = PFORT_CONF_RULE_PROG(data);
+    confProg->op_count = quint16(opCount);
+    confProg->reserved = 0;
+
+    ConfData confData(confProg->ops);
 
-    if (ok) {
-        PFORT_CONF_RULE_FILTER confFilter = PFORT_CONF_RULE_FILTER(data() + oldSize);
+    confData.writeData(wpa.ops.constData(), opCount, sizeof(FORT_CONF_RULE_OP));
+    confData.writeArray(wpa.data);
 
-        confFilter->is_not = ruleFilter.isNot;
-        confFilter->equal_values = ruleFilter.equalValues;
-        confFilter->is_empty = !ruleFilter.hasValues();
-        confFilter->type = ruleFilter.type;
+    return true;
+}
+
+bool ConfBuffer::writeRuleFilter(
+        const RuleFilter &ruleFilter, WriteRuleProgArgs &wpa, int trueLabel, int falseLabel)
+{
+    if (ruleFilter.isTypeList())
+        return writeRuleFilterList(ruleFilter, wpa, trueLabel, falseLabel);
 
-        const quint32 filterSize = buffer().size() - oldSize;
-        Q_ASSERT(filterSize > 0);
+    FORT_CONF_RULE_OP op = {};
 
-        confFilter->size = filterSize;
+    op.type = ruleFilter.type;
+    op.equal_values = ruleFilter.equalValues;
+    op.is_empty = !ruleFilter.hasValues();
+    op.data_off = wpa.data.size();
+
+    if (!writeRuleFilterValues(ruleFilter, wpa.data))
+        return false;
+
+    // Negation is compiled into swapped jumps
+    if (ruleFilter.isNot) {
+        std::swap(trueLabel, falseLabel);
     }
 
-    return ok;
+    addRuleProgOp(wpa, op, trueLabel, falseLabel);
+
+    return true;
 }
 
-bool ConfBuffer::writeRuleFilterList(const RuleFilter &ruleListFilter)
+bool ConfBuffer::writeRuleFilterList(
+        const RuleFilter &ruleListFilter, WriteRuleProgArgs &wpa, int trueLabel, int falseLabel)
 {
+    const bool isAnd = (ruleListFilter.type == FORT_RULE_FILTER_TYPE_LIST_AND);
+
+    // The failed AND-list jumps to the action reset op
+    const int listFalseLabel = isAnd ? newRuleProgLabel(wpa) : falseLabel;
+
     const RuleFilter *ruleFilter = &ruleListFilter + 1;
     int count = ruleListFilter.filterListCount;
 
-    for (; --count >= 0; ++ruleFilter) {
-        if (!writeRuleFilter(*ruleFilter))
-            return false;
+    while (count > 0) {
+        const int filterListCount = ruleFilter->isTypeList() ? ruleFilter->filterListCount : 0;
 
-        if (ruleFilter->isTypeList()) {
-            const int filterListCount = ruleFilter->filterListCount;
+        count -= 1 + filterListCount;
+
+        const bool isLast = (count <= 0);
+        const int nextLabel = isLast ? -1 : newRuleProgLabel(wpa);
+
+        const int subTrueLabel = (isAnd && !isLast) ? nextLabel : trueLabel;
+        const int subFalseLabel = isAnd ? listFalseLabel : (isLast ? falseLabel : nextLabel);
+
+        if (!writeRuleFilter(*ruleFilter, wpa, subTrueLabel, subFalseLabel))
+            return false;
 
-            count -= filterListCount;
-            ruleFilter += filterListCount;
+        if (!isLast) {
+            bindRuleProgLabel(wpa, nextLabel);
         }
+
+        ruleFilter += 1 + filterListCount;
+    }
+
+    if (isAnd) {
+        FORT_CONF_RULE_OP op = {};
+
+        op.type = FORT_RULE_FILTER_TYPE_ACTION_RESET;
+
+        bindRuleProgLabel(wpa, listFalseLabel);
+        addRuleProgOp(wpa, op, falseLabel, falseLabel);
     }
 
     return true;
 }
 
-bool ConfBuffer::writeRuleFilterValues(const RuleFilter &ruleFilter)
+bool ConfBuffer::writeRuleFilterValues(const RuleFilter &ruleFilter, QByteArray &data)
 {
     QScopedPointer<ValueRange> range(ValueRangeUtil::createRangeByType(ruleFilter.type));
 
@@ -647,14 +1209,14 @@ bool ConfBuffer::writeRuleFilterValues(const RuleFilter &ruleFilter)
         return false;
     }
 
-    // Resize the buffer
-    const int oldSize = buffer().size();
+    // Resize the data
+    const int oldSize = data.size();
     const int newSize = oldSize + range->sizeToWrite();
 
-    buffer().resize(newSize);
+    data.resize(newSize);
 
-    // Fill the buffer
-    ConfData confData(data() + oldSize);
+    // Fill the data
+    ConfData confData(data.data() + oldSize);
 
     range->write(confData);
 
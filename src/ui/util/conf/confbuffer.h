@@ -2,6 +2,8 @@
 #define CONFBUFFER_H
 
 #include <QByteArray>
+#include <QStringList>
+#include <QVector>
 
 #include <util/conf/confappswalker.h>
 #include <util/conf/confruleswalker.h>
@@ -13,6 +15,18 @@ class AppGroup;
 class EnvManager;
 class RuleFilter;
 
+struct WriteConfDeltaArgs
+{
+    bool wildApps = false;
+};
+
+struct WriteRuleProgArgs
+{
+    QVector<FORT_CONF_RULE_OP> ops;
+    QVector<quint16> labels; // label -> op index
+    QByteArray data;
+};
+
 class ConfBuffer : public QObject
 {
     Q_OBJECT
@@ -22,6 +36,8 @@ public:
 
     quint32 driveMask() const { return m_driveMask; }
 
+    bool wildExeApps() const { return m_wildExeApps; }
+
     QString errorMessage() const { return m_errorMessage; }
 
     bool hasError() const { return !errorMessage().isEmpty(); }
@@ -39,12 +55,16 @@ public slots:
 
     bool writeConf(
             const FirewallConf &conf, const ConfAppsWalker *confAppsWalker, EnvManager &envManager);
+    bool writeConfDelta(const FirewallConf &conf, const WriteConfDeltaArgs &wda,
+            const ConfAppsWalker *confAppsWalker, EnvManager &envManager);
     void writeFlags(const FirewallConf &conf);
     bool writeAppEntry(const App &app, bool isNew = false);
+    bool writeAppsBatch(const QVector<App> &apps, const QStringList &deletedAppPaths);
 
     void writeZone(const IpRange &ipRange);
     void writeZones(quint32 zonesMask, quint32 enabledMask, quint32 dataSize,
             const QList<QByteArray> &zonesData);
+    bool writeZoneUpdate(int zoneId, bool enabled, const QByteArray &zoneData);
     void writeZoneFlag(int zoneId, bool enabled);
 
     bool loadZone(IpRange &ipRange);
@@ -66,6 +86,9 @@ private:
     bool parseExeApps(
             EnvManager &envManager, const ConfAppsWalker *confAppsWalker, AppParseOptions &opt);
 
+    bool parseWildApps(EnvManager &envManager, const QList<AppGroup *> &appGroups,
+            const ConfAppsWalker *confAppsWalker, AppParseOptions &opt);
+
     bool parseAppsText(EnvManager &envManager, App &app, AppParseOptions &opt);
 
     bool parseAppLine(App &app, const QStringView line, AppParseOptions &opt);
@@ -74,13 +97,18 @@ private:
 
     bool writeRule(const Rule &rule, const WalkRulesArgs &wra);
     bool writeRuleText(const QString &ruleText, int &filtersCount);
-    bool writeRuleFilter(const RuleFilter &ruleFilter);
-    bool writeRuleFilterList(const RuleFilter &ruleListFilter);
-    bool writeRuleFilterValues(const RuleFilter &ruleFilter);
+    bool writeRuleProg(WriteRuleProgArgs &wpa);
+    bool writeRuleFilter(
+            const RuleFilter &ruleFilter, WriteRuleProgArgs &wpa, int trueLabel, int falseLabel);
+    bool writeRuleFilterList(const RuleFilter &ruleListFilter, WriteRuleProgArgs &wpa,
+            int trueLabel, int falseLabel);
+    bool writeRuleFilterValues(const RuleFilter &ruleFilter, QByteArray &data);
 
 private:
     quint32 m_driveMask = 0;
 
+    bool m_wildExeApps = false;
+
     QString m_errorMessage;
 
     QByteArray m_buffer;
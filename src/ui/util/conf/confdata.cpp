@@ -13,6 +13,25 @@
 
 namespace {
 
+template<typename T>
+QVector<T> addrListArray(const QVector<T> &array, bool eytzinger)
+{
+    if (!eytzinger)
+        return array;
+
+    const int count = array.size();
+
+    longs_arr_t order(count);
+    fort_conf_eytzinger_order(order.data(), count);
+
+    QVector<T> result(count);
+    for (int i = 0; i < count; ++i) {
+        result[i] = array[order[i]];
+    }
+
+    return result;
+}
+
 void writeAppGroupFlags(PFORT_CONF_GROUP out, const FirewallConf &conf)
 {
     out->group_bits = 0;
@@ -34,6 +53,11 @@ void writeAppGroupFlags(PFORT_CONF_GROUP out, const FirewallConf &conf)
     }
 }
 
+void writeLimitFlags(PFORT_SPEED_LIMIT limit, const AppGroup *appGroup)
+{
+    limit->flags = (appGroup->limitCodel() ? FORT_SPEED_LIMIT_CODEL : 0);
+}
+
 void writeLimitBps(PFORT_SPEED_LIMIT limit, quint32 kBits)
 {
     limit->bps = quint64(kBits) * (1024LL / 8); /* to bytes per second */
@@ -45,6 +69,7 @@ void writeLimitIn(PFORT_SPEED_LIMIT limit, const AppGroup *appGroup)
     limit->latency_ms = appGroup->limitLatency();
     limit->buffer_bytes = appGroup->limitBufferSizeIn();
 
+    writeLimitFlags(limit, appGroup);
     writeLimitBps(limit, appGroup->speedLimitIn());
 }
 
@@ -54,6 +79,7 @@ void writeLimitOut(PFORT_SPEED_LIMIT limit, const AppGroup *appGroup)
     limit->latency_ms = appGroup->limitLatency();
     limit->buffer_bytes = appGroup->limitBufferSizeOut();
 
+    writeLimitFlags(limit, appGroup);
     writeLimitBps(limit, appGroup->speedLimitOut());
 }
 
@@ -102,7 +128,7 @@ void ConfData::writeConf(const WriteConfArgs &wca, AppParseOptions &opt)
     PFORT_CONF drvConf = &drvConfIo->conf;
 
     quint32 addrGroupsOff;
-    quint32 wildAppsOff, prefixAppsOff, exeAppsOff;
+    quint32 wildAppsOff, prefixAppsOff, exeAppsOff, wildIndexOff = 0;
 
     m_data = drvConf->data;
     resetBase();
@@ -117,6 +143,12 @@ void ConfData::writeConf(const WriteConfArgs &wca, AppParseOptions &opt)
     prefixAppsOff = dataOffset();
     writeApps(opt.prefixAppsMap, /*useHeader=*/true);
 
+    if (!opt.wildAppsIndex.isEmpty()) {
+        wildIndexOff = dataOffset();
+        writeArray(opt.wildAppsIndex);
+    }
+
+    // The driver keeps the data before the exe apps
     exeAppsOff = dataOffset();
     writeApps(opt.exeAppsMap);
 
@@ -139,6 +171,36 @@ void ConfData::writeConf(const WriteConfArgs &wca, AppParseOptions &opt)
     drvConf->wild_apps_off = wildAppsOff;
     drvConf->prefix_apps_off = prefixAppsOff;
     drvConf->exe_apps_off = exeAppsOff;
+
+    drvConf->wild_index_off = wildIndexOff;
+}
+
+void ConfData::writeConfDeltaWildApps(const AppParseOptions &opt)
+{
+    PFORT_CONF_DELTA_WILD_APPS wildApps = PFORT_CONF_DELTA_WILD_APPS(m_data);
+
+    quint32 prefixAppsOff, wildIndexOff = 0;
+
+    m_data = wildApps->data;
+    resetBase();
+
+    writeApps(opt.wildAppsMap);
+
+    prefixAppsOff = dataOffset();
+    writeApps(opt.prefixAppsMap, /*useHeader=*/true);
+
+    if (!opt.wildAppsIndex.isEmpty()) {
+        wildIndexOff = dataOffset();
+        writeArray(opt.wildAppsIndex);
+    }
+
+    wildApps->proc_wild = opt.procWild;
+
+    wildApps->wild_apps_n = quint16(opt.wildAppsMap.size());
+    wildApps->prefix_apps_n = quint16(opt.prefixAppsMap.size());
+
+    wildApps->prefix_apps_off = prefixAppsOff;
+    wildApps->wild_index_off = wildIndexOff;
 }
 
 void ConfData::writeConfFlags(const FirewallConf &conf)
@@ -174,6 +236,7 @@ void ConfData::writeConfFlags(const FirewallConf &conf)
     confFlags->log_alerted_conn = conf.logAlertedConn();
 
     confFlags->group_bits = conf.activeGroupBits();
+    confFlags->ask_packets_max = quint16(qBound(1, conf.ini().askPacketsMax(), 0xFFFF));
 }
 
 void ConfData::writeAddressRanges(const addrranges_arr_t &addressRanges)
@@ -215,19 +278,25 @@ void ConfData::writeIpRange(const IpRange &ipRange, bool isIPv6)
 {
     PFORT_CONF_ADDR_LIST addrList = PFORT_CONF_ADDR_LIST(m_data);
 
-    addrList->ip_n = quint32(isIPv6 ? ipRange.ip6Size() : ipRange.ip4Size());
-    addrList->pair_n = quint32(isIPv6 ? ipRange.pair6Size() : ipRange.pair4Size());
+    const int ipSize = isIPv6 ? ipRange.ip6Size() : ipRange.ip4Size();
+    const int pairSize = isIPv6 ? ipRange.pair6Size() : ipRange.pair4Size();
+
+    const bool eytzinger = (qMax(ipSize, pairSize) >= FORT_CONF_ADDR_LIST_EYTZINGER_MIN);
+
+    addrList->ip_n = quint32(ipSize);
+    addrList->eytzinger = eytzinger;
+    addrList->pair_n = quint32(pairSize);
 
     m_data += FORT_CONF_ADDR_LIST_OFF;
 
     if (isIPv6) {
-        writeIp6Array(ipRange.ip6Array());
-        writeIp6Array(ipRange.pair6FromArray());
-        writeIp6Array(ipRange.pair6ToArray());
+        writeIp6Array(addrListArray(ipRange.ip6Array(), eytzinger));
+        writeIp6Array(addrListArray(ipRange.pair6FromArray(), eytzinger));
+        writeIp6Array(addrListArray(ipRange.pair6ToArray(), eytzinger));
     } else {
-        writeLongs(ipRange.ip4Array());
-        writeLongs(ipRange.pair4FromArray());
-        writeLongs(ipRange.pair4ToArray());
+        writeLongs(addrListArray(ipRange.ip4Array(), eytzinger));
+        writeLongs(addrListArray(ipRange.pair4FromArray(), eytzinger));
+        writeLongs(addrListArray(ipRange.pair4ToArray(), eytzinger));
     }
 }
 
@@ -10,6 +10,7 @@
 #include "conf_types.h"
 
 class ActionRange;
+class AppGroup;
 class AreaRange;
 class IpVerRange;
 class DirRange;
@@ -46,6 +47,8 @@ public:
     void writeConf(const WriteConfArgs &wca, AppParseOptions &opt);
     void writeConfFlags(const FirewallConf &conf);
 
+    void writeConfDeltaWildApps(const AppParseOptions &opt);
+
     void writeAddressRanges(const addrranges_arr_t &addressRanges);
     void writeAddressRange(const AddressRange &addressRange);
 
@@ -2,6 +2,27 @@
 
 #include <common/fortconf.h>
 
+namespace {
+
+template<typename T>
+void sortAddrListArray(QVector<T> &array, bool eytzinger)
+{
+    if (!eytzinger)
+        return;
+
+    const int count = array.size();
+
+    longs_arr_t order(count);
+    fort_conf_eytzinger_order(order.data(), count);
+
+    const QVector<T> eytzingerArray = array;
+    for (int i = 0; i < count; ++i) {
+        array[order[i]] = eytzingerArray[i];
+    }
+}
+
+}
+
 ConfRoData::ConfRoData(const void *data) : m_data((const char *) data) { }
 
 bool ConfRoData::loadAddressList(IpRange &ipRange, uint &bufSize)
@@ -18,6 +39,8 @@ bool ConfRoData::loadIpRange(IpRange &ipRange, uint &bufSize, bool isIPv6)
     PFORT_CONF_ADDR_LIST addr_list = PFORT_CONF_ADDR_LIST(m_data);
     m_data = (const char *) addr_list->ip;
 
+    const bool eytzinger = addr_list->eytzinger;
+
     const uint addrListSize = isIPv6
             ? FORT_CONF_ADDR6_LIST_SIZE(addr_list->ip_n, addr_list->pair_n)
             : FORT_CONF_ADDR4_LIST_SIZE(addr_list->ip_n, addr_list->pair_n);
@@ -35,6 +58,10 @@ bool ConfRoData::loadIpRange(IpRange &ipRange, uint &bufSize, bool isIPv6)
         loadIp6Array(ipRange.ip6Array());
         loadIp6Array(ipRange.pair6FromArray());
         loadIp6Array(ipRange.pair6ToArray());
+
+        sortAddrListArray(ipRange.ip6Array(), eytzinger);
+        sortAddrListArray(ipRange.pair6FromArray(), eytzinger);
+        sortAddrListArray(ipRange.pair6ToArray(), eytzinger);
     } else {
         ipRange.ip4Array().resize(addr_list->ip_n);
         ipRange.pair4FromArray().resize(addr_list->pair_n);
@@ -43,6 +70,10 @@ bool ConfRoData::loadIpRange(IpRange &ipRange, uint &bufSize, bool isIPv6)
         loadLongs(ipRange.ip4Array());
         loadLongs(ipRange.pair4FromArray());
         loadLongs(ipRange.pair4ToArray());
+
+        sortAddrListArray(ipRange.ip4Array(), eytzinger);
+        sortAddrListArray(ipRange.pair4FromArray(), eytzinger);
+        sortAddrListArray(ipRange.pair4ToArray(), eytzinger);
     }
 
     return true;
@@ -0,0 +1,56 @@
+#include "tablesqljob.h"
+
+#include <sqlite/dbquery.h>
+#include <sqlite/sqlitestmt.h>
+
+#include <util/worker/workerobject.h>
+
+#include "tablesqlloader.h"
+#include "tablesqlrows.h"
+
+TableSqlJob::TableSqlJob(
+        const QString &sql, const QVariantHash &vars, const TableSqlRowsPtr &rows) :
+    WorkerJob(sql), m_vars(vars), m_rows(rows)
+{
+}
+
+void TableSqlJob::doJob(WorkerObject &worker)
+{
+    auto loader = static_cast<TableSqlLoader *>(worker.manager());
+
+    if (!loader->beginJob(this))
+        return;
+
+    if (m_rows) {
+        loadRows(loader->sqliteDb());
+    } else {
+        loadCount(loader->sqliteDb());
+    }
+
+    loader->endJob();
+
+    m_finished.storeRelease(1);
+}
+
+void TableSqlJob::reportResult(WorkerObject &worker)
+{
+    if (!isFinished() || isCancelled())
+        return;
+
+    emit static_cast<TableSqlLoader *>(worker.manager())->jobFinished();
+}
+
+void TableSqlJob::loadRows(SqliteDb *sqliteDb)
+{
+    SqliteStmt stmt;
+    if (!DbQuery(sqliteDb).sql(sql()).vars(vars()).prepare(stmt))
+        return;
+
+    m_resultCount = m_rows->fetchRows(stmt);
+    m_ok = true;
+}
+
+void TableSqlJob::loadCount(SqliteDb *sqliteDb)
+{
+    m_resultCount = DbQuery(sqliteDb, &m_ok).sql(sql()).vars(vars()).execute().toInt();
+}
@@ -0,0 +1,56 @@
+#ifndef TABLESQLJOB_H
+#define TABLESQLJOB_H
+
+#include <QAtomicInt>
+#include <QVariant>
+
+#include <util/worker/workerjob.h>
+
+#include "tablesqlmodel.h"
+
+class TableSqlJob : public WorkerJob
+{
+public:
+    // Counts the rows, when the rows block is not set
+    explicit TableSqlJob(
+            const QString &sql, const QVariantHash &vars, const TableSqlRowsPtr &rows = {});
+
+    const QString &sql() const { return text(); }
+    const QVariantHash &vars() const { return m_vars; }
+
+    const TableSqlRowsPtr &rows() const { return m_rows; }
+
+    int firstRow() const { return m_firstRow; }
+    void setFirstRow(int v) { m_firstRow = v; }
+
+    // Returns false, when the query failed and the result is not valid
+    bool isOk() const { return m_ok; }
+
+    int resultCount() const { return m_resultCount; }
+
+    bool isCancelled() const { return m_cancelled.loadAcquire() != 0; }
+    void cancel() { m_cancelled.storeRelease(1); }
+
+    bool isFinished() const { return m_finished.loadAcquire() != 0; }
+
+    void doJob(WorkerObject &worker) override;
+    void reportResult(WorkerObject &worker) override;
+
+private:
+    void loadRows(SqliteDb *sqliteDb);
+    void loadCount(SqliteDb *sqliteDb);
+
+private:
+    bool m_ok = false;
+
+    int m_firstRow = 0;
+    int m_resultCount = 0;
+
+    QAtomicInt m_cancelled;
+    QAtomicInt m_finished;
+
+    const QVariantHash m_vars;
+    const TableSqlRowsPtr m_rows;
+};
+
+#endif // TABLESQLJOB_H
@@ -0,0 +1,63 @@
+#include "tablesqlloader.h"
+
+#include <sqlite/sqlitedb.h>
+
+#include "tablesqljob.h"
+
+TableSqlLoader::TableSqlLoader(const QString &filePath, QObject *parent) :
+    WorkerManager(parent),
+    m_sqliteDb(SqliteDbPtr::create(filePath, SqliteDb::OpenDefaultReadOnly))
+{
+    setMaxWorkersCount(1); // the connection is used by one worker at a time
+}
+
+TableSqlLoader::~TableSqlLoader()
+{
+    // Stop the workers, while the connection is alive
+    {
+        QMutexLocker locker(&m_jobMutex);
+
+        if (m_runningJob) {
+            m_runningJob->cancel();
+            sqliteDb()->interrupt();
+        }
+    }
+
+    abortWorkers();
+}
+
+bool TableSqlLoader::open()
+{
+    return sqliteDb()->open();
+}
+
+bool TableSqlLoader::beginJob(TableSqlJob *job)
+{
+    QMutexLocker locker(&m_jobMutex);
+
+    if (job->isCancelled())
+        return false;
+
+    m_runningJob = job;
+
+    return true;
+}
+
+void TableSqlLoader::endJob()
+{
+    QMutexLocker locker(&m_jobMutex);
+
+    m_runningJob = nullptr;
+}
+
+void TableSqlLoader::cancelJob(TableSqlJob *job)
+{
+    QMutexLocker locker(&m_jobMutex);
+
+    job->cancel();
+
+    // Abort the superseded query
+    if (m_runningJob == job) {
+        sqliteDb()->interrupt();
+    }
+}
@@ -0,0 +1,44 @@
+#ifndef TABLESQLLOADER_H
+#define TABLESQLLOADER_H
+
+#include <QMutex>
+
+#include <sqlite/sqlite_types.h>
+
+#include <util/classhelpers.h>
+#include <util/worker/workermanager.h>
+
+class TableSqlJob;
+
+class TableSqlLoader : public WorkerManager
+{
+    Q_OBJECT
+
+public:
+    explicit TableSqlLoader(const QString &filePath, QObject *parent = nullptr);
+    ~TableSqlLoader() override;
+    CLASS_DELETE_COPY_MOVE(TableSqlLoader)
+
+    SqliteDb *sqliteDb() const { return m_sqliteDb.data(); }
+
+    QString workerName() const override { return "TableSqlWorker"; }
+
+    bool open();
+
+    bool beginJob(TableSqlJob *job);
+    void endJob();
+
+    void cancelJob(TableSqlJob *job);
+
+signals:
+    void jobFinished();
+
+private:
+    TableSqlJob *m_runningJob = nullptr;
+
+    QMutex m_jobMutex;
+
+    SqliteDbPtr m_sqliteDb;
+};
+
+#endif // TABLESQLLOADER_H
@@ -4,12 +4,36 @@
 #include <sqlite/sqlitedb.h>
 #include <sqlite/sqlitestmt.h>
 
+#include "tablesqljob.h"
+#include "tablesqlloader.h"
+#include "tablesqlrows.h"
+
+namespace {
+
+constexpr int rowsBlockSize = 256;
+constexpr int rowsBlockBackSize = 16; // rows before the fetched row
+
+bool isMemoryDb(const SqliteDb *sqliteDb)
+{
+    const QString filePath = sqliteDb->filePath();
+
+    return (sqliteDb->openFlags() & SqliteDb::OpenMemory) != 0 || filePath.isEmpty()
+            || filePath == ":memory:";
+}
+
+}
+
 TableSqlModel::TableSqlModel(QObject *parent) : TableItemModel(parent) { }
 
 int TableSqlModel::rowCount(const QModelIndex & /*parent*/) const
 {
     if (m_sqlRowCount < 0) {
-        m_sqlRowCount = doSqlCount();
+        if (isSqlCountAsync()) {
+            loadSqlCount();
+            return m_shownRowCount;
+        }
+
+        setSqlRowCount(doSqlCount());
     }
 
     return m_sqlRowCount;
@@ -25,16 +49,312 @@ void TableSqlModel::sort(int column, Qt::SortOrder order)
     }
 }
 
+void TableSqlModel::setupSqlLoader()
+{
+    if (m_sqlLoader)
+        return;
+
+    // The in-memory database is not shared with other connections
+    if (isMemoryDb(sqliteDb()))
+        return;
+
+    auto loader = new TableSqlLoader(sqliteDb()->filePath(), this);
+    if (!loader->open()) {
+        delete loader;
+        return;
+    }
+
+    connect(loader, &TableSqlLoader::jobFinished, this, &TableSqlModel::onSqlJobFinished);
+
+    m_sqlLoader = loader;
+}
+
+bool TableSqlModel::isRowLoading(int row) const
+{
+    if (!isAsyncLoad())
+        return false;
+
+    m_rowsLoadAsync = true;
+    updateRowCache(row);
+    m_rowsLoadAsync = false;
+
+    return tableRow().isNull();
+}
+
 void TableSqlModel::invalidateRowCache() const
 {
     setSqlRowCount(-1);
+
+    if (isAsyncLoad()) {
+        cancelSqlJobs();
+        m_rowsBlockStale = true;
+    } else {
+        m_rowsBlockCount = 0;
+    }
+
     TableItemModel::invalidateRowCache();
 }
 
-void TableSqlModel::fillQueryVarsForRow(QVariantHash &vars, int row) const
+void TableSqlModel::invalidateRowCacheRange(int firstRow, int lastRow) const
+{
+    setSqlRowCount(-1);
+
+    const int blockLastRow = m_rowsBlockFirst + m_rowsBlockCount - 1;
+    if (m_rowsBlockFirst <= lastRow && blockLastRow >= firstRow) {
+        if (isAsyncLoad()) {
+            cancelSqlJob(m_rowsBlockJob);
+            m_rowsBlockStale = true;
+        } else {
+            m_rowsBlockCount = 0;
+        }
+    }
+
+    const int row = tableRow().row;
+    if (row >= firstRow && row <= lastRow) {
+        tableRow().invalidate();
+    }
+}
+
+void TableSqlModel::fillQueryVarsForRow(QVariantHash &vars, int /*row*/) const
 {
     fillQueryVars(vars);
-    vars.insert(":offset", row);
+}
+
+void TableSqlModel::fillQueryVarsForRows(QVariantHash &vars, int firstRow, int count) const
+{
+    vars.insert(":offset", firstRow);
+    vars.insert(":limit", count);
+}
+
+bool TableSqlModel::updateTableRow(const QVariantHash &vars, int row) const
+{
+    // The stale rows are shown only in the view
+    if (isRowsBlockRow(row) && (!m_rowsBlockStale || m_rowsLoadAsync)
+            && loadTableRow(*m_rowsBlock, row - m_rowsBlockFirst)) {
+        if (m_rowsBlockStale) {
+            loadRowsBlock(vars, row);
+        }
+        return true;
+    }
+
+    if (m_rowsLoadAsync) {
+        // The fresh block has no such row
+        if (!isRowsBlockRow(row) || m_rowsBlockStale) {
+            loadRowsBlock(vars, row);
+        }
+        return false;
+    }
+
+    if (!fetchRowsBlock(vars, row))
+        return false;
+
+    return isRowsBlockRow(row) && loadTableRow(*m_rowsBlock, row - m_rowsBlockFirst);
+}
+
+bool TableSqlModel::isRowsBlockRow(int row) const
+{
+    return row >= m_rowsBlockFirst && row < m_rowsBlockFirst + m_rowsBlockCount;
+}
+
+int TableSqlModel::rowsBlockFirstRow(int row) const
+{
+    // Prefetch the rows ahead in the scroll direction
+    const bool isScrollUp = (row < m_rowsBlockFetchRow);
+    const int backSize = isScrollUp ? (rowsBlockSize - rowsBlockBackSize) : rowsBlockBackSize;
+
+    int firstRow = row - backSize;
+
+    // Fill the block up to the last row, when the rows count is known
+    if (m_sqlRowCount >= 0) {
+        firstRow = qMin(firstRow, m_sqlRowCount - rowsBlockSize);
+    }
+
+    m_rowsBlockFetchRow = row;
+
+    return qMax(0, firstRow);
+}
+
+void TableSqlModel::fillQueryVarsForRowsBlock(QVariantHash &vars, int firstRow) const
+{
+    fillQueryVarsForRows(vars, firstRow, rowsBlockSize);
+
+    // Seek after the cached previous row instead of skipping the offset's rows
+    const int prevRow = firstRow - 1;
+    if (prevRow < 0 || m_rowsBlockStale || !isRowsBlockRow(prevRow))
+        return;
+
+    const QVariantList keyset = m_rowsBlock->keysetAt(prevRow - m_rowsBlockFirst);
+    if (keyset.isEmpty())
+        return;
+
+    int keyIndex = 0;
+    for (const QVariant &v : keyset) {
+        vars.insert(":key" + QString::number(++keyIndex), v);
+    }
+
+    vars.insert(":offset", 0);
+}
+
+bool TableSqlModel::fetchRowsBlock(const QVariantHash &vars, int row) const
+{
+    const int firstRow = rowsBlockFirstRow(row);
+
+    QVariantHash blockVars = vars;
+    fillQueryVarsForRowsBlock(blockVars, firstRow);
+
+    m_rowsBlockFirst = firstRow;
+    m_rowsBlockCount = 0;
+    m_rowsBlockStale = false;
+
+    SqliteStmt stmt;
+    if (!DbQuery(sqliteDb()).sql(sqlRowsBlock(blockVars)).vars(blockVars).prepare(stmt))
+        return false;
+
+    m_rowsBlock = createTableRows();
+    m_rowsBlock->setKeysetCount(rowsBlockKeysetColumns().size());
+    m_rowsBlockCount = m_rowsBlock->fetchRows(stmt);
+
+    return true;
+}
+
+void TableSqlModel::loadSqlCount() const
+{
+    if (m_sqlCountJob)
+        return; // already loading
+
+    QVariantHash vars;
+    fillQueryVars(vars);
+
+    m_sqlCountJob = TableSqlJobPtr::create(sqlCount(), vars);
+
+    m_sqlLoader->enqueueJob(m_sqlCountJob);
+}
+
+void TableSqlModel::loadRowsBlock(const QVariantHash &vars, int row) const
+{
+    if (m_rowsBlockJob) {
+        const int jobFirstRow = m_rowsBlockJob->firstRow();
+        if (row >= jobFirstRow && row < jobFirstRow + rowsBlockSize)
+            return; // already loading
+
+        // Superseded by the scrolling
+        cancelSqlJob(m_rowsBlockJob);
+    }
+
+    const int firstRow = rowsBlockFirstRow(row);
+
+    QVariantHash blockVars = vars;
+    fillQueryVarsForRowsBlock(blockVars, firstRow);
+
+    const TableSqlRowsPtr rows = createTableRows();
+    rows->setKeysetCount(rowsBlockKeysetColumns().size());
+
+    m_rowsBlockJob = TableSqlJobPtr::create(sqlRowsBlock(blockVars), blockVars, rows);
+    m_rowsBlockJob->setFirstRow(firstRow);
+
+    m_sqlLoader->enqueueJob(m_rowsBlockJob);
+}
+
+void TableSqlModel::cancelSqlJob(TableSqlJobPtr &job) const
+{
+    if (!job)
+        return;
+
+    m_sqlLoader->cancelJob(job.data());
+    job.reset();
+}
+
+void TableSqlModel::cancelSqlJobs() const
+{
+    cancelSqlJob(m_sqlCountJob);
+    cancelSqlJob(m_rowsBlockJob);
+}
+
+void TableSqlModel::onSqlJobFinished()
+{
+    if (m_sqlCountJob && m_sqlCountJob->isFinished()) {
+        const TableSqlJobPtr job = m_sqlCountJob;
+        m_sqlCountJob.reset();
+
+        // Keep the shown count on the failed query
+        updateSqlRowCount(job->isOk() ? job->resultCount() : m_shownRowCount);
+    }
+
+    if (m_rowsBlockJob && m_rowsBlockJob->isFinished()) {
+        const TableSqlJobPtr job = m_rowsBlockJob;
+        m_rowsBlockJob.reset();
+
+        // Keep the shown rows on the failed query
+        if (job->isOk()) {
+            updateRowsBlock(*job);
+        }
+    }
+}
+
+void TableSqlModel::updateSqlRowCount(int count)
+{
+    const int shownCount = m_shownRowCount;
+
+    if (count > shownCount) {
+        beginInsertRows({}, shownCount, count - 1);
+        setSqlRowCount(count);
+        endInsertRows();
+    } else if (count < shownCount) {
+        beginRemoveRows({}, count, shownCount - 1);
+        setSqlRowCount(count);
+        endRemoveRows();
+    } else {
+        setSqlRowCount(count);
+    }
+}
+
+void TableSqlModel::updateRowsBlock(const TableSqlJob &job)
+{
+    m_rowsBlock = job.rows();
+    m_rowsBlockFirst = job.firstRow();
+    m_rowsBlockCount = job.resultCount();
+    m_rowsBlockStale = false;
+
+    tableRow().invalidate();
+
+    // Replace the placeholder and stale rows
+    const int lastRow = qMin(m_rowsBlockFirst + m_rowsBlockCount, rowCount()) - 1;
+    if (lastRow < m_rowsBlockFirst)
+        return;
+
+    emit dataChanged(index(m_rowsBlockFirst, 0), index(lastRow, columnCount() - 1));
+}
+
+QStringList TableSqlModel::rowsBlockKeysetColumns() const
+{
+    if (sortColumn() == -1)
+        return {};
+
+    return sqlKeysetColumns();
+}
+
+QString TableSqlModel::sqlRowsBlock(const QVariantHash &vars) const
+{
+    const QStringList keysetColumns = rowsBlockKeysetColumns();
+    if (keysetColumns.isEmpty())
+        return sql();
+
+    const QString columnsStr = keysetColumns.join(", ");
+
+    // The keyset's values follow the row's columns
+    QString text = "SELECT *, " + columnsStr + " FROM (" + sqlBase() + sqlWhere() + ")";
+
+    if (vars.contains(":key1")) {
+        QStringList keys;
+        for (int i = 1; i <= keysetColumns.size(); ++i) {
+            keys << ":key" + QString::number(i);
+        }
+
+        text += QString(" WHERE (%1) %2 (%3)")
+                        .arg(columnsStr, isAscendingOrder() ? ">" : "<", keys.join(", "));
+    }
+
+    return text + sqlOrder() + sqlLimitOffset() + ';';
 }
 
 int TableSqlModel::doSqlCount() const
@@ -50,6 +370,15 @@ QString TableSqlModel::sqlCount() const
     return "SELECT COUNT(*) FROM (" + sqlBase() + sqlWhere() + ");";
 }
 
+void TableSqlModel::setSqlRowCount(int v) const
+{
+    m_sqlRowCount = v;
+
+    if (v >= 0) {
+        m_shownRowCount = v;
+    }
+}
+
 QString TableSqlModel::sql() const
 {
     return sqlBase() + sqlWhere() + sqlOrder() + sqlLimitOffset() + ';';
@@ -65,6 +394,10 @@ QString TableSqlModel::sqlOrder() const
     if (sortColumn() == -1)
         return QString();
 
+    const QStringList keysetColumns = sqlKeysetColumns();
+    if (!keysetColumns.isEmpty())
+        return " ORDER BY " + keysetColumns.join(sqlOrderAsc() + ", ") + sqlOrderAsc();
+
     return " ORDER BY " + sqlOrderColumn();
 }
 
@@ -80,5 +413,10 @@ QString TableSqlModel::sqlOrderColumn() const
 
 QString TableSqlModel::sqlLimitOffset() const
 {
-    return " LIMIT 1 OFFSET :offset";
+    return " LIMIT :limit OFFSET :offset";
+}
+
+QStringList TableSqlModel::sqlKeysetColumns() const
+{
+    return {};
 }
@@ -1,10 +1,19 @@
 #ifndef TABLESQLMODEL_H
 #define TABLESQLMODEL_H
 
+#include <QSharedPointer>
+
 #include <sqlite/sqlite_types.h>
 
 #include "tableitemmodel.h"
 
+class TableSqlJob;
+class TableSqlLoader;
+class TableSqlRows;
+
+using TableSqlRowsPtr = QSharedPointer<TableSqlRows>;
+using TableSqlJobPtr = QSharedPointer<TableSqlJob>;
+
 class TableSqlModel : public TableItemModel
 {
     Q_OBJECT
@@ -19,15 +28,35 @@ public:
 
     bool isAscendingOrder() const { return sortOrder() == Qt::AscendingOrder; }
 
+    bool isAsyncLoad() const { return m_sqlLoader != nullptr; }
+
     int rowCount(const QModelIndex &parent = QModelIndex()) const override;
 
     void sort(int column, Qt::SortOrder order = Qt::AscendingOrder) override;
 
 protected:
+    // Load the rows in the background by the separate read-only connection
+    void setupSqlLoader();
+
+    // Returns true, when the row's block is being loaded; the view shows a placeholder meanwhile
+    bool isRowLoading(int row) const;
+
     void invalidateRowCache() const override;
+    void invalidateRowCacheRange(int firstRow, int lastRow = INT_MAX) const;
 
     void fillQueryVarsForRow(QVariantHash &vars, int row) const override;
+    virtual void fillQueryVarsForRows(QVariantHash &vars, int firstRow, int count) const;
+
+    bool updateTableRow(const QVariantHash &vars, int row) const override;
 
+    virtual TableSqlRowsPtr createTableRows() const = 0;
+
+    // Load the block's row to the table row
+    virtual bool loadTableRow(const TableSqlRows &rows, int blockIndex) const = 0;
+
+    int rowsBlockFirst() const { return m_rowsBlockFirst; }
+
+    virtual bool isSqlCountAsync() const { return isAsyncLoad(); }
     virtual int doSqlCount() const;
     virtual QString sqlCount() const;
 
@@ -39,17 +68,61 @@ protected:
     virtual QString sqlOrderColumn() const;
     virtual QString sqlLimitOffset() const;
 
+    // Output columns of the sorted rows' order, the last one is unique;
+    // the next block is fetched after the previous block's last row by them
+    virtual QStringList sqlKeysetColumns() const;
+
     int sortColumn() const { return m_sortColumn; }
     void setSortColumn(int v) { m_sortColumn = v; }
 
     int sqlRowCount() const { return m_sqlRowCount; }
-    void setSqlRowCount(int v) const { m_sqlRowCount = v; }
+    void setSqlRowCount(int v) const;
+
+private:
+    bool isRowsBlockRow(int row) const;
+
+    int rowsBlockFirstRow(int row) const;
+
+    void fillQueryVarsForRowsBlock(QVariantHash &vars, int firstRow) const;
+
+    bool fetchRowsBlock(const QVariantHash &vars, int row) const;
+
+    void loadSqlCount() const;
+    void loadRowsBlock(const QVariantHash &vars, int row) const;
+
+    void cancelSqlJob(TableSqlJobPtr &job) const;
+    void cancelSqlJobs() const;
+
+    void onSqlJobFinished();
+
+    void updateSqlRowCount(int count);
+    void updateRowsBlock(const TableSqlJob &job);
+
+    QStringList rowsBlockKeysetColumns() const;
+
+    QString sqlRowsBlock(const QVariantHash &vars) const;
 
 private:
     int m_sortColumn = -1;
     Qt::SortOrder m_sortOrder = Qt::AscendingOrder;
 
     mutable int m_sqlRowCount = -1;
+    mutable int m_shownRowCount = 0; // while the count is loading
+
+    // Window of the cached rows
+    mutable int m_rowsBlockFirst = 0;
+    mutable int m_rowsBlockCount = 0;
+    mutable int m_rowsBlockFetchRow = 0; // to prefetch in the scroll direction
+
+    mutable bool m_rowsBlockStale = false; // shown, while the block is reloading
+    mutable bool m_rowsLoadAsync = false;
+
+    mutable TableSqlRowsPtr m_rowsBlock;
+
+    mutable TableSqlJobPtr m_sqlCountJob;
+    mutable TableSqlJobPtr m_rowsBlockJob;
+
+    TableSqlLoader *m_sqlLoader = nullptr;
 };
 
 #endif // TABLESQLMODEL_H
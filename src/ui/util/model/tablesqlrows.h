@@ -0,0 +1,74 @@
+#ifndef TABLESQLROWS_H
+#define TABLESQLROWS_H
+
+#include <QVariantList>
+#include <QVector>
+
+#include <sqlite/sqlitestmt.h>
+
+// Block of the fetched rows, may be filled by the loader's worker
+class TableSqlRows
+{
+public:
+    virtual ~TableSqlRows() = default;
+
+    // Count of the keyset's columns, selected after the row's columns
+    void setKeysetCount(int v) { m_keysetCount = v; }
+
+    QVariantList keysetAt(int index) const { return m_keysets.value(index); }
+
+    // Read the stepped rows of the block, returns the rows count
+    virtual int fetchRows(SqliteStmt &stmt) = 0;
+
+protected:
+    void fetchKeyset(SqliteStmt &stmt)
+    {
+        if (m_keysetCount == 0)
+            return;
+
+        const int columnCount = stmt.columnCount();
+
+        QVariantList keyset;
+        for (int column = columnCount - m_keysetCount; column < columnCount; ++column) {
+            keyset.append(stmt.columnVar(column));
+        }
+
+        m_keysets.append(keyset);
+    }
+
+private:
+    int m_keysetCount = 0;
+
+    QVector<QVariantList> m_keysets;
+};
+
+template<typename T>
+class TableSqlRowList : public TableSqlRows
+{
+public:
+    using FillRowFunc = void (*)(T &row, SqliteStmt &stmt);
+
+    explicit TableSqlRowList(FillRowFunc fillRow) : m_fillRow(fillRow) { }
+
+    const T &at(int index) const { return m_rows.at(index); }
+
+    int fetchRows(SqliteStmt &stmt) override
+    {
+        while (stmt.step() == SqliteStmt::StepRow) {
+            T row;
+            m_fillRow(row, stmt);
+            fetchKeyset(stmt);
+
+            m_rows.append(row);
+        }
+
+        return m_rows.size();
+    }
+
+private:
+    FillRowFunc m_fillRow = nullptr;
+
+    QVector<T> m_rows;
+};
+
+#endif // TABLESQLROWS_H